@@ -0,0 +1,323 @@
+/***************************************
+ Functions for encoding and decoding compressed blocks of nodes and segments.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <string.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+
+#include "blocks.h"
+
+
+/* Local functions */
+
+static inline unsigned char *put_varint(unsigned char *p,uint32_t value);
+static inline const unsigned char *get_varint(const unsigned char *p,uint32_t *value);
+
+static inline unsigned char *put_delta(unsigned char *p,uint32_t value,uint32_t previous);
+static inline const unsigned char *get_delta(const unsigned char *p,uint32_t *value,uint32_t previous);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compress a block of nodes.
+
+  int EncodeNodeBlock Returns the number of bytes of compressed data.
+
+  unsigned char *buffer The buffer to write into (at least BLOCK_MAX_BYTES long).
+
+  const Node *nodes The nodes to compress.
+
+  int count The number of nodes (no more than BLOCK_SIZE).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int EncodeNodeBlock(unsigned char *buffer,const Node *nodes,int count)
+{
+ unsigned char *p=buffer;
+ Node prev={0};
+ int i;
+
+ for(i=0;i<count;i++)
+   {
+    p=put_delta(p,nodes[i].firstseg,prev.firstseg);
+    p=put_delta(p,nodes[i].allow   ,prev.allow);
+    p=put_delta(p,nodes[i].flags   ,prev.flags);
+
+    prev=nodes[i];
+   }
+
+ return((int)(p-buffer));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decompress a block of nodes.
+
+  const unsigned char *buffer The compressed data.
+
+  Node *nodes The array of nodes to fill in.
+
+  int count The number of nodes in the block.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DecodeNodeBlock(const unsigned char *buffer,Node *nodes,int count)
+{
+ const unsigned char *p=buffer;
+ uint32_t firstseg=0,allow=0,flags=0;
+ int i;
+
+ for(i=0;i<count;i++)
+   {
+    p=get_delta(p,&firstseg,firstseg);
+    p=get_delta(p,&allow   ,allow);
+    p=get_delta(p,&flags   ,flags);
+
+    nodes[i].firstseg=firstseg;
+    nodes[i].allow   =(transports_t)allow;
+    nodes[i].flags   =(nodeflags_t)flags;
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compress a block of segments (the second node is stored relative to the first and the flags are moved to the bottom of the distance).
+
+  int EncodeSegmentBlock Returns the number of bytes of compressed data.
+
+  unsigned char *buffer The buffer to write into (at least BLOCK_MAX_BYTES long).
+
+  const Segment *segments The segments to compress.
+
+  int count The number of segments (no more than BLOCK_SIZE).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int EncodeSegmentBlock(unsigned char *buffer,const Segment *segments,int count)
+{
+ unsigned char *p=buffer;
+ Segment prev={0};
+ int i;
+
+ for(i=0;i<count;i++)
+   {
+    p=put_delta(p,segments[i].node1,prev.node1);
+    p=put_delta(p,segments[i].node2,segments[i].node1);
+    p=put_delta(p,segments[i].next2,prev.next2);
+    p=put_delta(p,segments[i].way  ,prev.way);
+
+    p=put_varint(p,(uint32_t)(DISTANCE(segments[i].distance)<<5)|(segments[i].distance>>27));
+
+    prev=segments[i];
+   }
+
+ return((int)(p-buffer));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decompress a block of segments.
+
+  const unsigned char *buffer The compressed data.
+
+  Segment *segments The array of segments to fill in.
+
+  int count The number of segments in the block.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DecodeSegmentBlock(const unsigned char *buffer,Segment *segments,int count)
+{
+ const unsigned char *p=buffer;
+ uint32_t node1=0,node2,next2=0,way=0,distance;
+ int i;
+
+ for(i=0;i<count;i++)
+   {
+    p=get_delta(p,&node1,node1);
+    p=get_delta(p,&node2,node1);
+    p=get_delta(p,&next2,next2);
+    p=get_delta(p,&way  ,way);
+
+    p=get_varint(p,&distance);
+
+    segments[i].node1   =node1;
+    segments[i].node2   =node2;
+    segments[i].next2   =next2;
+    segments[i].way     =way;
+    segments[i].distance=(distance>>5)|(distance<<27);
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decompress all of the blocks of nodes from a memory mapped file.
+
+  const char *DecodeAllNodeBlocks Returns a pointer to the byte after the compressed data.
+
+  const char *data The block index followed by the compressed data.
+
+  Node *nodes The array of nodes to fill in.
+
+  index_t number The number of nodes in total.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+const char *DecodeAllNodeBlocks(const char *data,Node *nodes,index_t number)
+{
+ const char *blocks=data+BlockIndexSize(number);
+ offset_t offset;
+ index_t i;
+
+ for(i=0;i<number;i+=BLOCK_SIZE)
+   {
+    memcpy(&offset,data+(i/BLOCK_SIZE)*sizeof(offset_t),sizeof(offset_t));
+
+    DecodeNodeBlock((const unsigned char*)blocks+offset,&nodes[i],(number-i)<BLOCK_SIZE?(int)(number-i):BLOCK_SIZE);
+   }
+
+ memcpy(&offset,blocks-sizeof(offset_t),sizeof(offset_t));
+
+ return(blocks+offset);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decompress all of the blocks of segments from a memory mapped file.
+
+  const char *DecodeAllSegmentBlocks Returns a pointer to the byte after the compressed data.
+
+  const char *data The block index followed by the compressed data.
+
+  Segment *segments The array of segments to fill in.
+
+  index_t number The number of segments in total.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+const char *DecodeAllSegmentBlocks(const char *data,Segment *segments,index_t number)
+{
+ const char *blocks=data+BlockIndexSize(number);
+ offset_t offset;
+ index_t i;
+
+ for(i=0;i<number;i+=BLOCK_SIZE)
+   {
+    memcpy(&offset,data+(i/BLOCK_SIZE)*sizeof(offset_t),sizeof(offset_t));
+
+    DecodeSegmentBlock((const unsigned char*)blocks+offset,&segments[i],(number-i)<BLOCK_SIZE?(int)(number-i):BLOCK_SIZE);
+   }
+
+ memcpy(&offset,blocks-sizeof(offset_t),sizeof(offset_t));
+
+ return(blocks+offset);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write an unsigned integer using a variable number of bytes (seven bits per byte, least significant first).
+
+  unsigned char *put_varint Returns a pointer to the byte after the ones written.
+
+  unsigned char *p The place to write the bytes.
+
+  uint32_t value The value to write.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline unsigned char *put_varint(unsigned char *p,uint32_t value)
+{
+ while(value>=0x80)
+   {
+    *p++=(unsigned char)(value|0x80);
+    value>>=7;
+   }
+
+ *p++=(unsigned char)value;
+
+ return(p);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read an unsigned integer stored using a variable number of bytes.
+
+  const unsigned char *get_varint Returns a pointer to the byte after the ones read.
+
+  const unsigned char *p The place to read the bytes from.
+
+  uint32_t *value Returns the value that was read.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline const unsigned char *get_varint(const unsigned char *p,uint32_t *value)
+{
+ uint32_t result=*p&0x7f;
+ int shift=7;
+
+ while(*p++&0x80)
+   {
+    result|=(uint32_t)(*p&0x7f)<<shift;
+    shift+=7;
+   }
+
+ *value=result;
+
+ return(p);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write the signed difference between two values (zig-zag encoded so that small negative numbers are short).
+
+  unsigned char *put_delta Returns a pointer to the byte after the ones written.
+
+  unsigned char *p The place to write the bytes.
+
+  uint32_t value The value to write.
+
+  uint32_t previous The value that it is relative to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline unsigned char *put_delta(unsigned char *p,uint32_t value,uint32_t previous)
+{
+ uint32_t delta=value-previous;
+
+ return(put_varint(p,(delta<<1)^(uint32_t)-(int32_t)(delta>>31)));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read the signed difference between two values and apply it.
+
+  const unsigned char *get_delta Returns a pointer to the byte after the ones read.
+
+  const unsigned char *p The place to read the bytes from.
+
+  uint32_t *value Returns the value that was read.
+
+  uint32_t previous The value that it is relative to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline const unsigned char *get_delta(const unsigned char *p,uint32_t *value,uint32_t previous)
+{
+ uint32_t zigzag;
+
+ p=get_varint(p,&zigzag);
+
+ *value=previous+((zigzag>>1)^(uint32_t)-(int32_t)(zigzag&1));
+
+ return(p);
+}
@@ -0,0 +1,189 @@
+/***************************************
+ Header file for compressed blocks of nodes and segments.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef BLOCKS_H
+#define BLOCKS_H    /*+ To stop multiple inclusions. +*/
+
+#include <stdint.h>
+
+#include "types.h"
+
+#include "files.h"
+#include "cache.h"
+
+
+/* Constants */
+
+/*+ The number of nodes or segments in each compressed block. +*/
+#define BLOCK_SIZE 64
+
+/*+ The largest number of bytes needed for a compressed block (five fields of up to five bytes each). +*/
+#define BLOCK_MAX_BYTES (BLOCK_SIZE*5*5)
+
+
+/* Functions in blocks.c */
+
+int EncodeNodeBlock(unsigned char *buffer,const Node *nodes,int count);
+void DecodeNodeBlock(const unsigned char *buffer,Node *nodes,int count);
+
+int EncodeSegmentBlock(unsigned char *buffer,const Segment *segments,int count);
+void DecodeSegmentBlock(const unsigned char *buffer,Segment *segments,int count);
+
+const char *DecodeAllNodeBlocks(const char *data,Node *nodes,index_t number);
+const char *DecodeAllSegmentBlocks(const char *data,Segment *segments,index_t number);
+
+/*+ Return the size of the index of compressed blocks for a number of nodes or segments. +*/
+#define BlockIndexSize(xxx)   ((((offset_t)(xxx)+BLOCK_SIZE-1)/BLOCK_SIZE+1)*sizeof(offset_t))
+
+
+#if SLIM
+
+/* Macros for constants */
+
+#define BLOCKCACHEWIDTH 512     /*+ The default number of decoded blocks in the cache. +*/
+
+
+/* Macro for structure declaration */
+
+/*+ A macro to create a cache structure for decoded blocks. +*/
+#define BLOCKCACHE_STRUCTURE(type) \
+                                   \
+struct _##type##BlockCache                                                             \
+{                                                                                      \
+ CacheStatistics stats;                         /*+ The statistics of the cache. +*/   \
+                                                                                       \
+ index_t       number;                          /*+ The number of items in total. +*/  \
+                                                                                       \
+ int           width;                           /*+ The number of cache entries. +*/   \
+                                                                                       \
+ index_t      *blocks;                          /*+ The block in each cache entry. +*/ \
+                                                                                       \
+ type        (*data)[BLOCK_SIZE];               /*+ The decoded items. +*/             \
+                                                                                       \
+ unsigned char buffer[BLOCK_MAX_BYTES];         /*+ The compressed data. +*/           \
+};
+
+
+/* Macros for function prototypes */
+
+#define BLOCKCACHE_NEWCACHE_PROTO(type) static inline type##BlockCache *New##type##BlockCache(index_t number,size_t size);
+
+#define BLOCKCACHE_DELETECACHE_PROTO(type) static inline void Delete##type##BlockCache(type##BlockCache *cache);
+
+#define BLOCKCACHE_FETCHCACHE_PROTO(type) static inline type *FetchBlockCached##type(type##BlockCache *cache,index_t index,int fd,offset_t indexoffset,offset_t dataoffset);
+
+
+/* Macros for function definitions */
+
+/*+ A macro to create a function that creates a new block cache data structure (the largest that fits in the size or the default if zero). +*/
+#define BLOCKCACHE_NEWCACHE(type) \
+                                  \
+static inline type##BlockCache *New##type##BlockCache(index_t number,size_t size) \
+{                                                                     \
+ type##BlockCache *cache;                                             \
+ size_t entrysize=BLOCK_SIZE*sizeof(type)+sizeof(index_t);            \
+ int width=BLOCKCACHEWIDTH;                                           \
+ char *p;                                                             \
+ int i;                                                               \
+                                                                      \
+ if(size)                                                             \
+   {                                                                  \
+    width=1;                                                          \
+                                                                      \
+    while(width<(1<<20) && (sizeof(type##BlockCache)+2*width*entrysize)<=size) \
+       width*=2;                                                      \
+   }                                                                  \
+                                                                      \
+ size=sizeof(type##BlockCache)+width*entrysize;                       \
+                                                                      \
+ p=(char*)malloc(size);                                               \
+                                                                      \
+ cache=(type##BlockCache*)p;           p+=sizeof(type##BlockCache);   \
+ cache->data=(type(*)[BLOCK_SIZE])p;   p+=width*BLOCK_SIZE*sizeof(type); \
+ cache->blocks=(index_t*)p;                                           \
+                                                                      \
+ cache->number=number;                                                \
+ cache->width=width;                                                  \
+                                                                      \
+ cache->stats.hits=cache->stats.misses=cache->stats.evictions=0;      \
+ cache->stats.size=size;                                              \
+                                                                      \
+ for(i=0;i<width;i++)                                                 \
+    cache->blocks[i]=NO_NODE;                                         \
+                                                                      \
+ return(cache);                                                       \
+}
+
+
+/*+ A macro to create a function that deletes a block cache data structure. +*/
+#define BLOCKCACHE_DELETECACHE(type) \
+                                     \
+static inline void Delete##type##BlockCache(type##BlockCache *cache) \
+{                                                                    \
+ free(cache);                                                        \
+}
+
+
+/*+ A macro to create a function that fetches an item from a block cache data structure or reads and decodes a block from file. +*/
+#define BLOCKCACHE_FETCHCACHE(type) \
+                                    \
+static inline type *FetchBlockCached##type(type##BlockCache *cache,index_t index,int fd,offset_t indexoffset,offset_t dataoffset) \
+{                                                                                                         \
+ index_t block=index/BLOCK_SIZE;                                                                          \
+ int slot=block&(cache->width-1);                                                                         \
+                                                                                                          \
+ if(cache->blocks[slot]!=block)                                                                           \
+   {                                                                                                      \
+    offset_t offsets[2];                                                                                  \
+    index_t count=cache->number-block*BLOCK_SIZE;                                                         \
+                                                                                                          \
+    if(count>BLOCK_SIZE)                                                                                  \
+       count=BLOCK_SIZE;                                                                                  \
+                                                                                                          \
+    cache->stats.misses++;                                                                                \
+                                                                                                          \
+    if(cache->blocks[slot]!=NO_NODE)                                                                      \
+       cache->stats.evictions++;                                                                          \
+                                                                                                          \
+    SlimFetch(fd,offsets,sizeof(offsets),indexoffset+(offset_t)block*sizeof(offset_t));                   \
+                                                                                                          \
+    SlimFetch(fd,cache->buffer,(size_t)(offsets[1]-offsets[0]),dataoffset+offsets[0]);                    \
+                                                                                                          \
+    Decode##type##Block(cache->buffer,cache->data[slot],count);                                           \
+                                                                                                          \
+    cache->blocks[slot]=block;                                                                            \
+   }                                                                                                      \
+ else                                                                                                     \
+    cache->stats.hits++;                                                                                  \
+                                                                                                          \
+ return(&cache->data[slot][index%BLOCK_SIZE]);                                                            \
+}
+
+
+/*+ Block cache data structure forward declarations (for router). +*/
+typedef struct _NodeBlockCache NodeBlockCache;
+typedef struct _SegmentBlockCache SegmentBlockCache;
+
+#endif /* SLIM */
+
+
+#endif /* BLOCKS_H */
@@ -26,16 +26,43 @@
 #define CACHE_H    /*+ To stop multiple inclusions. +*/
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "types.h"
 
 
 /* Macros for constants */
 
-#define CACHEWIDTH 8192         /*+ The width of the cache. +*/
+#define CACHEWIDTH 8192         /*+ The default width of the cache. +*/
 #define CACHEDEPTH   16         /*+ The depth of the cache. +*/
 
 
+/* Data types */
+
+/*+ A structure containing the statistics of a cache. +*/
+typedef struct _CacheStatistics
+{
+ uint64_t hits;                 /*+ The number of items found in the cache. +*/
+ uint64_t misses;               /*+ The number of items read from the file. +*/
+ uint64_t evictions;            /*+ The number of items removed from the cache to make space. +*/
+
+ size_t   size;                 /*+ The amount of memory used by the cache. +*/
+}
+ CacheStatistics;
+
+
+/* Variables */
+
+/*+ The amount of data to read from file for each cache miss in slim mode (or 0 to read one item). +*/
+extern size_t option_cache_block;
+
+/*+ The option to ask the operating system to read ahead of each block read for a cache miss. +*/
+extern int option_cache_readahead;
+
+/*+ Return the amount of memory for a cache given the total for the database and the percentage of it that the cache should use (or 0 for the default). +*/
+#define CacheShare(size,percent) ((size)*(percent)/100)
+
+
 /* Macro for structure forward declaration */
 
 #define CACHE_STRUCTURE_FWD(type) typedef struct _##type##Cache type##Cache;
@@ -46,18 +73,25 @@
 /*+ A macro to create a cache structure. +*/
 #define CACHE_STRUCTURE(type) \
                               \
-struct _##type##Cache                                                     \
-{                                                                         \
- int     first  [CACHEWIDTH];             /*+ The first entry to fill +*/ \
-                                                                          \
- type    data   [CACHEWIDTH][CACHEDEPTH]; /*+ The array of type##s. +*/   \
- index_t indices[CACHEWIDTH][CACHEDEPTH]; /*+ The array of indexes. +*/   \
+struct _##type##Cache                                                                   \
+{                                                                                       \
+ CacheStatistics stats;           /*+ The statistics of the cache. +*/                  \
+                                                                                        \
+ int       width;                 /*+ The width of the cache (a power of two). +*/      \
+                                                                                        \
+ type     *data;                  /*+ The array of type##s (width x depth). +*/         \
+ index_t  *indices;               /*+ The array of indexes (width x depth). +*/         \
+ uint16_t *referenced;            /*+ The flags for the recently used entries in each row. +*/ \
+ uint8_t  *hand;                  /*+ The next entry to consider replacing in each row. +*/ \
+                                                                                        \
+ int       block;                 /*+ The number of type##s read from file at once. +*/ \
+ type     *buffer;                /*+ The buffer for reading a block of type##s. +*/    \
 };
 
 
 /* Macros for function prototypes */
 
-#define CACHE_NEWCACHE_PROTO(type) static inline type##Cache *New##type##Cache(void);
+#define CACHE_NEWCACHE_PROTO(type) static inline type##Cache *New##type##Cache(size_t size,size_t blocksize);
 
 #define CACHE_DELETECACHE_PROTO(type) static inline void Delete##type##Cache(type##Cache *cache);
 
@@ -67,21 +101,52 @@ struct _##type##Cache                                                     \
 
 #define CACHE_INVALIDATECACHE_PROTO(type) static inline void Invalidate##type##Cache(type##Cache *cache);
 
+#define CACHE_CHOOSEVICTIM_PROTO(type) static inline int Choose##type##CacheVictim(type##Cache *cache,int row);
+
 
 /* Macros for function definitions */
 
-/*+ A macro to create a function that creates a new cache data structure. +*/
+/*+ A macro to create a function that creates a new cache data structure (the largest that fits in the size or the default if zero) that reads blocks of the given size. +*/
 #define CACHE_NEWCACHE(type) \
                              \
-static inline type##Cache *New##type##Cache(void)       \
-{                                                       \
- type##Cache *cache;                                    \
-                                                        \
- cache=(type##Cache*)malloc(sizeof(type##Cache));       \
-                                                        \
- Invalidate##type##Cache(cache);                        \
-                                                        \
- return(cache);                                         \
+static inline type##Cache *New##type##Cache(size_t size,size_t blocksize)                \
+{                                                                                        \
+ type##Cache *cache;                                                                     \
+ size_t rowsize=CACHEDEPTH*(sizeof(type)+sizeof(index_t))+sizeof(uint16_t)+sizeof(uint8_t); \
+ int width=CACHEWIDTH,block=1;                                                           \
+ char *p;                                                                                \
+                                                                                         \
+ if(size)                                                                                \
+   {                                                                                     \
+    width=1;                                                                             \
+                                                                                         \
+    while(width<(1<<24) && (sizeof(type##Cache)+2*width*rowsize)<=size)                  \
+       width*=2;                                                                         \
+   }                                                                                     \
+                                                                                         \
+ while(block<width && 2*block*sizeof(type)<=blocksize)                                   \
+    block*=2;                                                                            \
+                                                                                         \
+ size=sizeof(type##Cache)+width*rowsize+block*sizeof(type);                              \
+                                                                                         \
+ p=(char*)malloc(size);                                                                  \
+                                                                                         \
+ cache=(type##Cache*)p;                          p+=sizeof(type##Cache);                 \
+ cache->data      =(type*)p;                     p+=width*CACHEDEPTH*sizeof(type);       \
+ cache->buffer    =(type*)p;                     p+=block*sizeof(type);                  \
+ cache->indices   =(index_t*)p;                  p+=width*CACHEDEPTH*sizeof(index_t);    \
+ cache->referenced=(uint16_t*)p;                 p+=width*sizeof(uint16_t);              \
+ cache->hand      =(uint8_t*)p;                                                          \
+                                                                                         \
+ cache->width=width;                                                                     \
+ cache->block=block;                                                                     \
+                                                                                         \
+ cache->stats.hits=cache->stats.misses=cache->stats.evictions=0;                         \
+ cache->stats.size=size;                                                                 \
+                                                                                         \
+ Invalidate##type##Cache(cache);                                                         \
+                                                                                         \
+ return(cache);                                                                          \
 }
 
 
@@ -94,27 +159,80 @@ static inline void Delete##type##Cache(type##Cache *cache)      \
 }
 
 
-/*+ A macro to create a function that fetches an item from a cache data structure or reads from file. +*/
+/*+ A macro to create a function that fetches an item from a cache data structure or reads the block containing it from file. +*/
 #define CACHE_FETCHCACHE(type) \
                                \
 static inline type *FetchCached##type(type##Cache *cache,index_t index,int fd,offset_t offset) \
 {                                                                                           \
- int row=index%CACHEWIDTH;                                                                  \
+ int row=index&(cache->width-1);                                                            \
  int col;                                                                                   \
+ int entry;                                                                                 \
+ index_t first,i,n;                                                                         \
+ size_t length;                                                                             \
                                                                                             \
  for(col=0;col<CACHEDEPTH;col++)                                                            \
-    if(cache->indices[row][col]==index)                                                     \
-       return(&cache->data[row][col]);                                                      \
+    if(cache->indices[row*CACHEDEPTH+col]==index)                                           \
+      {                                                                                     \
+       cache->referenced[row]|=1<<col;                                                      \
+                                                                                            \
+       cache->stats.hits++;                                                                 \
+                                                                                            \
+       return(&cache->data[row*CACHEDEPTH+col]);                                            \
+      }                                                                                     \
+                                                                                            \
+ cache->stats.misses++;                                                                     \
+                                                                                            \
+ /* Read the whole aligned block and insert the other items (unreferenced) into the cache */ \
                                                                                             \
- col=cache->first[row];                                                                     \
+ if(cache->block>1)                                                                         \
+   {                                                                                        \
+    first=index&~(index_t)(cache->block-1);                                                 \
+    length=cache->block*sizeof(type);                                                       \
                                                                                             \
- cache->first[row]=(cache->first[row]+1)%CACHEDEPTH;                                        \
+    n=(index_t)(SlimFetchBlock(fd,cache->buffer,length,offset+(offset_t)first*sizeof(type))/sizeof(type)); \
                                                                                             \
- SlimFetch(fd,&cache->data[row][col],sizeof(type),offset+(offset_t)index*sizeof(type));     \
+    if(option_cache_readahead)                                                              \
+       SlimReadahead(fd,length,offset+(offset_t)(first+cache->block)*sizeof(type));         \
                                                                                             \
- cache->indices[row][col]=index;                                                            \
+    if(index<first+n)                                                                       \
+      {                                                                                     \
+       for(i=0;i<n;i++)                                                                     \
+         {                                                                                  \
+          int r=(first+i)&(cache->width-1);                                                 \
                                                                                             \
- return(&cache->data[row][col]);                                                            \
+          if(first+i==index)                                                                \
+             continue;                                                                      \
+                                                                                            \
+          for(col=0;col<CACHEDEPTH;col++)                                                   \
+             if(cache->indices[r*CACHEDEPTH+col]==first+i)                                  \
+                break;                                                                      \
+                                                                                            \
+          if(col<CACHEDEPTH)                                                                \
+             continue;                                                                      \
+                                                                                            \
+          entry=r*CACHEDEPTH+Choose##type##CacheVictim(cache,r);                            \
+                                                                                            \
+          cache->data[entry]=cache->buffer[i];                                              \
+          cache->indices[entry]=first+i;                                                    \
+         }                                                                                  \
+                                                                                            \
+       entry=row*CACHEDEPTH+Choose##type##CacheVictim(cache,row);                           \
+                                                                                            \
+       cache->data[entry]=cache->buffer[index-first];                                       \
+       cache->indices[entry]=index;                                                         \
+                                                                                            \
+       return(&cache->data[entry]);                                                         \
+      }                                                                                     \
+   }                                                                                        \
+                                                                                            \
+ col=Choose##type##CacheVictim(cache,row);                                                  \
+ entry=row*CACHEDEPTH+col;                                                                  \
+                                                                                            \
+ SlimFetch(fd,&cache->data[entry],sizeof(type),offset+(offset_t)index*sizeof(type));        \
+                                                                                            \
+ cache->indices[entry]=index;                                                               \
+                                                                                            \
+ return(&cache->data[entry]);                                                               \
 }
 
 
@@ -123,25 +241,49 @@ static inline type *FetchCached##type(type##Cache *cache,index_t index,int fd,of
                                  \
 static inline void ReplaceCached##type(type##Cache *cache,type *value,index_t index,int fd,offset_t offset) \
 {                                                                                                        \
- int row=index%CACHEWIDTH;                                                                               \
+ int row=index&(cache->width-1);                                                                         \
  int col;                                                                                                \
+ int entry;                                                                                              \
                                                                                                          \
  for(col=0;col<CACHEDEPTH;col++)                                                                         \
-    if(cache->indices[row][col]==index)                                                                  \
+    if(cache->indices[row*CACHEDEPTH+col]==index)                                                        \
        break;                                                                                            \
                                                                                                          \
  if(col==CACHEDEPTH)                                                                                     \
-   {                                                                                                     \
-    col=cache->first[row];                                                                               \
+    col=Choose##type##CacheVictim(cache,row);                                                            \
+ else                                                                                                    \
+    cache->referenced[row]|=1<<col;                                                                      \
                                                                                                          \
-    cache->first[row]=(cache->first[row]+1)%CACHEDEPTH;                                                  \
-   }                                                                                                     \
+ entry=row*CACHEDEPTH+col;                                                                               \
                                                                                                          \
- cache->indices[row][col]=index;                                                                         \
+ cache->indices[entry]=index;                                                                            \
                                                                                                          \
- cache->data[row][col]=*value;                                                                           \
+ cache->data[entry]=*value;                                                                              \
                                                                                                          \
- SlimReplace(fd,&cache->data[row][col],sizeof(type),offset+(offset_t)index*sizeof(type));                \
+ SlimReplace(fd,&cache->data[entry],sizeof(type),offset+(offset_t)index*sizeof(type));                   \
+}
+
+
+/*+ A macro to create a function that chooses the entry in a row to replace using the CLOCK algorithm
+    (entries used since the hand last passed them are skipped once, new entries start unused). +*/
+#define CACHE_CHOOSEVICTIM(type) \
+                                 \
+static inline int Choose##type##CacheVictim(type##Cache *cache,int row) \
+{                                                                       \
+ int col=cache->hand[row];                                              \
+                                                                        \
+ while(cache->referenced[row]&(1<<col))                                 \
+   {                                                                    \
+    cache->referenced[row]&=~(1<<col);                                  \
+    col=(col+1)%CACHEDEPTH;                                             \
+   }                                                                    \
+                                                                        \
+ cache->hand[row]=(col+1)%CACHEDEPTH;                                   \
+                                                                        \
+ if(cache->indices[row*CACHEDEPTH+col]!=NO_NODE)                        \
+    cache->stats.evictions++;                                           \
+                                                                        \
+ return(col);                                                           \
 }
 
 
@@ -152,12 +294,13 @@ static inline void Invalidate##type##Cache(type##Cache *cache) \
 {                                                              \
  int row,col;                                                  \
                                                                \
- for(row=0;row<CACHEWIDTH;row++)                               \
+ for(row=0;row<cache->width;row++)                             \
    {                                                           \
-    cache->first[row]=0;                                       \
+    cache->hand[row]=0;                                        \
+    cache->referenced[row]=0;                                  \
                                                                \
     for(col=0;col<CACHEDEPTH;col++)                            \
-       cache->indices[row][col]=NO_NODE;                       \
+       cache->indices[row*CACHEDEPTH+col]=NO_NODE;             \
    }                                                           \
 }
 
@@ -169,6 +312,7 @@ CACHE_STRUCTURE_FWD(WayX)
 
 /*+ Cache data structure forward declarations (for router). +*/
 CACHE_STRUCTURE_FWD(Node)
+CACHE_STRUCTURE_FWD(NodePosition)
 CACHE_STRUCTURE_FWD(Segment)
 CACHE_STRUCTURE_FWD(Way)
 CACHE_STRUCTURE_FWD(TurnRelation)
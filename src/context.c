@@ -0,0 +1,75 @@
+/***************************************
+ Routing context data type functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "hierarchy.h"
+
+#include "context.h"
+#include "fakes.h"
+#include "results.h"
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Allocate a new routing context.
+
+  Context *NewContext Returns the context.
+
+  Hierarchy *hierarchy The contraction hierarchy of the database (or NULL if there is none).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Context *NewContext(Hierarchy *hierarchy)
+{
+ Context *context;
+
+ context=(Context*)calloc(1,sizeof(Context));
+
+ DeleteFakeNodes(&context->fakes);
+
+ context->pool.queue_type=QUEUE_TYPE_DEFAULT;
+
+ if(hierarchy)
+    context->hierarchy=CopyHierarchy(hierarchy);
+
+ return(context);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Free a routing context.
+
+  Context *context The context to be freed.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void FreeContext(Context *context)
+{
+ if(context->hierarchy)
+    DestroyHierarchy(context->hierarchy);
+
+ FreeResultsPool(&context->pool);
+
+ if(context->dirname)
+    free(context->dirname);
+
+ free(context);
+}
@@ -0,0 +1,88 @@
+/***************************************
+ Header file for the routing context data type.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef CONTEXT_H
+#define CONTEXT_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "fakes.h"
+#include "results.h"
+
+#include "routino.h"
+
+
+/* Data structures */
+
+
+/*+ A structure containing everything that changes while calculating a route so
+    that several routes can be calculated at the same time using one database
+    (it is also the opaque Routino_Context type of the library). +*/
+struct _Routino_Context
+{
+ Fakes        fakes;            /*+ The fake nodes and segments for the waypoints. +*/
+
+ Hierarchy   *hierarchy;        /*+ A private copy of the contraction hierarchy for the customised scores (or NULL). +*/
+
+ ResultsPool  pool;             /*+ The results lists and queues kept for re-use by the next route calculation. +*/
+
+ int          quickest;         /*+ Set to calculate the quickest route instead of the shortest. +*/
+ int          bidirectional;    /*+ Set to search for normal routes in both directions at once. +*/
+
+ int          file_html;        /*+ Set to write an HTML file. +*/
+ int          file_gpx_track;   /*+ Set to write a GPX track file. +*/
+ int          file_gpx_route;   /*+ Set to write a GPX route file. +*/
+ int          file_text;        /*+ Set to write a plain text file. +*/
+ int          file_text_all;    /*+ Set to write a plain text file with all nodes. +*/
+ int          file_stdout;      /*+ Set to write the single selected file to stdout. +*/
+
+ char        *dirname;          /*+ The directory to write the output files into (or NULL for the current directory). +*/
+
+ int          list_html;        /*+ Set to create a linked list of HTML instructions. +*/
+ int          list_html_all;    /*+ Set to create a linked list of HTML instructions with all nodes. +*/
+ int          list_text;        /*+ Set to create a linked list like the plain text file. +*/
+ int          list_text_all;    /*+ Set to create a linked list like the plain text file with all nodes. +*/
+
+ Routino_ProgressFunc progress_func; /*+ The function to be called to report on the routing progress. +*/
+ double       progress_value;   /*+ The current state of the routing progress. +*/
+ int          progress_abort;   /*+ Set when the progress callback returns false in the routing function. +*/
+
+ int          normal_checked;   /*+ The number of nodes checked in the normal routes (for the progress messages). +*/
+
+#ifdef LIBROUTINO
+
+ Routino_Database *database;    /*+ The database that the context was created for. +*/
+
+ int          error;            /*+ The error number of the most recent function that used this context. +*/
+
+#endif
+};
+
+
+/* Functions in context.c */
+
+Context *NewContext(Hierarchy *hierarchy);
+
+void FreeContext(Context *context);
+
+
+#endif /* CONTEXT_H */
@@ -41,6 +41,11 @@ ErrorLogs *LoadErrorLogs(const char *filename)
 {
  ErrorLogs *errorlogs;
 
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,ERRORLOGS_MAGIC))
+    return(NULL);
+
  errorlogs=(ErrorLogs*)malloc(sizeof(ErrorLogs));
 
 #if !SLIM
@@ -47,6 +47,9 @@ typedef struct _ErrorLog
 /*+ A structure containing the header from the error log file. +*/
 typedef struct _ErrorLogsFile
 {
+ uint32_t magic;                /*+ The magic number that identifies the type of file. +*/
+ uint32_t version;              /*+ The version of the file format. +*/
+
  index_t  number;               /*+ The total number of error messages. +*/
  index_t  number_geo;           /*+ The number of error messages with a geographical location. +*/
  index_t  number_nongeo;        /*+ The number of error messages without a geographical location. +*/
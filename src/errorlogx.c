@@ -818,7 +818,7 @@ static int measure_lat_long(ErrorLogX *errorlogx,index_t index)
 
 void SaveErrorLogs(ErrorLogsX *errorlogsx,char *filename)
 {
- ErrorLogsFile errorlogsfile;
+ ErrorLogsFile errorlogsfile={0};
  ErrorLogX errorlogx;
  int oldfd,newfd;
  ll_bin2_t latlonbin=0,maxlatlonbins;
@@ -960,6 +960,9 @@ void SaveErrorLogs(ErrorLogsX *errorlogsx,char *filename)
 
  /* Write out the header structure */
 
+ errorlogsfile.magic=ERRORLOGS_MAGIC;
+ errorlogsfile.version=DATABASE_VERSION;
+
  errorlogsfile.number       =number;
  errorlogsfile.number_geo   =number_geo;
  errorlogsfile.number_nongeo=number_nongeo;
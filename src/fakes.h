@@ -24,6 +24,24 @@
 #define FAKES_H    /*+ To stop multiple inclusions. +*/
 
 #include "types.h"
+#include "segments.h"
+
+
+/* Data structures */
+
+
+/*+ A structure containing the fake nodes and segments that are used for the waypoints of a route. +*/
+struct _Fakes
+{
+ Segment  fake_segments[4*NWAYPOINTS+1]; /*+ A set of fake segments to allow start/finish in the middle of a segment. +*/
+
+ index_t  real_segments[4*NWAYPOINTS+1]; /*+ A set of pointers to the real segments underlying the fake segments. +*/
+
+ double   fake_lon[NWAYPOINTS+1];        /*+ A set of fake node longitudes. +*/
+ double   fake_lat[NWAYPOINTS+1];        /*+ A set of fake node latitudes. +*/
+
+ int      prevpoint;                     /*+ The previous waypoint. +*/
+};
 
 
 /* Macros */
@@ -37,22 +55,22 @@
 
 /* Functions in fakes.c */
 
-index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,index_t node1,index_t node2,distance_t dist1,distance_t dist2);
+index_t CreateFakes(Fakes *fakes,Nodes *nodes,Segments *segments,int point,Segment *segmentp,index_t node1,index_t node2,distance_t dist1,distance_t dist2);
 
-index_t CreateFakeNullSegment(Segments *segments,index_t node,index_t segment,int point);
+index_t CreateFakeNullSegment(Fakes *fakes,Segments *segments,index_t node,index_t segment,int point);
 
-void DeleteFakeNodes(void);
+void DeleteFakeNodes(Fakes *fakes);
 
-void GetFakeLatLong(index_t fakenode, double *latitude,double *longitude);
+void GetFakeLatLong(Fakes *fakes,index_t fakenode, double *latitude,double *longitude);
 
-Segment *FirstFakeSegment(index_t fakenode);
-Segment *NextFakeSegment(Segment *fakesegmentp,index_t fakenode);
-Segment *ExtraFakeSegment(index_t realnode,index_t fakenode);
+Segment *FirstFakeSegment(Fakes *fakes,index_t fakenode);
+Segment *NextFakeSegment(Fakes *fakes,Segment *fakesegmentp,index_t fakenode);
+Segment *ExtraFakeSegment(Fakes *fakes,index_t realnode,index_t fakenode);
 
-Segment *LookupFakeSegment(index_t index);
-index_t IndexFakeSegment(Segment *fakesegmentp);
-index_t IndexRealSegment(index_t fakesegment);
+Segment *LookupFakeSegment(Fakes *fakes,index_t index);
+index_t IndexFakeSegment(Fakes *fakes,Segment *fakesegmentp);
+index_t IndexRealSegment(Fakes *fakes,index_t fakesegment);
 
-int IsFakeUTurn(index_t fakesegment1,index_t fakesegment2);
+int IsFakeUTurn(Fakes *fakes,index_t fakesegment1,index_t fakesegment2);
 
 #endif /* FAKES_H */
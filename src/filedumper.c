@@ -79,6 +79,7 @@ int main(int argc,char** argv)
  Relations*OSMRelations;
  ErrorLogs*OSMErrorLogs=NULL;
  int       arg;
+ int       container;
  char     *dirname=NULL,*prefix=NULL;
  char     *nodes_filename,*segments_filename,*ways_filename,*relations_filename,*errorlogs_filename;
  int       option_statistics=0;
@@ -142,13 +143,15 @@ int main(int argc,char** argv)
 
  /* Load in the data - Note: No error checking because Load*List() will call exit() in case of an error. */
 
- OSMNodes=LoadNodeList(nodes_filename=FileName(dirname,prefix,"nodes.mem"));
+ container=OpenContainer(dirname,prefix);
 
- OSMSegments=LoadSegmentList(segments_filename=FileName(dirname,prefix,"segments.mem"));
+ OSMNodes=LoadNodeList(nodes_filename=FileName(dirname,prefix,"nodes.mem"),0,0);
 
- OSMWays=LoadWayList(ways_filename=FileName(dirname,prefix,"ways.mem"));
+ OSMSegments=LoadSegmentList(segments_filename=FileName(dirname,prefix,"segments.mem"),0,0);
 
- OSMRelations=LoadRelationList(relations_filename=FileName(dirname,prefix,"relations.mem"));
+ OSMWays=LoadWayList(ways_filename=FileName(dirname,prefix,"ways.mem"),0,0);
+
+ OSMRelations=LoadRelationList(relations_filename=FileName(dirname,prefix,"relations.mem"),0,0);
 
  if(ExistsFile(errorlogs_filename=FileName(dirname,prefix,"errorlogs.mem")))
     OSMErrorLogs=LoadErrorLogs(errorlogs_filename);
@@ -217,37 +220,74 @@ int main(int argc,char** argv)
     printf("-----\n");
     printf("\n");
 
-    stat(nodes_filename,&buf);
+    if(container>=0)
+      {
+       ContainerFile header;
+       char *container_filename=FileName(dirname,prefix,"database.mem");
+       uint32_t i;
 
-    printf("'%s%snodes.mem'     - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
-    printf("%s\n",RFC822Date(buf.st_mtime));
-    printf("\n");
+       ReadContainerHeader(container,&header);
 
-    stat(segments_filename,&buf);
+       stat(container_filename,&buf);
 
-    printf("'%s%ssegments.mem'  - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
-    printf("%s\n",RFC822Date(buf.st_mtime));
-    printf("\n");
+       printf("'%s%sdatabase.mem'  - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
+       printf("%s\n",RFC822Date(buf.st_mtime));
+       printf("\n");
 
-    stat(ways_filename,&buf);
+       printf("Version         =%9"PRIu32"\n",header.version);
+       printf("Options         = %s%s%s%s%s%s\n",
+              header.options&CONTAINER_OPTION_COMPRESS ?"compress " :"",
+              header.options&CONTAINER_OPTION_ADJACENCY?"adjacency ":"",
+              header.options&CONTAINER_OPTION_HILBERT  ?"hilbert "  :"",
+              header.options&CONTAINER_OPTION_SNAP     ?"snap-index ":"",
+              header.options&CONTAINER_OPTION_HIERARCHY?"hierarchy ":"",
+              header.options&CONTAINER_OPTION_LANDMARKS?"landmarks ":"");
+       printf("Nodes           =%9"PRIu64"\n",header.nodes);
+       printf("Segments        =%9"PRIu64"\n",header.segments);
+       printf("Ways            =%9"PRIu64"\n",header.ways);
+       printf("Turn relations  =%9"PRIu64"\n",header.turnrelations);
+       printf("\n");
 
-    printf("'%s%sways.mem'      - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
-    printf("%s\n",RFC822Date(buf.st_mtime));
-    printf("\n");
+       for(i=0;i<header.nsections;i++)
+          printf("Section '%s'%*s- %9"PRIu64" Bytes at %9"PRIu64"\n",header.sections[i].name,(int)(15-strlen(header.sections[i].name)),"",header.sections[i].length,header.sections[i].offset);
+       printf("\n");
+
+       free(container_filename);
+      }
+    else
+      {
+       stat(nodes_filename,&buf);
 
-    stat(relations_filename,&buf);
+       printf("'%s%snodes.mem'     - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
+       printf("%s\n",RFC822Date(buf.st_mtime));
+       printf("\n");
 
-    printf("'%s%srelations.mem' - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
-    printf("%s\n",RFC822Date(buf.st_mtime));
-    printf("\n");
+       stat(segments_filename,&buf);
 
-    if(errorlogs_filename)
-      {
-       stat(errorlogs_filename,&buf);
+       printf("'%s%ssegments.mem'  - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
+       printf("%s\n",RFC822Date(buf.st_mtime));
+       printf("\n");
 
-       printf("'%s%serrorlogs.mem' - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
+       stat(ways_filename,&buf);
+
+       printf("'%s%sways.mem'      - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
        printf("%s\n",RFC822Date(buf.st_mtime));
        printf("\n");
+
+       stat(relations_filename,&buf);
+
+       printf("'%s%srelations.mem' - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
+       printf("%s\n",RFC822Date(buf.st_mtime));
+       printf("\n");
+
+       if(errorlogs_filename)
+         {
+          stat(errorlogs_filename,&buf);
+
+          printf("'%s%serrorlogs.mem' - %9"PRIu64" Bytes\n",prefix?prefix:"",prefix?"-":"",(uint64_t)buf.st_size);
+          printf("%s\n",RFC822Date(buf.st_mtime));
+          printf("\n");
+         }
       }
 
     /* Examine the nodes */
@@ -256,13 +296,17 @@ int main(int argc,char** argv)
     printf("-----\n");
     printf("\n");
 
-    printf("sizeof(Node) =%9zu Bytes\n",sizeof(Node));
-    printf("Number       =%9"Pindex_t"\n",OSMNodes->file.number);
-    printf("Number(super)=%9"Pindex_t"\n",OSMNodes->file.snumber);
+    printf("sizeof(Node)        =%9zu Bytes\n",sizeof(Node));
+    printf("sizeof(NodePosition)=%9zu Bytes\n",sizeof(NodePosition));
+    printf("Number              =%9"Pindex_t"\n",OSMNodes->file.number);
+    printf("Number(super)       =%9"Pindex_t"\n",OSMNodes->file.snumber);
+    printf("Block size          =%9"Pindex_t"\n",OSMNodes->file.blocksize);
+    printf("Snapping index      =%9"Pindex_t"\n",OSMNodes->file.nsnaps);
     printf("\n");
 
     printf("Lat bins= %4d\n",(int)OSMNodes->file.latbins);
     printf("Lon bins= %4d\n",(int)OSMNodes->file.lonbins);
+    printf("Bin order= %s\n",OSMNodes->file.hilbert?"Hilbert curve":"longitude then latitude");
     printf("\n");
 
     printf("Lat zero=%5d (%8.4f deg)\n",(int)OSMNodes->file.latzero,radians_to_degrees(latlong_to_radians(bin_to_latlong(OSMNodes->file.latzero))));
@@ -279,6 +323,40 @@ int main(int argc,char** argv)
     printf("Number(total)  =%9"Pindex_t"\n",OSMSegments->file.number);
     printf("Number(super)  =%9"Pindex_t"\n",OSMSegments->file.snumber);
     printf("Number(normal) =%9"Pindex_t"\n",OSMSegments->file.nnumber);
+    printf("Number(edges)  =%9"Pindex_t"\n",OSMSegments->file.enumber);
+    printf("Block size     =%9"Pindex_t"\n",OSMSegments->file.blocksize);
+
+    /* Examine the edge locality (how close together the nodes at each end of the segments are stored) */
+
+    if(OSMSegments->file.number>0)
+      {
+       index_t item,samepos=0,samenode=0,near=0;
+       double totaldist=0;
+
+       for(item=0;item<OSMSegments->file.number;item++)
+         {
+          Segment *segmentp=LookupSegment(OSMSegments,item,1);
+          index_t dist=segmentp->node1>segmentp->node2?segmentp->node1-segmentp->node2:segmentp->node2-segmentp->node1;
+
+          if((segmentp->node1*sizeof(NodePosition))/4096==(segmentp->node2*sizeof(NodePosition))/4096)
+             samepos++;
+
+          if((segmentp->node1*sizeof(Node))/4096==(segmentp->node2*sizeof(Node))/4096)
+             samenode++;
+
+          if(dist<=64)
+             near++;
+
+          totaldist+=dist;
+         }
+
+       printf("\n");
+       printf("Edge locality (nodes at each end of a segment):\n");
+       printf("Same 4kB page(positions)=%6.2f%%\n",100.0*samepos/OSMSegments->file.number);
+       printf("Same 4kB page(nodes)    =%6.2f%%\n",100.0*samenode/OSMSegments->file.number);
+       printf("Within 64 nodes         =%6.2f%%\n",100.0*near/OSMSegments->file.number);
+       printf("Mean index distance     =%9.1f\n",totaldist/OSMSegments->file.number);
+      }
 
     /* Examine the ways */
 
@@ -291,8 +369,7 @@ int main(int argc,char** argv)
     printf("Number     =%9"Pindex_t"\n",OSMWays->file.number);
     printf("\n");
 
-    stat(ways_filename,&buf);
-    printf("Total names=%9zu Bytes\n",(size_t)buf.st_size-sizeof(Ways)-OSMWays->file.number*sizeof(Way));
+    printf("Total names=%9zu Bytes\n",(size_t)SizeFile(ways_filename)-sizeof(Ways)-OSMWays->file.number*sizeof(Way));
     printf("\n");
 
     printf("Included highways  : %s\n",HighwaysNameList(OSMWays->file.highways));
@@ -308,6 +385,7 @@ int main(int argc,char** argv)
 
     printf("sizeof(TurnRelation)=%9zu Bytes\n",sizeof(TurnRelation));
     printf("Number              =%9"Pindex_t"\n",OSMRelations->file.trnumber);
+    printf("Index entries       =%9"Pindex_t"\n",OSMRelations->file.trindexbins);
 
     if(errorlogs_filename)
       {
@@ -321,11 +399,10 @@ int main(int argc,char** argv)
        printf("Number(non-geographical)=%9"Pindex_t"\n",OSMErrorLogs->file.number_nongeo);
 
        printf("\n");
-       stat(errorlogs_filename,&buf);
 #if !SLIM
-       printf("Total strings=%9zu Bytes\n",(size_t)buf.st_size-(OSMErrorLogs->strings-(char*)OSMErrorLogs->data));
+       printf("Total strings=%9zu Bytes\n",(size_t)SizeFile(errorlogs_filename)-(OSMErrorLogs->strings-(char*)OSMErrorLogs->data));
 #else
-       printf("Total strings=%9zu Bytes\n",(size_t)buf.st_size-(size_t)OSMErrorLogs->stringsoffset);
+       printf("Total strings=%9zu Bytes\n",(size_t)SizeFile(errorlogs_filename)-(size_t)OSMErrorLogs->stringsoffset);
 #endif
       }
    }
@@ -501,16 +578,17 @@ int main(int argc,char** argv)
 static void print_node(Nodes *nodes,index_t item)
 {
  Node *nodep=LookupNode(nodes,item,1);
+ NodePosition *positionp=LookupNodePosition(nodes,item,2);
  double latitude,longitude;
 
- GetLatLong(nodes,item,nodep,&latitude,&longitude);
+ GetLatLong(nodes,item,&latitude,&longitude);
 
  printf("Node %"Pindex_t"\n",item);
  printf("  firstseg=%"Pindex_t"\n",nodep->firstseg);
- printf("  latoffset=%d lonoffset=%d (latitude=%.6f longitude=%.6f)\n",nodep->latoffset,nodep->lonoffset,radians_to_degrees(latitude),radians_to_degrees(longitude));
+ printf("  latoffset=%d lonoffset=%d (latitude=%.6f longitude=%.6f)\n",positionp->latoffset,positionp->lonoffset,radians_to_degrees(latitude),radians_to_degrees(longitude));
  printf("  allow=%02x (%s)\n",nodep->allow,AllowedNameList(nodep->allow));
  if(IsSuperNode(nodep))
-    printf("  Super-Node\n");
+    printf("  Super-Node (level %d)\n",SuperNodeLevel(nodep));
  if(nodep->flags & NODE_MINIRNDBT)
     printf("  Mini-roundabout\n");
 }
@@ -730,17 +808,18 @@ static void print_region_osm(Nodes *nodes,Segments *segments,Ways *ways,Relation
       {
        ll_bin2_t llbin=lonb*nodes->file.latbins+latb;
 
-       if(llbin<0 || llbin>(nodes->file.latbins*nodes->file.lonbins))
+       if(llbin<0 || llbin>=(nodes->file.latbins*nodes->file.lonbins))
           continue;
 
        index1=LookupNodeOffset(nodes,llbin);
-       index2=LookupNodeOffset(nodes,llbin+1);
+       index2=LookupNodeOffsetEnd(nodes,llbin);
 
        for(item=index1;item<index2;item++)
          {
           Node *nodep=LookupNode(nodes,item,1);
-          double lat=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(nodep->latoffset));
-          double lon=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(nodep->lonoffset));
+          NodePosition *positionp=LookupNodePosition(nodes,item,2);
+          double lat=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(positionp->latoffset));
+          double lon=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(positionp->lonoffset));
 
           if(lat>latmin && lat<latmax && lon>lonmin && lon<lonmax)
             {
@@ -755,7 +834,7 @@ static void print_region_osm(Nodes *nodes,Segments *segments,Ways *ways,Relation
                 double olat,olon;
                 index_t oitem=OtherNode(segmentp,item);
 
-                GetLatLong(nodes,oitem,NULL,&olat,&olon);
+                GetLatLong(nodes,oitem,&olat,&olon);
 
                 if(olat>latmin && olat<latmax && olon>lonmin && olon<lonmax)
                    if(item>oitem)
@@ -796,7 +875,7 @@ static void print_node_osm(Nodes *nodes,index_t item)
  double latitude,longitude;
  int i;
 
- GetLatLong(nodes,item,nodep,&latitude,&longitude);
+ GetLatLong(nodes,item,&latitude,&longitude);
 
  if(nodep->allow==Transports_ALL && nodep->flags==0)
     printf("  <node id='%"Pindex_t"' lat='%.7f' lon='%.7f' version='1' />\n",item+1,radians_to_degrees(latitude),radians_to_degrees(longitude));
@@ -919,7 +998,7 @@ static void print_turn_relation_osm(Relations *relations,index_t item,Segments *
  Segment *segmentp_from=LookupSegment(segments,relationp->from,1);
  Segment *segmentp_to  =LookupSegment(segments,relationp->to  ,2);
 
- double angle=TurnAngle(nodes,segmentp_from,segmentp_to,relationp->via);
+ double angle=TurnAngle(nodes,NULL,segmentp_from,segmentp_to,relationp->via);
 
  char *restriction;
 
@@ -971,7 +1050,7 @@ static void print_node_visualiser(Nodes *nodes,index_t item)
  double latitude,longitude;
  int i;
 
- GetLatLong(nodes,item,nodep,&latitude,&longitude);
+ GetLatLong(nodes,item,&latitude,&longitude);
 
  if(nodep->allow==Transports_ALL && nodep->flags==0)
     printf("&lt;routino:node id='%"Pindex_t"' lat='%.7f' lon='%.7f' /&gt;\n",item+1,radians_to_degrees(latitude),radians_to_degrees(longitude));
@@ -1094,7 +1173,7 @@ static void print_turn_relation_visualiser(Relations *relations,index_t item,Seg
  Segment *segmentp_from=LookupSegment(segments,relationp->from,1);
  Segment *segmentp_to  =LookupSegment(segments,relationp->to  ,2);
 
- double angle=TurnAngle(nodes,segmentp_from,segmentp_to,relationp->via);
+ double angle=TurnAngle(nodes,NULL,segmentp_from,segmentp_to,relationp->via);
 
  char *restriction;
 
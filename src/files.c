@@ -20,6 +20,11 @@
  ***************************************/
 
 
+/* Needed for MAP_POPULATE, MAP_ANONYMOUS and madvise() when _POSIX_C_SOURCE is defined */
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#define _DEFAULT_SOURCE
+#endif
+
 #if defined(_MSC_VER)
 #include <io.h>
 #include <basetsd.h>
@@ -27,6 +32,7 @@
 #define write(fd,address,length) _write(fd,address,(unsigned int)(length))
 #define open    _open
 #define close   _close
+#define dup     _dup
 #define unlink  _unlink
 #define ssize_t SSIZE_T
 #else
@@ -56,10 +62,25 @@
 #endif
 
 #include <sys/types.h>
+#include <stdint.h>
 
+#include "types.h"
 #include "files.h"
 
 
+/*+ The amount of data to read from file for each cache miss in slim mode (or 0 to read one item). +*/
+size_t option_cache_block=4096;
+
+/*+ The option to ask the operating system to read ahead of each block read for a cache miss in slim mode. +*/
+int option_cache_readahead=0;
+
+/*+ The offset of the data in each file opened for slim mode access (indexed by file descriptor). +*/
+offset_t *slimfileoffsets=NULL;
+
+/*+ The number of allocated slim mode file offsets. +*/
+int nslimfileoffsets=0;
+
+
 /*+ A structure to contain the list of memory mapped files. +*/
 struct mmapinfo
 {
@@ -67,6 +88,7 @@ struct mmapinfo
        int    fd;               /*+ The file descriptor used when it was opened. +*/
        char  *address;          /*+ The address the file was mapped to. +*/
        size_t length;           /*+ The length of the file. +*/
+       int    container;        /*+ The container file that the data is part of (or -1 for a separate file). +*/
 };
 
 /*+ The list of memory mapped files. +*/
@@ -76,6 +98,26 @@ static struct mmapinfo *mappedfiles;
 static int nmappedfiles=0;
 
 
+/*+ A structure to contain the information about an opened database container file. +*/
+struct containerinfo
+{
+ char         *filename;        /*+ The name of the container file. +*/
+ int           fd;              /*+ The file descriptor used when it was opened. +*/
+ char         *address;         /*+ The address the file was mapped to (or NULL if not mapped yet). +*/
+ size_t        length;          /*+ The length of the mapped memory. +*/
+ int           users;           /*+ The number of users (the open container and each mapped section). +*/
+ int           open;            /*+ Set to non-zero while the sections can be found by their file names. +*/
+ ContainerFile header;          /*+ The header from the container file. +*/
+ char         *names[CONTAINER_SECTIONS]; /*+ The names of the separate files that the sections replace. +*/
+};
+
+/*+ The list of opened database container files. +*/
+static struct containerinfo **containers=NULL;
+
+/*+ The number of allocated database container file pointers. +*/
+static int ncontainers=0;
+
+
 #define BUFFLEN 4096
 
 /*+ A structure to contain the list of file buffers. +*/
@@ -114,8 +156,15 @@ static int nopenedfiles=0;
 
 /* Local functions */
 
+static void *copy_file_anonymous(int fd,size_t size,size_t *length,int options);
+static void *map_file_descriptor(int fd,size_t size,size_t *length,int options);
+static void advise_mapped_file(void *address,size_t length,int options);
+
 static void CreateFileBuffer(int fd,int read_write);
 
+static int find_container_section(const char *filename,int *section);
+static void release_container(int container);
+
 #if defined(_MSC_VER) || defined(__MINGW32__)
 
 static void CreateOpenedFile(int fd,const char *filename);
@@ -154,11 +203,73 @@ char *FileName(const char *dirname,const char *prefix, const char *name)
   ++++++++++++++++++++++++++++++++++++++*/
 
 void *MapFile(const char *filename)
+{
+ return(MapFileWithOptions(filename,0));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Open a file read-only and map it into memory using the selected options.
+
+  void *MapFileWithOptions Returns the address of the file or exits in case of an error.
+
+  const char *filename The name of the file to open.
+
+  int options The options for mapping the file (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void *MapFileWithOptions(const char *filename,int options)
 {
  int fd;
  struct stat buf;
  offset_t size;
+ size_t length;
  void *address;
+ int container,section;
+
+ /* Use the section of a database container file if there is one */
+
+ if((container=find_container_section(filename,&section))>=0)
+   {
+    struct containerinfo *info=containers[container];
+
+    if(!info->address)
+      {
+       address=map_file_descriptor(info->fd,(size_t)SizeFileFD(info->fd),&info->length,options);
+
+       if(address==MAP_FAILED)
+         {
+#ifdef LIBROUTINO
+          return(NULL);
+#else
+          fprintf(stderr,"Cannot mmap file '%s' for reading [%s].\n",info->filename,strerror(errno));
+          exit(EXIT_FAILURE);
+#endif
+         }
+
+       info->address=(char*)address;
+
+#ifndef LIBROUTINO
+       log_mmap(info->length);
+#endif
+      }
+
+    info->users++;
+
+    /* Store the information about the mapped section */
+
+    mappedfiles=(struct mmapinfo*)realloc((void*)mappedfiles,(nmappedfiles+1)*sizeof(struct mmapinfo));
+
+    mappedfiles[nmappedfiles].filename=filename;
+    mappedfiles[nmappedfiles].fd=-1;
+    mappedfiles[nmappedfiles].address=info->address+info->header.sections[section].offset;
+    mappedfiles[nmappedfiles].length=(size_t)info->header.sections[section].length;
+    mappedfiles[nmappedfiles].container=container;
+
+    nmappedfiles++;
+
+    return(mappedfiles[nmappedfiles-1].address);
+   }
 
  /* Open the file */
 
@@ -192,9 +303,9 @@ void *MapFile(const char *filename)
 
  size=buf.st_size;
 
- /* Map the file */
+ /* Map the file (or copy it into memory) */
 
- address=mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0);
+ address=map_file_descriptor(fd,(size_t)size,&length,options);
 
  if(address==MAP_FAILED)
    {
@@ -209,7 +320,7 @@ void *MapFile(const char *filename)
    }
 
 #ifndef LIBROUTINO
- log_mmap(size);
+ log_mmap(length);
 #endif
 
  /* Store the information about the mapped file */
@@ -219,7 +330,8 @@ void *MapFile(const char *filename)
  mappedfiles[nmappedfiles].filename=filename;
  mappedfiles[nmappedfiles].fd=fd;
  mappedfiles[nmappedfiles].address=address;
- mappedfiles[nmappedfiles].length=size;
+ mappedfiles[nmappedfiles].length=length;
+ mappedfiles[nmappedfiles].container=-1;
 
  nmappedfiles++;
 
@@ -302,6 +414,7 @@ void *MapFileWriteable(const char *filename)
  mappedfiles[nmappedfiles].fd=fd;
  mappedfiles[nmappedfiles].address=address;
  mappedfiles[nmappedfiles].length=size;
+ mappedfiles[nmappedfiles].container=-1;
 
  nmappedfiles++;
 
@@ -335,17 +448,26 @@ void *UnmapFile(const void *address)
 #endif
    }
 
- /* Close the file */
+ if(mappedfiles[i].container>=0)
+   {
+    /* Release the container file (unmapped when the last section is unmapped) */
+
+    release_container(mappedfiles[i].container);
+   }
+ else
+   {
+    /* Close the file */
 
- close(mappedfiles[i].fd);
+    close(mappedfiles[i].fd);
 
- /* Unmap the file */
+    /* Unmap the file */
 
- munmap(mappedfiles[i].address,mappedfiles[i].length);
+    munmap(mappedfiles[i].address,mappedfiles[i].length);
 
 #ifndef LIBROUTINO
- log_munmap(mappedfiles[i].length);
+    log_munmap(mappedfiles[i].length);
 #endif
+   }
 
  /* Shuffle the list of files */
 
@@ -358,6 +480,72 @@ void *UnmapFile(const void *address)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Convert a comma separated list of names into a set of options for loading database files.
+
+  int MapOptionsByName Returns the MAP_OPTION_* values ORed together or -1 if a name is not recognised.
+
+  const char *names The list of names (populate, willneed, random, hugepage, copy or lock).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int MapOptionsByName(const char *names)
+{
+ static const struct {const char *name; int option;} options[]={{"populate",MAP_OPTION_POPULATE},
+                                                                {"willneed",MAP_OPTION_WILLNEED},
+                                                                {"random"  ,MAP_OPTION_RANDOM  },
+                                                                {"hugepage",MAP_OPTION_HUGEPAGE},
+                                                                {"copy"    ,MAP_OPTION_COPY    },
+                                                                {"lock"    ,MAP_OPTION_LOCK    }};
+ int result=0;
+
+ while(*names)
+   {
+    size_t length=strcspn(names,",");
+    int i;
+
+    for(i=0;i<(int)(sizeof(options)/sizeof(options[0]));i++)
+       if(strlen(options[i].name)==length && !strncmp(names,options[i].name,length))
+          break;
+
+    if(i==(int)(sizeof(options)/sizeof(options[0])))
+       return(-1);
+
+    result|=options[i].option;
+
+    names+=length;
+
+    if(*names==',')
+       names++;
+   }
+
+ return(result);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Lock some data into memory so that it is never paged out (if selected by the MAP_OPTION_LOCK option).
+
+  const void *address The start of the data.
+
+  size_t length The length of the data.
+
+  int options The options that the file containing the data was mapped with (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void LockMemory(const void *address,size_t length,int options)
+{
+ if(!(options&MAP_OPTION_LOCK) || !address || !length)
+    return;
+
+ if(mlock(address,length))
+   {
+#ifndef LIBROUTINO
+    fprintf(stderr,"Warning: Cannot lock %zu bytes into memory [%s].\n",length,strerror(errno));
+#endif
+   }
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Open an existing file on disk for reading.
 
@@ -367,16 +555,44 @@ void *UnmapFile(const void *address)
   ++++++++++++++++++++++++++++++++++++++*/
 
 int SlimMapFile(const char *filename)
+{
+ return(SlimMapFileWithOptions(filename,0));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Open an existing file on disk for reading using the selected options.
+
+  int SlimMapFileWithOptions Returns the file descriptor if OK or exits in case of an error.
+
+  const char *filename The name of the file to open.
+
+  int options The options for reading the file (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int SlimMapFileWithOptions(const char *filename,int options)
 {
  int fd;
+ int container,section;
+ offset_t offset=0,length=0;
 
- /* Open the file */
+ /* Open the file (or a copy of the descriptor of the container file that the data is part of) */
+
+ if((container=find_container_section(filename,&section))>=0)
+   {
+    fd=dup(containers[container]->fd);
 
+    offset=(offset_t)containers[container]->header.sections[section].offset;
+    length=(offset_t)containers[container]->header.sections[section].length;
+   }
+ else
+   {
 #if defined(_MSC_VER) || defined(__MINGW32__)
- fd=open(filename,O_RDONLY|O_BINARY|O_RANDOM);
+    fd=open(filename,O_RDONLY|O_BINARY|O_RANDOM);
 #else
- fd=open(filename,O_RDONLY);
+    fd=open(filename,O_RDONLY);
 #endif
+   }
 
  if(fd<0)
    {
@@ -388,6 +604,35 @@ int SlimMapFile(const char *filename)
 #endif
    }
 
+ /* Store the offset of the data in the file */
+
+ if(offset && nslimfileoffsets<=fd)
+   {
+    int i;
+
+    slimfileoffsets=(offset_t*)realloc((void*)slimfileoffsets,(fd+1)*sizeof(offset_t));
+
+    for(i=nslimfileoffsets;i<=fd;i++)
+       slimfileoffsets[i]=0;
+
+    nslimfileoffsets=fd+1;
+   }
+
+ if(fd<nslimfileoffsets)
+    slimfileoffsets[fd]=offset;
+
+ /* Apply the options that make sense for a file that is read */
+
+#if defined(POSIX_FADV_WILLNEED)
+ if(options&(MAP_OPTION_WILLNEED|MAP_OPTION_POPULATE))
+    posix_fadvise(fd,offset,length,POSIX_FADV_WILLNEED);
+#endif
+
+#if defined(POSIX_FADV_RANDOM)
+ if(options&MAP_OPTION_RANDOM)
+    posix_fadvise(fd,offset,length,POSIX_FADV_RANDOM);
+#endif
+
  CreateFileBuffer(fd,0);
 
  return(fd);
@@ -440,12 +685,291 @@ int SlimMapFileWriteable(const char *filename)
 
 int SlimUnmapFile(int fd)
 {
+ if(fd<nslimfileoffsets)
+    slimfileoffsets[fd]=0;
+
  close(fd);
 
  return(-1);
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Combine the separate database files into a single container file and delete them.
+
+  int WriteContainer Returns 0 if OK or exits in case of an error.
+
+  const char *dirname The directory name.
+
+  const char *prefix The file prefix.
+
+  ContainerFile *header The header for the container file (with the statistics and options filled in).
+
+  const char * const *names The NULL terminated list of separate file names (those that do not exist are skipped).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int WriteContainer(const char *dirname,const char *prefix,ContainerFile *header,const char * const *names)
+{
+ static const char zeros[CONTAINER_ALIGNMENT]={0};
+ char *filenames[CONTAINER_SECTIONS];
+ char *filename,*tmpfilename;
+ char *buffer;
+ uint64_t offset;
+ uint32_t i;
+ int fd;
+
+ /* Fill in the header and the section table */
+
+ memset(header->magic,0,sizeof(header->magic));
+ strcpy(header->magic,CONTAINER_MAGIC);
+
+ header->version=CONTAINER_VERSION;
+ header->indexsize=sizeof(index_t);
+ header->nsections=0;
+
+ memset(header->sections,0,sizeof(header->sections));
+
+ offset=(sizeof(ContainerFile)+CONTAINER_ALIGNMENT-1)&~(uint64_t)(CONTAINER_ALIGNMENT-1);
+
+ for(;*names;names++)
+   {
+    char *sectionfilename=FileName(dirname,prefix,*names);
+
+    if(!ExistsFile(sectionfilename))
+      {
+       free(sectionfilename);
+       continue;
+      }
+
+#ifndef LIBROUTINO
+    logassert(header->nsections<CONTAINER_SECTIONS && strlen(*names)<sizeof(header->sections[0].name),"Too many or too long database container sections - report a bug");
+#endif
+
+    filenames[header->nsections]=sectionfilename;
+
+    strcpy(header->sections[header->nsections].name,*names);
+
+    header->sections[header->nsections].offset=offset;
+    header->sections[header->nsections].length=(uint64_t)SizeFile(sectionfilename);
+
+    offset=(offset+header->sections[header->nsections].length+CONTAINER_ALIGNMENT-1)&~(uint64_t)(CONTAINER_ALIGNMENT-1);
+
+    header->nsections++;
+   }
+
+ /* Write the container to a temporary file */
+
+ filename=FileName(dirname,prefix,"database.mem");
+ tmpfilename=FileName(dirname,prefix,"database.mem.tmp");
+
+ fd=OpenFileBufferedNew(tmpfilename);
+
+ WriteFileBuffered(fd,header,sizeof(ContainerFile));
+
+ offset=sizeof(ContainerFile);
+
+ buffer=(char*)malloc(1024*1024);
+
+ for(i=0;i<header->nsections;i++)
+   {
+    uint64_t length=header->sections[i].length;
+    int infd;
+
+    while(offset<header->sections[i].offset)
+      {
+       size_t padding=(size_t)(header->sections[i].offset-offset);
+
+       if(padding>CONTAINER_ALIGNMENT)
+          padding=CONTAINER_ALIGNMENT;
+
+       WriteFileBuffered(fd,zeros,padding);
+
+       offset+=padding;
+      }
+
+    infd=ReOpenFileBuffered(filenames[i]);
+
+    while(length>0)
+      {
+       size_t chunk=length<1024*1024?(size_t)length:1024*1024;
+
+       if(ReadFileBuffered(infd,buffer,chunk) || WriteFileBuffered(fd,buffer,chunk))
+         {
+#ifdef LIBROUTINO
+          return(-1);
+#else
+          fprintf(stderr,"Cannot copy file '%s' into the database container [%s].\n",filenames[i],strerror(errno));
+          exit(EXIT_FAILURE);
+#endif
+         }
+
+       length-=chunk;
+       offset+=chunk;
+      }
+
+    CloseFileBuffered(infd);
+   }
+
+ free(buffer);
+
+ CloseFileBuffered(fd);
+
+ /* Replace any existing container and delete the separate files */
+
+ RenameFile(tmpfilename,filename);
+
+ for(i=0;i<header->nsections;i++)
+   {
+    DeleteFile(filenames[i]);
+    free(filenames[i]);
+   }
+
+ free(tmpfilename);
+ free(filename);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Open a database container file so that the separate files are loaded from its sections by MapFile() and SlimMapFile().
+
+  int OpenContainer Returns the container number, -1 if there is no container file or -2 if it is not valid (in the library).
+
+  const char *dirname The directory name.
+
+  const char *prefix The file prefix.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int OpenContainer(const char *dirname,const char *prefix)
+{
+ struct containerinfo *info;
+ char *filename;
+ const char *error=NULL;
+ offset_t size;
+ uint32_t i;
+ int fd,container;
+
+ filename=FileName(dirname,prefix,"database.mem");
+
+ if(!ExistsFile(filename))
+   {
+    free(filename);
+    return(-1);
+   }
+
+ /* Open the file and check the header */
+
+ info=(struct containerinfo*)calloc(sizeof(struct containerinfo),1);
+
+ fd=OpenFile(filename);
+
+ if(fd<0)
+    error="cannot open it";
+ else if((size=SizeFileFD(fd))<(offset_t)sizeof(ContainerFile) || SlimFetch(fd,&info->header,sizeof(ContainerFile),0))
+    error="too short";
+ else if(strncmp(info->header.magic,CONTAINER_MAGIC,sizeof(info->header.magic)))
+    error="wrong magic string";
+ else if(info->header.version!=CONTAINER_VERSION)
+    error="wrong version";
+ else if(info->header.indexsize!=sizeof(index_t))
+    error="created with a different index size";
+ else if(info->header.nsections>CONTAINER_SECTIONS)
+    error="too many sections";
+ else
+    for(i=0;i<info->header.nsections;i++)
+      {
+       ContainerSection *section=&info->header.sections[i];
+
+       if(section->offset%CONTAINER_ALIGNMENT || (section->offset+section->length)>(uint64_t)size ||
+          memchr(section->name,0,sizeof(section->name))==NULL)
+         {
+          error="bad section table";
+          break;
+         }
+      }
+
+ if(error)
+   {
+    if(fd>=0)
+       CloseFile(fd);
+
+    free(info);
+
+#ifdef LIBROUTINO
+    free(filename);
+    return(-2);
+#else
+    fprintf(stderr,"The file '%s' is not a valid database container [%s].\n",filename,error);
+    exit(EXIT_FAILURE);
+#endif
+   }
+
+ /* Store the information about the container file */
+
+ info->filename=filename;
+ info->fd=fd;
+ info->users=1;
+ info->open=1;
+
+ for(i=0;i<info->header.nsections;i++)
+    info->names[i]=FileName(dirname,prefix,info->header.sections[i].name);
+
+ for(container=0;container<ncontainers;container++)
+    if(!containers[container])
+       break;
+
+ if(container==ncontainers)
+   {
+    containers=(struct containerinfo**)realloc((void*)containers,(ncontainers+1)*sizeof(struct containerinfo*));
+
+    ncontainers++;
+   }
+
+ containers[container]=info;
+
+ return(container);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get a copy of the header of an opened database container file.
+
+  int ReadContainerHeader Returns 0 if OK or -1 if the container is not open.
+
+  int container The container number returned by OpenContainer().
+
+  ContainerFile *header Returns the header of the container file.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int ReadContainerHeader(int container,ContainerFile *header)
+{
+ if(container<0 || container>=ncontainers || !containers[container])
+    return(-1);
+
+ *header=containers[container]->header;
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Stop loading files from a database container file (the file stays mapped until the sections are unmapped).
+
+  int container The container number returned by OpenContainer().
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CloseContainer(int container)
+{
+ if(container<0 || container>=ncontainers || !containers[container] || !containers[container]->open)
+    return;
+
+ containers[container]->open=0;
+
+ release_container(container);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Open a new file on disk for writing (with buffering).
 
@@ -806,6 +1330,10 @@ int SkipFileBuffered(int fd,offset_t skip)
 offset_t SizeFile(const char *filename)
 {
  struct stat buf;
+ int container,section;
+
+ if((container=find_container_section(filename,&section))>=0)
+    return((offset_t)containers[container]->header.sections[section].length);
 
  if(stat(filename,&buf))
    {
@@ -858,6 +1386,10 @@ offset_t SizeFileFD(int fd)
 int ExistsFile(const char *filename)
 {
  struct stat buf;
+ int section;
+
+ if(find_container_section(filename,&section)>=0)
+    return(1);
 
  if(stat(filename,&buf))
     return(0);
@@ -866,6 +1398,54 @@ int ExistsFile(const char *filename)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Check that a database file starts with the expected magic number and format version.
+
+  int CheckFileHeader Returns 0 if OK, 1 if the file is not a database file of the current version or -1 if it cannot be read (exits in case of an error unless compiled for the library).
+
+  const char *filename The name of the file to check.
+
+  uint32_t magic The magic number that the file must start with.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int CheckFileHeader(const char *filename,uint32_t magic)
+{
+ uint32_t header[2];
+ int fd,status;
+
+ fd=SlimMapFile(filename);
+
+ if(fd<0)
+    return(-1);
+
+ status=SlimFetch(fd,header,sizeof(header),0);
+
+ SlimUnmapFile(fd);
+
+ if(status)
+   {
+#ifdef LIBROUTINO
+    return(-1);
+#else
+    fprintf(stderr,"Cannot read the header of file '%s'.\n",filename);
+    exit(EXIT_FAILURE);
+#endif
+   }
+
+ if(header[0]!=magic || header[1]!=DATABASE_VERSION)
+   {
+#ifdef LIBROUTINO
+    return(1);
+#else
+    fprintf(stderr,"The file '%s' is not a database file of this version of Routino (format version %d); regenerate the database with planetsplitter.\n",filename,DATABASE_VERSION);
+    exit(EXIT_FAILURE);
+#endif
+   }
+
+ return(0);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Close a file on disk (and flush the buffer).
 
@@ -1049,6 +1629,230 @@ static void CreateFileBuffer(int fd,int read_write)
 }
 
 
+
+/*++++++++++++++++++++++++++++++++++++++
+  Map an opened file into memory (or copy it) and apply the selected MAP_OPTION_* values.
+
+  void *map_file_descriptor Returns the address of the memory or MAP_FAILED in case of an error.
+
+  int fd The file descriptor of the file to map.
+
+  size_t size The size of the file.
+
+  size_t *length Returns the length of the memory that was mapped.
+
+  int options The options for mapping the file (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *map_file_descriptor(int fd,size_t size,size_t *length,int options)
+{
+ void *address;
+
+ if(options&MAP_OPTION_COPY)
+    address=copy_file_anonymous(fd,size,length,options);
+ else
+   {
+    int flags=MAP_SHARED;
+
+#if defined(MAP_POPULATE)
+    if(options&MAP_OPTION_POPULATE)
+       flags|=MAP_POPULATE;
+#endif
+
+    address=mmap(NULL,size,PROT_READ,flags,fd,0);
+    *length=size;
+   }
+
+ if(address!=MAP_FAILED)
+    advise_mapped_file(address,*length,options);
+
+ return(address);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Copy a file into anonymous memory that is aligned for huge pages (with the MAP_OPTION_COPY option).
+
+  void *copy_file_anonymous Returns the address of the memory or MAP_FAILED in case of an error.
+
+  int fd The file descriptor of the file to copy.
+
+  size_t size The size of the file.
+
+  size_t *length Returns the length of the memory that was allocated.
+
+  int options The options for mapping the file (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *copy_file_anonymous(int fd,size_t size,size_t *length,int options)
+{
+ const size_t hugepage=2*1024*1024;
+ size_t rounded=(size+hugepage-1)&~(hugepage-1);
+ char *region,*address;
+ size_t offset;
+
+ /* Allocate more than needed and trim it so that the start is aligned */
+
+ region=(char*)mmap(NULL,rounded+hugepage,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+
+ if(region==MAP_FAILED)
+    return(MAP_FAILED);
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+
+ address=region;
+
+#else
+
+ address=(char*)(((uintptr_t)region+hugepage-1)&~(uintptr_t)(hugepage-1));
+
+ if(address>region)
+    munmap(region,(size_t)(address-region));
+
+ munmap(address+rounded,(size_t)(region+hugepage-address));
+
+#endif
+
+#if defined(MADV_HUGEPAGE)
+ if(options&MAP_OPTION_HUGEPAGE)
+    madvise(address,rounded,MADV_HUGEPAGE);
+#endif
+
+ /* Read the file in pieces of no more than 1 GB */
+
+ for(offset=0;offset<size;offset+=(1<<30))
+   {
+    size_t chunk=(size-offset)<(1<<30)?(size-offset):(1<<30);
+
+    if(SlimFetch(fd,address+offset,chunk,(offset_t)offset))
+      {
+       munmap(address,rounded);
+       return(MAP_FAILED);
+      }
+   }
+
+ mprotect(address,rounded,PROT_READ);
+
+ *length=rounded;
+
+ return(address);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Apply the selected MAP_OPTION_* advice and prefaulting to a memory mapped file.
+
+  void *address The address of the mapped file.
+
+  size_t length The length of the mapped file.
+
+  int options The options for mapping the file (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void advise_mapped_file(void *address,size_t length,int options)
+{
+#if defined(MADV_RANDOM)
+ if(options&MAP_OPTION_RANDOM)
+    madvise(address,length,MADV_RANDOM);
+#endif
+
+#if defined(MADV_WILLNEED)
+ if(options&MAP_OPTION_WILLNEED)
+    madvise(address,length,MADV_WILLNEED);
+#endif
+
+#if defined(MADV_HUGEPAGE)
+ if(options&MAP_OPTION_HUGEPAGE && !(options&MAP_OPTION_COPY))
+    madvise(address,length,MADV_HUGEPAGE);
+#endif
+
+#if !defined(MAP_POPULATE)
+
+ /* Touch every page if the operating system cannot populate the mapping */
+
+ if(options&MAP_OPTION_POPULATE && !(options&MAP_OPTION_COPY))
+   {
+    volatile const char *p=(const char*)address;
+    size_t offset;
+    char sum=0;
+
+    for(offset=0;offset<length;offset+=4096)
+       sum^=p[offset];
+
+    (void)sum;
+   }
+
+#endif
+}
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the section of an open database container file that replaces a separate file.
+
+  int find_container_section Returns the container number or -1 if the file is not part of a container.
+
+  const char *filename The name of the separate file.
+
+  int *section Returns the section number in the container.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int find_container_section(const char *filename,int *section)
+{
+ int container;
+
+ /* Search the most recently opened containers first so that a new database replaces an old one */
+
+ for(container=ncontainers-1;container>=0;container--)
+    if(containers[container] && containers[container]->open)
+      {
+       uint32_t i;
+
+       for(i=0;i<containers[container]->header.nsections;i++)
+          if(!strcmp(containers[container]->names[i],filename))
+            {
+             *section=(int)i;
+             return(container);
+            }
+      }
+
+ return(-1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Release one user of a database container file and unmap and close it if it is not used any more.
+
+  int container The container number.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void release_container(int container)
+{
+ struct containerinfo *info=containers[container];
+ uint32_t i;
+
+ if(--info->users>0)
+    return;
+
+ if(info->address)
+   {
+    munmap(info->address,info->length);
+
+#ifndef LIBROUTINO
+    log_munmap(info->length);
+#endif
+   }
+
+ CloseFile(info->fd);
+
+ for(i=0;i<info->header.nsections;i++)
+    free(info->names[i]);
+
+ free(info->filename);
+ free(info);
+
+ containers[container]=NULL;
+}
+
+
 #if defined(_MSC_VER) || defined(__MINGW32__)
 
 /*++++++++++++++++++++++++++++++++++++++
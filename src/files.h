@@ -41,6 +41,7 @@
 #define ssize_t SSIZE_T
 #else
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
@@ -61,20 +62,94 @@
 typedef int64_t offset_t;
 
 
+/* Constants */
+
+/*+ The options for loading memory mapped database files. +*/
+#define MAP_OPTION_POPULATE  1  /*+ Read all of the file into memory when it is mapped. +*/
+#define MAP_OPTION_WILLNEED  2  /*+ Advise the operating system that the whole file will be needed. +*/
+#define MAP_OPTION_RANDOM    4  /*+ Advise the operating system that the file will be accessed randomly. +*/
+#define MAP_OPTION_HUGEPAGE  8  /*+ Advise the operating system to use huge pages for the file. +*/
+#define MAP_OPTION_COPY     16  /*+ Copy the file into anonymous memory instead of mapping it. +*/
+#define MAP_OPTION_LOCK     32  /*+ Lock the super-node data into memory. +*/
+
+/*+ The magic string at the start of a database container file. +*/
+#define CONTAINER_MAGIC     "RoutinoDB"
+
+/*+ The version number of the database container file format. +*/
+#define CONTAINER_VERSION   1
+
+/*+ The alignment of the sections in a database container file. +*/
+#define CONTAINER_ALIGNMENT 4096
+
+/*+ The maximum number of sections in a database container file. +*/
+#define CONTAINER_SECTIONS  8
+
+/*+ The options used by planetsplitter to create the database (in the container file header). +*/
+#define CONTAINER_OPTION_COMPRESS   1  /*+ The nodes and segments are stored in compressed blocks. +*/
+#define CONTAINER_OPTION_ADJACENCY  2  /*+ The segments are stored with an adjacency array. +*/
+#define CONTAINER_OPTION_HILBERT    4  /*+ The nodes and segments are sorted along a Hilbert curve. +*/
+#define CONTAINER_OPTION_HIERARCHY  8  /*+ A contraction hierarchy is included. +*/
+#define CONTAINER_OPTION_LANDMARKS 16  /*+ The landmark distances are included. +*/
+#define CONTAINER_OPTION_SNAP      32  /*+ The nodes are stored with a segment snapping index. +*/
+
+
+/* Data structures */
+
+/*+ A section of a database container file that replaces one of the separate database files. +*/
+typedef struct _ContainerSection
+{
+ char     name[24];             /*+ The name of the separate file (without the directory and prefix). +*/
+
+ uint64_t offset;               /*+ The offset of the section from the start of the container file. +*/
+ uint64_t length;               /*+ The length of the section. +*/
+}
+ ContainerSection;
+
+/*+ The header at the start of a database container file. +*/
+typedef struct _ContainerFile
+{
+ char     magic[16];            /*+ The magic string (CONTAINER_MAGIC). +*/
+
+ uint32_t version;              /*+ The version of the container file format (CONTAINER_VERSION). +*/
+ uint32_t indexsize;            /*+ The size of the index type that the database was created with. +*/
+
+ uint32_t options;              /*+ The CONTAINER_OPTION_* values ORed together. +*/
+ uint32_t nsections;            /*+ The number of sections that are used. +*/
+
+ uint64_t nodes;                /*+ The number of nodes in the database. +*/
+ uint64_t segments;             /*+ The number of segments in the database. +*/
+ uint64_t ways;                 /*+ The number of ways in the database. +*/
+ uint64_t turnrelations;        /*+ The number of turn relations in the database. +*/
+
+ ContainerSection sections[CONTAINER_SECTIONS]; /*+ The table of sections. +*/
+}
+ ContainerFile;
+
+
 /* Functions in files.c */
 
 char *FileName(const char *dirname,const char *prefix, const char *name);
 
 void *MapFile(const char *filename);
+void *MapFileWithOptions(const char *filename,int options);
 void *MapFileWriteable(const char *filename);
 
 void *UnmapFile(const void *address);
 
+int MapOptionsByName(const char *names);
+void LockMemory(const void *address,size_t length,int options);
+
 int SlimMapFile(const char *filename);
+int SlimMapFileWithOptions(const char *filename,int options);
 int SlimMapFileWriteable(const char *filename);
 
 int SlimUnmapFile(int fd);
 
+int WriteContainer(const char *dirname,const char *prefix,ContainerFile *header,const char * const *names);
+int OpenContainer(const char *dirname,const char *prefix);
+int ReadContainerHeader(int container,ContainerFile *header);
+void CloseContainer(int container);
+
 int OpenFileBufferedNew(const char *filename);
 int OpenFileBufferedAppend(const char *filename);
 
@@ -97,19 +172,46 @@ void CloseFile(int fd);
 offset_t SizeFile(const char *filename);
 offset_t SizeFileFD(int fd);
 int ExistsFile(const char *filename);
+int CheckFileHeader(const char *filename,uint32_t magic);
 
 int DeleteFile(const char *filename);
 
 int RenameFile(const char *oldfilename,const char *newfilename);
 
+/* Global variables in files.c */
+
+extern offset_t *slimfileoffsets;
+extern int nslimfileoffsets;
+
+
 /* Functions in files.h */
 
+static inline offset_t SlimFileOffset(int fd);
 static inline int SlimReplace(int fd,const void *address,size_t length,offset_t position);
 static inline int SlimFetch(int fd,void *address,size_t length,offset_t position);
+static inline size_t SlimFetchBlock(int fd,void *address,size_t length,offset_t position);
+static inline void SlimReadahead(int fd,size_t length,offset_t position);
 
 
 /* Inline the frequently called functions */
 
+/*++++++++++++++++++++++++++++++++++++++
+  Find the offset of the data in a file that has been opened for slim mode access.
+
+  offset_t SlimFileOffset Returns the offset of the section in the container file or zero for a separate file.
+
+  int fd The file descriptor of the file.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline offset_t SlimFileOffset(int fd)
+{
+ if(fd<nslimfileoffsets)
+    return(slimfileoffsets[fd]);
+ else
+    return(0);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Write data to a file that has been opened for slim mode access.
 
@@ -126,6 +228,8 @@ static inline int SlimFetch(int fd,void *address,size_t length,offset_t position
 
 static inline int SlimReplace(int fd,const void *address,size_t length,offset_t position)
 {
+ position+=SlimFileOffset(fd);
+
  /* Seek and write the data */
 
 #if HAVE_PREAD_PWRITE
@@ -163,6 +267,8 @@ static inline int SlimReplace(int fd,const void *address,size_t length,offset_t
 
 static inline int SlimFetch(int fd,void *address,size_t length,offset_t position)
 {
+ position+=SlimFileOffset(fd);
+
  /* Seek and read the data */
 
 #if HAVE_PREAD_PWRITE
@@ -184,4 +290,67 @@ static inline int SlimFetch(int fd,void *address,size_t length,offset_t position
 }
 
 
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read a block of data from a file that has been opened for slim mode access (stopping early at the end of the file).
+
+  size_t SlimFetchBlock Returns the number of bytes read.
+
+  int fd The file descriptor to read from.
+
+  void *address The address the data is to be read into.
+
+  size_t length The maximum length of data to read.
+
+  offset_t position The position in the file to seek to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline size_t SlimFetchBlock(int fd,void *address,size_t length,offset_t position)
+{
+ ssize_t n;
+
+ position+=SlimFileOffset(fd);
+
+ /* Seek and read the data */
+
+#if HAVE_PREAD_PWRITE
+
+ n=pread(fd,address,length,position);
+
+#else
+
+ if(lseek(fd,position,SEEK_SET)!=position)
+    return(0);
+
+ n=read(fd,address,length);
+
+#endif
+
+ if(n<0)
+    return(0);
+
+ return((size_t)n);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Tell the operating system that part of a file opened for slim mode access will be read soon.
+
+  int fd The file descriptor that will be read.
+
+  size_t length The length of data that will be read.
+
+  offset_t position The position in the file that will be read.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline void SlimReadahead(int fd,size_t length,offset_t position)
+{
+#if defined(POSIX_FADV_WILLNEED)
+
+ posix_fadvise(fd,position+SlimFileOffset(fd),(off_t)length,POSIX_FADV_WILLNEED);
+
+#endif
+}
+
+
 #endif /* FILES_H */
@@ -32,16 +32,37 @@
 #include "routino.h"
 
 
+/* Forward definition for opaque type */
+
+typedef struct _Matrix Matrix;
+
+
 /* Functions in optimiser.c */
 
-Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+Results *CalculateRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,Profile *profile,
                         index_t start_node,index_t prev_segment,index_t finish_node,
                         int start_waypoint,int finish_waypoint);
 
+void CalculateRouteTotals(Context *context,Results *results,Segments *segments,Ways *ways,Profile *profile,distance_t *distance,duration_t *duration);
+
+Matrix *NewMatrix(int nfinish);
+void FreeMatrix(Matrix *matrix);
+
+void AddMatrixFinish(Context *context,Matrix *matrix,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                     int finish,index_t finish_node);
+
+void CalculateMatrixRow(Context *context,Matrix *matrix,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                        index_t start_node,int *status,distance_t *distances,duration_t *durations);
+
+Results *CalculateIsochrone(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                            index_t start_node,score_t limit);
+
 
 /* Functions in output.c */
 
-Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Translation *translation);
+Routino_Output *PrintRoute(Context *context,Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Translation *translation);
+
+Routino_Output *PrintIsochrone(Context *context,Results *results,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile,Translation *translation);
 
 
 #endif /* FUNCTIONS_H */
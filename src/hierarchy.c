@@ -0,0 +1,491 @@
+/***************************************
+ Contraction hierarchy data type functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+#include "hierarchy.h"
+
+#include "files.h"
+#include "profiles.h"
+
+
+/* Local functions */
+
+static int same_profile_scores(const Profile *profile1,const Profile *profile2);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in a contraction hierarchy from a file.
+
+  Hierarchy *LoadHierarchy Returns the hierarchy.
+
+  const char *filename The name of the file to load.
+
+  int mapoptions The options for loading the file into memory (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Hierarchy *LoadHierarchy(const char *filename,int mapoptions)
+{
+ Hierarchy *hierarchy;
+#if SLIM
+ int fd;
+ offset_t position;
+#endif
+
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,HIERARCHY_MAGIC))
+    return(NULL);
+
+ hierarchy=(Hierarchy*)calloc(1,sizeof(Hierarchy));
+
+#if !SLIM
+
+ hierarchy->data=MapFileWithOptions(filename,mapoptions);
+
+ /* Copy the HierarchyFile header structure from the loaded data */
+
+ hierarchy->file=*((HierarchyFile*)hierarchy->data);
+
+ /* Set the pointers in the Hierarchy structure. */
+
+ hierarchy->nodes   =(index_t*)(hierarchy->data+sizeof(HierarchyFile));
+ hierarchy->sorted  =hierarchy->nodes +hierarchy->file.number;
+ hierarchy->ranks   =hierarchy->sorted+hierarchy->file.number;
+ hierarchy->firstarc=hierarchy->ranks +hierarchy->file.number;
+ hierarchy->arcs    =hierarchy->firstarc+hierarchy->file.number+1;
+
+#else
+
+ fd=SlimMapFileWithOptions(filename,mapoptions);
+
+ /* Copy the HierarchyFile header structure from the loaded data */
+
+ SlimFetch(fd,&hierarchy->file,sizeof(HierarchyFile),0);
+
+ /* The whole hierarchy is needed for each route so read it all into memory */
+
+ hierarchy->nodes   =(index_t*)malloc((4*hierarchy->file.number+1+hierarchy->file.narcs)*sizeof(index_t));
+#ifndef LIBROUTINO
+ log_malloc(hierarchy->nodes,(4*hierarchy->file.number+1+hierarchy->file.narcs)*sizeof(index_t));
+#endif
+
+ hierarchy->sorted  =hierarchy->nodes +hierarchy->file.number;
+ hierarchy->ranks   =hierarchy->sorted+hierarchy->file.number;
+ hierarchy->firstarc=hierarchy->ranks +hierarchy->file.number;
+ hierarchy->arcs    =hierarchy->firstarc+hierarchy->file.number+1;
+
+ position=sizeof(HierarchyFile);
+
+ SlimFetch(fd,hierarchy->nodes,(4*hierarchy->file.number+1+hierarchy->file.narcs)*sizeof(index_t),position);
+
+ SlimUnmapFile(fd);
+
+#endif
+
+ /* The hierarchy is searched for every route so optionally lock it into memory */
+
+ LockMemory(hierarchy->nodes,(4*hierarchy->file.number+1+hierarchy->file.narcs)*sizeof(index_t),mapoptions);
+
+ return(hierarchy);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy the contraction hierarchy.
+
+  Hierarchy *hierarchy The hierarchy to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyHierarchy(Hierarchy *hierarchy)
+{
+ if(!hierarchy->copy)
+   {
+#if !SLIM
+
+    hierarchy->data=UnmapFile(hierarchy->data);
+
+#else
+
+#ifndef LIBROUTINO
+    log_free(hierarchy->nodes);
+#endif
+    free(hierarchy->nodes);
+
+#endif
+   }
+
+ if(hierarchy->up)
+   {
+#ifndef LIBROUTINO
+    log_free(hierarchy->up);
+    log_free(hierarchy->upvia);
+#endif
+    free(hierarchy->up);
+    free(hierarchy->upvia);
+   }
+
+ free(hierarchy);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Make a copy of a contraction hierarchy that shares the data from the file but
+  has its own arc scores so that it can be customised independently.
+
+  Hierarchy *CopyHierarchy Returns the copy of the hierarchy.
+
+  Hierarchy *hierarchy The hierarchy to copy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Hierarchy *CopyHierarchy(Hierarchy *hierarchy)
+{
+ Hierarchy *copy;
+
+ copy=(Hierarchy*)calloc(1,sizeof(Hierarchy));
+
+ copy->file=hierarchy->file;
+
+ copy->copy=1;
+
+ copy->nodes   =hierarchy->nodes;
+ copy->sorted  =hierarchy->sorted;
+ copy->ranks   =hierarchy->ranks;
+ copy->firstarc=hierarchy->firstarc;
+ copy->arcs    =hierarchy->arcs;
+
+ return(copy);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the rank of a node in the contraction hierarchy.
+
+  index_t HierarchyRank Returns the rank or NO_NODE if the node is not in the hierarchy.
+
+  Hierarchy *hierarchy The hierarchy to search.
+
+  index_t node The node to look for.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+index_t HierarchyRank(Hierarchy *hierarchy,index_t node)
+{
+ index_t start=0;
+ index_t end=hierarchy->file.number;
+
+ /* Binary search - search key exact match only is required. */
+
+ while(start<end)
+   {
+    index_t mid=start+(end-start)/2;
+
+    if(hierarchy->sorted[mid]<node)
+       start=mid+1;
+    else if(hierarchy->sorted[mid]>node)
+       end=mid;
+    else
+       return(hierarchy->ranks[mid]);
+   }
+
+ return(NO_NODE);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the arc between two nodes in the contraction hierarchy.
+
+  index_t FindHierarchyArc Returns the index of the arc or NO_SEGMENT if there is none.
+
+  Hierarchy *hierarchy The hierarchy to search.
+
+  index_t lower The rank of the lower node of the arc.
+
+  index_t higher The rank of the higher node of the arc.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+index_t FindHierarchyArc(Hierarchy *hierarchy,index_t lower,index_t higher)
+{
+ index_t start=hierarchy->firstarc[lower];
+ index_t end=hierarchy->firstarc[lower+1];
+
+ /* Binary search - search key exact match only is required. */
+
+ while(start<end)
+   {
+    index_t mid=start+(end-start)/2;
+
+    if(hierarchy->arcs[mid]<higher)
+       start=mid+1;
+    else if(hierarchy->arcs[mid]>higher)
+       end=mid;
+    else
+       return(mid);
+   }
+
+ return(NO_SEGMENT);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the arc scores in the contraction hierarchy for a particular profile.
+  The super-segments give the scores of the lowest level arcs and the shortcuts are
+  then filled in from the bottom of the hierarchy upwards.
+
+  Hierarchy *hierarchy The hierarchy to customise.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int quickest Set to calculate the scores for the quickest route instead of the shortest.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CustomiseHierarchy(Hierarchy *hierarchy,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile,int quickest)
+{
+ index_t narcs=hierarchy->file.narcs;
+ index_t rank,arc;
+ char *allowed;
+
+ if(hierarchy->customised && hierarchy->quickest==quickest && same_profile_scores(&hierarchy->profile,profile))
+    return;
+
+ if(!hierarchy->up)
+   {
+    /* The scores and the via/segment indexes are each allocated as a single block */
+
+    hierarchy->up=(score_t*)malloc(2*narcs*sizeof(score_t));
+    hierarchy->upvia=(index_t*)malloc(4*narcs*sizeof(index_t));
+#ifndef LIBROUTINO
+    log_malloc(hierarchy->up,2*narcs*sizeof(score_t));
+    log_malloc(hierarchy->upvia,4*narcs*sizeof(index_t));
+#endif
+
+    hierarchy->down=hierarchy->up+narcs;
+
+    hierarchy->downvia=hierarchy->upvia+narcs;
+    hierarchy->upseg  =hierarchy->upvia+2*narcs;
+    hierarchy->downseg=hierarchy->upvia+3*narcs;
+   }
+
+ for(arc=0;arc<narcs;arc++)
+   {
+    hierarchy->up[arc]=hierarchy->down[arc]=INF_SCORE;
+    hierarchy->upvia[arc]=hierarchy->downvia[arc]=NO_NODE;
+    hierarchy->upseg[arc]=hierarchy->downseg[arc]=NO_SEGMENT;
+   }
+
+ /* Find the nodes that can be passed through */
+
+ allowed=(char*)malloc(hierarchy->file.number);
+
+ for(rank=0;rank<hierarchy->file.number;rank++)
+   {
+    Node *nodep=LookupNode(nodes,hierarchy->nodes[rank],1);
+
+    allowed[rank]=!!(nodep->allow&profile->allow);
+   }
+
+ /* Use the super-segments for the scores of the arcs at the bottom of the hierarchy.
+    Arcs that enter a node that cannot be passed through are left unusable. */
+
+ for(rank=0;rank<hierarchy->file.number;rank++)
+   {
+    index_t node=hierarchy->nodes[rank];
+    Node *nodep=LookupNode(nodes,node,1);
+    Segment *segmentp=FirstSegment(segments,nodep,1);
+
+    while(segmentp)
+      {
+       WayCost *waycost;
+       index_t other,otherrank;
+       score_t segment_pref,segment_score;
+
+       if(!IsSuperSegment(segmentp))
+          goto endloop;
+
+       other=OtherNode(segmentp,node);
+
+       if(other==node)
+          goto endloop;
+
+       otherrank=HierarchyRank(hierarchy,other);
+
+       if(otherrank==NO_NODE || !allowed[otherrank])
+          goto endloop;
+
+       /* Only found from the lower ranked node unless both are in the core */
+
+       arc=FindHierarchyArc(hierarchy,rank,otherrank);
+
+       if(arc==NO_SEGMENT)
+          goto endloop;
+
+       waycost=LookupWayCost(profile,segmentp->way);
+
+       segment_pref=waycost->pref;
+
+       /* mode of transport, restrictions and preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       if(quickest==0)
+          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       else
+          segment_score=(score_t)WayCostDuration(DISTANCE(segmentp->distance),waycost)/segment_pref;
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(!(profile->oneway && IsOnewayTo(segmentp,node)) || waycost->bothways)
+          if(segment_score<hierarchy->up[arc])
+            {
+             hierarchy->up[arc]=segment_score;
+             hierarchy->upseg[arc]=IndexSegment(segments,segmentp);
+            }
+
+       if(!(profile->oneway && IsOnewayFrom(segmentp,node)) || waycost->bothways)
+          if(segment_score<hierarchy->down[arc])
+            {
+             hierarchy->down[arc]=segment_score;
+             hierarchy->downseg[arc]=IndexSegment(segments,segmentp);
+            }
+
+      endloop:
+
+       segmentp=NextSegment(segments,segmentp,node);
+      }
+   }
+
+ /* Fill in the shortcuts working up from the lowest ranked nodes; all arcs that can
+    form a shortcut through a node are final before that node is considered. */
+
+ for(rank=0;rank<hierarchy->file.number;rank++)
+   {
+    index_t arc1,arc2;
+
+    if(!allowed[rank])
+       continue;
+
+    /* Nodes in the core (with arcs to lower ranked nodes) are not contracted */
+
+    if(hierarchy->firstarc[rank]<hierarchy->firstarc[rank+1] && hierarchy->arcs[hierarchy->firstarc[rank]]<rank)
+       continue;
+
+    for(arc1=hierarchy->firstarc[rank];arc1<hierarchy->firstarc[rank+1];arc1++)
+       for(arc2=arc1+1;arc2<hierarchy->firstarc[rank+1];arc2++)
+         {
+          index_t lower=hierarchy->arcs[arc1],higher=hierarchy->arcs[arc2];
+          score_t score;
+
+          arc=FindHierarchyArc(hierarchy,lower,higher);
+
+          if(arc==NO_SEGMENT)
+             continue;
+
+          /* lower -> rank -> higher */
+
+          score=hierarchy->down[arc1]+hierarchy->up[arc2];
+
+          if(score<hierarchy->up[arc])
+            {
+             hierarchy->up[arc]=score;
+             hierarchy->upvia[arc]=rank;
+            }
+
+          /* higher -> rank -> lower */
+
+          score=hierarchy->down[arc2]+hierarchy->up[arc1];
+
+          if(score<hierarchy->down[arc])
+            {
+             hierarchy->down[arc]=score;
+             hierarchy->downvia[arc]=rank;
+            }
+         }
+   }
+
+ free(allowed);
+
+ /* Copy the scores of the arcs in the core to the copy stored with the higher ranked node */
+
+ for(rank=0;rank<hierarchy->file.number;rank++)
+    for(arc=hierarchy->firstarc[rank];arc<hierarchy->firstarc[rank+1] && hierarchy->arcs[arc]<rank;arc++)
+      {
+       index_t lower=FindHierarchyArc(hierarchy,hierarchy->arcs[arc],rank);
+
+       hierarchy->up[arc]  =hierarchy->down[lower];
+       hierarchy->down[arc]=hierarchy->up[lower];
+
+       hierarchy->upvia[arc]  =hierarchy->downvia[lower];
+       hierarchy->downvia[arc]=hierarchy->upvia[lower];
+
+       hierarchy->upseg[arc]  =hierarchy->downseg[lower];
+       hierarchy->downseg[arc]=hierarchy->upseg[lower];
+      }
+
+ hierarchy->customised=1;
+ hierarchy->quickest=quickest;
+ hierarchy->profile=*profile;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if two profiles give the same scores for the arcs of the hierarchy (the parts
+  of the profile that do not affect the scores and the pointers are not compared).
+
+  int same_profile_scores Returns 1 if the scores are the same or 0 if not.
+
+  const Profile *profile1 The first profile.
+
+  const Profile *profile2 The second profile.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int same_profile_scores(const Profile *profile1,const Profile *profile2)
+{
+ int i;
+
+ if(profile1->transport!=profile2->transport || profile1->allow!=profile2->allow)
+    return(0);
+
+ for(i=0;i<Highway_Count;i++)
+    if(profile1->highway[i]!=profile2->highway[i] || profile1->speed[i]!=profile2->speed[i])
+       return(0);
+
+ for(i=0;i<Property_Count;i++)
+    if(profile1->props[i]!=profile2->props[i])
+       return(0);
+
+ if(profile1->oneway!=profile2->oneway)
+    return(0);
+
+ if(profile1->weight!=profile2->weight || profile1->height!=profile2->height ||
+    profile1->width !=profile2->width  || profile1->length!=profile2->length)
+    return(0);
+
+ return(1);
+}
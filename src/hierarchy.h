@@ -0,0 +1,100 @@
+/***************************************
+ A header file for the contraction hierarchy.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef HIERARCHY_H
+#define HIERARCHY_H    /*+ To stop multiple inclusions. +*/
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "types.h"
+
+#include "files.h"
+#include "profiles.h"
+
+
+/* Data structures */
+
+
+/*+ A structure containing the header from the file. +*/
+typedef struct _HierarchyFile
+{
+ uint32_t     magic;            /*+ The magic number that identifies the type of file. +*/
+ uint32_t     version;          /*+ The version of the file format. +*/
+
+ index_t      number;           /*+ The number of super-nodes in the hierarchy (one per rank). +*/
+ index_t      narcs;            /*+ The number of arcs (super-segments and shortcuts). +*/
+}
+ HierarchyFile;
+
+
+/*+ A structure containing a contraction hierarchy (and the per-profile arc scores). +*/
+struct _Hierarchy
+{
+ HierarchyFile file;            /*+ The header data from the file. +*/
+
+ int           copy;            /*+ Set if the data below belongs to another hierarchy. +*/
+
+#if !SLIM
+
+ char         *data;            /*+ The memory mapped data. +*/
+
+#endif
+
+ index_t      *nodes;           /*+ The node index for each rank. +*/
+ index_t      *sorted;          /*+ The node indexes of the super-nodes in ascending order. +*/
+ index_t      *ranks;           /*+ The rank of each super-node in the sorted list. +*/
+
+ index_t      *firstarc;        /*+ The index of the first arc for each rank. +*/
+ index_t      *arcs;            /*+ The higher ranked node at the other end of each arc. +*/
+
+ int           customised;      /*+ Set if the scores below are valid for the profile. +*/
+ int           quickest;        /*+ Set if the scores below are for the quickest route. +*/
+ Profile       profile;         /*+ A copy of the profile that the scores were calculated for. +*/
+
+ score_t      *up;              /*+ The score of each arc going up the hierarchy. +*/
+ score_t      *down;            /*+ The score of each arc coming down the hierarchy. +*/
+
+ index_t      *upvia;           /*+ The rank of the node that each upward shortcut goes via (or NO_NODE). +*/
+ index_t      *downvia;         /*+ The rank of the node that each downward shortcut goes via (or NO_NODE). +*/
+
+ index_t      *upseg;           /*+ The super-segment for each upward arc that is not a shortcut. +*/
+ index_t      *downseg;         /*+ The super-segment for each downward arc that is not a shortcut. +*/
+};
+
+
+/* Functions in hierarchy.c */
+
+Hierarchy *LoadHierarchy(const char *filename,int mapoptions);
+
+void DestroyHierarchy(Hierarchy *hierarchy);
+
+Hierarchy *CopyHierarchy(Hierarchy *hierarchy);
+
+index_t HierarchyRank(Hierarchy *hierarchy,index_t node);
+
+index_t FindHierarchyArc(Hierarchy *hierarchy,index_t lower,index_t higher);
+
+void CustomiseHierarchy(Hierarchy *hierarchy,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile,int quickest);
+
+
+#endif /* HIERARCHY_H */
@@ -0,0 +1,519 @@
+/***************************************
+ Contraction hierarchy generating functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "hierarchy.h"
+
+#include "typesx.h"
+#include "nodesx.h"
+#include "segmentsx.h"
+#include "hierarchyx.h"
+
+#include "files.h"
+#include "logging.h"
+
+
+/* Local types */
+
+/*+ The uncontracted neighbours of a super-node while the hierarchy is being built. +*/
+typedef struct _NeighboursX
+{
+ index_t *nodes;                /*+ The neighbouring super-nodes. +*/
+ index_t  number;               /*+ The number of neighbouring super-nodes. +*/
+ index_t  size;                 /*+ The allocated size of the array. +*/
+}
+ NeighboursX;
+
+/*+ An entry in the heap used to choose the next super-node to contract. +*/
+typedef struct _HeapEntryX
+{
+ index_t  degree;               /*+ The number of neighbours when the entry was added. +*/
+ index_t  node;                 /*+ The super-node. +*/
+}
+ HeapEntryX;
+
+
+/* Local functions */
+
+static index_t find_supernode(index_t *supernodes,index_t number,index_t node);
+
+static int add_neighbour(NeighboursX *neighbours,index_t node);
+static void remove_neighbour(NeighboursX *neighbours,index_t node);
+
+static void heap_push(HeapEntryX **heap,index_t *number,index_t *size,index_t degree,index_t node);
+static int heap_pop(HeapEntryX *heap,index_t *number,HeapEntryX *entry);
+
+static int sort_by_index(index_t *a,index_t *b);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create a contraction hierarchy of the super-nodes and super-segments and save it to a file.
+
+  The super-nodes are contracted in order of fewest remaining neighbours and each one
+  that is removed gets shortcuts between all of its remaining neighbours.  No scores
+  are stored in the file, they are calculated by the router for each profile.
+
+  Contraction stops when every remaining super-node has more than the maximum number
+  of neighbours, so no node adds more than maxdegree*(maxdegree-1)/2 shortcuts.  The
+  remaining super-nodes form an uncontracted core at the top of the hierarchy; each
+  of them keeps arcs to all of its core neighbours (in both directions) and the router
+  searches the core like an ordinary graph.
+
+  NodesX *nodesx The set of nodes to use (sorted geographically).
+
+  SegmentsX *segmentsx The set of segments to use (sorted geographically).
+
+  index_t maxdegree The maximum number of neighbours of a super-node that is contracted.
+
+  const char *filename The name of the file to create.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void SaveHierarchy(NodesX *nodesx,SegmentsX *segmentsx,index_t maxdegree,const char *filename)
+{
+ HierarchyFile hierarchyfile={0};
+ index_t *supernodes=NULL,*ranks,*order,*firstarc,*arcs;
+ index_t nsupernodes=0,nsuperalloc=0;
+ NeighboursX *neighbours;
+ HeapEntryX *heap=NULL,entry;
+ index_t nheap=0,sizeheap=0;
+ index_t i,j,k,nedges=0,nshortcuts=0,ncore,narcs;
+ int fd;
+
+ /* Print the start message */
+
+ printf_first("Contracting Super-Nodes: Super-Nodes=0 Shortcuts=0");
+
+ /* Find the super-nodes */
+
+ nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
+
+ for(i=0;i<nodesx->number;i++)
+   {
+    NodeX nodex;
+
+    ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
+
+    if(nodex.flags&NODE_SUPER)
+      {
+       if(nsupernodes==nsuperalloc)
+         {
+          nsuperalloc+=1024*1024;
+          supernodes=(index_t*)realloc(supernodes,nsuperalloc*sizeof(index_t));
+
+          logassert(supernodes,"Failed to allocate memory (try using slim mode?)"); /* Check realloc() worked */
+         }
+
+       supernodes[nsupernodes++]=i;
+      }
+   }
+
+ nodesx->fd=CloseFileBuffered(nodesx->fd);
+
+ /* Create the neighbour lists from the super-segments */
+
+ neighbours=(NeighboursX*)calloc(nsupernodes+1,sizeof(NeighboursX));
+ log_malloc(neighbours,(nsupernodes+1)*sizeof(NeighboursX));
+
+ logassert(neighbours,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ segmentsx->fd=ReOpenFileBuffered(segmentsx->filename_tmp);
+
+ for(i=0;i<segmentsx->number;i++)
+   {
+    SegmentX segmentx;
+    index_t node1,node2;
+
+    ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX));
+
+    if(!(segmentx.distance&SEGMENT_SUPER) || segmentx.node1==segmentx.node2)
+       continue;
+
+    node1=find_supernode(supernodes,nsupernodes,segmentx.node1);
+    node2=find_supernode(supernodes,nsupernodes,segmentx.node2);
+
+    if(node1==NO_NODE || node2==NO_NODE)
+       continue;
+
+    if(add_neighbour(&neighbours[node1],node2))
+      {
+       add_neighbour(&neighbours[node2],node1);
+       nedges++;
+      }
+   }
+
+ segmentsx->fd=CloseFileBuffered(segmentsx->fd);
+
+ /* Contract the super-nodes */
+
+ ranks=(index_t*)malloc((nsupernodes+1)*sizeof(index_t));
+ order=(index_t*)malloc((nsupernodes+1)*sizeof(index_t));
+ log_malloc(ranks,(nsupernodes+1)*sizeof(index_t));
+ log_malloc(order,(nsupernodes+1)*sizeof(index_t));
+
+ logassert(ranks && order,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ for(i=0;i<nsupernodes;i++)
+   {
+    ranks[i]=NO_NODE;
+    heap_push(&heap,&nheap,&sizeheap,neighbours[i].number,i);
+   }
+
+ narcs=0;
+ k=0;
+
+ while(heap_pop(heap,&nheap,&entry))
+   {
+    NeighboursX *contracted=&neighbours[entry.node];
+
+    /* Ignore entries that are out of date */
+
+    if(ranks[entry.node]!=NO_NODE || entry.degree!=contracted->number)
+       continue;
+
+    /* Stop when the node with the fewest neighbours has too many; the rest form the core */
+
+    if(contracted->number>maxdegree)
+       break;
+
+    ranks[entry.node]=k;
+    order[k]=entry.node;
+    k++;
+
+    narcs+=contracted->number;
+
+    /* Add the shortcuts between the remaining neighbours */
+
+    for(i=0;i<contracted->number;i++)
+       for(j=i+1;j<contracted->number;j++)
+          if(add_neighbour(&neighbours[contracted->nodes[i]],contracted->nodes[j]))
+            {
+             add_neighbour(&neighbours[contracted->nodes[j]],contracted->nodes[i]);
+             nshortcuts++;
+            }
+
+    /* Remove the contracted node from the neighbours; its own list is kept for the arcs */
+
+    for(i=0;i<contracted->number;i++)
+      {
+       remove_neighbour(&neighbours[contracted->nodes[i]],entry.node);
+
+       heap_push(&heap,&nheap,&sizeheap,neighbours[contracted->nodes[i]].number,contracted->nodes[i]);
+      }
+
+    if(!(k%10000))
+       printf_middle("Contracting Super-Nodes: Super-Nodes=%"Pindex_t" Shortcuts=%"Pindex_t,k,nshortcuts);
+   }
+
+ free(heap);
+
+ /* Put the uncontracted super-nodes at the top of the hierarchy, each with arcs to all of its core neighbours */
+
+ ncore=nsupernodes-k;
+
+ for(i=0;i<nsupernodes;i++)
+    if(ranks[i]==NO_NODE)
+      {
+       ranks[i]=k;
+       order[k]=i;
+       k++;
+
+       narcs+=neighbours[i].number;
+      }
+
+ /* Print the final message */
+
+ printf_last("Contracted Super-Nodes: Super-Nodes=%"Pindex_t" Super-Segments=%"Pindex_t" Shortcuts=%"Pindex_t" Core=%"Pindex_t,nsupernodes,nedges,nshortcuts,ncore);
+
+ /* Create the arcs (each one stored with the lower ranked node, arcs in the core are stored with both nodes) */
+
+ printf_first("Writing Hierarchy: Super-Nodes=0");
+
+ firstarc=(index_t*)malloc((nsupernodes+1)*sizeof(index_t));
+ arcs=(index_t*)malloc((narcs+1)*sizeof(index_t));
+ log_malloc(firstarc,(nsupernodes+1)*sizeof(index_t));
+ log_malloc(arcs,(narcs+1)*sizeof(index_t));
+
+ logassert(firstarc && arcs,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ for(k=0,j=0;k<nsupernodes;k++)
+   {
+    NeighboursX *contracted=&neighbours[order[k]];
+
+    firstarc[k]=j;
+
+    for(i=0;i<contracted->number;i++)
+       arcs[j+i]=ranks[contracted->nodes[i]];
+
+    qsort(arcs+j,contracted->number,sizeof(index_t),(int (*)(const void*,const void*))sort_by_index);
+
+    j+=contracted->number;
+   }
+
+ firstarc[nsupernodes]=j;
+
+ /* Write out the file */
+
+ hierarchyfile.magic=HIERARCHY_MAGIC;
+ hierarchyfile.version=DATABASE_VERSION;
+
+ hierarchyfile.number=nsupernodes;
+ hierarchyfile.narcs=narcs;
+
+ fd=OpenFileBufferedNew(filename);
+
+ WriteFileBuffered(fd,&hierarchyfile,sizeof(HierarchyFile));
+
+ for(k=0;k<nsupernodes;k++)
+    WriteFileBuffered(fd,&supernodes[order[k]],sizeof(index_t));
+
+ WriteFileBuffered(fd,supernodes,nsupernodes*sizeof(index_t));
+ WriteFileBuffered(fd,ranks,nsupernodes*sizeof(index_t));
+ WriteFileBuffered(fd,firstarc,(nsupernodes+1)*sizeof(index_t));
+ WriteFileBuffered(fd,arcs,narcs*sizeof(index_t));
+
+ CloseFileBuffered(fd);
+
+ /* Free the memory */
+
+ for(i=0;i<nsupernodes;i++)
+    free(neighbours[i].nodes);
+
+ log_free(neighbours);
+ free(neighbours);
+
+ log_free(ranks);
+ log_free(order);
+ log_free(firstarc);
+ log_free(arcs);
+
+ free(supernodes);
+ free(ranks);
+ free(order);
+ free(firstarc);
+ free(arcs);
+
+ /* Print the final message */
+
+ printf_last("Wrote Hierarchy: Super-Nodes=%"Pindex_t" Arcs=%"Pindex_t,nsupernodes,narcs);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the position of a node in the sorted list of super-nodes.
+
+  index_t find_supernode Returns the position or NO_NODE if it is not a super-node.
+
+  index_t *supernodes The sorted list of super-nodes.
+
+  index_t number The number of super-nodes.
+
+  index_t node The node to look for.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t find_supernode(index_t *supernodes,index_t number,index_t node)
+{
+ index_t start=0;
+ index_t end=number;
+
+ while(start<end)
+   {
+    index_t mid=start+(end-start)/2;
+
+    if(supernodes[mid]<node)
+       start=mid+1;
+    else if(supernodes[mid]>node)
+       end=mid;
+    else
+       return(mid);
+   }
+
+ return(NO_NODE);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a node to a list of neighbours unless it is already there.
+
+  int add_neighbour Returns 1 if the node was added or 0 if it was already there.
+
+  NeighboursX *neighbours The list of neighbours.
+
+  index_t node The node to add.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int add_neighbour(NeighboursX *neighbours,index_t node)
+{
+ index_t i;
+
+ for(i=0;i<neighbours->number;i++)
+    if(neighbours->nodes[i]==node)
+       return(0);
+
+ if(neighbours->number==neighbours->size)
+   {
+    neighbours->size+=8;
+    neighbours->nodes=(index_t*)realloc(neighbours->nodes,neighbours->size*sizeof(index_t));
+
+    logassert(neighbours->nodes,"Failed to allocate memory (try using slim mode?)"); /* Check realloc() worked */
+   }
+
+ neighbours->nodes[neighbours->number++]=node;
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove a node from a list of neighbours.
+
+  NeighboursX *neighbours The list of neighbours.
+
+  index_t node The node to remove.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void remove_neighbour(NeighboursX *neighbours,index_t node)
+{
+ index_t i;
+
+ for(i=0;i<neighbours->number;i++)
+    if(neighbours->nodes[i]==node)
+      {
+       neighbours->nodes[i]=neighbours->nodes[--neighbours->number];
+       break;
+      }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add an entry to the heap (a binary heap with the lowest degree at the top).
+
+  HeapEntryX **heap The heap (may be reallocated).
+
+  index_t *number The number of entries in the heap.
+
+  index_t *size The allocated size of the heap.
+
+  index_t degree The degree of the node.
+
+  index_t node The node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void heap_push(HeapEntryX **heap,index_t *number,index_t *size,index_t degree,index_t node)
+{
+ index_t index;
+
+ if(*number==*size)
+   {
+    *size+=1024*1024;
+    *heap=(HeapEntryX*)realloc(*heap,*size*sizeof(HeapEntryX));
+
+    logassert(*heap,"Failed to allocate memory (try using slim mode?)"); /* Check realloc() worked */
+   }
+
+ index=(*number)++;
+
+ while(index>0)
+   {
+    index_t parent=(index-1)/2;
+
+    if((*heap)[parent].degree<degree || ((*heap)[parent].degree==degree && (*heap)[parent].node<node))
+       break;
+
+    (*heap)[index]=(*heap)[parent];
+    index=parent;
+   }
+
+ (*heap)[index].degree=degree;
+ (*heap)[index].node=node;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove the entry at the top of the heap.
+
+  int heap_pop Returns 1 if an entry was removed or 0 if the heap is empty.
+
+  HeapEntryX *heap The heap.
+
+  index_t *number The number of entries in the heap.
+
+  HeapEntryX *entry Returns the entry that was removed.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int heap_pop(HeapEntryX *heap,index_t *number,HeapEntryX *entry)
+{
+ HeapEntryX last;
+ index_t index=0;
+
+ if(*number==0)
+    return(0);
+
+ *entry=heap[0];
+
+ last=heap[--(*number)];
+
+ while(1)
+   {
+    index_t child=2*index+1;
+
+    if(child>=*number)
+       break;
+
+    if((child+1)<*number && (heap[child+1].degree<heap[child].degree ||
+                             (heap[child+1].degree==heap[child].degree && heap[child+1].node<heap[child].node)))
+       child++;
+
+    if(last.degree<heap[child].degree || (last.degree==heap[child].degree && last.node<heap[child].node))
+       break;
+
+    heap[index]=heap[child];
+    index=child;
+   }
+
+ if(*number>0)
+    heap[index]=last;
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the arcs into ascending order of the rank of the other node.
+
+  int sort_by_index Returns the comparison of the two values.
+
+  index_t *a The first value.
+
+  index_t *b The second value.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_index(index_t *a,index_t *b)
+{
+ if(*a<*b)
+    return(-1);
+ else if(*a>*b)
+    return(1);
+ else
+    return(0);
+}
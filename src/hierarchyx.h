@@ -0,0 +1,40 @@
+/***************************************
+ Header for contraction hierarchy functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef HIERARCHYX_H
+#define HIERARCHYX_H    /*+ To stop multiple inclusions. +*/
+
+#include "typesx.h"
+
+
+/* Constants */
+
+/*+ The default maximum number of neighbours of a super-node that is contracted. +*/
+#define DEFAULT_HIERARCHY_DEGREE 32
+
+
+/* Functions in hierarchyx.c */
+
+void SaveHierarchy(NodesX *nodesx,SegmentsX *segmentsx,index_t maxdegree,const char *filename);
+
+
+#endif /* HIERARCHYX_H */
@@ -0,0 +1,163 @@
+/***************************************
+ Landmark distance data type functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "landmarks.h"
+
+#include "files.h"
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in the landmark distances from a file.
+
+  Landmarks *LoadLandmarks Returns the landmarks.
+
+  const char *filename The name of the file to load.
+
+  int mapoptions The options for loading the file into memory (MAP_OPTION_* values ORed together).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Landmarks *LoadLandmarks(const char *filename,int mapoptions)
+{
+ Landmarks *landmarks;
+#if SLIM
+ int fd;
+ size_t size;
+#endif
+
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,LANDMARKS_MAGIC))
+    return(NULL);
+
+ landmarks=(Landmarks*)calloc(1,sizeof(Landmarks));
+
+#if !SLIM
+
+ landmarks->data=MapFileWithOptions(filename,mapoptions);
+
+ /* Copy the LandmarksFile header structure from the loaded data */
+
+ landmarks->file=*((LandmarksFile*)landmarks->data);
+
+ /* Set the pointers in the Landmarks structure. */
+
+ landmarks->landmarks=(index_t*)(landmarks->data+sizeof(LandmarksFile));
+ landmarks->sorted   =landmarks->landmarks+landmarks->file.nlandmarks;
+ landmarks->from     =(distance_t*)(landmarks->sorted+landmarks->file.number);
+ landmarks->to       =landmarks->from+(size_t)landmarks->file.number*landmarks->file.nlandmarks;
+
+#else
+
+ fd=SlimMapFileWithOptions(filename,mapoptions);
+
+ /* Copy the LandmarksFile header structure from the loaded data */
+
+ SlimFetch(fd,&landmarks->file,sizeof(LandmarksFile),0);
+
+ /* The distances are needed for every super-node that is searched so read them all into memory */
+
+ size=(landmarks->file.nlandmarks+landmarks->file.number)*sizeof(index_t)+
+      2*(size_t)landmarks->file.number*landmarks->file.nlandmarks*sizeof(distance_t);
+
+ landmarks->landmarks=(index_t*)malloc(size);
+#ifndef LIBROUTINO
+ log_malloc(landmarks->landmarks,size);
+#endif
+
+ landmarks->sorted   =landmarks->landmarks+landmarks->file.nlandmarks;
+ landmarks->from     =(distance_t*)(landmarks->sorted+landmarks->file.number);
+ landmarks->to       =landmarks->from+(size_t)landmarks->file.number*landmarks->file.nlandmarks;
+
+ SlimFetch(fd,landmarks->landmarks,size,sizeof(LandmarksFile));
+
+ SlimUnmapFile(fd);
+
+#endif
+
+ /* The distances are used for every super-node that is searched so optionally lock them into memory */
+
+ LockMemory(landmarks->landmarks,(landmarks->file.nlandmarks+landmarks->file.number)*sizeof(index_t)+
+                                 2*(size_t)landmarks->file.number*landmarks->file.nlandmarks*sizeof(distance_t),mapoptions);
+
+ return(landmarks);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy the landmark distances.
+
+  Landmarks *landmarks The landmarks to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyLandmarks(Landmarks *landmarks)
+{
+#if !SLIM
+
+ landmarks->data=UnmapFile(landmarks->data);
+
+#else
+
+#ifndef LIBROUTINO
+ log_free(landmarks->landmarks);
+#endif
+ free(landmarks->landmarks);
+
+#endif
+
+ free(landmarks);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the position of a super-node in the landmark distance tables.
+
+  index_t LandmarksIndex Returns the position or NO_NODE if the node is not a super-node.
+
+  Landmarks *landmarks The landmarks to search.
+
+  index_t node The node to look for.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+index_t LandmarksIndex(Landmarks *landmarks,index_t node)
+{
+ index_t start=0;
+ index_t end=landmarks->file.number;
+
+ /* Binary search - search key exact match only is required. */
+
+ while(start<end)
+   {
+    index_t mid=start+(end-start)/2;
+
+    if(landmarks->sorted[mid]<node)
+       start=mid+1;
+    else if(landmarks->sorted[mid]>node)
+       end=mid;
+    else
+       return(mid);
+   }
+
+ return(NO_NODE);
+}
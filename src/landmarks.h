@@ -0,0 +1,92 @@
+/***************************************
+ A header file for the landmark distances.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef LANDMARKS_H
+#define LANDMARKS_H    /*+ To stop multiple inclusions. +*/
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "types.h"
+
+#include "files.h"
+
+
+/* Constants */
+
+/*+ The distance to or from a landmark for a super-node that cannot be reached. +*/
+#define NO_LANDMARK_DISTANCE ((distance_t)~0)
+
+
+/* Data structures */
+
+
+/*+ A structure containing the header from the file. +*/
+typedef struct _LandmarksFile
+{
+ uint32_t     magic;            /*+ The magic number that identifies the type of file. +*/
+ uint32_t     version;          /*+ The version of the file format. +*/
+
+ index_t      number;           /*+ The number of super-nodes. +*/
+ index_t      nlandmarks;       /*+ The number of landmarks. +*/
+}
+ LandmarksFile;
+
+
+/*+ A structure containing the distances between the landmarks and the super-nodes. +*/
+struct _Landmarks
+{
+ LandmarksFile file;            /*+ The header data from the file. +*/
+
+#if !SLIM
+
+ char         *data;            /*+ The memory mapped data. +*/
+
+#endif
+
+ index_t      *landmarks;       /*+ The node index of each landmark. +*/
+ index_t      *sorted;          /*+ The node indexes of the super-nodes in ascending order. +*/
+
+ distance_t   *from;            /*+ The distance from each landmark to each super-node (landmarks vary fastest). +*/
+ distance_t   *to;              /*+ The distance from each super-node to each landmark (landmarks vary fastest). +*/
+};
+
+
+/* Functions in landmarks.c */
+
+Landmarks *LoadLandmarks(const char *filename,int mapoptions);
+
+void DestroyLandmarks(Landmarks *landmarks);
+
+index_t LandmarksIndex(Landmarks *landmarks,index_t node);
+
+
+/* Macros */
+
+/*+ Return the distances from the landmarks to a super-node given its position in the sorted list. +*/
+#define LandmarkDistancesFrom(xxx,yyy) (&(xxx)->from[(size_t)(yyy)*(xxx)->file.nlandmarks])
+
+/*+ Return the distances to the landmarks from a super-node given its position in the sorted list. +*/
+#define LandmarkDistancesTo(xxx,yyy)   (&(xxx)->to  [(size_t)(yyy)*(xxx)->file.nlandmarks])
+
+
+#endif /* LANDMARKS_H */
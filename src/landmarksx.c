@@ -0,0 +1,537 @@
+/***************************************
+ Landmark distance generating functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "landmarks.h"
+
+#include "typesx.h"
+#include "nodesx.h"
+#include "segmentsx.h"
+#include "landmarksx.h"
+
+#include "files.h"
+#include "logging.h"
+
+
+/* Local types */
+
+/*+ The super-segments leaving (or entering) each super-node while the distances are calculated. +*/
+typedef struct _GraphX
+{
+ index_t    *first;             /*+ The index of the first edge for each super-node. +*/
+ index_t    *other;             /*+ The super-node at the other end of each edge. +*/
+ distance_t *distance;          /*+ The length of each edge. +*/
+}
+ GraphX;
+
+/*+ An entry in the heap used to find the shortest distances. +*/
+typedef struct _QueueEntryX
+{
+ distance_t distance;           /*+ The distance when the entry was added. +*/
+ index_t    node;               /*+ The super-node. +*/
+}
+ QueueEntryX;
+
+
+/* Local functions */
+
+static index_t find_supernode(index_t *supernodes,index_t number,index_t node);
+
+static void create_graph(GraphX *graph,index_t *supernodes,index_t nsupernodes,SegmentsX *segmentsx,int reverse);
+static void free_graph(GraphX *graph);
+
+static void find_distances(GraphX *graph,index_t nsupernodes,index_t source,distance_t *distances,QueueEntryX **heap,index_t *size);
+
+static void heap_push(QueueEntryX **heap,index_t *number,index_t *size,distance_t distance,index_t node);
+static int heap_pop(QueueEntryX *heap,index_t *number,QueueEntryX *entry);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Choose a set of landmarks from the super-nodes, calculate the shortest distances along
+  the super-segments from each landmark to every super-node and back and save them to a file.
+
+  The first landmark is the super-node furthest from an arbitrary one and each of the others
+  is the super-node that is furthest from all of the landmarks already chosen.  Only the
+  distances are stored (obeying one-way restrictions), they are independent of the profile.
+
+  NodesX *nodesx The set of nodes to use (sorted geographically).
+
+  SegmentsX *segmentsx The set of segments to use (sorted geographically).
+
+  int nlandmarks The number of landmarks to choose.
+
+  const char *filename The name of the file to create.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void SaveLandmarks(NodesX *nodesx,SegmentsX *segmentsx,int nlandmarks,const char *filename)
+{
+ LandmarksFile landmarksfile={0};
+ index_t *supernodes=NULL,*landmarks;
+ index_t nsupernodes=0,nsuperalloc=0,sizeheap=0;
+ distance_t *from,*to,*distances,*mindistance;
+ GraphX forward,backward;
+ QueueEntryX *heap=NULL;
+ index_t i,source;
+ int l,fd;
+
+ /* Print the start message */
+
+ printf_first("Choosing Landmarks: Super-Nodes=0 Landmarks=0");
+
+ /* Find the super-nodes */
+
+ nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
+
+ for(i=0;i<nodesx->number;i++)
+   {
+    NodeX nodex;
+
+    ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
+
+    if(nodex.flags&NODE_SUPER)
+      {
+       if(nsupernodes==nsuperalloc)
+         {
+          nsuperalloc+=1024*1024;
+          supernodes=(index_t*)realloc(supernodes,nsuperalloc*sizeof(index_t));
+
+          logassert(supernodes,"Failed to allocate memory (try using slim mode?)"); /* Check realloc() worked */
+         }
+
+       supernodes[nsupernodes++]=i;
+      }
+   }
+
+ nodesx->fd=CloseFileBuffered(nodesx->fd);
+
+ if(nlandmarks>(int)nsupernodes)
+    nlandmarks=nsupernodes;
+
+ /* Create the graphs of super-segments in each direction */
+
+ create_graph(&forward ,supernodes,nsupernodes,segmentsx,0);
+ create_graph(&backward,supernodes,nsupernodes,segmentsx,1);
+
+ /* Allocate the distance tables */
+
+ landmarks  =(index_t*)malloc((nlandmarks+1)*sizeof(index_t));
+ from       =(distance_t*)malloc(((size_t)nsupernodes*nlandmarks+1)*sizeof(distance_t));
+ to         =(distance_t*)malloc(((size_t)nsupernodes*nlandmarks+1)*sizeof(distance_t));
+ distances  =(distance_t*)malloc((nsupernodes+1)*sizeof(distance_t));
+ mindistance=(distance_t*)malloc((nsupernodes+1)*sizeof(distance_t));
+ log_malloc(from,((size_t)nsupernodes*nlandmarks+1)*sizeof(distance_t));
+ log_malloc(to,((size_t)nsupernodes*nlandmarks+1)*sizeof(distance_t));
+
+ logassert(landmarks && from && to && distances && mindistance,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ /* Choose the landmarks and find the distances */
+
+ source=0;
+
+ if(nsupernodes>0)
+   {
+    find_distances(&forward,nsupernodes,0,distances,&heap,&sizeheap);
+
+    for(i=0;i<nsupernodes;i++)
+       if(distances[i]!=NO_LANDMARK_DISTANCE && distances[i]>distances[source])
+          source=i;
+   }
+
+ for(i=0;i<nsupernodes;i++)
+    mindistance[i]=NO_LANDMARK_DISTANCE;
+
+ for(l=0;l<nlandmarks;l++)
+   {
+    landmarks[l]=source;
+
+    find_distances(&forward,nsupernodes,source,distances,&heap,&sizeheap);
+
+    for(i=0;i<nsupernodes;i++)
+      {
+       from[(size_t)i*nlandmarks+l]=distances[i];
+
+       if(distances[i]<mindistance[i])
+          mindistance[i]=distances[i];
+      }
+
+    find_distances(&backward,nsupernodes,source,distances,&heap,&sizeheap);
+
+    for(i=0;i<nsupernodes;i++)
+       to[(size_t)i*nlandmarks+l]=distances[i];
+
+    /* The next landmark is the one furthest from all of the others (that can be reached) */
+
+    for(i=0;i<nsupernodes;i++)
+       if(mindistance[i]!=NO_LANDMARK_DISTANCE && mindistance[i]>mindistance[source])
+          source=i;
+
+    printf_middle("Choosing Landmarks: Super-Nodes=%"Pindex_t" Landmarks=%d",nsupernodes,l+1);
+   }
+
+ free(heap);
+
+ free_graph(&forward);
+ free_graph(&backward);
+
+ /* Print the final message */
+
+ printf_last("Chose Landmarks: Super-Nodes=%"Pindex_t" Landmarks=%d",nsupernodes,nlandmarks);
+
+ /* Write out the file */
+
+ printf_first("Writing Landmarks: Landmarks=%d",nlandmarks);
+
+ landmarksfile.magic=LANDMARKS_MAGIC;
+ landmarksfile.version=DATABASE_VERSION;
+
+ landmarksfile.number=nsupernodes;
+ landmarksfile.nlandmarks=nlandmarks;
+
+ fd=OpenFileBufferedNew(filename);
+
+ WriteFileBuffered(fd,&landmarksfile,sizeof(LandmarksFile));
+
+ for(l=0;l<nlandmarks;l++)
+    WriteFileBuffered(fd,&supernodes[landmarks[l]],sizeof(index_t));
+
+ WriteFileBuffered(fd,supernodes,nsupernodes*sizeof(index_t));
+ WriteFileBuffered(fd,from,(size_t)nsupernodes*nlandmarks*sizeof(distance_t));
+ WriteFileBuffered(fd,to,(size_t)nsupernodes*nlandmarks*sizeof(distance_t));
+
+ CloseFileBuffered(fd);
+
+ /* Free the memory */
+
+ log_free(from);
+ log_free(to);
+
+ free(supernodes);
+ free(landmarks);
+ free(from);
+ free(to);
+ free(distances);
+ free(mindistance);
+
+ /* Print the final message */
+
+ printf_last("Wrote Landmarks: Super-Nodes=%"Pindex_t" Landmarks=%d",nsupernodes,nlandmarks);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the position of a node in the sorted list of super-nodes.
+
+  index_t find_supernode Returns the position or NO_NODE if it is not a super-node.
+
+  index_t *supernodes The sorted list of super-nodes.
+
+  index_t number The number of super-nodes.
+
+  index_t node The node to look for.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t find_supernode(index_t *supernodes,index_t number,index_t node)
+{
+ index_t start=0;
+ index_t end=number;
+
+ while(start<end)
+   {
+    index_t mid=start+(end-start)/2;
+
+    if(supernodes[mid]<node)
+       start=mid+1;
+    else if(supernodes[mid]>node)
+       end=mid;
+    else
+       return(mid);
+   }
+
+ return(NO_NODE);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the graph of the super-segments that can be followed away from (or towards) each super-node.
+
+  GraphX *graph The graph to fill in.
+
+  index_t *supernodes The sorted list of super-nodes.
+
+  index_t nsupernodes The number of super-nodes.
+
+  SegmentsX *segmentsx The set of segments to use.
+
+  int reverse Set to create the graph of super-segments leading towards each super-node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void create_graph(GraphX *graph,index_t *supernodes,index_t nsupernodes,SegmentsX *segmentsx,int reverse)
+{
+ index_t *count,i,nedges=0;
+ int pass;
+
+ graph->first=(index_t*)calloc(nsupernodes+1,sizeof(index_t));
+ count=(index_t*)calloc(nsupernodes+1,sizeof(index_t));
+
+ logassert(graph->first && count,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ /* Count the edges on the first pass and store them on the second */
+
+ for(pass=0;pass<2;pass++)
+   {
+    segmentsx->fd=ReOpenFileBuffered(segmentsx->filename_tmp);
+
+    for(i=0;i<segmentsx->number;i++)
+      {
+       SegmentX segmentx;
+       index_t node1,node2;
+
+       ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX));
+
+       if(!(segmentx.distance&SEGMENT_SUPER) || segmentx.node1==segmentx.node2)
+          continue;
+
+       node1=find_supernode(supernodes,nsupernodes,segmentx.node1);
+       node2=find_supernode(supernodes,nsupernodes,segmentx.node2);
+
+       if(node1==NO_NODE || node2==NO_NODE)
+          continue;
+
+       /* The reverse graph has the edges pointing backwards */
+
+       if(reverse)
+         {
+          index_t temp=node1;
+          node1=node2;
+          node2=temp;
+         }
+
+       /* The edge from node1 to node2 (unless a one-way restriction prevents travel from segmentx.node1 to segmentx.node2) */
+
+       if(!(segmentx.distance&ONEWAY_2TO1))
+         {
+          if(pass==0)
+             graph->first[node1+1]++;
+          else
+            {
+             index_t edge=graph->first[node1]+count[node1]++;
+
+             graph->other[edge]=node2;
+             graph->distance[edge]=DISTANCE(segmentx.distance);
+            }
+         }
+
+       /* The edge from node2 to node1 (unless a one-way restriction prevents travel from segmentx.node2 to segmentx.node1) */
+
+       if(!(segmentx.distance&ONEWAY_1TO2))
+         {
+          if(pass==0)
+             graph->first[node2+1]++;
+          else
+            {
+             index_t edge=graph->first[node2]+count[node2]++;
+
+             graph->other[edge]=node1;
+             graph->distance[edge]=DISTANCE(segmentx.distance);
+            }
+         }
+      }
+
+    segmentsx->fd=CloseFileBuffered(segmentsx->fd);
+
+    if(pass==0)
+      {
+       for(i=0;i<nsupernodes;i++)
+          graph->first[i+1]+=graph->first[i];
+
+       nedges=graph->first[nsupernodes];
+
+       graph->other=(index_t*)malloc((nedges+1)*sizeof(index_t));
+       graph->distance=(distance_t*)malloc((nedges+1)*sizeof(distance_t));
+
+       logassert(graph->other && graph->distance,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+      }
+   }
+
+ free(count);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Free the memory used by a graph of super-segments.
+
+  GraphX *graph The graph to free.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void free_graph(GraphX *graph)
+{
+ free(graph->first);
+ free(graph->other);
+ free(graph->distance);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the shortest distance from one super-node to all of the others (Dijkstra's algorithm).
+
+  GraphX *graph The graph of super-segments to follow.
+
+  index_t nsupernodes The number of super-nodes.
+
+  index_t source The super-node to start from.
+
+  distance_t *distances Returns the distance to each super-node (or NO_LANDMARK_DISTANCE).
+
+  QueueEntryX **heap The heap to use (may be reallocated).
+
+  index_t *size The allocated size of the heap.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void find_distances(GraphX *graph,index_t nsupernodes,index_t source,distance_t *distances,QueueEntryX **heap,index_t *size)
+{
+ QueueEntryX entry;
+ index_t nheap=0,i;
+
+ for(i=0;i<nsupernodes;i++)
+    distances[i]=NO_LANDMARK_DISTANCE;
+
+ distances[source]=0;
+
+ heap_push(heap,&nheap,size,0,source);
+
+ while(heap_pop(*heap,&nheap,&entry))
+   {
+    index_t edge;
+
+    /* Ignore entries that are out of date */
+
+    if(entry.distance!=distances[entry.node])
+       continue;
+
+    for(edge=graph->first[entry.node];edge<graph->first[entry.node+1];edge++)
+      {
+       index_t other=graph->other[edge];
+       distance_t distance=entry.distance+graph->distance[edge];
+
+       if(distance<distances[other])
+         {
+          distances[other]=distance;
+
+          heap_push(heap,&nheap,size,distance,other);
+         }
+      }
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add an entry to the heap (a binary heap with the shortest distance at the top).
+
+  QueueEntryX **heap The heap (may be reallocated).
+
+  index_t *number The number of entries in the heap.
+
+  index_t *size The allocated size of the heap.
+
+  distance_t distance The distance to the node.
+
+  index_t node The node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void heap_push(QueueEntryX **heap,index_t *number,index_t *size,distance_t distance,index_t node)
+{
+ index_t index;
+
+ if(*number==*size)
+   {
+    *size+=1024*1024;
+    *heap=(QueueEntryX*)realloc(*heap,*size*sizeof(QueueEntryX));
+
+    logassert(*heap,"Failed to allocate memory (try using slim mode?)"); /* Check realloc() worked */
+   }
+
+ index=(*number)++;
+
+ while(index>0)
+   {
+    index_t parent=(index-1)/2;
+
+    if((*heap)[parent].distance<=distance)
+       break;
+
+    (*heap)[index]=(*heap)[parent];
+    index=parent;
+   }
+
+ (*heap)[index].distance=distance;
+ (*heap)[index].node=node;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove the entry at the top of the heap.
+
+  int heap_pop Returns 1 if an entry was removed or 0 if the heap is empty.
+
+  QueueEntryX *heap The heap.
+
+  index_t *number The number of entries in the heap.
+
+  QueueEntryX *entry Returns the entry that was removed.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int heap_pop(QueueEntryX *heap,index_t *number,QueueEntryX *entry)
+{
+ QueueEntryX last;
+ index_t index=0;
+
+ if(*number==0)
+    return(0);
+
+ *entry=heap[0];
+
+ last=heap[--(*number)];
+
+ while(1)
+   {
+    index_t child=2*index+1;
+
+    if(child>=*number)
+       break;
+
+    if((child+1)<*number && heap[child+1].distance<heap[child].distance)
+       child++;
+
+    if(last.distance<=heap[child].distance)
+       break;
+
+    heap[index]=heap[child];
+    index=child;
+   }
+
+ if(*number>0)
+    heap[index]=last;
+
+ return(1);
+}
@@ -0,0 +1,845 @@
+/***************************************
+ Matching a trace of points onto the highways (using a hidden Markov model).
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+#include "relations.h"
+
+#include "context.h"
+#include "results.h"
+#include "matcher.h"
+
+
+/* Constants */
+
+/*+ The maximum number of candidate segments for each point of the trace. +*/
+#define MATCH_CANDIDATES 8
+
+/*+ The distance from each point to look for candidate segments (as a multiple of the accuracy). +*/
+#define MATCH_RADIUS 4
+
+/*+ The extra distance to look for the nodes at the ends of the candidate segments (in km). +*/
+#define MATCH_NODE_SEARCH 0.5
+
+/*+ The distance between two points of the trace above which the trace is split into sections (in km). +*/
+#define MATCH_MAX_GAP 5
+
+/*+ The extra distance allowed for the route between two points beyond twice the straight line distance (in km). +*/
+#define MATCH_DETOUR 0.1
+
+/*+ The number of searches from the ends of the candidate segments that are kept for re-use. +*/
+#define MATCH_CACHE_SIZE 32
+
+
+/* Local types */
+
+/*+ A search outwards from one end of a candidate segment that is kept for re-use. +*/
+typedef struct _MatchSearch
+{
+ index_t    node;               /*+ The node that the search started from. +*/
+ index_t    segment;            /*+ The segment used to arrive at the start node. +*/
+
+ score_t    limit;              /*+ The distance limit of the search. +*/
+
+ Results   *results;            /*+ The results of the search (or NULL if this entry is unused). +*/
+
+ uint32_t   used;               /*+ When the search was last used (the least recently used one is replaced). +*/
+}
+ MatchSearch;
+
+/*+ The searches that are kept for re-use while matching a trace. +*/
+typedef struct _MatchCache
+{
+ MatchSearch searches[MATCH_CACHE_SIZE]; /*+ The searches. +*/
+
+ uint32_t   clock;              /*+ A counter that is incremented each time that a search is used. +*/
+}
+ MatchCache;
+
+/*+ The best way to reach one candidate segment of one point of the trace. +*/
+typedef struct _MatchState
+{
+ int        from;               /*+ The candidate of the previous point on the best path (or -1 if this starts a section). +*/
+
+ double     cost;               /*+ The total cost of the best path (or -1 if the candidate cannot be reached). +*/
+
+ distance_t route;              /*+ The distance along the highways from the candidate of the previous point. +*/
+
+ index_t    exit;               /*+ The node where the route leaves the previous segment (or NO_NODE if it stays on the segment). +*/
+ index_t    entry;              /*+ The node where the route joins this segment. +*/
+ index_t    entryseg;           /*+ The segment used to arrive at the entry node. +*/
+}
+ MatchState;
+
+
+/* Local functions */
+
+static int match_backtrack(NearbySegment *nearby,int *nnearby,MatchState *states,int last,MatchedPoint *matched);
+
+static distance_t match_transition(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                   MatchCache *cache,NearbySegment *from,NearbySegment *to,distance_t limit,distance_t accuracy,MatchState *state);
+static Results *match_search(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                             MatchCache *cache,index_t node,index_t segment,score_t limit);
+static score_t arrival_score(Context *context,Nodes *nodes,Segments *segments,Relations *relations,Profile *profile,
+                             Results *results,index_t node,index_t segment,index_t *arrival);
+static void expand_search(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                          Results *results,index_t start_node,index_t prev_segment,score_t limit);
+static int leave_allowed(Ways *ways,Profile *profile,Segment *segmentp,index_t node);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Match a trace of points (e.g. from a GPS) onto the highways. The candidates for each point are the
+  segments that pass close to it and the most likely sequence of candidates is found with a hidden
+  Markov model (Viterbi algorithm). The cost of each candidate depends on its distance from the point
+  and the cost of moving between the candidates of two consecutive points depends on the difference
+  between the distance along the highways and the straight line distance. The highway distances come
+  from searches with a distance limit outwards from the ends of the candidate segments which are kept
+  and re-used for the next point. The trace is split into sections where no route can be found.
+
+  int MatchTrace Returns the number of points that were matched.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type and allowed highways.
+
+  int npoints The number of points in the trace.
+
+  const double *latitudes The latitudes of the points (radians).
+
+  const double *longitudes The longitudes of the points (radians).
+
+  distance_t accuracy The accuracy of the points (the standard deviation of their errors).
+
+  MatchedPoint *matched Returns the matched position of each point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int MatchTrace(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+               int npoints,const double *latitudes,const double *longitudes,distance_t accuracy,MatchedPoint *matched)
+{
+ MatchCache cache;
+ NearbySegment *nearby;
+ MatchState *states;
+ int *nnearby;
+ distance_t radius;
+ int p,prev=-1,nmatched=0,i;
+
+ if(accuracy==0)
+    accuracy=1;
+
+ radius=MATCH_RADIUS*accuracy;
+
+ for(i=0;i<MATCH_CACHE_SIZE;i++)
+   {
+    cache.searches[i].results=NULL;
+    cache.searches[i].used=0;
+   }
+
+ cache.clock=0;
+
+ /* Find the candidate segments for all of the points */
+
+ nearby=(NearbySegment*)malloc(npoints*MATCH_CANDIDATES*sizeof(NearbySegment));
+ nnearby=(int*)malloc(npoints*sizeof(int));
+
+ states=(MatchState*)malloc(npoints*MATCH_CANDIDATES*sizeof(MatchState));
+
+ FindNearbySegments(nodes,segments,ways,npoints,latitudes,longitudes,radius+km_to_distance(MATCH_NODE_SEARCH),radius,
+                    profile,MATCH_CANDIDATES,nearby,nnearby);
+
+ /* Find the best path to each candidate of each point in turn */
+
+ for(p=0;p<npoints;p++)
+   {
+    NearbySegment *to=&nearby[p*MATCH_CANDIDATES];
+    MatchState *state=&states[p*MATCH_CANDIDATES];
+    int j,found=0;
+
+    matched[p].segment=NO_SEGMENT;
+
+    if(nnearby[p]==0)
+       continue;
+
+    if(prev>=0)
+      {
+       distance_t gap=Distance(latitudes[prev],longitudes[prev],latitudes[p],longitudes[p]);
+
+       if(gap<=km_to_distance(MATCH_MAX_GAP))
+         {
+          NearbySegment *from=&nearby[prev*MATCH_CANDIDATES];
+          MatchState *prevstate=&states[prev*MATCH_CANDIDATES];
+          distance_t limit=2*gap+2*radius+km_to_distance(MATCH_DETOUR);
+
+          for(j=0;j<nnearby[p];j++)
+            {
+             MatchState trans;
+
+             state[j].cost=-1;
+
+             for(i=0;i<nnearby[prev];i++)
+               {
+                distance_t route;
+                double cost;
+
+                if(prevstate[i].cost<0)
+                   continue;
+
+                route=match_transition(context,nodes,segments,ways,relations,profile,&cache,&from[i],&to[j],limit,accuracy,&trans);
+
+                if(route>limit)
+                   continue;
+
+                cost=prevstate[i].cost+fabs((double)route-(double)gap)/(double)accuracy;
+
+                if(state[j].cost<0 || cost<state[j].cost)
+                  {
+                   state[j]=trans;
+
+                   state[j].from=i;
+                   state[j].cost=cost;
+                   state[j].route=route;
+                  }
+               }
+
+             if(state[j].cost>=0)
+               {
+                state[j].cost+=0.5*((double)to[j].dist/(double)accuracy)*((double)to[j].dist/(double)accuracy);
+                found++;
+               }
+            }
+         }
+
+       /* Finish the previous section if none of the candidates can be reached */
+
+       if(!found)
+         {
+          nmatched+=match_backtrack(nearby,nnearby,states,prev,matched);
+          prev=-1;
+         }
+      }
+
+    /* Start a new section */
+
+    if(prev<0)
+       for(j=0;j<nnearby[p];j++)
+         {
+          state[j].from=-1;
+          state[j].cost=0.5*((double)to[j].dist/(double)accuracy)*((double)to[j].dist/(double)accuracy);
+          state[j].route=INF_DISTANCE;
+          state[j].exit=NO_NODE;
+          state[j].entry=NO_NODE;
+          state[j].entryseg=NO_SEGMENT;
+         }
+
+    prev=p;
+   }
+
+ if(prev>=0)
+    nmatched+=match_backtrack(nearby,nnearby,states,prev,matched);
+
+ /* Tidy up */
+
+ for(i=0;i<MATCH_CACHE_SIZE;i++)
+    if(cache.searches[i].results)
+       PutResultsList(&context->pool,cache.searches[i].results);
+
+ free(nearby);
+ free(nnearby);
+ free(states);
+
+ return(nmatched);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the route along the highways between two consecutive matched points of a trace.
+
+  index_t *MatchedRoute Returns an allocated array of the nodes passed through (or NULL if there are none).
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type and allowed highways (the same as for MatchTrace()).
+
+  MatchedPoint *from The previous matched point.
+
+  MatchedPoint *to The next matched point.
+
+  int *nnodes Returns the number of nodes in the array.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+index_t *MatchedRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                      MatchedPoint *from,MatchedPoint *to,int *nnodes)
+{
+ Results *results;
+ Result *result,*r;
+ index_t *route=NULL;
+ int n=0;
+
+ *nnodes=0;
+
+ if(from->segment==NO_SEGMENT || to->segment==NO_SEGMENT || to->route==INF_DISTANCE || to->exit==NO_NODE)
+    return(NULL);
+
+ /* Repeat the search from the node where the route left the previous segment */
+
+ results=GetResultsList(&context->pool,10);
+
+ expand_search(context,nodes,segments,ways,relations,profile,results,to->exit,from->segment,(score_t)to->route);
+
+ result=FindResult(results,to->entry,to->entryseg);
+
+ for(r=result;r;r=r->prev)
+    n++;
+
+ if(n>0)
+   {
+    route=(index_t*)malloc(n*sizeof(index_t));
+
+    *nnodes=n;
+
+    for(r=result;r;r=r->prev)
+       route[--n]=r->node;
+   }
+
+ PutResultsList(&context->pool,results);
+
+ return(route);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Follow the best path backwards from the end of a section of the trace and store the matched points.
+
+  int match_backtrack Returns the number of points in the section.
+
+  NearbySegment *nearby The candidate segments for all of the points.
+
+  int *nnearby The number of candidate segments for each point.
+
+  MatchState *states The best path to each candidate of each point.
+
+  int last The last point of the section.
+
+  MatchedPoint *matched Returns the matched position of each point in the section.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int match_backtrack(NearbySegment *nearby,int *nnearby,MatchState *states,int last,MatchedPoint *matched)
+{
+ int p=last,i,j=0,n=0;
+
+ for(i=1;i<nnearby[last];i++)
+    if(states[last*MATCH_CANDIDATES+i].cost>=0 &&
+       (states[last*MATCH_CANDIDATES+j].cost<0 || states[last*MATCH_CANDIDATES+i].cost<states[last*MATCH_CANDIDATES+j].cost))
+       j=i;
+
+ while(1)
+   {
+    NearbySegment *nearbyp=&nearby[p*MATCH_CANDIDATES+j];
+    MatchState *statep=&states[p*MATCH_CANDIDATES+j];
+
+    matched[p].segment =nearbyp->segment;
+    matched[p].node1   =nearbyp->node1;
+    matched[p].node2   =nearbyp->node2;
+    matched[p].dist1   =nearbyp->dist1;
+    matched[p].dist2   =nearbyp->dist2;
+    matched[p].error   =nearbyp->dist;
+
+    matched[p].route   =statep->route;
+    matched[p].exit    =statep->exit;
+    matched[p].entry   =statep->entry;
+    matched[p].entryseg=statep->entryseg;
+
+    n++;
+
+    if(statep->from<0)
+       break;
+
+    j=statep->from;
+
+    do
+       p--;
+    while(nnearby[p]==0);
+   }
+
+ return(n);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the distance along the highways from a candidate of one point to a candidate of the next point.
+
+  distance_t match_transition Returns the distance (or INF_DISTANCE if there is no route within the limit).
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type and allowed highways.
+
+  MatchCache *cache The searches that are kept for re-use.
+
+  NearbySegment *from The candidate of the previous point.
+
+  NearbySegment *to The candidate of the next point.
+
+  distance_t limit The maximum distance to search.
+
+  distance_t accuracy The accuracy of the points (a short movement backwards along a oneway segment is allowed).
+
+  MatchState *state Returns the nodes and segment where the route leaves and joins the segments.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static distance_t match_transition(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                   MatchCache *cache,NearbySegment *from,NearbySegment *to,distance_t limit,distance_t accuracy,MatchState *state)
+{
+ Segment *segmentp;
+ index_t exits[2],entries[2];
+ distance_t exitdist[2],entrydist[2];
+ distance_t best=INF_DISTANCE;
+ int nexits=0,nentries=0,x,y;
+
+ state->exit=NO_NODE;
+ state->entry=NO_NODE;
+ state->entryseg=NO_SEGMENT;
+
+ /* Moving along the same segment */
+
+ segmentp=LookupSegment(segments,from->segment,1);
+
+ if(from->segment==to->segment)
+   {
+    if(to->dist1>=from->dist1)
+      {
+       if((to->dist1-from->dist1)<=accuracy || leave_allowed(ways,profile,segmentp,from->node1))
+          return(to->dist1-from->dist1);
+      }
+    else
+      {
+       if((from->dist1-to->dist1)<=accuracy || leave_allowed(ways,profile,segmentp,from->node2))
+          return(from->dist1-to->dist1);
+      }
+   }
+
+ /* The ends of the previous segment that can be used to leave it */
+
+ if(leave_allowed(ways,profile,segmentp,from->node1))
+   {
+    exits[nexits]=from->node2;
+    exitdist[nexits++]=from->dist2;
+   }
+
+ if(leave_allowed(ways,profile,segmentp,from->node2))
+   {
+    exits[nexits]=from->node1;
+    exitdist[nexits++]=from->dist1;
+   }
+
+ /* The ends of the next segment that can be used to join it */
+
+ segmentp=LookupSegment(segments,to->segment,1);
+
+ if(leave_allowed(ways,profile,segmentp,to->node1))
+   {
+    entries[nentries]=to->node1;
+    entrydist[nentries++]=to->dist1;
+   }
+
+ if(leave_allowed(ways,profile,segmentp,to->node2))
+   {
+    entries[nentries]=to->node2;
+    entrydist[nentries++]=to->dist2;
+   }
+
+ /* Combine the searches from the exits with the distances to the entries */
+
+ for(x=0;x<nexits;x++)
+   {
+    Results *results;
+
+    if(exitdist[x]>=best || exitdist[x]>limit)
+       continue;
+
+    results=match_search(context,nodes,segments,ways,relations,profile,cache,exits[x],from->segment,(score_t)(limit-exitdist[x]));
+
+    for(y=0;y<nentries;y++)
+      {
+       index_t arrival;
+       score_t score;
+       distance_t route;
+
+       if((exitdist[x]+entrydist[y])>=best)
+          continue;
+
+       score=arrival_score(context,nodes,segments,relations,profile,results,entries[y],to->segment,&arrival);
+
+       if(score<0)
+          continue;
+
+       route=exitdist[x]+(distance_t)score+entrydist[y];
+
+       if(route<best)
+         {
+          best=route;
+
+          state->exit=exits[x];
+          state->entry=entries[y];
+          state->entryseg=arrival;
+         }
+      }
+   }
+
+ return(best);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get the search outwards from a node (re-using a previous search if one is available).
+
+  Results *match_search Returns the results of the search.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type and allowed highways.
+
+  MatchCache *cache The searches that are kept for re-use.
+
+  index_t node The node to start the search from.
+
+  index_t segment The segment used to arrive at the node.
+
+  score_t limit The minimum distance limit for the search.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *match_search(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                             MatchCache *cache,index_t node,index_t segment,score_t limit)
+{
+ MatchSearch *searchp=NULL;
+ int i;
+
+ cache->clock++;
+
+ for(i=0;i<MATCH_CACHE_SIZE;i++)
+    if(cache->searches[i].results && cache->searches[i].node==node && cache->searches[i].segment==segment)
+      {
+       searchp=&cache->searches[i];
+
+       if(searchp->limit>=limit)
+         {
+          searchp->used=cache->clock;
+
+          return(searchp->results);
+         }
+
+       break;
+      }
+
+ /* Replace the least recently used search if there is not one from this node */
+
+ if(!searchp)
+   {
+    searchp=&cache->searches[0];
+
+    for(i=1;i<MATCH_CACHE_SIZE;i++)
+       if(cache->searches[i].used<searchp->used)
+          searchp=&cache->searches[i];
+   }
+
+ if(searchp->results)
+    ResetResultsList(searchp->results);
+ else
+    searchp->results=GetResultsList(&context->pool,10);
+
+ /* Search further than needed now so that the search can be re-used for the next point */
+
+ limit+=limit/2;
+
+ expand_search(context,nodes,segments,ways,relations,profile,searchp->results,node,segment,limit);
+
+ searchp->node=node;
+ searchp->segment=segment;
+ searchp->limit=limit;
+ searchp->used=cache->clock;
+
+ return(searchp->results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the shortest distance in a search to a node from which a particular segment can be joined.
+
+  score_t arrival_score Returns the distance or -1 if the node was not reached.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type and allowed highways.
+
+  Results *results The results of the search.
+
+  index_t node The node to look for.
+
+  index_t segment The segment that is to be joined at the node.
+
+  index_t *arrival Returns the segment used to arrive at the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static score_t arrival_score(Context *context,Nodes *nodes,Segments *segments,Relations *relations,Profile *profile,
+                             Results *results,index_t node,index_t segment,index_t *arrival)
+{
+ Node *nodep=LookupNode(nodes,node,2);
+ Segment *segmentp;
+ score_t best=-1;
+
+ /* mode of transport must be allowed through the node */
+ if(!(nodep->allow&profile->allow))
+    return(-1);
+
+ segmentp=FirstSegment(segments,nodep,2);
+
+ do
+   {
+    index_t seg=IndexSegment(segments,segmentp);
+    Result *result;
+
+    /* must not perform U-turn (unless profile allows) */
+    if(profile->turns && seg==segment)
+       goto endloop;
+
+    result=FindResult(results,node,seg);
+
+    if(result && (best<0 || result->score<best))
+      {
+       /* must obey turn relations */
+       if(profile->turns && IsTurnRestrictedNode(nodep))
+         {
+          index_t turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node,seg);
+
+          if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node,seg,segment,profile->allow))
+             goto endloop;
+         }
+
+       best=result->score;
+       *arrival=seg;
+      }
+
+   endloop:
+
+    segmentp=NextSegment(segments,segmentp,node);
+   }
+ while(segmentp);
+
+ return(best);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Search outwards from a node for all of the nodes within a distance limit (like an isochrone but
+  by distance and starting from a segment so that turn restrictions apply at the start node).
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type and allowed highways.
+
+  Results *results The results list to fill in.
+
+  index_t start_node The start node.
+
+  index_t prev_segment The segment used to arrive at the start node.
+
+  score_t limit The maximum distance to search.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void expand_search(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                          Results *results,index_t start_node,index_t prev_segment,score_t limit)
+{
+ Queue   *queue;
+ Result  *result1,*result2;
+
+ /* Insert the first node into the queue */
+
+ queue=GetQueueList(&context->pool,10);
+
+ result1=InsertResult(results,start_node,prev_segment);
+
+ InsertInQueue(queue,result1,0);
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p;
+    Segment *segment2p;
+    index_t node1,seg1;
+    index_t turnrelation=NO_RELATION;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1p=LookupNode(nodes,node1,1);
+
+    /* mode of transport must be allowed through node1 */
+    if(!(node1p->allow&profile->allow))
+       continue;
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && IsTurnRestrictedNode(node1p))
+       turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1);
+
+    /* Loop across all segments */
+
+    segment2p=FirstSegment(segments,node1p,1);
+
+    while(segment2p)
+      {
+       WayCost *waycost2;
+       index_t node2,seg2;
+       score_t cumulative_score;
+
+       node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
+
+       /* must be a normal segment */
+       if(!IsNormalSegment(segment2p))
+          goto endloop;
+
+       waycost2=LookupWayCost(profile,segment2p->way);
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segment2p,node1) && !waycost2->bothways)
+          goto endloop;
+
+       seg2=IndexSegment(segments,segment2p);
+
+       /* must not perform U-turn (unless profile allows) */
+       if(profile->turns && seg1==seg2)
+          goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg1,seg2,profile->allow))
+          goto endloop;
+
+       /* mode of transport, restrictions and preferences must allow this highway */
+       if(waycost2->pref==0)
+          goto endloop;
+
+       /* must be within the limit */
+       cumulative_score=result1->score+(score_t)DISTANCE(segment2p->distance);
+
+       if(cumulative_score>limit)
+          goto endloop;
+
+       /* find whether the node/segment combination already exists */
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment combination */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       segment2p=NextSegment(segments,segment2p,node1);
+      }
+   }
+
+ PutQueueList(&context->pool,queue);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if a segment can be used to move away from one of its nodes.
+
+  int leave_allowed Returns true if the segment can be used.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type.
+
+  Segment *segmentp The segment.
+
+  index_t node The node to move away from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int leave_allowed(Ways *ways,Profile *profile,Segment *segmentp,index_t node)
+{
+ if(profile->oneway && IsOnewayTo(segmentp,node) && !LookupWayCost(profile,segmentp->way)->bothways)
+    return(0);
+
+ return(1);
+}
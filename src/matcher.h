@@ -0,0 +1,66 @@
+/***************************************
+ Header file for the trace matching data type and function prototypes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef MATCHER_H
+#define MATCHER_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "context.h"
+#include "profiles.h"
+
+
+/* Data structures */
+
+
+/*+ The position on the highways that one point of a trace has been matched to. +*/
+typedef struct _MatchedPoint
+{
+ index_t    segment;            /*+ The segment that the point is matched to (or NO_SEGMENT if the point is not matched). +*/
+
+ index_t    node1;              /*+ The first node of the segment. +*/
+ index_t    node2;              /*+ The second node of the segment. +*/
+
+ distance_t dist1;              /*+ The distance along the segment from the first node to the matched position. +*/
+ distance_t dist2;              /*+ The distance along the segment from the second node to the matched position. +*/
+
+ distance_t error;              /*+ The distance from the point of the trace to the matched position. +*/
+
+ distance_t route;              /*+ The distance along the highways from the previous matched point (or INF_DISTANCE if this starts a new section). +*/
+
+ index_t    exit;               /*+ The node where the route leaves the segment of the previous matched point (or NO_NODE if it stays on the segment). +*/
+ index_t    entry;              /*+ The node where the route joins the segment of this point. +*/
+ index_t    entryseg;           /*+ The segment used to arrive at the entry node. +*/
+}
+ MatchedPoint;
+
+
+/* Functions in matcher.c */
+
+int MatchTrace(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+               int npoints,const double *latitudes,const double *longitudes,distance_t accuracy,MatchedPoint *matched);
+
+index_t *MatchedRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                      MatchedPoint *from,MatchedPoint *to,int *nnodes);
+
+
+#endif /* MATCHER_H */
@@ -28,14 +28,69 @@
 #include "segments.h"
 #include "ways.h"
 
+#include "blocks.h"
 #include "files.h"
 #include "profiles.h"
 
 
+/* Constants */
+
+/*+ The maximum number of points in the same bin that are searched for together by FindClosestSegments(). +*/
+#define MAX_SNAP_GROUP 64
+
+
+/* Local types */
+
+/*+ A structure containing the search state for one of the points in FindClosestSegments(). +*/
+typedef struct _SnapPoint
+{
+ int        index;              /*+ The index of the point in the arrays passed to the function. +*/
+
+ double     latitude;           /*+ The latitude of the point. +*/
+ double     longitude;          /*+ The longitude of the point. +*/
+ double     coslat;             /*+ The cosine of the latitude of the point. +*/
+
+ ll_bin_t   latbin;             /*+ The latitude bin containing the point. +*/
+ ll_bin_t   lonbin;             /*+ The longitude bin containing the point. +*/
+
+ ll_bin_t   minlatbin;          /*+ The minimum latitude bin to search. +*/
+ ll_bin_t   maxlatbin;          /*+ The maximum latitude bin to search. +*/
+ ll_bin_t   minlonbin;          /*+ The minimum longitude bin to search. +*/
+ ll_bin_t   maxlonbin;          /*+ The maximum longitude bin to search. +*/
+
+ ll_off_t   minlatoff;          /*+ The minimum latitude offset to search in the minimum latitude bin. +*/
+ ll_off_t   maxlatoff;          /*+ The maximum latitude offset to search in the maximum latitude bin. +*/
+ ll_off_t   minlonoff;          /*+ The minimum longitude offset to search in the minimum longitude bin. +*/
+ ll_off_t   maxlonoff;          /*+ The maximum longitude offset to search in the maximum longitude bin. +*/
+
+ int        done;               /*+ Set to true when the search for this point has finished. +*/
+ int        count;              /*+ The number of bins searched for this point in the current ring of bins. +*/
+
+ distance_t dist1;              /*+ The distance from the point to the node being checked. +*/
+
+ index_t    bests;              /*+ The closest segment found so far. +*/
+ index_t    bestn1;             /*+ The node at one end of the closest segment. +*/
+ index_t    bestn2;             /*+ The node at the other end of the closest segment. +*/
+ distance_t bestd;              /*+ The distance to the closest segment. +*/
+ distance_t bestd1;             /*+ The distance along the closest segment to the node at one end. +*/
+ distance_t bestd2;             /*+ The distance along the closest segment to the node at the other end. +*/
+
+ NearbySegment *nearby;         /*+ The nearby segments sorted by distance (FindNearbySegments() only, otherwise NULL). +*/
+ int        nnearby;            /*+ The number of nearby segments found so far. +*/
+ int        maxnearby;          /*+ The maximum number of nearby segments to keep. +*/
+}
+ SnapPoint;
+
+
 /* Local functions */
 
 static int valid_segment_for_profile(Ways *ways,Segment *segmentp,Profile *profile);
 
+static void init_snap_point(Nodes *nodes,SnapPoint *pointp,int index,double latitude,double longitude,distance_t distance);
+static void search_snap_points(Nodes *nodes,Segments *segments,Ways *ways,SnapPoint *points,int npoints,distance_t distance,Profile *profile);
+static void update_snap_point(SnapPoint *pointp,index_t segment,index_t node,index_t othernode,int node1,double distp,double dist3a,double dist3b);
+static int sort_by_bin(SnapPoint *a,SnapPoint *b);
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Load in a node list from a file.
@@ -43,20 +98,27 @@ static int valid_segment_for_profile(Ways *ways,Segment *segmentp,Profile *profi
   Nodes *LoadNodeList Returns the node list.
 
   const char *filename The name of the file to load.
+
+  int mapoptions The options for loading the file into memory (MAP_OPTION_* values ORed together).
+
+  size_t cachesize The amount of memory to use for all of the caches of the database in slim mode (or 0 for the default sizes).
   ++++++++++++++++++++++++++++++++++++++*/
 
-Nodes *LoadNodeList(const char *filename)
+Nodes *LoadNodeList(const char *filename,int mapoptions,size_t cachesize)
 {
  Nodes *nodes;
-#if SLIM
- size_t sizeoffsets;
-#endif
+ size_t sizeoffsets,sizebins,sizepositions,sizesnaps;
+
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,NODES_MAGIC))
+    return(NULL);
 
  nodes=(Nodes*)malloc(sizeof(Nodes));
 
 #if !SLIM
 
- nodes->data=MapFile(filename);
+ nodes->data=MapFileWithOptions(filename,mapoptions);
 
  /* Copy the NodesFile header structure from the loaded data */
 
@@ -64,12 +126,49 @@ Nodes *LoadNodeList(const char *filename)
 
  /* Set the pointers in the Nodes structure. */
 
- nodes->offsets=(index_t*)(nodes->data+sizeof(NodesFile));
- nodes->nodes  =(Node*   )(nodes->data+sizeof(NodesFile)+(nodes->file.latbins*nodes->file.lonbins+1)*sizeof(index_t));
+ sizeoffsets=(nodes->file.latbins*nodes->file.lonbins+1)*sizeof(index_t);
+ sizebins=nodes->file.hilbert?2*nodes->file.latbins*nodes->file.lonbins*sizeof(ll_bin2_t):0;
+ sizepositions=nodes->file.number*sizeof(NodePosition);
+ sizesnaps=nodes->file.nsnaps?(nodes->file.number+1)*sizeof(index_t)+nodes->file.nsnaps*sizeof(NodeSnap):0;
+
+ nodes->offsets  =(index_t*     )(nodes->data+sizeof(NodesFile));
+ nodes->positions=(NodePosition*)(nodes->data+sizeof(NodesFile)+sizeoffsets+sizebins);
+ nodes->nodes    =(Node*        )(nodes->data+sizeof(NodesFile)+sizeoffsets+sizebins+sizepositions+sizesnaps);
+
+ if(nodes->file.nsnaps)
+   {
+    nodes->firstsnap=(index_t* )(nodes->data+sizeof(NodesFile)+sizeoffsets+sizebins+sizepositions);
+    nodes->snaps    =(NodeSnap*)(nodes->firstsnap+nodes->file.number+1);
+   }
+ else
+   {
+    nodes->firstsnap=NULL;
+    nodes->snaps=NULL;
+   }
+
+ if(nodes->file.hilbert)
+   {
+    nodes->binrank =(ll_bin2_t*)(nodes->data+sizeof(NodesFile)+sizeoffsets);
+    nodes->binorder=nodes->binrank+nodes->file.latbins*nodes->file.lonbins;
+   }
+ else
+    nodes->binrank=nodes->binorder=NULL;
+
+ /* Decompress the nodes if they are stored in blocks */
+
+ if(nodes->file.blocksize)
+   {
+    nodes->nodes=(Node*)malloc(nodes->file.number*sizeof(Node));
+#ifndef LIBROUTINO
+    log_malloc(nodes->nodes,nodes->file.number*sizeof(Node));
+#endif
+
+    DecodeAllNodeBlocks(nodes->data+sizeof(NodesFile)+sizeoffsets+sizebins+sizepositions+sizesnaps,nodes->nodes,nodes->file.number);
+   }
 
 #else
 
- nodes->fd=SlimMapFile(filename);
+ nodes->fd=SlimMapFileWithOptions(filename,mapoptions);
 
  /* Copy the NodesFile header structure from the loaded data */
 
@@ -84,13 +183,61 @@ Nodes *LoadNodeList(const char *filename)
 
  SlimFetch(nodes->fd,nodes->offsets,sizeoffsets,sizeof(NodesFile));
 
- nodes->nodesoffset=(offset_t)(sizeof(NodesFile)+sizeoffsets);
+ /* Copy the bin ranks and order if the bins are stored in Hilbert curve order */
+
+ sizebins=nodes->file.hilbert?2*nodes->file.latbins*nodes->file.lonbins*sizeof(ll_bin2_t):0;
 
- nodes->cache=NewNodeCache();
+ if(nodes->file.hilbert)
+   {
+    nodes->binrank=(ll_bin2_t*)malloc(sizebins);
 #ifndef LIBROUTINO
- log_malloc(nodes->cache,sizeof(*nodes->cache));
+    log_malloc(nodes->binrank,sizebins);
 #endif
 
+    SlimFetch(nodes->fd,nodes->binrank,sizebins,sizeof(NodesFile)+sizeoffsets);
+
+    nodes->binorder=nodes->binrank+nodes->file.latbins*nodes->file.lonbins;
+   }
+ else
+    nodes->binrank=nodes->binorder=NULL;
+
+ sizepositions=nodes->file.number*sizeof(NodePosition);
+ sizesnaps=nodes->file.nsnaps?(nodes->file.number+1)*sizeof(index_t)+nodes->file.nsnaps*sizeof(NodeSnap):0;
+
+ nodes->positionsoffset=(offset_t)(sizeof(NodesFile)+sizeoffsets+sizebins);
+ nodes->firstsnapoffset=nodes->positionsoffset+sizepositions;
+ nodes->snapsoffset=nodes->firstsnapoffset+(offset_t)(nodes->file.number+1)*sizeof(index_t);
+ nodes->nodesoffset=nodes->positionsoffset+sizepositions+sizesnaps;
+
+ nodes->poscache=NewNodePositionCache(CacheShare(cachesize,10),option_cache_block);
+#ifndef LIBROUTINO
+ log_malloc(nodes->poscache,nodes->poscache->stats.size);
+#endif
+
+ /* Use a cache of decompressed blocks if the nodes are stored in blocks */
+
+ if(nodes->file.blocksize)
+   {
+    nodes->blockindexoffset=nodes->nodesoffset;
+    nodes->nodesoffset+=BlockIndexSize(nodes->file.number);
+
+    nodes->cache=NULL;
+
+    nodes->blockcache=NewNodeBlockCache(nodes->file.number,CacheShare(cachesize,15));
+#ifndef LIBROUTINO
+    log_malloc(nodes->blockcache,nodes->blockcache->stats.size);
+#endif
+   }
+ else
+   {
+    nodes->cache=NewNodeCache(CacheShare(cachesize,15),option_cache_block);
+#ifndef LIBROUTINO
+    log_malloc(nodes->cache,nodes->cache->stats.size);
+#endif
+
+    nodes->blockcache=NULL;
+   }
+
 #endif
 
  return(nodes);
@@ -107,6 +254,14 @@ void DestroyNodeList(Nodes *nodes)
 {
 #if !SLIM
 
+ if(nodes->file.blocksize)
+   {
+#ifndef LIBROUTINO
+    log_free(nodes->nodes);
+#endif
+    free(nodes->nodes);
+   }
+
  nodes->data=UnmapFile(nodes->data);
 
 #else
@@ -118,10 +273,34 @@ void DestroyNodeList(Nodes *nodes)
 #endif
  free(nodes->offsets);
 
+ if(nodes->binrank)
+   {
 #ifndef LIBROUTINO
- log_free(nodes->cache);
+    log_free(nodes->binrank);
 #endif
- DeleteNodeCache(nodes->cache);
+    free(nodes->binrank);
+   }
+
+ if(nodes->cache)
+   {
+#ifndef LIBROUTINO
+    log_free(nodes->cache);
+#endif
+    DeleteNodeCache(nodes->cache);
+   }
+
+#ifndef LIBROUTINO
+ log_free(nodes->poscache);
+#endif
+ DeleteNodePositionCache(nodes->poscache);
+
+ if(nodes->blockcache)
+   {
+#ifndef LIBROUTINO
+    log_free(nodes->blockcache);
+#endif
+    DeleteNodeBlockCache(nodes->blockcache);
+   }
 
 #endif
 
@@ -209,33 +388,34 @@ index_t FindClosestNode(Nodes *nodes,Segments *segments,Ways *ways,double latitu
           llbin=lonb*nodes->file.latbins+latb;
 
           index1=LookupNodeOffset(nodes,llbin);
-          index2=LookupNodeOffset(nodes,llbin+1);
+          index2=LookupNodeOffsetEnd(nodes,llbin);
 
           for(i=index1;i<index2;i++)
             {
-             Node *nodep=LookupNode(nodes,i,3);
+             NodePosition *positionp=LookupNodePosition(nodes,i,2);
              double lat,lon;
              distance_t dist;
 
-             if(latb==minlatbin && nodep->latoffset<minlatoff)
+             if(latb==minlatbin && positionp->latoffset<minlatoff)
                 continue;
 
-             if(latb==maxlatbin && nodep->latoffset>maxlatoff)
+             if(latb==maxlatbin && positionp->latoffset>maxlatoff)
                 continue;
 
-             if(lonb==minlonbin && nodep->lonoffset<minlonoff)
+             if(lonb==minlonbin && positionp->lonoffset<minlonoff)
                 continue;
 
-             if(lonb==maxlonbin && nodep->lonoffset>maxlonoff)
+             if(lonb==maxlonbin && positionp->lonoffset>maxlonoff)
                 continue;
 
-             lat=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(nodep->latoffset));
-             lon=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(nodep->lonoffset));
+             lat=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(positionp->latoffset));
+             lon=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(positionp->lonoffset));
 
              dist=Distance(lat,lon,latitude,longitude);
 
              if(dist<bestd)
                {
+                Node *nodep=LookupNode(nodes,i,3);
                 Segment *segmentp;
 
                 /* Check that at least one segment is valid for the profile */
@@ -308,16 +488,157 @@ index_t FindClosestSegment(Nodes *nodes,Segments *segments,Ways *ways,double lat
                            distance_t distance,Profile *profile, distance_t *bestdist,
                            index_t *bestnode1,index_t *bestnode2,distance_t *bestdist1,distance_t *bestdist2)
 {
- ll_bin_t   latbin=latlong_to_bin(radians_to_latlong(latitude ))-nodes->file.latzero;
- ll_bin_t   lonbin=latlong_to_bin(radians_to_latlong(longitude))-nodes->file.lonzero;
- int        delta=0,count;
- index_t    i,index1,index2;
- index_t    bestn1=NO_NODE,bestn2=NO_NODE;
- distance_t bestd=INF_DISTANCE,bestd1=INF_DISTANCE,bestd2=INF_DISTANCE;
- index_t    bests=NO_SEGMENT;
+ index_t bestsegment;
 
- /* Find the maximum distance to search */
+ FindClosestSegments(nodes,segments,ways,1,&latitude,&longitude,distance,profile,&bestsegment,bestdist,
+                     bestnode1,bestnode2,bestdist1,bestdist2);
+
+ return(bestsegment);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the closest segment to each of a set of latitudes and longitudes. The points are sorted by
+  the bin that contains them and the points that share a bin also share the search through the
+  nearby bins so that each node and segment is only read once for all of them. The result for each
+  point is the same as calling FindClosestSegment() for it.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to search.
+
+  Ways *ways The set of ways to use.
+
+  int npoints The number of points.
+
+  const double *latitudes The latitudes to look for.
+
+  const double *longitudes The longitudes to look for.
+
+  distance_t distance The maximum distance to look from the specified coordinates.
+
+  Profile *profile The profile of the mode of transport.
+
+  index_t *bestsegment Returns the closest segment index for each point (or NO_SEGMENT if none).
+
+  distance_t *bestdist Returns the distance to the closest point on the best segment for each point.
+
+  index_t *bestnode1 Returns the index of the node at one end of the closest segment for each point.
+
+  index_t *bestnode2 Returns the index of the node at the other end of the closest segment for each point.
+
+  distance_t *bestdist1 Returns the distance along the segment to the node at one end for each point.
+
+  distance_t *bestdist2 Returns the distance along the segment to the node at the other end for each point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void FindClosestSegments(Nodes *nodes,Segments *segments,Ways *ways,int npoints,const double *latitudes,const double *longitudes,
+                         distance_t distance,Profile *profile,index_t *bestsegment,distance_t *bestdist,
+                         index_t *bestnode1,index_t *bestnode2,distance_t *bestdist1,distance_t *bestdist2)
+{
+ SnapPoint *points;
+ int p;
+
+ points=(SnapPoint*)malloc(npoints*sizeof(SnapPoint));
+
+ for(p=0;p<npoints;p++)
+    init_snap_point(nodes,&points[p],p,latitudes[p],longitudes[p],distance);
+
+ search_snap_points(nodes,segments,ways,points,npoints,distance,profile);
+
+ /* Return the results in the original order */
+
+ for(p=0;p<npoints;p++)
+   {
+    SnapPoint *pointp=&points[p];
+
+    bestsegment[pointp->index]=pointp->bests;
+    bestdist   [pointp->index]=pointp->bestd;
+    bestnode1  [pointp->index]=pointp->bestn1;
+    bestnode2  [pointp->index]=pointp->bestn2;
+    bestdist1  [pointp->index]=pointp->bestd1;
+    bestdist2  [pointp->index]=pointp->bestd2;
+   }
+
+ free(points);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the segments that pass close to each of a set of latitudes and longitudes. This uses the
+  same shared search as FindClosestSegments() but keeps the closest few segments within a radius
+  instead of only the closest one.
+
+  Nodes *nodes The set of nodes to use.
 
+  Segments *segments The set of segments to search.
+
+  Ways *ways The set of ways to use.
+
+  int npoints The number of points.
+
+  const double *latitudes The latitudes to look for.
+
+  const double *longitudes The longitudes to look for.
+
+  distance_t distance The maximum distance to look for the nodes at the ends of the segments.
+
+  distance_t radius The maximum distance from the point to the closest point on a segment.
+
+  Profile *profile The profile of the mode of transport.
+
+  int maxnearby The maximum number of segments to return for each point.
+
+  NearbySegment *nearby Returns the nearby segments sorted by distance (maxnearby for each point in order).
+
+  int *nnearby Returns the number of nearby segments found for each point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void FindNearbySegments(Nodes *nodes,Segments *segments,Ways *ways,int npoints,const double *latitudes,const double *longitudes,
+                        distance_t distance,distance_t radius,Profile *profile,int maxnearby,NearbySegment *nearby,int *nnearby)
+{
+ SnapPoint *points;
+ int p;
+
+ points=(SnapPoint*)malloc(npoints*sizeof(SnapPoint));
+
+ for(p=0;p<npoints;p++)
+   {
+    init_snap_point(nodes,&points[p],p,latitudes[p],longitudes[p],distance);
+
+    points[p].bestd=radius;
+
+    points[p].nearby=&nearby[p*maxnearby];
+    points[p].maxnearby=maxnearby;
+   }
+
+ search_snap_points(nodes,segments,ways,points,npoints,distance,profile);
+
+ for(p=0;p<npoints;p++)
+    nnearby[points[p].index]=points[p].nnearby;
+
+ free(points);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Initialise the search state for one of the points in a batch.
+
+  Nodes *nodes The set of nodes to use.
+
+  SnapPoint *pointp The point to initialise.
+
+  int index The index of the point in the arrays passed to the calling function.
+
+  double latitude The latitude of the point.
+
+  double longitude The longitude of the point.
+
+  distance_t distance The maximum distance to look from the point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void init_snap_point(Nodes *nodes,SnapPoint *pointp,int index,double latitude,double longitude,distance_t distance)
+{
  double dlat=DeltaLat(longitude,distance);
  double dlon=DeltaLon(latitude ,distance);
 
@@ -326,173 +647,409 @@ index_t FindClosestSegment(Nodes *nodes,Segments *segments,Ways *ways,double lat
  double minlon=longitude-dlon;
  double maxlon=longitude+dlon;
 
- ll_bin_t minlatbin=latlong_to_bin(radians_to_latlong(minlat))-nodes->file.latzero;
- ll_bin_t maxlatbin=latlong_to_bin(radians_to_latlong(maxlat))-nodes->file.latzero;
- ll_bin_t minlonbin=latlong_to_bin(radians_to_latlong(minlon))-nodes->file.lonzero;
- ll_bin_t maxlonbin=latlong_to_bin(radians_to_latlong(maxlon))-nodes->file.lonzero;
+ pointp->index=index;
 
- ll_off_t minlatoff=latlong_to_off(radians_to_latlong(minlat));
- ll_off_t maxlatoff=latlong_to_off(radians_to_latlong(maxlat));
- ll_off_t minlonoff=latlong_to_off(radians_to_latlong(minlon));
- ll_off_t maxlonoff=latlong_to_off(radians_to_latlong(maxlon));
+ pointp->latitude =latitude;
+ pointp->longitude=longitude;
+ pointp->coslat   =cos(latitude);
 
- /* Start with the bin containing the location, then spiral outwards. */
+ pointp->latbin=latlong_to_bin(radians_to_latlong(latitude ))-nodes->file.latzero;
+ pointp->lonbin=latlong_to_bin(radians_to_latlong(longitude))-nodes->file.lonzero;
 
- do
+ pointp->minlatbin=latlong_to_bin(radians_to_latlong(minlat))-nodes->file.latzero;
+ pointp->maxlatbin=latlong_to_bin(radians_to_latlong(maxlat))-nodes->file.latzero;
+ pointp->minlonbin=latlong_to_bin(radians_to_latlong(minlon))-nodes->file.lonzero;
+ pointp->maxlonbin=latlong_to_bin(radians_to_latlong(maxlon))-nodes->file.lonzero;
+
+ pointp->minlatoff=latlong_to_off(radians_to_latlong(minlat));
+ pointp->maxlatoff=latlong_to_off(radians_to_latlong(maxlat));
+ pointp->minlonoff=latlong_to_off(radians_to_latlong(minlon));
+ pointp->maxlonoff=latlong_to_off(radians_to_latlong(maxlon));
+
+ pointp->done=0;
+
+ pointp->bestn1=NO_NODE;
+ pointp->bestn2=NO_NODE;
+ pointp->bestd =INF_DISTANCE;
+ pointp->bestd1=INF_DISTANCE;
+ pointp->bestd2=INF_DISTANCE;
+ pointp->bests =NO_SEGMENT;
+
+ pointp->nearby=NULL;
+ pointp->nnearby=0;
+ pointp->maxnearby=0;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Search for the closest segments to a batch of points. The points are sorted by the bin that
+  contains them and the points that share a bin also share the search through the nearby bins.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to search.
+
+  Ways *ways The set of ways to use.
+
+  SnapPoint *points The points to search for (sorted by this function).
+
+  int npoints The number of points.
+
+  distance_t distance The maximum distance to look from the specified coordinates.
+
+  Profile *profile The profile of the mode of transport.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void search_snap_points(Nodes *nodes,Segments *segments,Ways *ways,SnapPoint *points,int npoints,distance_t distance,Profile *profile)
+{
+ int p,first,ngroup;
+
+ /* Sort the points so that those in the same bin are together */
+
+ qsort(points,npoints,sizeof(SnapPoint),(int (*)(const void*,const void*))sort_by_bin);
+
+ /* Search for each group of points that are in the same bin */
+
+ for(first=0;first<npoints;first+=ngroup)
    {
-    ll_bin_t latb,lonb;
-    ll_bin2_t llbin;
+    SnapPoint *group=&points[first];
+    ll_bin_t latbin=group->latbin;
+    ll_bin_t lonbin=group->lonbin;
+    int delta=0,active;
 
-    count=0;
+    ngroup=1;
 
-    for(latb=latbin-delta;latb<=latbin+delta;latb++)
+    while(ngroup<MAX_SNAP_GROUP && (first+ngroup)<npoints && group[ngroup].latbin==latbin && group[ngroup].lonbin==lonbin)
+       ngroup++;
+
+    /* Start with the bin containing the points, then spiral outwards. */
+
+    do
       {
-       if(latb<0 || latb>=nodes->file.latbins || latb<minlatbin || latb>maxlatbin)
-          continue;
+       ll_bin_t latb,lonb;
+       ll_bin2_t llbin;
 
-       for(lonb=lonbin-delta;lonb<=lonbin+delta;lonb++)
+       for(p=0;p<ngroup;p++)
+          group[p].count=0;
+
+       for(latb=latbin-delta;latb<=latbin+delta;latb++)
          {
-          if(lonb<0 || lonb>=nodes->file.lonbins || lonb<minlonbin || lonb>maxlonbin)
+          if(latb<0 || latb>=nodes->file.latbins)
              continue;
 
-          if(abs(latb-latbin)<delta && abs(lonb-lonbin)<delta)
-             continue;
+          for(lonb=lonbin-delta;lonb<=lonbin+delta;lonb++)
+            {
+             int inbin[MAX_SNAP_GROUP],ninbin=0;
+             index_t i,index1,index2;
 
-          /* Check every node in this grid square. */
+             if(lonb<0 || lonb>=nodes->file.lonbins)
+                continue;
 
-          llbin=lonb*nodes->file.latbins+latb;
+             if(abs(latb-latbin)<delta && abs(lonb-lonbin)<delta)
+                continue;
 
-          index1=LookupNodeOffset(nodes,llbin);
-          index2=LookupNodeOffset(nodes,llbin+1);
+             /* Find the points whose search includes this grid square. */
 
-          for(i=index1;i<index2;i++)
-            {
-             Node *nodep=LookupNode(nodes,i,3);
-             double lat1,lon1;
-             distance_t dist1;
+             for(p=0;p<ngroup;p++)
+               {
+                SnapPoint *pointp=&group[p];
 
-             if(latb==minlatbin && nodep->latoffset<minlatoff)
-                continue;
+                if(pointp->done)
+                   continue;
 
-             if(latb==maxlatbin && nodep->latoffset>maxlatoff)
-                continue;
+                if(latb<pointp->minlatbin || latb>pointp->maxlatbin || lonb<pointp->minlonbin || lonb>pointp->maxlonbin)
+                   continue;
 
-             if(lonb==minlonbin && nodep->lonoffset<minlonoff)
-                continue;
+                inbin[ninbin++]=p;
 
-             if(lonb==maxlonbin && nodep->lonoffset>maxlonoff)
+                pointp->count++;
+               }
+
+             if(ninbin==0)
                 continue;
 
-             lat1=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(nodep->latoffset));
-             lon1=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(nodep->lonoffset));
+             /* Check every node in this grid square. */
+
+             llbin=lonb*nodes->file.latbins+latb;
 
-             dist1=Distance(lat1,lon1,latitude,longitude);
+             index1=LookupNodeOffset(nodes,llbin);
+             index2=LookupNodeOffsetEnd(nodes,llbin);
 
-             if(dist1<distance)
+             for(i=index1;i<index2;i++)
                {
-                Segment *segmentp;
+                NodePosition *positionp=LookupNodePosition(nodes,i,2);
+                int nearby[MAX_SNAP_GROUP],nnearby=0;
+                double lat1,lon1,coslat1;
+                int j;
 
-                /* Check each segment for closeness and if valid for the profile */
+                lat1=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(positionp->latoffset));
+                lon1=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(positionp->lonoffset));
 
-                segmentp=FirstSegment(segments,nodep,1);
+                coslat1=cos(lat1);
 
-                do
+                /* Find the points that are close enough to this node. */
+
+                for(j=0;j<ninbin;j++)
                   {
-                   if(IsNormalSegment(segmentp) && valid_segment_for_profile(ways,segmentp,profile))
+                   SnapPoint *pointp=&group[inbin[j]];
+
+                   if(latb==pointp->minlatbin && positionp->latoffset<pointp->minlatoff)
+                      continue;
+
+                   if(latb==pointp->maxlatbin && positionp->latoffset>pointp->maxlatoff)
+                      continue;
+
+                   if(lonb==pointp->minlonbin && positionp->lonoffset<pointp->minlonoff)
+                      continue;
+
+                   if(lonb==pointp->maxlonbin && positionp->lonoffset>pointp->maxlonoff)
+                      continue;
+
+                   pointp->dist1=DistanceCos(lat1,lon1,coslat1,pointp->latitude,pointp->longitude,pointp->coslat);
+
+                   if(pointp->dist1<distance)
+                      nearby[nnearby++]=inbin[j];
+                  }
+
+                if(nnearby==0)
+                   continue;
+
+                /* Check each segment for closeness to each of the points and if valid for the profile */
+
+                if(nodes->file.nsnaps)
+                  {
+                   index_t snap1=LookupNodeFirstSnap(nodes,i  ,1);
+                   index_t snap2=LookupNodeFirstSnap(nodes,i+1,2);
+                   index_t s;
+
+                   for(s=snap1;s<snap2;s++)
                      {
-                      distance_t dist2,dist3;
-                      double lat2,lon2,dist3a,dist3b,distp;
+                      NodeSnap *snapp=LookupNodeSnap(nodes,s,1);
+                      double lat2,lon2,coslat2;
+                      distance_t dist3;
+                      int valid=-1;
 
-                      GetLatLong(nodes,OtherNode(segmentp,i),NULL,&lat2,&lon2);
+                      if(!(snapp->allow&profile->allow))
+                         continue;
 
-                      dist2=Distance(lat2,lon2,latitude,longitude);
+                      lat2=latlong_to_radians(snapp->latitude);
+                      lon2=latlong_to_radians(snapp->longitude);
 
-                      dist3=Distance(lat1,lon1,lat2,lon2);
+                      coslat2=cos(lat2);
 
-                      /* Use law of cosines (assume flat Earth) */
+                      dist3=DistanceCos(lat1,lon1,coslat1,lat2,lon2,coslat2);
 
-                      if(dist3==0)
-                        {
-                         distp=dist1;  /* == dist2 */
-                         dist3a=dist1; /* == dist2 */
-                         dist3b=dist2; /* == dist1 */
-                        }
-                      else if((dist1+dist2)<dist3)
-                        {
-                         distp=0;
-                         dist3a=dist1;
-                         dist3b=dist2;
-                        }
-                      else
+                      for(j=0;j<nnearby;j++)
                         {
-                         dist3a=((double)dist1*(double)dist1-(double)dist2*(double)dist2+(double)dist3*(double)dist3)/(2.0*(double)dist3);
-                         dist3b=(double)dist3-dist3a;
+                         SnapPoint *pointp=&group[nearby[j]];
+                         distance_t dist2;
+                         double dist3a,dist3b,distp;
 
-                         if(dist3a>=0 && dist3b>=0)
-                            distp=sqrt((double)dist1*(double)dist1-dist3a*dist3a);
-                         else if(dist3a>0)
-                           {
-                            distp=dist2;
-                            dist3a=dist3;
-                            dist3b=0;
-                           }
-                         else /* if(dist3b>0) */
+                         dist2=DistanceCos(lat2,lon2,coslat2,pointp->latitude,pointp->longitude,pointp->coslat);
+
+                         distp=DistanceToSegment(pointp->dist1,dist2,dist3,&dist3a,&dist3b);
+
+                         if(distp<(double)pointp->bestd)
                            {
-                            distp=dist1;
-                            dist3a=0;
-                            dist3b=dist3;
+                            if(valid<0)
+                               valid=valid_segment_for_profile(ways,LookupSegment(segments,snapp->segment,1),profile);
+
+                            if(!valid)
+                               break;
+
+                            update_snap_point(pointp,snapp->segment,i,snapp->othernode,snapp->node1,distp,dist3a,dist3b);
                            }
                         }
+                     }
+                  }
+                else
+                  {
+                   Node *nodep=LookupNode(nodes,i,3);
+                   Segment *segmentp;
+
+                   segmentp=FirstSegment(segments,nodep,1);
 
-                      if(distp<(double)bestd)
+                   do
+                     {
+                      if(IsNormalSegment(segmentp) && valid_segment_for_profile(ways,segmentp,profile))
                         {
-                         bests=IndexSegment(segments,segmentp);
+                         double lat2,lon2,coslat2;
+                         distance_t dist3;
+                         index_t othernode=OtherNode(segmentp,i);
 
-                         if(segmentp->node1==i)
-                           {
-                            bestn1=i;
-                            bestn2=OtherNode(segmentp,i);
-                            bestd1=(distance_t)dist3a;
-                            bestd2=(distance_t)dist3b;
-                           }
-                         else
+                         GetLatLong(nodes,othernode,&lat2,&lon2);
+
+                         coslat2=cos(lat2);
+
+                         dist3=DistanceCos(lat1,lon1,coslat1,lat2,lon2,coslat2);
+
+                         for(j=0;j<nnearby;j++)
                            {
-                            bestn1=OtherNode(segmentp,i);
-                            bestn2=i;
-                            bestd1=(distance_t)dist3b;
-                            bestd2=(distance_t)dist3a;
-                           }
+                            SnapPoint *pointp=&group[nearby[j]];
+                            distance_t dist2;
+                            double dist3a,dist3b,distp;
+
+                            dist2=DistanceCos(lat2,lon2,coslat2,pointp->latitude,pointp->longitude,pointp->coslat);
+
+                            distp=DistanceToSegment(pointp->dist1,dist2,dist3,&dist3a,&dist3b);
 
-                         bestd=(distance_t)distp;
+                            if(distp<(double)pointp->bestd)
+                               update_snap_point(pointp,IndexSegment(segments,segmentp),i,othernode,segmentp->node1==i,distp,dist3a,dist3b);
+                           }
                         }
-                     }
 
-                   segmentp=NextSegment(segments,segmentp,i);
+                      segmentp=NextSegment(segments,segmentp,i);
+                     }
+                   while(segmentp);
                   }
-                while(segmentp);
+               }
+            }
+         }
 
-               } /* dist1 < distance */
+       /* A point's search is finished when none of the bins in the ring were within its limits */
+
+       active=0;
+
+       for(p=0;p<ngroup;p++)
+          if(!group[p].done)
+            {
+             if(group[p].count==0)
+                group[p].done=1;
+             else
+                active++;
             }
 
-          count++;
-         }
+       delta++;
       }
+    while(active);
+   }
+}
 
-    delta++;
+
+/*++++++++++++++++++++++++++++++++++++++
+  Update the closest segment (or the list of nearby segments) for a point in a batch.
+
+  SnapPoint *pointp The point to update.
+
+  index_t segment The index of the segment.
+
+  index_t node The index of the node that is being checked.
+
+  index_t othernode The index of the node at the other end of the segment.
+
+  int node1 Set to true if the node being checked is the first node of the segment.
+
+  double distp The distance from the point to the closest point on the segment.
+
+  double dist3a The distance along the segment from the node being checked to the closest point.
+
+  double dist3b The distance along the segment from the other node to the closest point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void update_snap_point(SnapPoint *pointp,index_t segment,index_t node,index_t othernode,int node1,double distp,double dist3a,double dist3b)
+{
+ if(pointp->nearby)
+   {
+    NearbySegment *nearby=pointp->nearby;
+    int i;
+
+    /* Each segment is found from both of its nodes so replace it if it is already in the list */
+
+    for(i=0;i<pointp->nnearby;i++)
+       if(nearby[i].segment==segment)
+          break;
+
+    if(i<pointp->nnearby)
+      {
+       if((distance_t)distp>=nearby[i].dist)
+          return;
+      }
+    else if(pointp->nnearby<pointp->maxnearby)
+       i=pointp->nnearby++;
+    else
+       i=pointp->nnearby-1;
+
+    /* Keep the list sorted by distance */
+
+    for(;i>0 && nearby[i-1].dist>(distance_t)distp;i--)
+       nearby[i]=nearby[i-1];
+
+    nearby[i].segment=segment;
+
+    if(node1)
+      {
+       nearby[i].node1=node;
+       nearby[i].node2=othernode;
+       nearby[i].dist1=(distance_t)dist3a;
+       nearby[i].dist2=(distance_t)dist3b;
+      }
+    else
+      {
+       nearby[i].node1=othernode;
+       nearby[i].node2=node;
+       nearby[i].dist1=(distance_t)dist3b;
+       nearby[i].dist2=(distance_t)dist3a;
+      }
+
+    nearby[i].dist=(distance_t)distp;
+
+    /* Once the list is full only closer segments are wanted */
+
+    if(pointp->nnearby==pointp->maxnearby)
+       pointp->bestd=nearby[pointp->nnearby-1].dist;
+
+    return;
    }
- while(count);
 
- *bestdist=bestd;
+ pointp->bests=segment;
 
- *bestnode1=bestn1;
- *bestnode2=bestn2;
- *bestdist1=bestd1;
- *bestdist2=bestd2;
+ if(node1)
+   {
+    pointp->bestn1=node;
+    pointp->bestn2=othernode;
+    pointp->bestd1=(distance_t)dist3a;
+    pointp->bestd2=(distance_t)dist3b;
+   }
+ else
+   {
+    pointp->bestn1=othernode;
+    pointp->bestn2=node;
+    pointp->bestd1=(distance_t)dist3b;
+    pointp->bestd2=(distance_t)dist3a;
+   }
 
- return(bests);
+ pointp->bestd=(distance_t)distp;
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the points into bin order (longitude bin then latitude bin) keeping the original order within each bin.
+
+  int sort_by_bin Returns the comparison of the bin fields.
+
+  SnapPoint *a The first point.
+
+  SnapPoint *b The second point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_bin(SnapPoint *a,SnapPoint *b)
+{
+ if(a->lonbin<b->lonbin)
+    return(-1);
+ else if(a->lonbin>b->lonbin)
+    return(1);
+ else if(a->latbin<b->latbin)
+    return(-1);
+ else if(a->latbin>b->latbin)
+    return(1);
+ else if(a->index<b->index)
+    return(-1);
+ else if(a->index>b->index)
+    return(1);
+ else
+    return(0);
+}
+
 /*++++++++++++++++++++++++++++++++++++++
   Check if the transport defined by the profile is allowed on the segment.
 
@@ -552,15 +1109,14 @@ static int valid_segment_for_profile(Ways *ways,Segment *segmentp,Profile *profi
 
   index_t index The node index.
 
-  Node *nodep A pointer to the node if already available.
-
   double *latitude Returns the latitude.
 
   double *longitude Returns the logitude.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *longitude)
+void GetLatLong(Nodes *nodes,index_t index,double *latitude,double *longitude)
 {
+ NodePosition *positionp;
  ll_bin_t latbin,lonbin;
  ll_bin2_t bin=-1;
  ll_bin2_t start,end,mid;
@@ -577,7 +1133,7 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
   *  # <- end    |  start or end is the wanted one.
   */
 
- /* Search for offset */
+ /* Search for offset (in the file order of the bins) */
 
  start=0;
  end=nodes->file.lonbins*nodes->file.latbins;
@@ -586,7 +1142,7 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
    {
     mid=(start+end)/2;                  /* Choose mid point */
 
-    offset=LookupNodeOffset(nodes,mid);
+    offset=nodes->offsets[mid];
 
     if(offset<index)                    /* Mid point is too low for an exact match but could be lower bound */
        start=mid;
@@ -599,7 +1155,7 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
 
  if(bin==-1)
    {
-    offset=LookupNodeOffset(nodes,end);
+    offset=nodes->offsets[end];
 
     if(offset>index)
        bin=start;
@@ -608,17 +1164,21 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
    }
 
  while(bin<=(nodes->file.lonbins*nodes->file.latbins) && 
-       LookupNodeOffset(nodes,bin)==LookupNodeOffset(nodes,bin+1))
+       nodes->offsets[bin]==nodes->offsets[bin+1])
     bin++;
 
+ /* Convert the position in the file order into the bin number */
+
+ if(nodes->binorder)
+    bin=nodes->binorder[bin];
+
  latbin=bin%nodes->file.latbins;
  lonbin=bin/nodes->file.latbins;
 
  /* Return the values */
 
- if(nodep==NULL)
-    nodep=LookupNode(nodes,index,4);
+ positionp=LookupNodePosition(nodes,index,1);
 
- *latitude =latlong_to_radians(bin_to_latlong(nodes->file.latzero+latbin)+off_to_latlong(nodep->latoffset));
- *longitude=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonbin)+off_to_latlong(nodep->lonoffset));
+ *latitude =latlong_to_radians(bin_to_latlong(nodes->file.latzero+latbin)+off_to_latlong(positionp->latoffset));
+ *longitude=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonbin)+off_to_latlong(positionp->lonoffset));
 }
@@ -29,6 +29,7 @@
 #include "types.h"
 
 #include "cache.h"
+#include "blocks.h"
 #include "files.h"
 #include "profiles.h"
 
@@ -36,22 +37,61 @@
 /* Data structures */
 
 
-/*+ A structure containing a single node. +*/
+/*+ A structure containing a single node (the information needed for routing). +*/
 struct _Node
 {
  index_t      firstseg;         /*+ The index of the first segment. +*/
 
- ll_off_t     latoffset;        /*+ The node latitude offset within its bin. +*/
- ll_off_t     lonoffset;        /*+ The node longitude offset within its bin. +*/
-
  transports_t allow;            /*+ The types of transport that are allowed through the node. +*/
  nodeflags_t  flags;            /*+ Flags containing extra information (e.g. super-node, turn restriction). +*/
 };
 
 
+/*+ A structure containing the position of a single node (stored in a separate array from the nodes). +*/
+typedef struct _NodePosition
+{
+ ll_off_t     latoffset;        /*+ The node latitude offset within its bin. +*/
+ ll_off_t     lonoffset;        /*+ The node longitude offset within its bin. +*/
+}
+ NodePosition;
+
+
+/*+ A structure containing a segment used for finding the closest segment to a point (stored in a separate array for each node). +*/
+typedef struct _NodeSnap
+{
+ index_t      segment;          /*+ The index of the segment. +*/
+ index_t      othernode;        /*+ The index of the node at the other end of the segment. +*/
+
+ latlong_t    latitude;         /*+ The latitude of the node at the other end of the segment. +*/
+ latlong_t    longitude;        /*+ The longitude of the node at the other end of the segment. +*/
+
+ transports_t allow;            /*+ The types of transport that are allowed on the way of the segment. +*/
+ uint16_t     node1;            /*+ Set to non-zero if this node is the first node of the segment. +*/
+}
+ NodeSnap;
+
+
+/*+ A structure containing one of the segments close to a point (returned by FindNearbySegments()). +*/
+typedef struct _NearbySegment
+{
+ index_t      segment;          /*+ The index of the segment. +*/
+
+ index_t      node1;            /*+ The index of the first node of the segment. +*/
+ index_t      node2;            /*+ The index of the second node of the segment. +*/
+
+ distance_t   dist;             /*+ The distance from the point to the closest point on the segment. +*/
+ distance_t   dist1;            /*+ The distance along the segment from the first node to the closest point. +*/
+ distance_t   dist2;            /*+ The distance along the segment from the second node to the closest point. +*/
+}
+ NearbySegment;
+
+
 /*+ A structure containing the header from the file. +*/
 typedef struct _NodesFile
 {
+ uint32_t magic;                /*+ The magic number that identifies the type of file. +*/
+ uint32_t version;              /*+ The version of the file format. +*/
+
  index_t  number;               /*+ The number of nodes in total. +*/
  index_t  snumber;              /*+ The number of super-nodes. +*/
 
@@ -60,6 +100,14 @@ typedef struct _NodesFile
 
  ll_bin_t latzero;              /*+ The bin number of the furthest south bin. +*/
  ll_bin_t lonzero;              /*+ The bin number of the furthest west bin. +*/
+
+ index_t  blocksize;            /*+ The number of nodes in each compressed block (or 0 if not compressed). +*/
+
+ index_t  hilbert;              /*+ Set to non-zero if the bins are stored in Hilbert curve order (with the bin rank and order arrays). +*/
+
+ index_t  nsnaps;               /*+ The number of segments in the snapping index (or 0 if there is no snapping index). +*/
+
+ uint32_t waychecksum;          /*+ The checksum of the ways that the nodes and segments were created with. +*/
 }
  NodesFile;
 
@@ -75,6 +123,14 @@ struct _Nodes
 
  index_t  *offsets;             /*+ A pointer to the array of offsets in the file. +*/
 
+ ll_bin2_t *binrank;            /*+ A pointer to the array of bin ranks in the file (or NULL if not Hilbert curve order). +*/
+ ll_bin2_t *binorder;           /*+ A pointer to the array of bins in the file order (or NULL if not Hilbert curve order). +*/
+
+ NodePosition *positions;       /*+ A pointer to the array of node positions in the file. +*/
+
+ index_t  *firstsnap;           /*+ A pointer to the array of first snapping index entries for each node (or NULL if no snapping index). +*/
+ NodeSnap *snaps;               /*+ A pointer to the array of snapping index entries in the file (or NULL if no snapping index). +*/
+
  Node     *nodes;               /*+ A pointer to the array of nodes in the file. +*/
 
 #else
@@ -83,19 +139,39 @@ struct _Nodes
 
  index_t  *offsets;             /*+ An allocated array with a copy of the file offsets. +*/
 
- offset_t  nodesoffset;         /*+ The offset of the nodes within the file. +*/
+ ll_bin2_t *binrank;            /*+ An allocated array with a copy of the bin ranks (or NULL if not Hilbert curve order). +*/
+ ll_bin2_t *binorder;           /*+ An allocated array with a copy of the bins in the file order (or NULL if not Hilbert curve order). +*/
+
+ offset_t  nodesoffset;         /*+ The offset of the nodes (or the compressed data) within the file. +*/
 
  Node      cached[6];           /*+ Some cached nodes read from the file in slim mode. +*/
 
  NodeCache *cache;              /*+ A RAM cache of nodes read from the file. +*/
 
+ offset_t  positionsoffset;     /*+ The offset of the node positions within the file. +*/
+
+ NodePosition cachedpos[2];     /*+ Some cached node positions read from the file in slim mode. +*/
+
+ NodePositionCache *poscache;   /*+ A RAM cache of node positions read from the file. +*/
+
+ offset_t  firstsnapoffset;     /*+ The offset of the first snapping index entries for each node within the file. +*/
+ offset_t  snapsoffset;         /*+ The offset of the snapping index entries within the file. +*/
+
+ index_t   cachedfirstsnap[2];  /*+ Some cached first snapping index entries read from the file in slim mode. +*/
+
+ NodeSnap  cachedsnap[1];       /*+ A cached snapping index entry read from the file in slim mode. +*/
+
+ offset_t  blockindexoffset;    /*+ The offset of the compressed block index within the file. +*/
+
+ NodeBlockCache *blockcache;    /*+ A RAM cache of decompressed blocks of nodes (if the file is compressed). +*/
+
 #endif
 };
 
 
 /* Functions in nodes.c */
 
-Nodes *LoadNodeList(const char *filename);
+Nodes *LoadNodeList(const char *filename,int mapoptions,size_t cachesize);
 
 void DestroyNodeList(Nodes *nodes);
 
@@ -106,7 +182,14 @@ index_t FindClosestSegment(Nodes *nodes,Segments *segments,Ways *ways,double lat
                            distance_t distance,Profile *profile, distance_t *bestdist,
                            index_t *bestnode1,index_t *bestnode2,distance_t *bestdist1,distance_t *bestdist2);
 
-void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *longitude);
+void FindClosestSegments(Nodes *nodes,Segments *segments,Ways *ways,int npoints,const double *latitudes,const double *longitudes,
+                         distance_t distance,Profile *profile,index_t *bestsegment,distance_t *bestdist,
+                         index_t *bestnode1,index_t *bestnode2,distance_t *bestdist1,distance_t *bestdist2);
+
+void FindNearbySegments(Nodes *nodes,Segments *segments,Ways *ways,int npoints,const double *latitudes,const double *longitudes,
+                        distance_t distance,distance_t radius,Profile *profile,int maxnearby,NearbySegment *nearby,int *nnearby);
+
+void GetLatLong(Nodes *nodes,index_t index,double *latitude,double *longitude);
 
 
 /* Macros and inline functions */
@@ -114,14 +197,23 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
 /*+ Return true if this is a super-node. +*/
 #define IsSuperNode(xxx)            (((xxx)->flags)&NODE_SUPER)
 
+/*+ Return the level of a super-node in the hierarchy of super-nodes. +*/
+#define SuperNodeLevel(xxx)         (((xxx)->flags)&NODE_LEVEL)
+
 /*+ Return true if this is a turn restricted node. +*/
 #define IsTurnRestrictedNode(xxx)   (((xxx)->flags)&NODE_TURNRSTRCT)
 
-/*+ Return a Segment index given a Node pointer and a set of segments. +*/
-#define FirstSegment(xxx,yyy,ppp)   LookupSegment((xxx),(yyy)->firstseg,ppp)
+/*+ Return a Segment index given a Node pointer and a set of segments (the first edge if there is an adjacency array). +*/
+#define FirstSegment(xxx,yyy,ppp)   ((xxx)->file.enumber?LookupEdge((xxx),(yyy)->firstseg,ppp):LookupSegment((xxx),(yyy)->firstseg,ppp))
+
+/*+ Return the position of a geographical region in the file order given a set of nodes. +*/
+#define NodeBinRank(xxx,yyy)        ((xxx)->binrank?(xxx)->binrank[yyy]:(yyy))
 
 /*+ Return the offset of a geographical region given a set of nodes. +*/
-#define LookupNodeOffset(xxx,yyy)   ((xxx)->offsets[yyy])
+#define LookupNodeOffset(xxx,yyy)   ((xxx)->offsets[NodeBinRank(xxx,yyy)])
+
+/*+ Return the offset of the end of a geographical region given a set of nodes. +*/
+#define LookupNodeOffsetEnd(xxx,yyy) ((xxx)->offsets[NodeBinRank(xxx,yyy)+1])
 
 
 #if !SLIM
@@ -129,28 +221,69 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
 /*+ Return a Node pointer given a set of nodes and an index. +*/
 #define LookupNode(xxx,yyy,ppp)     (&(xxx)->nodes[yyy])
 
+/*+ Return a NodePosition pointer given a set of nodes and an index. +*/
+#define LookupNodePosition(xxx,yyy,ppp) (&(xxx)->positions[yyy])
+
+/*+ Return the index of the first snapping index entry for a node given a set of nodes and an index. +*/
+#define LookupNodeFirstSnap(xxx,yyy,ppp) ((xxx)->firstsnap[yyy])
+
+/*+ Return a NodeSnap pointer given a set of nodes and a snapping index entry index. +*/
+#define LookupNodeSnap(xxx,yyy,ppp) (&(xxx)->snaps[yyy])
+
 #else
 
 /* Prototypes */
 
 static inline Node *LookupNode(Nodes *nodes,index_t index,int position);
 
+static inline NodePosition *LookupNodePosition(Nodes *nodes,index_t index,int position);
+
+static inline index_t LookupNodeFirstSnap(Nodes *nodes,index_t index,int position);
+
+static inline NodeSnap *LookupNodeSnap(Nodes *nodes,index_t index,int position);
+
 CACHE_NEWCACHE_PROTO(Node)
 CACHE_DELETECACHE_PROTO(Node)
 CACHE_FETCHCACHE_PROTO(Node)
+CACHE_CHOOSEVICTIM_PROTO(Node)
 CACHE_INVALIDATECACHE_PROTO(Node)
 
+CACHE_NEWCACHE_PROTO(NodePosition)
+CACHE_DELETECACHE_PROTO(NodePosition)
+CACHE_FETCHCACHE_PROTO(NodePosition)
+CACHE_CHOOSEVICTIM_PROTO(NodePosition)
+CACHE_INVALIDATECACHE_PROTO(NodePosition)
+
+BLOCKCACHE_NEWCACHE_PROTO(Node)
+BLOCKCACHE_DELETECACHE_PROTO(Node)
+BLOCKCACHE_FETCHCACHE_PROTO(Node)
+
 /* Data type */
 
 CACHE_STRUCTURE(Node)
 
+CACHE_STRUCTURE(NodePosition)
+
+BLOCKCACHE_STRUCTURE(Node)
+
 /* Inline functions */
 
 CACHE_NEWCACHE(Node)
 CACHE_DELETECACHE(Node)
 CACHE_FETCHCACHE(Node)
+CACHE_CHOOSEVICTIM(Node)
 CACHE_INVALIDATECACHE(Node)
 
+CACHE_NEWCACHE(NodePosition)
+CACHE_DELETECACHE(NodePosition)
+CACHE_FETCHCACHE(NodePosition)
+CACHE_CHOOSEVICTIM(NodePosition)
+CACHE_INVALIDATECACHE(NodePosition)
+
+BLOCKCACHE_NEWCACHE(Node)
+BLOCKCACHE_DELETECACHE(Node)
+BLOCKCACHE_FETCHCACHE(Node)
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Find the Node information for a particular node.
@@ -166,11 +299,74 @@ CACHE_INVALIDATECACHE(Node)
 
 static inline Node *LookupNode(Nodes *nodes,index_t index,int position)
 {
- nodes->cached[position-1]=*FetchCachedNode(nodes->cache,index,nodes->fd,nodes->nodesoffset);
+ if(nodes->blockcache)
+    nodes->cached[position-1]=*FetchBlockCachedNode(nodes->blockcache,index,nodes->fd,nodes->blockindexoffset,nodes->nodesoffset);
+ else
+    nodes->cached[position-1]=*FetchCachedNode(nodes->cache,index,nodes->fd,nodes->nodesoffset);
 
  return(&nodes->cached[position-1]);
 }
 
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the position of a particular node.
+
+  NodePosition *LookupNodePosition Returns a pointer to the cached node position.
+
+  Nodes *nodes The set of nodes to use.
+
+  index_t index The index of the node.
+
+  int position The position in the cache to store the value.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline NodePosition *LookupNodePosition(Nodes *nodes,index_t index,int position)
+{
+ nodes->cachedpos[position-1]=*FetchCachedNodePosition(nodes->poscache,index,nodes->fd,nodes->positionsoffset);
+
+ return(&nodes->cachedpos[position-1]);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the index of the first snapping index entry for a particular node.
+
+  index_t LookupNodeFirstSnap Returns the index of the first snapping index entry.
+
+  Nodes *nodes The set of nodes to use.
+
+  index_t index The index of the node (or the number of nodes for the end of the last one).
+
+  int position The position in the cache to store the value.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline index_t LookupNodeFirstSnap(Nodes *nodes,index_t index,int position)
+{
+ SlimFetch(nodes->fd,&nodes->cachedfirstsnap[position-1],sizeof(index_t),nodes->firstsnapoffset+(offset_t)index*sizeof(index_t));
+
+ return(nodes->cachedfirstsnap[position-1]);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find a particular snapping index entry.
+
+  NodeSnap *LookupNodeSnap Returns a pointer to the cached snapping index entry.
+
+  Nodes *nodes The set of nodes to use.
+
+  index_t index The index of the snapping index entry.
+
+  int position The position in the cache to store the value.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline NodeSnap *LookupNodeSnap(Nodes *nodes,index_t index,int position)
+{
+ SlimFetch(nodes->fd,&nodes->cachedsnap[position-1],sizeof(NodeSnap),nodes->snapsoffset+(offset_t)index*sizeof(NodeSnap));
+
+ return(&nodes->cachedsnap[position-1]);
+}
+
 #endif
 
 
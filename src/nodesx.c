@@ -36,11 +36,35 @@
 #include "sorting.h"
 
 
+/* Constants */
+
+/*+ The offset added to the latitudes and longitudes to make them positive for the Hilbert curve. +*/
+#define HILBERT_ZERO      (1<<28)
+
+/*+ The number of bits in each coordinate of the Hilbert curve through the node positions. +*/
+#define HILBERT_ORDER     29
+
+/*+ The number of bits in each coordinate of the Hilbert curve through the bins (LAT_LONG_BIN is 16 bits). +*/
+#define HILBERT_BIN_ORDER (HILBERT_ORDER-16)
+
+
 /* Global variables */
 
 /*+ The command line '--tmpdir' option or its default value. +*/
 extern char *option_tmpdirname;
 
+/* Local data types */
+
+/*+ A segment in the snapping index with the node that it belongs to (used for sorting). +*/
+typedef struct _NodeSnapX
+{
+ index_t  node;                 /*+ The node whose snapping index contains the segment. +*/
+
+ NodeSnap snap;                 /*+ The snapping index entry. +*/
+}
+ NodeSnapX;
+
+
 /* Local variables */
 
 /*+ Temporary file-local variables for use by the sort functions (re-initialised for each sort). +*/
@@ -54,8 +78,15 @@ static int deduplicate_and_index_by_id(NodeX *nodex,index_t index);
 
 static int update_id(NodeX *nodex,index_t index);
 static int sort_by_lat_long(NodeX *a,NodeX *b);
+static int sort_by_hilbert(NodeX *a,NodeX *b);
 static int index_by_lat_long(NodeX *nodex,index_t index);
 
+static uint64_t hilbert_key(uint32_t x,uint32_t y,int order);
+static int sort_by_uint64(uint64_t *a,uint64_t *b);
+
+static index_t create_snap_index(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,const char *filename);
+static int sort_snaps(NodeSnapX *a,NodeSnapX *b);
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Allocate a new node list (create a new file or open an existing one).
@@ -101,8 +132,8 @@ NodesX *NewNodeList(int append,int readonly)
     nodesx->fd=-1;
 
 #if SLIM
- nodesx->cache=NewNodeXCache();
- log_malloc(nodesx->cache,sizeof(*nodesx->cache));
+ nodesx->cache=NewNodeXCache(0,0);
+ log_malloc(nodesx->cache,nodesx->cache->stats.size);
 #endif
 
  return(nodesx);
@@ -601,9 +632,11 @@ void RemovePrunedNodes(NodesX *nodesx,SegmentsX *segmentsx)
   Sort the node list geographically.
 
   NodesX *nodesx The set of nodes to modify.
+
+  int hilbert Set to true if the nodes are to be sorted along a Hilbert curve instead of by bin and position.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void SortNodeListGeographically(NodesX *nodesx)
+void SortNodeListGeographically(NodesX *nodesx,int hilbert)
 {
  int fd;
  ll_bin_t lat_min_bin,lat_max_bin,lon_min_bin,lon_max_bin;
@@ -637,8 +670,10 @@ void SortNodeListGeographically(NodesX *nodesx)
 
  sortnodesx=nodesx;
 
+ nodesx->hilbert=hilbert;
+
  filesort_fixed(nodesx->fd,fd,sizeof(NodeX),(int (*)(void*,index_t))update_id,
-                                            (int (*)(const void*,const void*))sort_by_lat_long,
+                                            (int (*)(const void*,const void*))(hilbert?sort_by_hilbert:sort_by_lat_long),
                                             (int (*)(void*,index_t))index_by_lat_long);
 
  /* Close the files */
@@ -691,7 +726,7 @@ static int update_id(NodeX *nodex,index_t index)
 {
  nodex->id=index;
 
- if(sortnodesx->super && IsBitSet(sortnodesx->super,index))
+ if(sortnodesx->super && nodex->flags&NODE_LEVEL)
     nodex->flags|=NODE_SUPER;
 
  return(1);
@@ -748,6 +783,31 @@ static int sort_by_lat_long(NodeX *a,NodeX *b)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the nodes into the order of a Hilbert curve through their positions (this keeps
+  the nodes in each bin together and puts the bins into the order of a Hilbert curve).
+
+  int sort_by_hilbert Returns the comparison of the positions along the curve.
+
+  NodeX *a The first extended node.
+
+  NodeX *b The second extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_hilbert(NodeX *a,NodeX *b)
+{
+ uint64_t a_key=hilbert_key((uint32_t)(a->longitude+HILBERT_ZERO),(uint32_t)(a->latitude+HILBERT_ZERO),HILBERT_ORDER);
+ uint64_t b_key=hilbert_key((uint32_t)(b->longitude+HILBERT_ZERO),(uint32_t)(b->latitude+HILBERT_ZERO),HILBERT_ORDER);
+
+ if(a_key<b_key)
+    return(-1);
+ else if(a_key>b_key)
+    return(1);
+
+ return(FILESORT_PRESERVE_ORDER(a,b));
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Create the index between the sorted and unsorted nodes.
 
@@ -786,9 +846,15 @@ static int index_by_lat_long(NodeX *nodex,index_t index)
   const char *filename The name of the file to save.
 
   SegmentsX *segmentsx The set of segments to use.
+
+  WaysX *waysx The set of ways to use.
+
+  int snap Set to true if the segment snapping index is to be written.
+
+  int compress Set to true if the nodes are to be written in compressed blocks.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
+void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx,WaysX *waysx,int snap,int compress)
 {
  index_t i;
  int fd;
@@ -796,6 +862,27 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
  index_t super_number=0;
  ll_bin2_t latlonbin=0,maxlatlonbins;
  index_t *offsets;
+ ll_bin2_t *binrank=NULL;
+ size_t sizebins=0,sizesnaps=0;
+ offset_t *blockindex=NULL;
+ index_t nsnaps=0;
+ char *snapfilename=NULL;
+ Node block[BLOCK_SIZE];
+ unsigned char buffer[BLOCK_MAX_BYTES];
+
+ /* Create the segment snapping index (sorted into node order) */
+
+ if(snap)
+   {
+    snapfilename=(char*)malloc(strlen(option_tmpdirname)+48); /* allow %p to be up to 20 bytes */
+
+    sprintf(snapfilename,"%s/nodesx.%p.snaps.tmp",option_tmpdirname,(void*)nodesx);
+
+    nsnaps=create_snap_index(nodesx,segmentsx,waysx,snapfilename);
+
+    if(nsnaps)
+       sizesnaps=(nodesx->number+1)*sizeof(index_t)+nsnaps*sizeof(NodeSnap);
+   }
 
  /* Print the start message */
 
@@ -809,35 +896,73 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
 
  latlonbin=0;
 
+ /* Work out the order of the bins along the Hilbert curve (the rank of each bin and the bin for each rank) */
+
+ if(nodesx->hilbert)
+   {
+    ll_bin2_t nbins=nodesx->latbins*nodesx->lonbins,llbin;
+    uint64_t *keys;
+
+    sizebins=2*nbins*sizeof(ll_bin2_t);
+
+    binrank=(ll_bin2_t*)malloc(sizebins);
+    keys=(uint64_t*)malloc(nbins*sizeof(uint64_t));
+
+    logassert(binrank && keys,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+    for(llbin=0;llbin<nbins;llbin++)
+      {
+       uint32_t lonbin=(uint32_t)(llbin/nodesx->latbins+nodesx->lonzero+HILBERT_ZERO/LAT_LONG_BIN);
+       uint32_t latbin=(uint32_t)(llbin%nodesx->latbins+nodesx->latzero+HILBERT_ZERO/LAT_LONG_BIN);
+
+       keys[llbin]=(hilbert_key(lonbin,latbin,HILBERT_BIN_ORDER)<<32)|(uint64_t)llbin;
+      }
+
+    qsort(keys,nbins,sizeof(uint64_t),(int (*)(const void*,const void*))sort_by_uint64);
+
+    for(llbin=0;llbin<nbins;llbin++)
+      {
+       binrank[nbins+llbin]=(ll_bin2_t)(keys[llbin]&0xffffffff);
+       binrank[binrank[nbins+llbin]]=llbin;
+      }
+
+    free(keys);
+   }
+
+ /* Allocate the memory for the index of the compressed blocks */
+
+ if(compress)
+   {
+    blockindex=(offset_t*)malloc(BlockIndexSize(nodesx->number));
+
+    logassert(blockindex,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+    blockindex[0]=0;
+   }
+
  /* Re-open the file */
 
  nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
 
- /* Write out the nodes data */
+ /* Write out the node positions (and work out the offsets) */
 
  fd=OpenFileBufferedNew(filename);
 
- SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t));
+ SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t)+sizebins);
 
  for(i=0;i<nodesx->number;i++)
    {
     NodeX nodex;
-    Node node={0};
+    NodePosition position={0};
     ll_bin_t latbin,lonbin;
     ll_bin2_t llbin;
 
     ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
 
-    /* Create the Node */
-
-    node.latoffset=latlong_to_off(nodex.latitude);
-    node.lonoffset=latlong_to_off(nodex.longitude);
-    node.firstseg=segmentsx->firstnode[i];
-    node.allow=nodex.allow;
-    node.flags=nodex.flags;
+    /* Create the NodePosition */
 
-    if(node.flags&NODE_SUPER)
-       super_number++;
+    position.latoffset=latlong_to_off(nodex.latitude);
+    position.lonoffset=latlong_to_off(nodex.longitude);
 
     /* Work out the offsets */
 
@@ -845,12 +970,111 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
     lonbin=latlong_to_bin(nodex.longitude)-nodesx->lonzero;
     llbin=lonbin*nodesx->latbins+latbin;
 
+    if(binrank)
+       llbin=binrank[llbin];
+
     for(;latlonbin<=llbin;latlonbin++)
        offsets[latlonbin]=i;
 
     /* Write the data */
 
-    WriteFileBuffered(fd,&node,sizeof(Node));
+    WriteFileBuffered(fd,&position,sizeof(NodePosition));
+
+    if(!((i+1)%10000))
+       printf_middle("Writing Nodes: Positions=%"Pindex_t,i+1);
+   }
+
+ /* Write out the segment snapping index (after the positions) followed by the index of the first entry for each node */
+
+ if(snap)
+   {
+    if(nsnaps)
+      {
+       index_t *firstsnap,node=0;
+       int snapfd;
+
+       firstsnap=(index_t*)malloc((nodesx->number+1)*sizeof(index_t));
+
+       logassert(firstsnap,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+       snapfd=ReOpenFileBuffered(snapfilename);
+
+       SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t)+sizebins+nodesx->number*sizeof(NodePosition)+(nodesx->number+1)*sizeof(index_t));
+
+       for(i=0;i<nsnaps;i++)
+         {
+          NodeSnapX snapx;
+
+          ReadFileBuffered(snapfd,&snapx,sizeof(NodeSnapX));
+
+          for(;node<=snapx.node;node++)
+             firstsnap[node]=i;
+
+          WriteFileBuffered(fd,&snapx.snap,sizeof(NodeSnap));
+         }
+
+       for(;node<=nodesx->number;node++)
+          firstsnap[node]=nsnaps;
+
+       CloseFileBuffered(snapfd);
+
+       SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t)+sizebins+nodesx->number*sizeof(NodePosition));
+       WriteFileBuffered(fd,firstsnap,(nodesx->number+1)*sizeof(index_t));
+
+       free(firstsnap);
+      }
+
+    DeleteFile(snapfilename);
+
+    free(snapfilename);
+   }
+
+ /* Re-open the file */
+
+ nodesx->fd=CloseFileBuffered(nodesx->fd);
+
+ nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
+
+ /* Write out the nodes data (after the positions and the snapping index) */
+
+ if(compress)
+    SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t)+sizebins+nodesx->number*sizeof(NodePosition)+sizesnaps+BlockIndexSize(nodesx->number));
+ else
+    SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t)+sizebins+nodesx->number*sizeof(NodePosition)+sizesnaps);
+
+ for(i=0;i<nodesx->number;i++)
+   {
+    NodeX nodex;
+    Node node={0};
+
+    ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
+
+    /* Create the Node */
+
+    node.firstseg=segmentsx->firstedge?segmentsx->firstedge[i]:segmentsx->firstnode[i];
+    node.allow=nodex.allow;
+    node.flags=nodex.flags;
+
+    if(node.flags&NODE_SUPER)
+       super_number++;
+
+    /* Write the data (or compress it a block at a time) */
+
+    if(compress)
+      {
+       block[i%BLOCK_SIZE]=node;
+
+       if((i+1)%BLOCK_SIZE==0 || (i+1)==nodesx->number)
+         {
+          int bytes=EncodeNodeBlock(buffer,block,(int)(i%BLOCK_SIZE)+1);
+
+          WriteFileBuffered(fd,buffer,bytes);
+
+          blockindex[i/BLOCK_SIZE+1]=blockindex[i/BLOCK_SIZE]+bytes;
+         }
+      }
+    else
+       WriteFileBuffered(fd,&node,sizeof(Node));
 
     if(!((i+1)%10000))
        printf_middle("Writing Nodes: Nodes=%"Pindex_t,i+1);
@@ -872,8 +1096,30 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
 
  free(offsets);
 
+ /* Write out the bin ranks and order (after the offsets) */
+
+ if(binrank)
+   {
+    WriteFileBuffered(fd,binrank,sizebins);
+
+    free(binrank);
+   }
+
+ /* Write out the index of the compressed blocks (after the positions) */
+
+ if(compress)
+   {
+    SeekFileBuffered(fd,sizeof(NodesFile)+(nodesx->latbins*nodesx->lonbins+1)*sizeof(index_t)+sizebins+nodesx->number*sizeof(NodePosition)+sizesnaps);
+    WriteFileBuffered(fd,blockindex,BlockIndexSize(nodesx->number));
+
+    free(blockindex);
+   }
+
  /* Write out the header structure */
 
+ nodesfile.magic=NODES_MAGIC;
+ nodesfile.version=DATABASE_VERSION;
+
  nodesfile.number=nodesx->number;
  nodesfile.snumber=super_number;
 
@@ -883,6 +1129,14 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
  nodesfile.latzero=nodesx->latzero;
  nodesfile.lonzero=nodesx->lonzero;
 
+ nodesfile.blocksize=compress?BLOCK_SIZE:0;
+
+ nodesfile.hilbert=nodesx->hilbert;
+
+ nodesfile.nsnaps=nsnaps;
+
+ nodesfile.waychecksum=waysx->checksum;
+
  SeekFileBuffered(fd,0);
  WriteFileBuffered(fd,&nodesfile,sizeof(NodesFile));
 
@@ -898,3 +1152,237 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
 
  printf_last("Wrote Nodes: Nodes=%"Pindex_t,nodesx->number);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the segment snapping index in a temporary file with an entry for each node of each normal segment
+  sorted into node order.
+
+  index_t create_snap_index Returns the number of entries in the snapping index.
+
+  NodesX *nodesx The set of nodes to use.
+
+  SegmentsX *segmentsx The set of segments to use.
+
+  WaysX *waysx The set of ways to use.
+
+  const char *filename The name of the temporary file to write.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t create_snap_index(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,const char *filename)
+{
+ index_t i,nsnaps;
+ int fd,sortedfd;
+ transports_t *allow;
+
+ /* Print the start message */
+
+ printf_first("Creating Snapping Index: Segments=0");
+
+ /* Read in the allowed transport types for each way */
+
+ allow=(transports_t*)malloc(waysx->number*sizeof(transports_t));
+
+ logassert(allow,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ waysx->fd=ReOpenFileBuffered(waysx->filename_tmp);
+
+ for(i=0;i<waysx->number;i++)
+   {
+    WayX wayx;
+
+    ReadFileBuffered(waysx->fd,&wayx,sizeof(WayX));
+
+    allow[i]=wayx.way.allow;
+   }
+
+ waysx->fd=CloseFileBuffered(waysx->fd);
+
+ /* Map into memory / open the files */
+
+#if !SLIM
+ nodesx->data=MapFile(nodesx->filename_tmp);
+#else
+ nodesx->fd=SlimMapFile(nodesx->filename_tmp);
+
+ InvalidateNodeXCache(nodesx->cache);
+#endif
+
+ segmentsx->fd=ReOpenFileBuffered(segmentsx->filename_tmp);
+
+ fd=OpenFileBufferedNew(filename);
+
+ /* Write out an entry for each node of each normal segment */
+
+ for(i=0;i<segmentsx->number;i++)
+   {
+    SegmentX segmentx;
+    NodeX *node1x,*node2x;
+    NodeSnapX snapx={0};
+
+    ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX));
+
+    if(segmentx.distance&SEGMENT_NORMAL)
+      {
+       node1x=LookupNodeX(nodesx,segmentx.node1,1);
+       node2x=LookupNodeX(nodesx,segmentx.node2,2);
+
+       snapx.snap.segment=i;
+       snapx.snap.allow=allow[segmentx.way];
+
+       snapx.node=segmentx.node1;
+       snapx.snap.othernode=segmentx.node2;
+       snapx.snap.latitude =node2x->latitude;
+       snapx.snap.longitude=node2x->longitude;
+       snapx.snap.node1=1;
+
+       WriteFileBuffered(fd,&snapx,sizeof(NodeSnapX));
+
+       if(segmentx.node2!=segmentx.node1)
+         {
+          snapx.node=segmentx.node2;
+          snapx.snap.othernode=segmentx.node1;
+          snapx.snap.latitude =node1x->latitude;
+          snapx.snap.longitude=node1x->longitude;
+          snapx.snap.node1=0;
+
+          WriteFileBuffered(fd,&snapx,sizeof(NodeSnapX));
+         }
+      }
+
+    if(!((i+1)%10000))
+       printf_middle("Creating Snapping Index: Segments=%"Pindex_t,i+1);
+   }
+
+ /* Unmap from memory / close the files */
+
+#if !SLIM
+ nodesx->data=UnmapFile(nodesx->data);
+#else
+ nodesx->fd=SlimUnmapFile(nodesx->fd);
+#endif
+
+ segmentsx->fd=CloseFileBuffered(segmentsx->fd);
+
+ CloseFileBuffered(fd);
+
+ free(allow);
+
+ /* Sort the entries by node and then by segment index */
+
+ sortedfd=ReplaceFileBuffered(filename,&fd);
+
+ nsnaps=filesort_fixed(fd,sortedfd,sizeof(NodeSnapX),NULL,
+                                                     (int (*)(const void*,const void*))sort_snaps,
+                                                     NULL);
+
+ CloseFileBuffered(fd);
+ CloseFileBuffered(sortedfd);
+
+ /* Print the final message */
+
+ printf_last("Created Snapping Index: Segments=%"Pindex_t" Entries=%"Pindex_t,segmentsx->number,nsnaps);
+
+ return(nsnaps);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the snapping index entries into node order and then into segment index order for each node (the
+  same order that the segments are visited by following the 'next2' index).
+
+  int sort_snaps Returns the comparison of the node and segment index fields.
+
+  NodeSnapX *a The first snapping index entry.
+
+  NodeSnapX *b The second snapping index entry.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_snaps(NodeSnapX *a,NodeSnapX *b)
+{
+ index_t a_id=a->node;
+ index_t b_id=b->node;
+
+ if(a_id<b_id)
+    return(-1);
+ else if(a_id>b_id)
+    return(1);
+ else
+   {
+    index_t a_id=a->snap.segment;
+    index_t b_id=b->snap.segment;
+
+    if(a_id<b_id)
+       return(-1);
+    else if(a_id>b_id)
+       return(1);
+    else
+       return(FILESORT_PRESERVE_ORDER(a,b));
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance along a Hilbert curve for a point in a square grid.
+
+  uint64_t hilbert_key Returns the distance along the curve.
+
+  uint32_t x The x coordinate (less than 2 to the power of order).
+
+  uint32_t y The y coordinate (less than 2 to the power of order).
+
+  int order The number of bits in each coordinate.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t hilbert_key(uint32_t x,uint32_t y,int order)
+{
+ uint32_t mask=(1U<<order)-1;
+ uint32_t s;
+ uint64_t d=0;
+
+ for(s=1U<<(order-1);s>0;s>>=1)
+   {
+    uint32_t rx=(x&s)?1:0;
+    uint32_t ry=(y&s)?1:0;
+
+    d+=(uint64_t)s*s*((3*rx)^ry);
+
+    /* Rotate the quadrant (only the lower bits are used after this) */
+
+    if(ry==0)
+      {
+       uint32_t t;
+
+       if(rx==1)
+         {
+          x=mask-x;
+          y=mask-y;
+         }
+
+       t=x; x=y; y=t;
+      }
+   }
+
+ return(d);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort 64-bit integers into ascending order.
+
+  int sort_by_uint64 Returns the comparison of the two integers.
+
+  uint64_t *a The first integer.
+
+  uint64_t *b The second integer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_uint64(uint64_t *a,uint64_t *b)
+{
+ if(*a<*b)
+    return(-1);
+ else if(*a>*b)
+    return(1);
+ else
+    return(0);
+}
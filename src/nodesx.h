@@ -86,6 +86,8 @@ struct _NodesX
 
  ll_bin_t  latzero;             /*+ The bin number of the furthest south bin. +*/
  ll_bin_t  lonzero;             /*+ The bin number of the furthest west bin. +*/
+
+ int       hilbert;             /*+ Set to non-zero if the nodes are sorted along a Hilbert curve. +*/
 };
 
 
@@ -105,9 +107,9 @@ void RemoveNonHighwayNodes(NodesX *nodesx,WaysX *waysx,int keep);
 
 void RemovePrunedNodes(NodesX *nodesx,SegmentsX *segmentsx);
 
-void SortNodeListGeographically(NodesX *nodesx);
+void SortNodeListGeographically(NodesX *nodesx,int hilbert);
 
-void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx);
+void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx,WaysX *waysx,int snap,int compress);
 
 
 /* Macros and inline functions */
@@ -129,6 +131,7 @@ static inline void PutBackNodeX(NodesX *nodesx,NodeX *nodex);
 CACHE_NEWCACHE_PROTO(NodeX)
 CACHE_DELETECACHE_PROTO(NodeX)
 CACHE_FETCHCACHE_PROTO(NodeX)
+CACHE_CHOOSEVICTIM_PROTO(NodeX)
 CACHE_REPLACECACHE_PROTO(NodeX)
 CACHE_INVALIDATECACHE_PROTO(NodeX)
 
@@ -141,6 +144,7 @@ CACHE_STRUCTURE(NodeX)
 CACHE_NEWCACHE(NodeX)
 CACHE_DELETECACHE(NodeX)
 CACHE_FETCHCACHE(NodeX)
+CACHE_CHOOSEVICTIM(NodeX)
 CACHE_REPLACECACHE(NodeX)
 CACHE_INVALIDATECACHE(NodeX)
 
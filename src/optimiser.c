@@ -25,50 +25,89 @@
 #include "segments.h"
 #include "ways.h"
 #include "relations.h"
+#include "hierarchy.h"
+#include "landmarks.h"
 
 #include "logging.h"
 #include "functions.h"
+#include "context.h"
 #include "fakes.h"
 #include "results.h"
 
-#ifdef LIBROUTINO
+/*+ To help when debugging +*/
+#define DEBUG 0
+
 
-#include "routino.h"
+/* Global variables */
 
-/*+ The function to be called to report on the routing progress. +*/
-extern Routino_ProgressFunc progress_func;
+/*+ The option not to print any progress information. +*/
+extern int option_quiet;
 
-/*+ The current state of the routing progress. +*/
-extern double progress_value;
 
-/*+ Set when the progress callback returns false in the routing function. +*/
-extern int progress_abort;
+/* Local types */
 
-#endif
+/*+ One of the super-nodes reached by the search backwards from one of the finish points of a matrix. +*/
+typedef struct _MatrixEntry
+{
+ index_t     node;              /*+ The super-node for which this entry applies. +*/
+ index_t     segment;           /*+ The super-segment used to get to the super-node. +*/
 
+ int         finish;            /*+ The finish point that this entry leads to. +*/
 
-/*+ To help when debugging +*/
-#define DEBUG 0
+ score_t     score;             /*+ The score from the super-node to the finish point. +*/
 
+ distance_t  distance;          /*+ The distance from the super-node to the finish point. +*/
+ duration_t  duration;          /*+ The duration from the super-node to the finish point. +*/
+}
+ MatrixEntry;
 
-/* Global variables */
+/*+ The super-nodes near to all of the finish points of a matrix. +*/
+struct _Matrix
+{
+ int          nfinish;          /*+ The number of finish points. +*/
 
-/*+ The option not to print any progress information. +*/
-extern int option_quiet;
+ index_t    **near;             /*+ The sorted list of nodes near to each finish point (or NULL if there is no route to it). +*/
+ int         *nnear;            /*+ The number of nodes near to each finish point. +*/
 
-/*+ The option to calculate the quickest route insted of the shortest. +*/
-extern int option_quickest;
+ MatrixEntry *entries;          /*+ The super-nodes near to all of the finish points sorted by node, segment and finish point. +*/
+ size_t       nentries;         /*+ The number of entries. +*/
+ size_t       nallocentries;    /*+ The number of allocated entries. +*/
+
+ int          sorted;           /*+ Set to true when the entries have been sorted. +*/
+};
 
 
 /* Local functions */
 
-static Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
-static Results *FindMiddleRoute(Nodes *supernodes,Segments *supersegments,Ways *superways,Relations *relations,Profile *profile,Results *begin,Results *end);
-static index_t  FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node,index_t finish_segment);
-static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t finish_node);
-static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
-static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node);
-static Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle,Results *end);
+static Results *FindNormalRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
+static Results *FindNormalRouteBidirectional(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
+static int      CheckForwardSegment(Context *context,Nodes *nodes,Segments *segments,Relations *relations,Profile *profile,
+                                    index_t node1,index_t seg1,index_t seg1r,index_t turnrelation,int force_uturn,
+                                    Segment *segment2p,index_t node2,index_t finish_node,int pass_level,
+                                    index_t *seg2,score_t *segment_score);
+static int      CheckReverseSegment(Context *context,Nodes *nodes,Segments *segments,Relations *relations,Profile *profile,
+                                    index_t node1,Node *node1p,index_t seg1,index_t seg1r,
+                                    Segment *segment2p,index_t node2,index_t start_node,int pass_level,
+                                    index_t *seg2);
+static Results *FindMiddleRoute(Context *context,Nodes *supernodes,Segments *supersegments,Ways *superways,Relations *relations,Landmarks *landmarks,Profile *profile,Results *begin,Results *end);
+static Results *FindMiddleRouteHierarchy(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Hierarchy *hierarchy,Profile *profile,Results *begin,Results *end);
+static int      UnpackHierarchyArc(Hierarchy *hierarchy,index_t lower,index_t arc,int up,index_t *segments,score_t *scores);
+static index_t  FindSuperSegment(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node,index_t finish_segment);
+static Results *FindSuperRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t finish_node);
+static int      SuperSegmentPassesOver(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile,index_t start_node,index_t superseg,index_t via_node);
+static void     AddLandmarkTarget(Landmarks *landmarks,index_t node,score_t score,score_t factor,int reverse,score_t *targets);
+static score_t  LandmarkPotential(Landmarks *landmarks,index_t node,score_t factor,int reverse,score_t *targets);
+static Results *FindStartRoutes(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
+static Results *FindFinishRoutes(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node);
+static Results *CombineRoutes(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle,Results *end);
+
+static Results *FindMatrixForwardRoutes(Context *context,Matrix *matrix,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                        Results *begin,score_t *scores,Result **fwd_results,MatrixEntry **rev_entries);
+static int      JoinMatrixEntries(Matrix *matrix,Result *result,score_t *scores,Result **fwd_results,MatrixEntry **rev_entries);
+static index_t *NearNodes(Nodes *nodes,Segments *segments,Results *results,index_t waypoint_node,int *number);
+static void     AddSegmentTotals(Context *context,Segments *segments,Ways *ways,Profile *profile,index_t segment,distance_t *distance,duration_t *duration);
+static int      sort_by_node_segment_finish(MatrixEntry *a,MatrixEntry *b);
+static int      sort_by_index(index_t *a,index_t *b);
 
 static void     FixForwardRoute(Results *results,Result *finish_result);
 
@@ -82,6 +121,8 @@ static void print_debug_route(Nodes *nodes,Segments *segments,Results *results,R
 
   Results *CalculateRoute Returns a set of results.
 
+  Context *context The routing context to use.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -90,6 +131,8 @@ static void print_debug_route(Nodes *nodes,Segments *segments,Results *results,R
 
   Relations *relations The set of relations to use.
 
+  Landmarks *landmarks The landmark distances to use (or NULL if there are none).
+
   Profile *profile The profile containing the transport type, speeds and allowed highways.
 
   index_t start_node The start node.
@@ -103,7 +146,7 @@ static void print_debug_route(Nodes *nodes,Segments *segments,Results *results,R
   int finish_waypoint The finish waypoint.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+Results *CalculateRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,Profile *profile,
                         index_t start_node,index_t prev_segment,index_t finish_node,
                         int start_waypoint,int finish_waypoint)
 {
@@ -116,7 +159,7 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
     index_t fake_segment;
     Result *result1,*result2;
 
-    complete=NewResultsList(8);
+    complete=GetResultsList(&context->pool,8);
 
     if(prev_segment==NO_SEGMENT)
       {
@@ -124,15 +167,15 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
        distance_t distmin,dist1,dist2;
        index_t node1,node2;
 
-       GetLatLong(nodes,start_node,NULL,&lat,&lon);
+       GetLatLong(nodes,start_node,&lat,&lon);
 
        prev_segment=FindClosestSegment(nodes,segments,ways,lat,lon,1,profile,&distmin,&node1,&node2,&dist1,&dist2);
       }
 
     if(IsFakeSegment(prev_segment))
-       prev_segment=IndexRealSegment(prev_segment);
+       prev_segment=IndexRealSegment(&context->fakes,prev_segment);
 
-    fake_segment=CreateFakeNullSegment(segments,start_node,prev_segment,finish_waypoint);
+    fake_segment=CreateFakeNullSegment(&context->fakes,segments,start_node,prev_segment,finish_waypoint);
 
     result1=InsertResult(complete,start_node,prev_segment);
     result2=InsertResult(complete,finish_node,fake_segment);
@@ -151,7 +194,7 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
 
     /* Calculate the beginning of the route */
 
-    begin=FindStartRoutes(nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node);
+    begin=FindStartRoutes(context,nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node);
 
     if(begin)
       {
@@ -169,7 +212,7 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
 
           prev_segment=NO_SEGMENT;
 
-          begin=FindStartRoutes(nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node);
+          begin=FindStartRoutes(context,nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node);
          }
 
        if(begin)
@@ -196,7 +239,7 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
 
        /* Calculate the end of the route */
 
-       end=FindFinishRoutes(nodes,segments,ways,relations,profile,finish_node);
+       end=FindFinishRoutes(context,nodes,segments,ways,relations,profile,finish_node);
 
        if(!end)
          {
@@ -208,19 +251,25 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
 
        /* Calculate the middle of the route */
 
-       middle=FindMiddleRoute(nodes,segments,ways,relations,profile,begin,end);
+       middle=NULL;
+
+       if(context->hierarchy)
+          middle=FindMiddleRouteHierarchy(context,nodes,segments,ways,relations,context->hierarchy,profile,begin,end);
+
+       if(!middle)
+          middle=FindMiddleRoute(context,nodes,segments,ways,relations,landmarks,profile,begin,end);
 
        if(!middle && prev_segment!=NO_SEGMENT)
          {
           /* Try again but allow a U-turn at the start waypoint -
              this solves the problem of facing a dead-end that contains some super-nodes. */
 
-          FreeResultsList(begin);
+          PutResultsList(&context->pool,begin);
 
-          begin=FindStartRoutes(nodes,segments,ways,relations,profile,start_node,NO_SEGMENT,finish_node);
+          begin=FindStartRoutes(context,nodes,segments,ways,relations,profile,start_node,NO_SEGMENT,finish_node);
 
           if(begin)
-             middle=FindMiddleRoute(nodes,segments,ways,relations,profile,begin,end);
+             middle=FindMiddleRoute(context,nodes,segments,ways,relations,landmarks,profile,begin,end);
          }
 
        if(!middle)
@@ -231,7 +280,7 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
           return(NULL);
          }
 
-       complete=CombineRoutes(nodes,segments,ways,relations,profile,begin,middle,end);
+       complete=CombineRoutes(context,nodes,segments,ways,relations,profile,begin,middle,end);
 
        if(!complete)
          {
@@ -241,9 +290,9 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
           return(NULL);
          }
 
-       FreeResultsList(begin);
-       FreeResultsList(middle);
-       FreeResultsList(end);
+       PutResultsList(&context->pool,begin);
+       PutResultsList(&context->pool,middle);
+       PutResultsList(&context->pool,end);
       }
    }
 
@@ -261,9 +310,59 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Find the optimum route between two nodes not passing through a super-node.
+  Create a new matrix to hold the searches from a set of finish points.
 
-  Results *FindNormalRoute Returns a set of results.
+  Matrix *NewMatrix Returns the new matrix.
+
+  int nfinish The number of finish points.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Matrix *NewMatrix(int nfinish)
+{
+ Matrix *matrix;
+
+ matrix=(Matrix*)calloc(1,sizeof(Matrix));
+
+ matrix->nfinish=nfinish;
+
+ matrix->near   =(index_t**)calloc(nfinish,sizeof(index_t*));
+ matrix->nnear  =(int*)calloc(nfinish,sizeof(int));
+
+ return(matrix);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Free a matrix and all of the searches that it contains.
+
+  Matrix *matrix The matrix to free.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void FreeMatrix(Matrix *matrix)
+{
+ int i;
+
+ for(i=0;i<matrix->nfinish;i++)
+    if(matrix->near[i])
+       free(matrix->near[i]);
+
+ free(matrix->near);
+ free(matrix->nnear);
+
+ if(matrix->entries)
+    free(matrix->entries);
+
+ free(matrix);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Search backwards from one of the finish points of a matrix to the super-nodes and keep only
+  the score, distance and duration from each of them to the finish point.
+
+  Context *context The routing context to use.
+
+  Matrix *matrix The matrix to add the search to.
 
   Nodes *nodes The set of nodes to use.
 
@@ -275,635 +374,2209 @@ Results *CalculateRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *re
 
   Profile *profile The profile containing the transport type, speeds and allowed highways.
 
-  index_t start_node The start node.
-
-  index_t prev_segment The previous segment before the start node.
+  int finish The number of the finish point.
 
   index_t finish_node The finish node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
+void AddMatrixFinish(Context *context,Matrix *matrix,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                     int finish,index_t finish_node)
 {
- Results *results;
- Queue   *queue;
- score_t total_score;
- double  finish_lat,finish_lon;
- Result  *start_result,*finish_result;
- Result  *result1,*result2;
- int     force_uturn=0;
+ Results *end;
+ Result *end_result;
 
-#if DEBUG
- printf("    FindNormalRoute(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" finish_node=%"Pindex_t")\n",start_node,prev_segment,finish_node);
-#endif
+ end=FindFinishRoutes(context,nodes,segments,ways,relations,profile,finish_node);
 
- /* Set up the finish conditions */
+ if(!end)
+    return;
 
- total_score=INF_SCORE;
- finish_result=NULL;
+ matrix->near[finish]=NearNodes(nodes,segments,end,finish_node,&matrix->nnear[finish]);
 
- if(IsFakeNode(finish_node))
-    GetFakeLatLong(finish_node,&finish_lat,&finish_lon);
- else
-    GetLatLong(nodes,finish_node,NULL,&finish_lat,&finish_lon);
+ /* Add the super-nodes to the list with the distance and duration of the end part of the
+    route (which may use fake segments that will not exist when the routes are joined). */
 
- /* Create the list of results and insert the first node into the queue */
+ end_result=FirstResult(end);
 
- results=NewResultsList(8);
- queue=NewQueueList(8);
+ while(end_result)
+   {
+    if(!IsFakeNode(end_result->node) && IsSuperNode(LookupNode(nodes,end_result->node,3)))
+      {
+       MatrixEntry *entry;
+       Result *result=end_result;
 
- start_result=InsertResult(results,start_node,prev_segment);
+       if(matrix->nentries==matrix->nallocentries)
+         {
+          matrix->nallocentries+=matrix->nallocentries+1024;
 
- InsertInQueue(queue,start_result,0);
+          matrix->entries=(MatrixEntry*)realloc(matrix->entries,matrix->nallocentries*sizeof(MatrixEntry));
+         }
 
- /* Check for barrier at start waypoint - must perform U-turn */
+       entry=&matrix->entries[matrix->nentries++];
 
- if(prev_segment!=NO_SEGMENT && !IsFakeNode(start_node))
-   {
-    Node *startp=LookupNode(nodes,start_node,1);
+       entry->node=end_result->node;
+       entry->segment=end_result->segment;
+       entry->finish=finish;
+       entry->score=end_result->score;
+       entry->distance=0;
+       entry->duration=0;
 
-    if(!(startp->allow&profile->allow))
-       force_uturn=1;
-   }
+       while(result->next)
+         {
+          AddSegmentTotals(context,segments,ways,profile,result->next->segment,&entry->distance,&entry->duration);
 
- /* Loop across all nodes in the queue */
+          result=result->next;
+         }
+      }
 
- while((result1=PopFromQueue(queue)))
-   {
-    Node *node1p=NULL;
-    Segment *segment2p;
-    index_t node1,seg1,seg1r;
-    index_t turnrelation=NO_RELATION;
+    end_result=NextResult(end,end_result);
+   }
 
-    /* score must be better than current best score */
-    if(result1->score>=total_score)
-       continue;
+ matrix->sorted=0;
 
-    node1=result1->node;
-    seg1=result1->segment;
+ PutResultsList(&context->pool,end);
+}
 
-    if(IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
-    else
-       seg1r=seg1;
 
-    if(!IsFakeNode(node1))
-       node1p=LookupNode(nodes,node1,1);
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the routes from a start point to all of the finish points of a matrix by
+  searching forwards across the super-segments until the super-nodes near to all of
+  the finish points have been reached.
 
-    /* lookup if a turn restriction applies */
-    if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
-       turnrelation=FindFirstTurnRelation2(relations,node1,seg1r);
+  Context *context The routing context to use.
 
-    /* Loop across all segments */
+  Matrix *matrix The matrix containing the super-nodes near to the finish points.
 
-    if(IsFakeNode(node1))
-       segment2p=FirstFakeSegment(node1);
-    else
-       segment2p=FirstSegment(segments,node1p,1);
+  Nodes *nodes The set of nodes to use.
 
-    while(segment2p)
-      {
-       Node *node2p=NULL;
-       Way *way2p;
-       index_t node2,seg2,seg2r;
-       score_t segment_pref,segment_score,cumulative_score;
-       int i;
+  Segments *segments The set of segments to use.
 
-       node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
+  Ways *ways The set of ways to use.
 
-       /* must be a normal segment */
-       if(!IsNormalSegment(segment2p))
-          goto endloop;
+  Relations *relations The set of relations to use.
 
-       /* must obey one-way restrictions (unless profile allows) */
-       if(profile->oneway && IsOnewayTo(segment2p,node1))
-         {
-          if(profile->allow!=Transports_Bicycle)
-             goto endloop;
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
 
-          way2p=LookupWay(ways,segment2p->way,1);
+  index_t start_node The start node.
 
-          if(!(way2p->type&Highway_CycleBothWays))
-             goto endloop;
-         }
+  int *status Returns for each finish point 1 if a route was found, 0 if there is no route or -1
+              if the start and finish are close and the route must be calculated in full.
 
-       if(IsFakeNode(node1) || IsFakeNode(node2))
-         {
-          seg2 =IndexFakeSegment(segment2p);
-          seg2r=IndexRealSegment(seg2);
-         }
-       else
-         {
-          seg2 =IndexSegment(segments,segment2p);
-          seg2r=seg2;
-         }
+  distance_t *distances Returns the distance of the route to each finish point.
 
-       /* must perform U-turn in special cases */
-       if(force_uturn && node1==start_node)
-         {
-          if(seg2r!=result1->segment)
-             goto endloop;
-         }
-       else
-          /* must not perform U-turn (unless profile allows) */
-          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2))))
-             goto endloop;
+  duration_t *durations Returns the duration of the route to each finish point.
+  ++++++++++++++++++++++++++++++++++++++*/
 
-       /* must obey turn relations */
-       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2r,profile->allow))
-          goto endloop;
+void CalculateMatrixRow(Context *context,Matrix *matrix,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                        index_t start_node,int *status,distance_t *distances,duration_t *durations)
+{
+ Results *begin,*forward;
+ Result  **fwd_results;
+ MatrixEntry **rev_entries;
+ score_t *scores;
+ index_t *near;
+ int     nnear,i;
+
+ if(!matrix->sorted)
+   {
+    qsort(matrix->entries,matrix->nentries,sizeof(MatrixEntry),(int (*)(const void*,const void*))sort_by_node_segment_finish);
 
-       if(!IsFakeNode(node2))
-          node2p=LookupNode(nodes,node2,2);
+    matrix->sorted=1;
+   }
 
-       /* must not pass over super-node */
-       if(node2!=finish_node && node2p && IsSuperNode(node2p))
-          goto endloop;
+ for(i=0;i<matrix->nfinish;i++)
+    status[i]=0;
 
-       way2p=LookupWay(ways,segment2p->way,1);
+ /* Find the nearby super-nodes (if there are none then the only possible routes are to nearby points) */
 
-       /* mode of transport must be allowed on the highway */
-       if(!(way2p->allow&profile->allow))
-          goto endloop;
+ begin=FindStartRoutes(context,nodes,segments,ways,relations,profile,start_node,NO_SEGMENT,NO_NODE);
 
-       /* must obey weight restriction (if exists) */
-       if(way2p->weight && way2p->weight<profile->weight)
-          goto endloop;
+ if(!begin)
+   {
+    for(i=0;i<matrix->nfinish;i++)
+       if(matrix->near[i])
+          status[i]=-1;
 
-       /* must obey height/width/length restriction (if exist) */
-       if((way2p->height && way2p->height<profile->height) ||
-          (way2p->width  && way2p->width <profile->width ) ||
-          (way2p->length && way2p->length<profile->length))
-          goto endloop;
+    return;
+   }
 
-       segment_pref=profile->highway[HIGHWAY(way2p->type)];
+ near=NearNodes(nodes,segments,begin,start_node,&nnear);
 
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
+ /* Search forwards joining the search to the super-nodes near the finish points */
 
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(way2p->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
+ scores=(score_t*)malloc(matrix->nfinish*sizeof(score_t));
+ fwd_results=(Result**)malloc(matrix->nfinish*sizeof(Result*));
+ rev_entries=(MatrixEntry**)malloc(matrix->nfinish*sizeof(MatrixEntry*));
 
-       /* profile preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
+ for(i=0;i<matrix->nfinish;i++)
+    scores[i]=INF_SCORE;
 
-       /* mode of transport must be allowed through node2 unless it is the final node */
-       if(node2p && node2!=finish_node && !(node2p->allow&profile->allow))
-          goto endloop;
+ forward=FindMatrixForwardRoutes(context,matrix,nodes,segments,ways,relations,profile,begin,scores,fwd_results,rev_entries);
 
-       /* calculate the score for the segment and cumulative */
-       if(option_quickest==0)
-          segment_score=(score_t)DISTANCE(segment2p->distance)/segment_pref;
-       else
-          segment_score=(score_t)Duration(segment2p,way2p,profile)/segment_pref;
+ /* Calculate the distance and duration of each route */
 
-       cumulative_score=result1->score+segment_score;
+ for(i=0;i<matrix->nfinish;i++)
+   {
+    Result *fwd_result;
+    int j,k;
 
-       /* score must be better than current best score */
-       if(cumulative_score>=total_score)
-          goto endloop;
+    if(!matrix->near[i])
+       continue;
 
-       /* find whether the node/segment combination already exists */
-       result2=FindResult(results,node2,seg2);
+    /* A route between two close points might not pass through any super-nodes */
 
-       if(!result2) /* New end node/segment combination */
-         {
-          result2=InsertResult(results,node2,seg2);
-          result2->prev=result1;
-          result2->score=cumulative_score;
-         }
-       else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
-         {
-          result2->prev=result1;
-          result2->score=cumulative_score;
-          result2->segment=seg2;
-         }
+    for(j=0,k=0;j<nnear && k<matrix->nnear[i];)
+       if(near[j]<matrix->near[i][k])
+          j++;
+       else if(near[j]>matrix->near[i][k])
+          k++;
        else
-          goto endloop;
+          break;
 
-       if(node2==finish_node)
-         {
-          total_score=cumulative_score;
-          finish_result=result2;
-         }
-       else
-          InsertInQueue(queue,result2,result2->score);
+    if(j<nnear && k<matrix->nnear[i])
+      {
+       status[i]=-1;
+       continue;
+      }
 
-      endloop:
+    if(scores[i]==INF_SCORE)
+       continue;
 
-       if(IsFakeNode(node1))
-          segment2p=NextFakeSegment(segment2p,node1);
-       else if(IsFakeNode(node2))
-          segment2p=NULL; /* cannot call NextSegment() with a fake segment */
-       else
-         {
-          segment2p=NextSegment(segments,segment2p,node1);
+    distances[i]=0;
+    durations[i]=0;
 
-          if(!segment2p && IsFakeNode(finish_node))
-             segment2p=ExtraFakeSegment(node1,finish_node);
-         }
-      }
-   }
+    /* The part of the route from the start to the first super-node and across the super-segments */
 
- FreeQueueList(queue);
+    fwd_result=fwd_results[i];
 
- /* Check it worked */
+    while(fwd_result->prev)
+      {
+       AddSegmentTotals(context,segments,ways,profile,fwd_result->segment,&distances[i],&durations[i]);
 
- if(!finish_result)
-   {
-#if DEBUG
-    printf("      Failed\n");
-#endif
+       fwd_result=fwd_result->prev;
+      }
 
-    FreeResultsList(results);
-    return(NULL);
-   }
+    fwd_result=fwd_result->next;
 
- /* Turn the route round and fill in the start and finish information */
+    while(fwd_result->prev)
+      {
+       AddSegmentTotals(context,segments,ways,profile,fwd_result->segment,&distances[i],&durations[i]);
 
- FixForwardRoute(results,finish_result);
+       fwd_result=fwd_result->prev;
+      }
 
- results->start_node  =start_result->node;
- results->prev_segment=start_result->segment;
+    /* The part of the route from the last super-node to the finish */
 
- results->finish_node =finish_result->node;
- results->last_segment=finish_result->segment;
+    distances[i]+=rev_entries[i]->distance;
+    durations[i]+=rev_entries[i]->duration;
 
-#if DEBUG
- printf("      -------- normal route (between super-nodes)\n");
+    status[i]=1;
+   }
 
- print_debug_route(nodes,segments,results,NULL,6,+1);
-#endif
+ free(scores);
+ free(fwd_results);
+ free(rev_entries);
 
- return(results);
+ free(near);
+
+ PutResultsList(&context->pool,forward);
+ PutResultsList(&context->pool,begin);
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Find the optimum route between two nodes where the start and end are a set of pre/post-routed super-nodes.
+  Calculate the total distance and duration of a complete route.
 
-  Results *FindMiddleRoute Returns a set of results.
+  Context *context The routing context to use.
 
-  Nodes *nodes The set of nodes to use.
+  Results *results The complete route.
 
   Segments *segments The set of segments to use.
 
   Ways *ways The set of ways to use.
 
-  Relations *relations The set of relations to use.
-
   Profile *profile The profile containing the transport type, speeds and allowed highways.
 
-  Results *begin The initial portion of the route.
+  distance_t *distance Returns the distance of the route.
 
-  Results *end The final portion of the route.
+  duration_t *duration Returns the duration of the route.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *end)
+void CalculateRouteTotals(Context *context,Results *results,Segments *segments,Ways *ways,Profile *profile,distance_t *distance,duration_t *duration)
 {
- Results *results;
- Queue   *fwd_queue,*rev_queue;
- Result  *start_result,*finish_result;
- score_t total_score;
- double  start_lat,start_lon;
+ Result *result=FindResult(results,results->start_node,results->prev_segment);
+
+ *distance=0;
+ *duration=0;
+
+ while(result->next)
+   {
+    result=result->next;
+
+    AddSegmentTotals(context,segments,ways,profile,result->segment,distance,duration);
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find all of the nodes that can be reached from a node within a limited distance or duration.
+  Only normal segments are followed because super-segments would skip the intermediate nodes
+  (which could then be reached by a longer route).
+
+  Results *CalculateIsochrone Returns the set of results (the score of each is the distance or
+                              duration rather than the weighted value used for routing).
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t start_node The start node.
+
+  score_t limit The limit of the distance (shortest) or duration (quickest).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Results *CalculateIsochrone(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                            index_t start_node,score_t limit)
+{
+ Results *results;
+ Queue   *queue;
+ Result  *result1,*result2;
+#ifdef LIBROUTINO
+ int     loopcount=0;
+#endif
+
+#if DEBUG
+ printf("  CalculateIsochrone(...,start_node=%"Pindex_t" limit=%f)\n",start_node,limit);
+#endif
+
+#if !DEBUG && !defined(LIBROUTINO)
+ if(!option_quiet)
+    printf_first("Finding Isochrone: Nodes checked = 0");
+#endif
+
+ /* Create the list of results and insert the first node into the queue */
+
+ results=GetResultsList(&context->pool,20);
+ queue=GetQueueList(&context->pool,12);
+
+ result1=InsertResult(results,start_node,NO_SEGMENT);
+
+ InsertInQueue(queue,result1,0);
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p=NULL;
+    Segment *segment2p;
+    index_t node1,seg1,seg1r;
+    index_t turnrelation=NO_RELATION;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    if(seg1!=NO_SEGMENT && IsFakeSegment(seg1))
+       seg1r=IndexRealSegment(&context->fakes,seg1);
+    else
+       seg1r=seg1;
+
+    if(!IsFakeNode(node1))
+       node1p=LookupNode(nodes,node1,1);
+
+    /* mode of transport must be allowed through node1 (it can be reached if it is a barrier) */
+    if(node1p && node1!=start_node && !(node1p->allow&profile->allow))
+       continue;
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
+       turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1r);
+
+    /* Loop across all segments */
+
+    if(IsFakeNode(node1))
+       segment2p=FirstFakeSegment(&context->fakes,node1);
+    else
+       segment2p=FirstSegment(segments,node1p,1);
+
+    while(segment2p)
+      {
+       WayCost *waycost2;
+       index_t node2,seg2,seg2r;
+       score_t segment_score,cumulative_score;
+
+       node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
+
+       /* must be a normal segment */
+       if(!IsNormalSegment(segment2p))
+          goto endloop;
+
+       waycost2=LookupWayCost(profile,segment2p->way);
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segment2p,node1) && !waycost2->bothways)
+          goto endloop;
+
+       if(IsFakeNode(node1) || IsFakeNode(node2))
+         {
+          seg2 =IndexFakeSegment(&context->fakes,segment2p);
+          seg2r=IndexRealSegment(&context->fakes,seg2);
+         }
+       else
+         {
+          seg2 =IndexSegment(segments,segment2p);
+          seg2r=seg2;
+         }
+
+       /* must not perform U-turn (unless profile allows) */
+       if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(&context->fakes,seg1,seg2))))
+          goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg1r,seg2r,profile->allow))
+          goto endloop;
+
+       /* mode of transport, restrictions and preferences must allow this highway */
+       if(waycost2->pref==0)
+          goto endloop;
+
+       /* calculate the distance or duration for the segment and cumulative */
+       if(context->quickest==0)
+          segment_score=(score_t)DISTANCE(segment2p->distance);
+       else
+          segment_score=(score_t)WayCostDuration(DISTANCE(segment2p->distance),waycost2);
+
+       cumulative_score=result1->score+segment_score;
+
+       /* must be within the limit */
+       if(cumulative_score>limit)
+          goto endloop;
+
+       /* find whether the node/segment combination already exists */
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment combination */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       if(IsFakeNode(node1))
+          segment2p=NextFakeSegment(&context->fakes,segment2p,node1);
+       else if(IsFakeNode(node2))
+          segment2p=NULL; /* cannot call NextSegment() with a fake segment */
+       else
+          segment2p=NextSegment(segments,segment2p,node1);
+      }
+
+#ifdef LIBROUTINO
+    if(!(++loopcount%100000))
+       if(context->progress_func && !context->progress_func(context->progress_value))
+         {
+          context->progress_abort=1;
+          break;
+         }
+#endif
+   }
+
+ PutQueueList(&context->pool,queue);
+
+ results->start_node=start_node;
+ results->prev_segment=NO_SEGMENT;
+
+#if !DEBUG && !defined(LIBROUTINO)
+ if(!option_quiet)
+    printf_last("Found Isochrone: Nodes checked = %d",results->number);
+#endif
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the optimum route between two nodes not passing through a super-node.
+
+  Results *FindNormalRoute Returns a set of results.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t start_node The start node.
+
+  index_t prev_segment The previous segment before the start node.
+
+  index_t finish_node The finish node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *FindNormalRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
+{
+ Results *results;
+ Queue   *queue;
+ score_t total_score;
  double  finish_lat,finish_lon;
+ Result  *start_result,*finish_result;
  Result  *result1,*result2;
- int     force_uturn=0;
+ int     force_uturn=0,pass_level=0;
+
+#if DEBUG
+ printf("    FindNormalRoute(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" finish_node=%"Pindex_t")\n",start_node,prev_segment,finish_node);
+#endif
+
+ /* Search from both ends at once if requested */
+
+ if(context->bidirectional)
+    return(FindNormalRouteBidirectional(context,nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node));
+
+ /* Set up the finish conditions */
+
+ total_score=INF_SCORE;
+ finish_result=NULL;
+
+ if(IsFakeNode(finish_node))
+    GetFakeLatLong(&context->fakes,finish_node,&finish_lat,&finish_lon);
+ else
+    GetLatLong(nodes,finish_node,&finish_lat,&finish_lon);
+
+ /* Create the list of results and insert the first node into the queue */
+
+ results=GetResultsList(&context->pool,8);
+ queue=GetQueueList(&context->pool,8);
+
+ start_result=InsertResult(results,start_node,prev_segment);
+
+ InsertInQueue(queue,start_result,0);
+
+ /* Check for barrier at start waypoint - must perform U-turn */
+
+ if(prev_segment!=NO_SEGMENT && !IsFakeNode(start_node))
+   {
+    Node *startp=LookupNode(nodes,start_node,1);
+
+    if(!(startp->allow&profile->allow))
+       force_uturn=1;
+   }
+
+ /* Lower level super-nodes can be passed over when following a higher level super-segment */
+
+ if(!IsFakeNode(start_node) && !IsFakeNode(finish_node))
+   {
+    int start_level =SuperNodeLevel(LookupNode(nodes,start_node ,1));
+    int finish_level=SuperNodeLevel(LookupNode(nodes,finish_node,1));
+
+    pass_level=start_level<finish_level?start_level:finish_level;
+   }
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p=NULL;
+    Segment *segment2p;
+    index_t node1,seg1,seg1r;
+    index_t turnrelation=NO_RELATION;
+
+    /* score must be better than current best score */
+    if(result1->score>=total_score)
+       continue;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    if(IsFakeSegment(seg1))
+       seg1r=IndexRealSegment(&context->fakes,seg1);
+    else
+       seg1r=seg1;
+
+    if(!IsFakeNode(node1))
+       node1p=LookupNode(nodes,node1,1);
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
+       turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1r);
+
+    /* Loop across all segments */
+
+    if(IsFakeNode(node1))
+       segment2p=FirstFakeSegment(&context->fakes,node1);
+    else
+       segment2p=FirstSegment(segments,node1p,1);
+
+    while(segment2p)
+      {
+       index_t node2,seg2;
+       score_t segment_score,cumulative_score;
+
+       node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
+
+       if(!CheckForwardSegment(context,nodes,segments,relations,profile,node1,seg1,seg1r,turnrelation,force_uturn && node1==start_node,
+                               segment2p,node2,finish_node,pass_level,&seg2,&segment_score))
+          goto endloop;
+
+       cumulative_score=result1->score+segment_score;
+
+       /* score must be better than current best score */
+       if(cumulative_score>=total_score)
+          goto endloop;
+
+       /* find whether the node/segment combination already exists */
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment combination */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+          result2->segment=seg2;
+         }
+       else
+          goto endloop;
+
+       if(node2==finish_node)
+         {
+          total_score=cumulative_score;
+          finish_result=result2;
+         }
+       else
+          InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       if(IsFakeNode(node1))
+          segment2p=NextFakeSegment(&context->fakes,segment2p,node1);
+       else if(IsFakeNode(node2))
+          segment2p=NULL; /* cannot call NextSegment() with a fake segment */
+       else
+         {
+          segment2p=NextSegment(segments,segment2p,node1);
+
+          if(!segment2p && IsFakeNode(finish_node))
+             segment2p=ExtraFakeSegment(&context->fakes,node1,finish_node);
+         }
+      }
+   }
+
+ PutQueueList(&context->pool,queue);
+
+ context->normal_checked+=results->number;
+
+ /* Check it worked */
+
+ if(!finish_result)
+   {
+#if DEBUG
+    printf("      Failed\n");
+#endif
+
+    PutResultsList(&context->pool,results);
+    return(NULL);
+   }
+
+ /* Turn the route round and fill in the start and finish information */
+
+ FixForwardRoute(results,finish_result);
+
+ results->start_node  =start_result->node;
+ results->prev_segment=start_result->segment;
+
+ results->finish_node =finish_result->node;
+ results->last_segment=finish_result->segment;
+
+#if DEBUG
+ printf("      -------- normal route (between super-nodes)\n");
+
+ print_debug_route(nodes,segments,results,NULL,6,+1);
+#endif
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the optimum route between two nodes not passing through a super-node by
+  searching forwards from the start and backwards from the finish at the same time.
+
+  Results *FindNormalRouteBidirectional Returns a set of results.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t start_node The start node.
+
+  index_t prev_segment The previous segment before the start node.
+
+  index_t finish_node The finish node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *FindNormalRouteBidirectional(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
+{
+ Results *results,*fwd_results,*rev_results;
+ Queue   *fwd_queue,*rev_queue;
+ score_t total_score;
+ double  start_lat,start_lon;
+ double  finish_lat,finish_lon;
+ Result  *start_result,*fwd_result,*rev_result;
+ Result  *result1,*result2,*result3;
+ Segment *segment2p;
+ Node    *finishp=NULL;
+ int     force_uturn=0,pass_level=0;
+
+#if DEBUG
+ printf("    FindNormalRouteBidirectional(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" finish_node=%"Pindex_t")\n",start_node,prev_segment,finish_node);
+#endif
+
+ /* Set up the finish conditions */
+
+ total_score=INF_SCORE;
+ fwd_result=NULL;
+ rev_result=NULL;
+
+ if(IsFakeNode(start_node))
+    GetFakeLatLong(&context->fakes,start_node,&start_lat,&start_lon);
+ else
+    GetLatLong(nodes,start_node,&start_lat,&start_lon);
+
+ if(IsFakeNode(finish_node))
+    GetFakeLatLong(&context->fakes,finish_node,&finish_lat,&finish_lon);
+ else
+    GetLatLong(nodes,finish_node,&finish_lat,&finish_lon);
+
+ /* Create the lists of results and insert the first node into the forward queue */
+
+ fwd_results=GetResultsList(&context->pool,8);
+ rev_results=GetResultsList(&context->pool,8);
+ fwd_queue=GetQueueList(&context->pool,8);
+ rev_queue=GetQueueList(&context->pool,8);
+
+ start_result=InsertResult(fwd_results,start_node,prev_segment);
+
+ InsertInQueue(fwd_queue,start_result,0);
+
+ /* Check for barrier at start waypoint - must perform U-turn */
+
+ if(prev_segment!=NO_SEGMENT && !IsFakeNode(start_node))
+   {
+    Node *startp=LookupNode(nodes,start_node,1);
+
+    if(!(startp->allow&profile->allow))
+       force_uturn=1;
+   }
+
+ /* Lower level super-nodes can be passed over when following a higher level super-segment */
+
+ if(!IsFakeNode(start_node) && !IsFakeNode(finish_node))
+   {
+    int start_level =SuperNodeLevel(LookupNode(nodes,start_node ,1));
+    int finish_level=SuperNodeLevel(LookupNode(nodes,finish_node,1));
+
+    pass_level=start_level<finish_level?start_level:finish_level;
+   }
+
+ /* Insert the segments that can be used to reach the finish node into the reverse queue (a
+    fake segment from the start node directly to a fake finish node is left to the forward search) */
+
+ if(IsFakeNode(finish_node))
+    segment2p=FirstFakeSegment(&context->fakes,finish_node);
+ else
+   {
+    finishp=LookupNode(nodes,finish_node,1);
+    segment2p=FirstSegment(segments,finishp,1);
+   }
+
+ while(segment2p)
+   {
+    index_t node2,seg2;
+
+    node2=OtherNode(segment2p,finish_node);
+
+    if(!IsFakeNode(node2) &&
+       CheckReverseSegment(context,nodes,segments,relations,profile,finish_node,finishp,NO_SEGMENT,NO_SEGMENT,segment2p,node2,start_node,pass_level,&seg2))
+      {
+       result2=InsertResult(rev_results,finish_node,seg2);
+
+       InsertInQueue(rev_queue,result2,0);
+      }
+
+    if(IsFakeNode(finish_node))
+       segment2p=NextFakeSegment(&context->fakes,segment2p,finish_node);
+    else
+       segment2p=NextSegment(segments,segment2p,finish_node);
+   }
+
+ /* Loop across all nodes in the two queues, alternating between them */
+
+ while(1)
+   {
+    int queue1_empty=0,queue2_empty=0;
+
+    /* Forward queue */
+
+    if((result1=PopFromQueue(fwd_queue)))
+      {
+       Node *node1p=NULL;
+       index_t node1,seg1,seg1r;
+       index_t turnrelation=NO_RELATION;
+
+       /* stop when the best possible route through the forward queue cannot be better than current best score */
+       if(result1->sortby>=total_score)
+          break;
+
+       /* score must be better than current best score */
+       if(result1->score>=total_score)
+          continue;
+
+       node1=result1->node;
+       seg1=result1->segment;
+
+       if(IsFakeSegment(seg1))
+          seg1r=IndexRealSegment(&context->fakes,seg1);
+       else
+          seg1r=seg1;
+
+       if(!IsFakeNode(node1))
+          node1p=LookupNode(nodes,node1,1);
+
+       /* lookup if a turn restriction applies */
+       if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
+          turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1r);
+
+       /* Loop across all segments */
+
+       if(IsFakeNode(node1))
+          segment2p=FirstFakeSegment(&context->fakes,node1);
+       else
+          segment2p=FirstSegment(segments,node1p,1);
+
+       while(segment2p)
+         {
+          index_t node2,seg2;
+          score_t segment_score,cumulative_score,potential_score;
+          double lat,lon;
+          distance_t direct;
+
+          node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
+
+          if(!CheckForwardSegment(context,nodes,segments,relations,profile,node1,seg1,seg1r,turnrelation,force_uturn && node1==start_node,
+                                  segment2p,node2,finish_node,pass_level,&seg2,&segment_score))
+             goto endloop_fwd;
+
+          cumulative_score=result1->score+segment_score;
+
+          /* score must be better than current best score */
+          if(cumulative_score>=total_score)
+             goto endloop_fwd;
+
+          /* find whether the node/segment combination already exists */
+          result2=FindResult(fwd_results,node2,seg2);
+
+          if(!result2) /* New end node/segment combination */
+            {
+             result2=InsertResult(fwd_results,node2,seg2);
+             result2->prev=result1;
+             result2->score=cumulative_score;
+            }
+          else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+            {
+             result2->prev=result1;
+             result2->score=cumulative_score;
+            }
+          else
+             goto endloop_fwd;
+
+          if(node2==finish_node)
+            {
+             total_score=cumulative_score;
+             fwd_result=result2;
+             rev_result=NULL;
+
+             goto endloop_fwd;
+            }
+
+          /* check whether the reverse search has already reached this node/segment combination */
+          result3=FindResult(rev_results,node2,seg2);
+
+          if(result3 && (cumulative_score+result3->score)<total_score)
+            {
+             total_score=cumulative_score+result3->score;
+             fwd_result=result2;
+             rev_result=result3;
+            }
+
+          /* Insert a new node into the queue */
+
+          if(IsFakeNode(node2))
+             GetFakeLatLong(&context->fakes,node2,&lat,&lon);
+          else
+             GetLatLong(nodes,node2,&lat,&lon);
+
+          direct=Distance(lat,lon,finish_lat,finish_lon);
+
+          if(context->quickest==0)
+             potential_score=result2->score+(score_t)direct/profile->max_pref;
+          else
+             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+
+          if(potential_score<total_score)
+             InsertInQueue(fwd_queue,result2,potential_score);
+
+         endloop_fwd:
+
+          if(IsFakeNode(node1))
+             segment2p=NextFakeSegment(&context->fakes,segment2p,node1);
+          else if(IsFakeNode(node2))
+             segment2p=NULL; /* cannot call NextSegment() with a fake segment */
+          else
+            {
+             segment2p=NextSegment(segments,segment2p,node1);
+
+             if(!segment2p && IsFakeNode(finish_node))
+                segment2p=ExtraFakeSegment(&context->fakes,node1,finish_node);
+            }
+         }
+      }
+    else
+       queue1_empty=1;
+
+    /* Reverse queue */
+
+    if((result1=PopFromQueue(rev_queue)))
+      {
+       Node *node1p;
+       Segment *segment1p;
+       WayCost *waycost1;
+       index_t real_node1,node1,seg1,seg1r;
+       score_t segment1_pref,segment1_score;
+
+       /* stop when the best possible route through the reverse queue cannot be better than current best score */
+       if(result1->sortby>=total_score)
+          break;
+
+       /* score must be better than current best score */
+       if(result1->score>=total_score)
+          continue;
+
+       real_node1=result1->node;
+       seg1=result1->segment;
+
+       if(IsFakeSegment(seg1))
+         {
+          seg1r=IndexRealSegment(&context->fakes,seg1);
+          segment1p=LookupFakeSegment(&context->fakes,seg1);
+         }
+       else
+         {
+          seg1r=seg1;
+          segment1p=LookupSegment(segments,seg1,1);
+         }
+
+       node1=OtherNode(segment1p,real_node1);
+
+       node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (the fake start node is not searched) */
+
+       /* mode of transport must be allowed through node1 */
+       if(!(node1p->allow&profile->allow))
+          continue;
+
+       waycost1=LookupWayCost(profile,segment1p->way);
+
+       segment1_pref=waycost1->pref;
+
+       /* calculate the score for the segment */
+       if(context->quickest==0)
+          segment1_score=(score_t)DISTANCE(segment1p->distance)/segment1_pref;
+       else
+          segment1_score=(score_t)WayCostDuration(DISTANCE(segment1p->distance),waycost1)/segment1_pref;
+
+       /* Loop across all segments */
+
+       segment2p=FirstSegment(segments,node1p,1);
+
+       while(segment2p)
+         {
+          index_t node2,seg2;
+          score_t cumulative_score,potential_score;
+          double lat,lon;
+          distance_t direct;
+
+          node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
+
+          if(!CheckReverseSegment(context,nodes,segments,relations,profile,node1,node1p,seg1,seg1r,segment2p,node2,start_node,pass_level,&seg2))
+             goto endloop_rev;
+
+          cumulative_score=result1->score+segment1_score;
+
+          /* score must be better than current best score */
+          if(cumulative_score>=total_score)
+             goto endloop_rev;
+
+          /* find whether the node/segment combination already exists */
+          result2=FindResult(rev_results,node1,seg2); /* adding in reverse => node1,seg2 */
+
+          if(!result2) /* New end node/segment combination */
+            {
+             result2=InsertResult(rev_results,node1,seg2); /* adding in reverse => node1,seg2 */
+             result2->next=result1;   /* working backwards */
+             result2->score=cumulative_score;
+            }
+          else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+            {
+             result2->next=result1;   /* working backwards */
+             result2->score=cumulative_score;
+            }
+          else
+             goto endloop_rev;
+
+          /* check whether the forward search has already reached this node/segment combination
+             (the start is excluded since the forward search handles the special cases there) */
+          result3=FindResult(fwd_results,node1,seg2);
+
+          if(result3 && result3!=start_result && (cumulative_score+result3->score)<total_score)
+            {
+             total_score=cumulative_score+result3->score;
+             fwd_result=result3;
+             rev_result=result2;
+            }
+
+          /* the fake start node is not searched (the forward search has already left it) */
+          if(IsFakeNode(node2))
+             goto endloop_rev;
+
+          /* Insert a new node into the queue */
+
+          GetLatLong(nodes,node2,&lat,&lon);
+
+          direct=Distance(lat,lon,start_lat,start_lon);
+
+          if(context->quickest==0)
+             potential_score=result2->score+(score_t)direct/profile->max_pref;
+          else
+             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+
+          if(potential_score<total_score)
+             InsertInQueue(rev_queue,result2,potential_score);
+
+         endloop_rev:
+
+          if(IsFakeNode(node2))
+             segment2p=NULL; /* cannot call NextSegment() with a fake segment */
+          else
+            {
+             segment2p=NextSegment(segments,segment2p,node1);
+
+             if(!segment2p && IsFakeNode(start_node))
+                segment2p=ExtraFakeSegment(&context->fakes,node1,start_node);
+            }
+         }
+      }
+    else
+       queue2_empty=1;
+
+    if(queue1_empty || queue2_empty)
+       break;
+   }
+
+ PutQueueList(&context->pool,fwd_queue);
+ PutQueueList(&context->pool,rev_queue);
+
+ context->normal_checked+=fwd_results->number+rev_results->number;
+
+ /* Check it worked */
+
+ if(!fwd_result)
+   {
+#if DEBUG
+    printf("      Failed\n");
+#endif
+
+    PutResultsList(&context->pool,fwd_results);
+    PutResultsList(&context->pool,rev_results);
+    return(NULL);
+   }
+
+ /* Join the forward and reverse parts of the route together into a new set of results */
+
+ FixForwardRoute(fwd_results,fwd_result);
+
+ results=GetResultsList(&context->pool,8);
+
+ result1=InsertResult(results,start_result->node,start_result->segment);
+
+ result3=start_result;
+
+ while(result3!=fwd_result)
+   {
+    result3=result3->next;
+
+    result2=InsertResult(results,result3->node,result3->segment);
+
+    result2->prev=result1;
+    result2->score=result3->score;
+
+    result1=result2;
+   }
+
+ result3=rev_result;
+
+ while(result3 && result3->next)
+   {
+    result3=result3->next;
+
+    result2=InsertResult(results,result3->node,result3->segment);
+
+    result2->prev=result1;
+    result2->score=total_score-result3->score;
+
+    result1=result2;
+   }
+
+ PutResultsList(&context->pool,fwd_results);
+ PutResultsList(&context->pool,rev_results);
+
+ /* Turn the route round and fill in the start and finish information */
+
+ FixForwardRoute(results,result1);
+
+ results->start_node  =start_node;
+ results->prev_segment=prev_segment;
+
+ results->finish_node =result1->node;
+ results->last_segment=result1->segment;
+
+#if DEBUG
+ printf("      -------- normal route (between super-nodes, bidirectional)\n");
+
+ print_debug_route(nodes,segments,results,NULL,6,+1);
+#endif
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check whether a segment can be followed forwards from a node when searching for a normal route and calculate its score.
+
+  int CheckForwardSegment Returns true if the segment can be followed.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t node1 The node that the segment is followed from.
+
+  index_t seg1 The segment that was used to reach node1.
+
+  index_t seg1r The real segment that was used to reach node1.
+
+  index_t turnrelation The first turn relation that applies at node1 (or NO_RELATION).
+
+  int force_uturn Set to true if the route must perform a U-turn at node1.
+
+  Segment *segment2p The segment to check.
+
+  index_t node2 The node at the other end of the segment.
+
+  index_t finish_node The finish node (which the route is allowed to enter).
+
+  int pass_level The level below which super-nodes can be passed over.
+
+  index_t *seg2 Returns the index of the segment.
+
+  score_t *segment_score Returns the score for the segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int CheckForwardSegment(Context *context,Nodes *nodes,Segments *segments,Relations *relations,Profile *profile,
+                               index_t node1,index_t seg1,index_t seg1r,index_t turnrelation,int force_uturn,
+                               Segment *segment2p,index_t node2,index_t finish_node,int pass_level,
+                               index_t *seg2,score_t *segment_score)
+{
+ Node *node2p=NULL;
+ WayCost *waycost2;
+ index_t seg2r;
+ score_t segment_pref;
+
+ /* must be a normal segment */
+ if(!IsNormalSegment(segment2p))
+    return(0);
+
+ waycost2=LookupWayCost(profile,segment2p->way);
+
+ /* must obey one-way restrictions (unless profile allows) */
+ if(profile->oneway && IsOnewayTo(segment2p,node1) && !waycost2->bothways)
+    return(0);
+
+ if(IsFakeNode(node1) || IsFakeNode(node2))
+   {
+    *seg2=IndexFakeSegment(&context->fakes,segment2p);
+    seg2r=IndexRealSegment(&context->fakes,*seg2);
+   }
+ else
+   {
+    *seg2=IndexSegment(segments,segment2p);
+    seg2r=*seg2;
+   }
+
+ /* must perform U-turn in special cases */
+ if(force_uturn)
+   {
+    if(seg2r!=seg1)
+       return(0);
+   }
+ else
+    /* must not perform U-turn (unless profile allows) */
+    if(profile->turns && (seg1==*seg2 || seg1==seg2r || seg1r==*seg2 || (seg1r==seg2r && IsFakeUTurn(&context->fakes,seg1,*seg2))))
+       return(0);
+
+ /* must obey turn relations */
+ if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg1r,seg2r,profile->allow))
+    return(0);
+
+ if(!IsFakeNode(node2))
+    node2p=LookupNode(nodes,node2,2);
+
+ /* must not pass over super-node (unless it is a lower level than both ends) */
+ if(node2!=finish_node && node2p && IsSuperNode(node2p) && SuperNodeLevel(node2p)>=pass_level)
+    return(0);
+
+ segment_pref=waycost2->pref;
+
+ /* mode of transport, restrictions and preferences must allow this highway */
+ if(segment_pref==0)
+    return(0);
+
+ /* mode of transport must be allowed through node2 unless it is the final node */
+ if(node2p && node2!=finish_node && !(node2p->allow&profile->allow))
+    return(0);
+
+ /* calculate the score for the segment */
+ if(context->quickest==0)
+    *segment_score=(score_t)DISTANCE(segment2p->distance)/segment_pref;
+ else
+    *segment_score=(score_t)WayCostDuration(DISTANCE(segment2p->distance),waycost2)/segment_pref;
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check whether a segment can be followed backwards to a node when searching for a normal route.
+
+  int CheckReverseSegment Returns true if the segment can be followed.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t node1 The node that the segment is followed back from.
+
+  Node *node1p A pointer to node1 (or NULL if it is a fake node).
+
+  index_t seg1 The segment that is used to leave node1 (or NO_SEGMENT at the finish node).
+
+  index_t seg1r The real segment that is used to leave node1.
+
+  Segment *segment2p The segment to check.
+
+  index_t node2 The node at the other end of the segment.
+
+  index_t start_node The start node (which the route is allowed to leave).
+
+  int pass_level The level below which super-nodes can be passed over.
+
+  index_t *seg2 Returns the index of the segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int CheckReverseSegment(Context *context,Nodes *nodes,Segments *segments,Relations *relations,Profile *profile,
+                               index_t node1,Node *node1p,index_t seg1,index_t seg1r,
+                               Segment *segment2p,index_t node2,index_t start_node,int pass_level,
+                               index_t *seg2)
+{
+ Node *node2p=NULL;
+ WayCost *waycost2;
+ index_t seg2r;
+
+ /* must be a normal segment */
+ if(!IsNormalSegment(segment2p))
+    return(0);
+
+ waycost2=LookupWayCost(profile,segment2p->way);
+
+ /* must obey one-way restrictions (unless profile allows) */
+ if(profile->oneway && IsOnewayFrom(segment2p,node1) && !waycost2->bothways) /* working backwards => disallow oneway *from* node1 */
+    return(0);
+
+ if(IsFakeNode(node1) || IsFakeNode(node2))
+   {
+    *seg2=IndexFakeSegment(&context->fakes,segment2p);
+    seg2r=IndexRealSegment(&context->fakes,*seg2);
+   }
+ else
+   {
+    *seg2=IndexSegment(segments,segment2p);
+    seg2r=*seg2;
+   }
+
+ if(seg1!=NO_SEGMENT)
+   {
+    /* must not perform U-turn (unless profile allows) */
+    if(profile->turns && (seg1==*seg2 || seg1==seg2r || seg1r==*seg2 || (seg1r==seg2r && IsFakeUTurn(&context->fakes,seg1,*seg2))))
+       return(0);
+
+    /* must obey turn relations */
+    if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
+      {
+       index_t turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg2r);
+
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg2r,seg1r,profile->allow))
+          return(0);
+      }
+   }
+
+ if(!IsFakeNode(node2))
+    node2p=LookupNode(nodes,node2,2);
+
+ /* must not pass over super-node (unless it is a lower level than both ends) */
+ if(node2!=start_node && node2p && IsSuperNode(node2p) && SuperNodeLevel(node2p)>=pass_level)
+    return(0);
+
+ /* mode of transport, restrictions and preferences must allow this highway */
+ if(waycost2->pref==0)
+    return(0);
+
+ /* mode of transport must be allowed through node2 unless it is the start node */
+ if(node2p && node2!=start_node && !(node2p->allow&profile->allow))
+    return(0);
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the optimum route between two nodes where the start and end are a set of pre/post-routed super-nodes.
+
+  Results *FindMiddleRoute Returns a set of results.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Landmarks *landmarks The landmark distances to use (or NULL if there are none).
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *begin The initial portion of the route.
+
+  Results *end The final portion of the route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *FindMiddleRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,Profile *profile,Results *begin,Results *end)
+{
+ Results *results;
+ Queue   *fwd_queue,*rev_queue;
+ Result  *start_result,*finish_result;
+ score_t total_score;
+ double  start_lat,start_lon;
+ double  finish_lat,finish_lon;
+ Result  *result1,*result2;
+ score_t *fwd_landmarks=NULL,*rev_landmarks=NULL,landmark_factor=0;
+ int     force_uturn=0;
+#ifdef LIBROUTINO
+ int     loopcount=0;
+#endif
+
+#if DEBUG
+ printf("  FindMiddleRoute(...,[begin has %d nodes],[end has %d nodes])\n",begin->number,end->number);
+#endif
+
+#if !DEBUG && !defined(LIBROUTINO)
+ if(!option_quiet)
+    printf_first("Finding Middle Route: Super-Nodes checked = 0");
+#endif
+
+ /* Set up the finish conditions */
+
+ total_score=INF_SCORE;
+ start_result=NULL;
+ finish_result=NULL;
+
+ if(IsFakeNode(begin->start_node))
+    GetFakeLatLong(&context->fakes,begin->start_node,&start_lat,&start_lon);
+ else
+    GetLatLong(nodes,begin->start_node,&start_lat,&start_lon);
+
+ if(IsFakeNode(end->finish_node))
+    GetFakeLatLong(&context->fakes,end->finish_node,&finish_lat,&finish_lon);
+ else
+    GetLatLong(nodes,end->finish_node,&finish_lat,&finish_lon);
+
+ /* Create the list of results and queues */
+
+ results=GetResultsList(&context->pool,20);
+ fwd_queue=GetQueueList(&context->pool,12);
+ rev_queue=GetQueueList(&context->pool,12);
+
+ /* The landmark distances can only be used if the profile obeys the same one-way
+    restrictions that were used when they were calculated. */
+
+ if(landmarks && landmarks->file.nlandmarks>0 && profile->oneway && profile->allow!=Transports_Bicycle)
+   {
+    Result *end_result;
+    index_t l;
+
+    fwd_landmarks=(score_t*)malloc(4*landmarks->file.nlandmarks*sizeof(score_t));
+    rev_landmarks=fwd_landmarks+2*landmarks->file.nlandmarks;
+
+    for(l=0;l<2*landmarks->file.nlandmarks;l++)
+       fwd_landmarks[l]=rev_landmarks[l]=INF_SCORE;
+
+    /* the lowest possible score for each metre of distance */
+    if(context->quickest==0)
+       landmark_factor=1/profile->max_pref;
+    else
+       landmark_factor=(score_t)distance_speed_to_duration(1000000,profile->max_speed)/1000000/profile->max_pref;
+
+    /* the forward search is heading for the start points of the end part of the path */
+    end_result=FirstResult(end);
+
+    while(end_result)
+      {
+       if(!IsFakeNode(end_result->node) && IsSuperNode(LookupNode(nodes,end_result->node,3)))
+          AddLandmarkTarget(landmarks,end_result->node,end_result->score,landmark_factor,0,fwd_landmarks);
+
+       end_result=NextResult(end,end_result);
+      }
+   }
+
+ /* Insert the finish points of the beginning part of the path into the results,
+    translating the segments into super-segments. */
+
+ if(begin->number==1)
+   {
+    index_t superseg=NO_SEGMENT;
+
+    if(begin->prev_segment!=NO_SEGMENT)
+       superseg=FindSuperSegment(context,nodes,segments,ways,relations,profile,begin->start_node,begin->prev_segment);
+
+    start_result=InsertResult(results,begin->start_node,superseg);
+
+    InsertInQueue(fwd_queue,start_result,0);
+
+    if(rev_landmarks)
+       AddLandmarkTarget(landmarks,begin->start_node,0,landmark_factor,1,rev_landmarks);
+
+    /* Check for barrier at start waypoint - must perform U-turn */
+
+    if(superseg!=NO_SEGMENT)
+      {
+       Node *startp=LookupNode(nodes,begin->start_node,1);
+
+       if(!(startp->allow&profile->allow))
+          force_uturn=1;
+      }
+   }
+ else
+   {
+    Result *begin_result=FirstResult(begin);
+    Result *end_result;
+
+    while((begin_result=NextResult(begin,begin_result)))
+      {
+       if(!IsFakeNode(begin_result->node) && IsSuperNode(LookupNode(nodes,begin_result->node,3)))
+         {
+          index_t superseg=FindSuperSegment(context,nodes,segments,ways,relations,profile,begin_result->node,begin_result->segment);
+
+          if(superseg!=begin_result->segment)
+            {
+             result1=InsertResult(results,begin_result->node,begin_result->segment);
+
+             result1->score=begin_result->score;
+            }
+          else
+             result1=NO_RESULT;
+
+          result2=FindResult(results,begin_result->node,superseg);
+
+          if(!result2) /* New end node/super-segment pair */
+            {
+             result2=InsertResult(results,begin_result->node,superseg);
+             result2->prev=result1;
+             result2->score=begin_result->score;
+            }
+          else if(begin_result->score<result2->score) /* New end node/super-segment pair is better */
+            {
+             result2->prev=result1;
+             result2->score=begin_result->score;
+            }
+          else
+             continue;
+
+          if((end_result=FindResult(end,result2->node,result2->segment)))
+            {
+             if((result2->score+end_result->score)<total_score)
+               {
+                total_score=result2->score+end_result->score;
+                start_result=finish_result=result2;
+               }
+            }
+         }
+      }
+
+    /* Insert the start points of the beginning part of the path into the queue */
+
+    if(!finish_result)
+      {
+       Result *result=FirstResult(results);
+
+       while(result)
+         {
+          if(result->prev)
+            {
+             InsertInQueue(fwd_queue,result,result->score);
+
+             if(rev_landmarks)
+                AddLandmarkTarget(landmarks,result->node,result->score,landmark_factor,1,rev_landmarks);
+            }
+
+          result=NextResult(results,result);
+         }
+      }
+
+    /* Insert the start points of the end part of the path into the queue */
+
+    if(!finish_result)
+      {
+       end_result=FirstResult(end);
+
+       while(end_result)
+         {
+          if(!IsFakeNode(end_result->node) && IsSuperNode(LookupNode(nodes,end_result->node,3)))
+            {
+             result1=InsertResult(results,end_result->node,end_result->segment);
+
+             result1->next=NO_RESULT;
+             result1->score=end_result->score;
+
+             InsertInQueue(rev_queue,result1,0);
+            }
+
+          end_result=NextResult(end,end_result);
+         }
+      }
+   }
+
+
+ /* Loop across all nodes in the two queues, alternating between them */
+
+ while(1)
+   {
+    int queue1_empty=0,queue2_empty=0;
+
+    /* Forward queue */
+
+    if((result1=PopFromQueue(fwd_queue)))
+      {
+       Node *node1p;
+       Segment *segment2p;
+       index_t node1,seg1;
+       index_t turnrelation=NO_RELATION;
+       index_t climbed_from=NO_NODE;
+
+       /* score must be better than current best score */
+       if(result1->score>=total_score)
+          continue;
+
+       node1=result1->node;
+       seg1=result1->segment;
+
+       node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+
+       /* lookup if a turn restriction applies */
+       if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
+          turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1);
+
+       /* find whether node1 was reached by going up a level of super-node */
+       if(seg1!=NO_SEGMENT)
+         {
+          Segment *segment1p=LookupSegment(segments,seg1,2);
+          index_t node0=OtherNode(segment1p,node1);
+
+          if(SuperNodeLevel(LookupNode(nodes,node0,2))<SuperNodeLevel(node1p))
+             climbed_from=node0;
+         }
+
+       /* Loop across all segments */
+
+       segment2p=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+
+       while(segment2p)
+         {
+          Node *node2p;
+          WayCost *waycost2;
+          index_t node2,seg2;
+          score_t segment_pref,segment_score,cumulative_score,potential_score;
+          double lat,lon;
+          distance_t direct;
+
+          /* must be a super segment */
+          if(!IsSuperSegment(segment2p))
+             goto endloop_fwd;
+
+          waycost2=LookupWayCost(profile,segment2p->way);
+
+          /* must obey one-way restrictions (unless profile allows) */
+          if(profile->oneway && IsOnewayTo(segment2p,node1) && !waycost2->bothways)
+             goto endloop_fwd;
+
+          seg2=IndexSegment(segments,segment2p); /* segment cannot be a fake segment (must be a super-segment) */
+
+          /* must perform U-turn in special cases */
+          if(force_uturn && node1==begin->start_node)
+            {
+             if(seg2!=result1->segment)
+                goto endloop_fwd;
+            }
+          else
+             /* must not perform U-turn */
+             if(seg1==seg2) /* No fake segments, applies to all profiles */
+                goto endloop_fwd;
+
+          /* must obey turn relations */
+          if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg1,seg2,profile->allow))
+             goto endloop_fwd;
+
+          segment_pref=waycost2->pref;
+
+          /* mode of transport, restrictions and preferences must allow this highway */
+          if(segment_pref==0)
+             goto endloop_fwd;
+
+          node2=OtherNode(segment2p,node1);
+
+          node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+          /* must not go down to a lower level of super-node (the reverse search comes up from the finish) */
+          if(SuperNodeLevel(node2p)<SuperNodeLevel(node1p))
+             goto endloop_fwd;
+
+          /* must not perform U-turn (a higher level super-segment can start along the lower level one just used) */
+          if(climbed_from!=NO_NODE && SuperSegmentPassesOver(context,nodes,segments,ways,profile,node1,seg2,climbed_from))
+             goto endloop_fwd;
+
+          /* mode of transport must be allowed through node2 unless it is the final node */
+          if(node2!=end->finish_node && !(node2p->allow&profile->allow))
+             goto endloop_fwd;
+
+          /* calculate the score for the segment and cumulative */
+          if(context->quickest==0)
+             segment_score=(score_t)DISTANCE(segment2p->distance)/segment_pref;
+          else
+             segment_score=(score_t)WayCostDuration(DISTANCE(segment2p->distance),waycost2)/segment_pref;
+
+          cumulative_score=result1->score+segment_score;
+
+          /* score must be better than current best score */
+          if(cumulative_score>=total_score)
+             goto endloop_fwd;
+
+          /* find whether the node/segment combination already exists */
+          result2=FindResult(results,node2,seg2);
+
+          if(result2 && result2->next)
+            {
+             if((result2->score+cumulative_score)<total_score)
+               {
+                total_score=result2->score+cumulative_score;
+                finish_result=result2;
+                start_result =result1;
+               }
+
+             goto endloop_fwd;
+            }
+
+          if(!result2) /* New end node/segment pair */
+            {
+             result2=InsertResult(results,node2,seg2);
+             result2->prev=result1;
+             result2->score=cumulative_score;
+            }
+          else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+            {
+             result2->prev=result1;
+             result2->score=cumulative_score;
+            }
+          else
+             goto endloop_fwd;
+
+          /* Insert a new node into the queue */
+
+          GetLatLong(nodes,node2,&lat,&lon); /* node2 cannot be a fake node (must be a super-node) */
+
+          direct=Distance(lat,lon,finish_lat,finish_lon);
+
+          if(context->quickest==0)
+             potential_score=result2->score+(score_t)direct/profile->max_pref;
+          else
+             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+
+          if(fwd_landmarks)
+            {
+             score_t landmark_score=result2->score+LandmarkPotential(landmarks,node2,landmark_factor,0,fwd_landmarks);
+
+             if(landmark_score>potential_score)
+                potential_score=landmark_score;
+            }
+
+          if(potential_score<total_score)
+             InsertInQueue(fwd_queue,result2,potential_score);
+
+         endloop_fwd:
+
+          segment2p=NextSegment(segments,segment2p,node1); /* node1 cannot be a fake node (must be a super-node) */
+         }
+
+#ifdef LIBROUTINO
+       if(!(++loopcount%100000))
+          if(context->progress_func && !context->progress_func(context->progress_value))
+            {
+             context->progress_abort=1;
+             break;
+            }
+#endif
+      }
+    else
+       queue1_empty=1;
+
+    /* Reverse queue */
+
+    if((result1=PopFromQueue(rev_queue)))
+      {
+       Node *node1p;
+       Segment *segment1p,*segment2p;
+       WayCost *waycost1;
+       index_t real_node1,node1,seg1;
+       score_t segment1_pref,segment1_score=0;
+       int real_node1_level,climbed;
+
+       /* score must be better than current best score */
+       if(result1->score>=total_score)
+          continue;
+
+       real_node1=result1->node;
+       seg1=result1->segment;
+
+       segment1p=LookupSegment(segments,seg1,1);
+
+       node1=OtherNode(segment1p,real_node1);
+
+       node1p=LookupNode(nodes,node1,1);
+
+       /* must not go down to a lower level of super-node (the forward search comes up from the start) */
+       real_node1_level=SuperNodeLevel(LookupNode(nodes,real_node1,2));
+
+       if(SuperNodeLevel(node1p)<real_node1_level)
+          continue;
+
+       climbed=SuperNodeLevel(node1p)>real_node1_level;
+
+       /* mode of transport must be allowed through node1 */
+       if(!(node1p->allow&profile->allow))
+          continue;
+
+       waycost1=LookupWayCost(profile,segment1p->way);
+
+       segment1_pref=waycost1->pref;
+
+       /* calculate the score for the segment */
+       if(context->quickest==0)
+          segment1_score=(score_t)DISTANCE(segment1p->distance)/segment1_pref;
+       else
+          segment1_score=(score_t)WayCostDuration(DISTANCE(segment1p->distance),waycost1)/segment1_pref;
+
+       /* Loop across all segments */
+
+       segment2p=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+
+       while(segment2p)
+         {
+          WayCost *waycost2;
+          index_t node2,seg2;
+          score_t segment_pref,cumulative_score,potential_score;
+          double lat,lon;
+          distance_t direct;
+
+          seg2=IndexSegment(segments,segment2p); /* segment cannot be a fake segment (must be a super-segment) */
+
+          /* must not perform U-turn */
+          if(seg1==seg2) /* No fake segments, applies to all profiles */
+             goto endloop_rev;
+
+          /* find whether the node/segment combination already exists */
+          result2=FindResult(results,node1,seg2);
+
+          /* must be a super segment */
+          if(!IsSuperSegment(segment2p) && !(result2 && result2->prev))
+             goto endloop_rev;
+
+          /* must not perform U-turn (a higher level super-segment can finish along the lower level one just used) */
+          if(climbed && SuperSegmentPassesOver(context,nodes,segments,ways,profile,node1,seg2,real_node1))
+             goto endloop_rev;
+
+          /* must obey turn relations */
+          if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
+            {
+             index_t turnrelation2=FindFirstTurnRelation2(relations,&context->fakes,node1,seg2);
+
+             if(turnrelation2!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation2,node1,seg2,seg1,profile->allow))
+                goto endloop_rev;
+            }
+
+          waycost2=LookupWayCost(profile,segment2p->way);
+
+          /* must obey one-way restrictions (unless profile allows) */
+          if(profile->oneway && IsOnewayFrom(segment2p,node1) && !waycost2->bothways) /* working backwards => disallow oneway *from* node1 */
+             goto endloop_rev;
+
+          segment_pref=waycost2->pref;
+
+          /* mode of transport, restrictions and preferences must allow this highway */
+          if(segment_pref==0)
+             goto endloop_rev;
+
+          node2=OtherNode(segment2p,node1);
+
+          cumulative_score=result1->score+segment1_score;
+
+          /* score must be better than current best score */
+          if(cumulative_score>=total_score)
+             goto endloop_rev;
+
+          if(result2 && result2->prev)
+            {
+             if((result2->score+cumulative_score)<total_score)
+               {
+                total_score=result2->score+cumulative_score;
+                finish_result=result1;
+                start_result =result2;
+               }
+
+             goto endloop_rev;
+            }
+
+          if(!result2) /* New end node/segment pair */
+            {
+             result2=InsertResult(results,node1,seg2); /* adding in reverse => node1,seg2 */
+             result2->next=result1;   /* working backwards */
+             result2->score=cumulative_score;
+            }
+          else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+            {
+             result2->next=result1; /* working backwards */
+             result2->score=cumulative_score;
+            }
+          else
+             goto endloop_rev;
+
+          /* Insert a new node into the queue */
+
+          GetLatLong(nodes,node2,&lat,&lon); /* node2 cannot be a fake node (must be a super-node) */
+
+          direct=Distance(lat,lon,start_lat,start_lon);
+
+          if(context->quickest==0)
+             potential_score=result2->score+(score_t)direct/profile->max_pref;
+          else
+             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+
+          if(rev_landmarks)
+            {
+             score_t landmark_score=result2->score+LandmarkPotential(landmarks,node2,landmark_factor,1,rev_landmarks);
+
+             if(landmark_score>potential_score)
+                potential_score=landmark_score;
+            }
+
+          if(potential_score<total_score)
+             InsertInQueue(rev_queue,result2,potential_score);
+
+         endloop_rev:
+
+          segment2p=NextSegment(segments,segment2p,node1); /* node1 cannot be a fake node (must be a super-node) */
+         }
+
 #ifdef LIBROUTINO
- int     loopcount=0;
+       if(!(++loopcount%100000))
+          if(context->progress_func && !context->progress_func(context->progress_value))
+            {
+             context->progress_abort=1;
+             break;
+            }
 #endif
+      }
+    else
+       queue2_empty=1;
+
+    if(queue1_empty && queue2_empty)
+       break;
+   }
+
+ PutQueueList(&context->pool,fwd_queue);
+ PutQueueList(&context->pool,rev_queue);
+
+ if(fwd_landmarks)
+    free(fwd_landmarks);
+
+ /* Check it worked */
 
+ if(!finish_result)
+   {
 #if DEBUG
- printf("  FindMiddleRoute(...,[begin has %d nodes],[end has %d nodes])\n",begin->number,end->number);
+    printf("    Failed\n");
 #endif
 
 #if !DEBUG && !defined(LIBROUTINO)
- if(!option_quiet)
-    printf_first("Finding Middle Route: Super-Nodes checked = 0");
+    if(!option_quiet)
+       printf_last("Found Middle Route: Super-Nodes checked = %d - Fail",results->number);
 #endif
 
- /* Set up the finish conditions */
+    PutResultsList(&context->pool,results);
+    return(NULL);
+   }
 
- total_score=INF_SCORE;
- start_result=NULL;
- finish_result=NULL;
+ /* Turn the route round and fill in the start and finish information */
 
- if(IsFakeNode(begin->start_node))
-    GetFakeLatLong(begin->start_node,&start_lat,&start_lon);
- else
-    GetLatLong(nodes,begin->start_node,NULL,&start_lat,&start_lon);
+ if(start_result!=finish_result)
+   {
+    start_result->next=finish_result;
+    finish_result->prev=start_result;
 
- if(IsFakeNode(end->finish_node))
-    GetFakeLatLong(end->finish_node,&finish_lat,&finish_lon);
- else
-    GetLatLong(nodes,end->finish_node,NULL,&finish_lat,&finish_lon);
+    while(start_result->prev && start_result->prev!=NO_RESULT)
+       start_result=start_result->prev;
 
- /* Create the list of results and queues */
+    FixForwardRoute(results,finish_result);
 
- results=NewResultsList(20);
- fwd_queue=NewQueueList(12);
- rev_queue=NewQueueList(12);
+    if(!start_result->prev && start_result->next)
+       start_result=start_result->next;
 
- /* Insert the finish points of the beginning part of the path into the results,
-    translating the segments into super-segments. */
+    while(finish_result->next && finish_result->next!=NO_RESULT)
+       finish_result=finish_result->next;
+   }
 
- if(begin->number==1)
-   {
-    index_t superseg=NO_SEGMENT;
+ results->start_node=start_result->node;
+ results->prev_segment=start_result->segment;
 
-    if(begin->prev_segment!=NO_SEGMENT)
-       superseg=FindSuperSegment(nodes,segments,ways,relations,profile,begin->start_node,begin->prev_segment);
+ results->finish_node=finish_result->node;
+ results->last_segment=finish_result->segment;
 
-    start_result=InsertResult(results,begin->start_node,superseg);
+#if DEBUG
+ printf("    -------- middle route (via super-nodes/segments) score=%.3f\n",total_score);
 
-    InsertInQueue(fwd_queue,start_result,0);
+ print_debug_route(nodes,segments,results,NULL,4,+1);
+#endif
 
-    /* Check for barrier at start waypoint - must perform U-turn */
+#if !DEBUG && !defined(LIBROUTINO)
+ if(!option_quiet)
+    printf_last("Found Middle Route: Super-Nodes checked = %d",results->number);
+#endif
 
-    if(superseg!=NO_SEGMENT)
-      {
-       Node *startp=LookupNode(nodes,begin->start_node,1);
+ return(results);
+}
 
-       if(!(startp->allow&profile->allow))
-          force_uturn=1;
-      }
-   }
- else
-   {
-    Result *begin_result=FirstResult(begin);
-    Result *end_result;
 
-    while((begin_result=NextResult(begin,begin_result)))
-      {
-       if(!IsFakeNode(begin_result->node) && IsSuperNode(LookupNode(nodes,begin_result->node,3)))
-         {
-          index_t superseg=FindSuperSegment(nodes,segments,ways,relations,profile,begin_result->node,begin_result->segment);
+/*++++++++++++++++++++++++++++++++++++++
+  Find the optimum route between two nodes where the start and end are a set of pre/post-routed
+  super-nodes by searching upwards through the contraction hierarchy from both ends.
 
-          if(superseg!=begin_result->segment)
-            {
-             result1=InsertResult(results,begin_result->node,begin_result->segment);
+  Results *FindMiddleRouteHierarchy Returns a set of results or NULL if the hierarchy did not give a route.
 
-             result1->score=begin_result->score;
-            }
-          else
-             result1=NO_RESULT;
+  Context *context The routing context to use.
 
-          result2=FindResult(results,begin_result->node,superseg);
+  Nodes *nodes The set of nodes to use.
 
-          if(!result2) /* New end node/super-segment pair */
-            {
-             result2=InsertResult(results,begin_result->node,superseg);
-             result2->prev=result1;
-             result2->score=begin_result->score;
-            }
-          else if(begin_result->score<result2->score) /* New end node/super-segment pair is better */
-            {
-             result2->prev=result1;
-             result2->score=begin_result->score;
-            }
-          else
-             continue;
+  Segments *segments The set of segments to use.
 
-          if((end_result=FindResult(end,result2->node,result2->segment)))
-            {
-             if((result2->score+end_result->score)<total_score)
-               {
-                total_score=result2->score+end_result->score;
-                start_result=finish_result=result2;
-               }
-            }
-         }
-      }
+  Ways *ways The set of ways to use.
 
-    /* Insert the start points of the beginning part of the path into the queue */
+  Relations *relations The set of relations to use.
 
-    if(!finish_result)
-      {
-       Result *result=FirstResult(results);
+  Hierarchy *hierarchy The contraction hierarchy to use.
 
-       while(result)
-         {
-          if(result->prev)
-             InsertInQueue(fwd_queue,result,result->score);
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
 
-          result=NextResult(results,result);
-         }
-      }
+  Results *begin The initial portion of the route.
 
-    /* Insert the start points of the end part of the path into the queue */
+  Results *end The final portion of the route.
+  ++++++++++++++++++++++++++++++++++++++*/
 
-    if(!finish_result)
-      {
-       end_result=FirstResult(end);
+static Results *FindMiddleRouteHierarchy(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Hierarchy *hierarchy,Profile *profile,Results *begin,Results *end)
+{
+ Results *results=NULL,*fwd_results,*rev_results;
+ Queue   *fwd_queue,*rev_queue;
+ Result  *fwd_meet=NULL,*rev_meet=NULL;
+ Result  *result1,*result2,*result3,*begin_result,*end_result;
+ score_t total_score=INF_SCORE;
+ index_t *path_ranks,*path_segments;
+ score_t *path_scores;
+ index_t start_node,finish_node,superseg,node,prev_segment;
+ int     nranks,npath=0,i;
+#ifdef LIBROUTINO
+ int     loopcount=0;
+#endif
 
-       while(end_result)
-         {
-          if(!IsFakeNode(end_result->node) && IsSuperNode(LookupNode(nodes,end_result->node,3)))
-            {
-             result1=InsertResult(results,end_result->node,end_result->segment);
+#if DEBUG
+ printf("  FindMiddleRouteHierarchy(...,[begin has %d nodes],[end has %d nodes])\n",begin->number,end->number);
+#endif
 
-             result1->next=NO_RESULT;
-             result1->score=end_result->score;
+ /* The special cases at the start waypoint are left to the normal search */
 
-             InsertInQueue(rev_queue,result1,0);
-            }
+ if(begin->number==1)
+    return(NULL);
 
-          end_result=NextResult(end,end_result);
-         }
-      }
-   }
+#if !DEBUG && !defined(LIBROUTINO)
+ if(!option_quiet)
+    printf_first("Finding Middle Route (hierarchy): Super-Nodes checked = 0");
+#endif
 
+ /* Calculate the scores for this profile (if not already done) */
 
- /* Loop across all nodes in the two queues, alternating between them */
+ CustomiseHierarchy(hierarchy,nodes,segments,ways,profile,context->quickest);
 
- while(1)
-   {
-    int queue1_empty=0,queue2_empty=0;
+ /* Create the list of results and queues */
 
-    /* Forward queue */
+ fwd_results=GetResultsList(&context->pool,12);
+ rev_results=GetResultsList(&context->pool,12);
+ fwd_queue=GetQueueList(&context->pool,12);
+ rev_queue=GetQueueList(&context->pool,12);
 
-    if((result1=PopFromQueue(fwd_queue)))
+ /* Insert the super-nodes at the end of the beginning part of the route; the 'next' pointer of
+    each one refers to the best result in the beginning part. */
+
+ begin_result=FirstResult(begin);
+
+ while((begin_result=NextResult(begin,begin_result)))
+    if(!IsFakeNode(begin_result->node) && IsSuperNode(LookupNode(nodes,begin_result->node,3)))
       {
-       Node *node1p;
-       Segment *segment2p;
-       index_t node1,seg1;
-       index_t turnrelation=NO_RELATION;
+       index_t rank=HierarchyRank(hierarchy,begin_result->node);
 
-       /* score must be better than current best score */
-       if(result1->score>=total_score)
+       /* The route may not need to leave the beginning and end parts, let the normal search find it */
+
+       superseg=FindSuperSegment(context,nodes,segments,ways,relations,profile,begin_result->node,begin_result->segment);
+
+       if(FindResult(end,begin_result->node,superseg))
+          goto finished;
+
+       if(rank==NO_NODE)
           continue;
 
-       node1=result1->node;
-       seg1=result1->segment;
+       result1=FindResult(fwd_results,rank,NO_SEGMENT);
 
-       node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+       if(!result1)
+         {
+          result1=InsertResult(fwd_results,rank,NO_SEGMENT);
+          result1->next=begin_result;
+          result1->score=begin_result->score;
+         }
+       else if(begin_result->score<result1->score)
+         {
+          result1->next=begin_result;
+          result1->score=begin_result->score;
+         }
+       else
+          continue;
 
-       /* lookup if a turn restriction applies */
-       if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
-          turnrelation=FindFirstTurnRelation2(relations,node1,seg1);
+       InsertInQueue(fwd_queue,result1,result1->score);
+      }
 
-       /* Loop across all segments */
+ /* Insert the super-nodes one super-segment before the start of the end part of the route; the
+    'next' pointer of each one refers to the best result in the end part. */
 
-       segment2p=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+ end_result=FirstResult(end);
 
-       while(segment2p)
-         {
-          Node *node2p;
-          Way *way2p;
-          index_t node2,seg2;
-          score_t segment_pref,segment_score,cumulative_score,potential_score;
-          double lat,lon;
-          distance_t direct;
-          int i;
+ while(end_result)
+   {
+    if(!IsFakeNode(end_result->node) && !IsFakeSegment(end_result->segment) && IsSuperNode(LookupNode(nodes,end_result->node,3)))
+      {
+       Segment *segmentp=LookupSegment(segments,end_result->segment,1);
+       Node *nodep;
+       WayCost *waycost;
+       index_t node1,rank;
+       score_t segment_pref,segment_score,cumulative_score;
 
-          /* must be a super segment */
-          if(!IsSuperSegment(segment2p))
-             goto endloop_fwd;
+       if(!IsSuperSegment(segmentp))
+          goto endloop_end;
 
-          /* must obey one-way restrictions (unless profile allows) */
-          if(profile->oneway && IsOnewayTo(segment2p,node1))
-            {
-             if(profile->allow!=Transports_Bicycle)
-                goto endloop_fwd;
+       node1=OtherNode(segmentp,end_result->node);
 
-             way2p=LookupWay(ways,segment2p->way,1);
+       rank=HierarchyRank(hierarchy,node1);
 
-             if(!(way2p->type&Highway_CycleBothWays))
-                goto endloop_fwd;
-            }
+       if(rank==NO_NODE)
+          goto endloop_end;
 
-          seg2=IndexSegment(segments,segment2p); /* segment cannot be a fake segment (must be a super-segment) */
+       nodep=LookupNode(nodes,node1,1);
 
-          /* must perform U-turn in special cases */
-          if(force_uturn && node1==begin->start_node)
-            {
-             if(seg2!=result1->segment)
-                goto endloop_fwd;
-            }
-          else
-             /* must not perform U-turn */
-             if(seg1==seg2) /* No fake segments, applies to all profiles */
-                goto endloop_fwd;
+       /* mode of transport must be allowed through node1 */
+       if(!(nodep->allow&profile->allow))
+          goto endloop_end;
 
-          /* must obey turn relations */
-          if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1,seg2,profile->allow))
-             goto endloop_fwd;
+       waycost=LookupWayCost(profile,segmentp->way);
 
-          way2p=LookupWay(ways,segment2p->way,1);
+       segment_pref=waycost->pref;
 
-          /* mode of transport must be allowed on the highway */
-          if(!(way2p->allow&profile->allow))
-             goto endloop_fwd;
+       /* calculate the score for the segment and cumulative */
+       if(context->quickest==0)
+          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       else
+          segment_score=(score_t)WayCostDuration(DISTANCE(segmentp->distance),waycost)/segment_pref;
 
-          /* must obey weight restriction (if exists) */
-          if(way2p->weight && way2p->weight<profile->weight)
-             goto endloop_fwd;
+       cumulative_score=end_result->score+segment_score;
 
-          /* must obey height/width/length restriction (if exist) */
-          if((way2p->height && way2p->height<profile->height) ||
-             (way2p->width  && way2p->width <profile->width ) ||
-             (way2p->length && way2p->length<profile->length))
-             goto endloop_fwd;
+       result1=FindResult(rev_results,rank,NO_SEGMENT);
+
+       if(!result1)
+         {
+          result1=InsertResult(rev_results,rank,NO_SEGMENT);
+          result1->next=end_result;
+          result1->score=cumulative_score;
+         }
+       else if(cumulative_score<result1->score)
+         {
+          result1->next=end_result;
+          result1->score=cumulative_score;
+         }
+       else
+          goto endloop_end;
 
-          segment_pref=profile->highway[HIGHWAY(way2p->type)];
+       InsertInQueue(rev_queue,result1,result1->score);
+
+       if((result2=FindResult(fwd_results,rank,NO_SEGMENT)) && (result2->score+result1->score)<total_score)
+         {
+          total_score=result2->score+result1->score;
+          fwd_meet=result2;
+          rev_meet=result1;
+         }
+      }
 
-          /* highway preferences must allow this highway */
-          if(segment_pref==0)
-             goto endloop_fwd;
+   endloop_end:
 
-          for(i=1;i<Property_Count;i++)
-             if(ways->file.props & PROPERTIES(i))
-               {
-                if(way2p->props & PROPERTIES(i))
-                   segment_pref*=profile->props_yes[i];
-                else
-                   segment_pref*=profile->props_no[i];
-               }
+    end_result=NextResult(end,end_result);
+   }
 
-          /* profile preferences must allow this highway */
-          if(segment_pref==0)
-             goto endloop_fwd;
+ /* Loop across all nodes in the two queues, alternating between them and only moving up the hierarchy
+    (the arcs of the uncontracted nodes at the top of the hierarchy also lead to lower ranked nodes) */
 
-          node2=OtherNode(segment2p,node1);
+ while(1)
+   {
+    int queue1_empty=0,queue2_empty=0;
 
-          node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+    /* Forward queue */
 
-          /* mode of transport must be allowed through node2 unless it is the final node */
-          if(node2!=end->finish_node && !(node2p->allow&profile->allow))
-             goto endloop_fwd;
+    if((result1=PopFromQueue(fwd_queue)))
+      {
+       index_t arc;
 
-          /* calculate the score for the segment and cumulative */
-          if(option_quickest==0)
-             segment_score=(score_t)DISTANCE(segment2p->distance)/segment_pref;
-          else
-             segment_score=(score_t)Duration(segment2p,way2p,profile)/segment_pref;
+       /* stop searching forwards when no route through the forward queue can be better than current best score */
+       if(result1->sortby>=total_score)
+         {
+          while(PopFromQueue(fwd_queue));
+          continue;
+         }
 
-          cumulative_score=result1->score+segment_score;
+       for(arc=hierarchy->firstarc[result1->node];arc<hierarchy->firstarc[result1->node+1];arc++)
+         {
+          score_t cumulative_score=result1->score+hierarchy->up[arc];
 
           /* score must be better than current best score */
           if(cumulative_score>=total_score)
-             goto endloop_fwd;
-
-          /* find whether the node/segment combination already exists */
-          result2=FindResult(results,node2,seg2);
-
-          if(result2 && result2->next)
-            {
-             if((result2->score+cumulative_score)<total_score)
-               {
-                total_score=result2->score+cumulative_score;
-                finish_result=result2;
-                start_result =result1;
-               }
+             continue;
 
-             goto endloop_fwd;
-            }
+          result2=FindResult(fwd_results,hierarchy->arcs[arc],NO_SEGMENT);
 
-          if(!result2) /* New end node/segment pair */
+          if(!result2) /* New node */
             {
-             result2=InsertResult(results,node2,seg2);
+             result2=InsertResult(fwd_results,hierarchy->arcs[arc],NO_SEGMENT);
              result2->prev=result1;
              result2->score=cumulative_score;
             }
-          else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+          else if(cumulative_score<result2->score) /* New node is better */
             {
              result2->prev=result1;
+             result2->next=NULL;
              result2->score=cumulative_score;
             }
           else
-             goto endloop_fwd;
-
-          /* Insert a new node into the queue */
-
-          GetLatLong(nodes,node2,node2p,&lat,&lon); /* node2 cannot be a fake node (must be a super-node) */
-
-          direct=Distance(lat,lon,finish_lat,finish_lon);
-
-          if(option_quickest==0)
-             potential_score=result2->score+(score_t)direct/profile->max_pref;
-          else
-             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
-
-          if(potential_score<total_score)
-             InsertInQueue(fwd_queue,result2,potential_score);
+             continue;
 
-         endloop_fwd:
+          InsertInQueue(fwd_queue,result2,result2->score);
 
-          segment2p=NextSegment(segments,segment2p,node1); /* node1 cannot be a fake node (must be a super-node) */
+          if((result3=FindResult(rev_results,result2->node,NO_SEGMENT)) && (result2->score+result3->score)<total_score)
+            {
+             total_score=result2->score+result3->score;
+             fwd_meet=result2;
+             rev_meet=result3;
+            }
          }
 
 #ifdef LIBROUTINO
        if(!(++loopcount%100000))
-          if(progress_func && !progress_func(progress_value))
+          if(context->progress_func && !context->progress_func(context->progress_value))
             {
-             progress_abort=1;
+             context->progress_abort=1;
              break;
             }
 #endif
@@ -915,259 +2588,273 @@ static Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
     if((result1=PopFromQueue(rev_queue)))
       {
-       Node *node1p;
-       Segment *segment1p,*segment2p;
-       Way *way1p;
-       index_t real_node1,node1,seg1;
-       score_t segment1_pref,segment1_score=0;
-       int i;
+       index_t arc;
 
-       /* score must be better than current best score */
-       if(result1->score>=total_score)
+       /* stop searching backwards when no route through the reverse queue can be better than current best score */
+       if(result1->sortby>=total_score)
+         {
+          while(PopFromQueue(rev_queue));
           continue;
+         }
 
-       real_node1=result1->node;
-       seg1=result1->segment;
-
-       segment1p=LookupSegment(segments,seg1,1);
+       for(arc=hierarchy->firstarc[result1->node];arc<hierarchy->firstarc[result1->node+1];arc++)
+         {
+          score_t cumulative_score=result1->score+hierarchy->down[arc];
 
-       node1=OtherNode(segment1p,real_node1);
+          /* score must be better than current best score */
+          if(cumulative_score>=total_score)
+             continue;
 
-       node1p=LookupNode(nodes,node1,1);
+          result2=FindResult(rev_results,hierarchy->arcs[arc],NO_SEGMENT);
 
-       /* mode of transport must be allowed through node1 */
-       if(!(node1p->allow&profile->allow))
-          continue;
+          if(!result2) /* New node */
+            {
+             result2=InsertResult(rev_results,hierarchy->arcs[arc],NO_SEGMENT);
+             result2->prev=result1;  /* working backwards, 'prev' leads towards the end */
+             result2->score=cumulative_score;
+            }
+          else if(cumulative_score<result2->score) /* New node is better */
+            {
+             result2->prev=result1;
+             result2->next=NULL;
+             result2->score=cumulative_score;
+            }
+          else
+             continue;
 
-       way1p=LookupWay(ways,segment1p->way,1);
+          InsertInQueue(rev_queue,result2,result2->score);
 
-       segment1_pref=profile->highway[HIGHWAY(way1p->type)];
+          if((result3=FindResult(fwd_results,result2->node,NO_SEGMENT)) && (result2->score+result3->score)<total_score)
+            {
+             total_score=result2->score+result3->score;
+             fwd_meet=result3;
+             rev_meet=result2;
+            }
+         }
 
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
+#ifdef LIBROUTINO
+       if(!(++loopcount%100000))
+          if(context->progress_func && !context->progress_func(context->progress_value))
             {
-             if(way1p->props & PROPERTIES(i))
-                segment1_pref*=profile->props_yes[i];
-             else
-                segment1_pref*=profile->props_no[i];
+             context->progress_abort=1;
+             break;
             }
+#endif
+      }
+    else
+       queue2_empty=1;
 
-       /* calculate the score for the segment */
-       if(option_quickest==0)
-          segment1_score=(score_t)DISTANCE(segment1p->distance)/segment1_pref;
-       else
-          segment1_score=(score_t)Duration(segment1p,way1p,profile)/segment1_pref;
+    if(queue1_empty && queue2_empty)
+       break;
+   }
 
-       /* Loop across all segments */
+ /* Check it worked */
 
-       segment2p=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+ if(!fwd_meet)
+    goto finished;
 
-       while(segment2p)
-         {
-          Node *node2p;
-          Way *way2p;
-          index_t node2,seg2;
-          score_t segment_pref,cumulative_score,potential_score;
-          double lat,lon;
-          distance_t direct;
+ /* Find the super-nodes on the route through the hierarchy, the ranks go up and then down again */
 
-          seg2=IndexSegment(segments,segment2p); /* segment cannot be a fake segment (must be a super-segment) */
+ path_ranks=(index_t*)malloc((hierarchy->file.number+1)*sizeof(index_t));
 
-          /* must not perform U-turn */
-          if(seg1==seg2) /* No fake segments, applies to all profiles */
-             goto endloop_rev;
+ for(nranks=0,result1=fwd_meet;result1;result1=result1->prev)
+    nranks++;
 
-          /* find whether the node/segment combination already exists */
-          result2=FindResult(results,node1,seg2);
+ for(i=nranks-1,result1=fwd_meet;result1;result1=result1->prev,i--)
+   {
+    path_ranks[i]=result1->node;
+    begin_result=result1->next;
+   }
 
-          /* must be a super segment */
-          if(!IsSuperSegment(segment2p) && !(result2 && result2->prev))
-             goto endloop_rev;
+ for(result1=rev_meet;result1->prev;result1=result1->prev)
+    path_ranks[nranks++]=result1->prev->node;
 
-          /* must obey turn relations */
-          if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
-            {
-             index_t turnrelation2=FindFirstTurnRelation2(relations,node1,seg2);
+ end_result=result1->next;
 
-             if(turnrelation2!=NO_RELATION && !IsTurnAllowed(relations,turnrelation2,node1,seg2,seg1,profile->allow))
-                goto endloop_rev;
-            }
+ /* Unpack the shortcuts into super-segments; the route is a simple path through the super-nodes
+    so the number of super-segments is limited by the number of super-nodes. */
 
-          /* must obey one-way restrictions (unless profile allows) */
-          if(profile->oneway && IsOnewayFrom(segment2p,node1)) /* working backwards => disallow oneway *from* node1 */
-            {
-             if(profile->allow!=Transports_Bicycle)
-                goto endloop_rev;
+ path_segments=(index_t*)malloc((hierarchy->file.number+1)*sizeof(index_t));
+ path_scores  =(score_t*)malloc((hierarchy->file.number+1)*sizeof(score_t));
 
-             way2p=LookupWay(ways,segment2p->way,1);
+ for(i=1;i<nranks;i++)
+    if(path_ranks[i]>path_ranks[i-1])
+       npath+=UnpackHierarchyArc(hierarchy,path_ranks[i-1],FindHierarchyArc(hierarchy,path_ranks[i-1],path_ranks[i]),1,
+                                 path_segments+npath,path_scores+npath);
+    else
+       npath+=UnpackHierarchyArc(hierarchy,path_ranks[i],FindHierarchyArc(hierarchy,path_ranks[i],path_ranks[i-1]),0,
+                                 path_segments+npath,path_scores+npath);
 
-             if(!(way2p->type&Highway_CycleBothWays))
-                goto endloop_rev;
-            }
+ path_segments[npath]=end_result->segment;
+ path_scores[npath]=result1->score-end_result->score;
+ npath++;
 
-          way2p=LookupWay(ways,segment2p->way,1);
+ /* Create the route through the super-segments checking the turns that the hierarchy ignores */
 
-          /* mode of transport must be allowed on the highway */
-          if(!(way2p->allow&profile->allow))
-             goto endloop_rev;
+ start_node=begin_result->node;
 
-          /* must obey weight restriction (if exists) */
-          if(way2p->weight && way2p->weight<profile->weight)
-             goto endloop_rev;
+ superseg=FindSuperSegment(context,nodes,segments,ways,relations,profile,start_node,begin_result->segment);
 
-          /* must obey height/width/length restriction (if exist) */
-          if((way2p->height && way2p->height<profile->height) ||
-             (way2p->width  && way2p->width <profile->width ) ||
-             (way2p->length && way2p->length<profile->length))
-             goto endloop_rev;
+ results=GetResultsList(&context->pool,20);
 
-          segment_pref=profile->highway[HIGHWAY(way2p->type)];
+ if(superseg!=begin_result->segment)
+   {
+    result1=InsertResult(results,start_node,begin_result->segment);
 
-          /* highway preferences must allow this highway */
-          if(segment_pref==0)
-             goto endloop_rev;
+    result1->score=begin_result->score;
+   }
+ else
+    result1=NO_RESULT;
 
-          for(i=1;i<Property_Count;i++)
-             if(ways->file.props & PROPERTIES(i))
-               {
-                if(way2p->props & PROPERTIES(i))
-                   segment_pref*=profile->props_yes[i];
-                else
-                   segment_pref*=profile->props_no[i];
-               }
+ result2=InsertResult(results,start_node,superseg);
+ result2->prev=result1;
+ result2->score=begin_result->score;
 
-          /* profile preferences must allow this highway */
-          if(segment_pref==0)
-             goto endloop_rev;
+ node=start_node;
+ prev_segment=superseg;
 
-          node2=OtherNode(segment2p,node1);
+ for(i=0;i<npath;i++)
+   {
+    Node *nodep=LookupNode(nodes,node,1); /* node cannot be a fake node (must be a super-node) */
 
-          cumulative_score=result1->score+segment1_score;
+    /* must not perform U-turn */
+    if(path_segments[i]==prev_segment)
+       break;
 
-          /* score must be better than current best score */
-          if(cumulative_score>=total_score)
-             goto endloop_rev;
+    /* must not perform U-turn (a higher level super-segment can start along the lower level one just used) */
+    if(!IsFakeSegment(prev_segment) &&
+       SuperSegmentPassesOver(context,nodes,segments,ways,profile,node,path_segments[i],OtherNode(LookupSegment(segments,prev_segment,1),node)))
+       break;
 
-          if(result2 && result2->prev)
-            {
-             if((result2->score+cumulative_score)<total_score)
-               {
-                total_score=result2->score+cumulative_score;
-                finish_result=result1;
-                start_result =result2;
-               }
+    /* must obey turn relations */
+    if(profile->turns && IsTurnRestrictedNode(nodep))
+      {
+       index_t turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node,prev_segment);
 
-             goto endloop_rev;
-            }
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node,prev_segment,path_segments[i],profile->allow))
+          break;
+      }
 
-          if(!result2) /* New end node/segment pair */
-            {
-             result2=InsertResult(results,node1,seg2); /* adding in reverse => node1,seg2 */
-             result2->next=result1;   /* working backwards */
-             result2->score=cumulative_score;
-            }
-          else if(cumulative_score<result2->score) /* New end node/segment pair is better */
-            {
-             result2->next=result1; /* working backwards */
-             result2->score=cumulative_score;
-            }
-          else
-             goto endloop_rev;
+    node=OtherNode(LookupSegment(segments,path_segments[i],1),node);
+    prev_segment=path_segments[i];
 
-          /* Insert a new node into the queue */
+    result1=result2;
 
-          node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+    result2=InsertResult(results,node,prev_segment);
+    result2->prev=result1;
+    result2->score=result1->score+path_scores[i];
+   }
 
-          GetLatLong(nodes,node2,node2p,&lat,&lon);
+ finish_node=node;
 
-          direct=Distance(lat,lon,start_lat,start_lon);
+ if(i<npath)
+   {
+#if DEBUG
+    printf("    Failed turn check\n");
+#endif
 
-          if(option_quickest==0)
-             potential_score=result2->score+(score_t)direct/profile->max_pref;
-          else
-             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+    PutResultsList(&context->pool,results);
+    results=NULL;
+   }
+ else
+   {
+    FixForwardRoute(results,result2);
 
-          if(potential_score<total_score)
-             InsertInQueue(rev_queue,result2,potential_score);
+    results->start_node=start_node;
+    results->prev_segment=superseg;
 
-         endloop_rev:
+    results->finish_node=finish_node;
+    results->last_segment=prev_segment;
+   }
 
-          segment2p=NextSegment(segments,segment2p,node1); /* node1 cannot be a fake node (must be a super-node) */
-         }
+ free(path_ranks);
+ free(path_segments);
+ free(path_scores);
 
-#ifdef LIBROUTINO
-       if(!(++loopcount%100000))
-          if(progress_func && !progress_func(progress_value))
-            {
-             progress_abort=1;
-             break;
-            }
-#endif
-      }
-    else
-       queue2_empty=1;
+ finished:
 
-    if(queue1_empty && queue2_empty)
-       break;
-   }
+#if !DEBUG && !defined(LIBROUTINO)
+ if(!option_quiet)
+    printf_last("Found Middle Route (hierarchy): Super-Nodes checked = %d%s",fwd_results->number+rev_results->number,results?"":" - Fail");
+#endif
 
- FreeQueueList(fwd_queue);
- FreeQueueList(rev_queue);
+ PutQueueList(&context->pool,fwd_queue);
+ PutQueueList(&context->pool,rev_queue);
 
- /* Check it worked */
+ PutResultsList(&context->pool,fwd_results);
+ PutResultsList(&context->pool,rev_results);
 
- if(!finish_result)
-   {
 #if DEBUG
-    printf("    Failed\n");
-#endif
+ if(results)
+   {
+    printf("    -------- middle route (via hierarchy) score=%.3f\n",total_score);
 
-#if !DEBUG && !defined(LIBROUTINO)
-    if(!option_quiet)
-       printf_last("Found Middle Route: Super-Nodes checked = %d - Fail",results->number);
+    print_debug_route(nodes,segments,results,NULL,4,+1);
+   }
 #endif
 
-    FreeResultsList(results);
-    return(NULL);
-   }
+ return(results);
+}
 
- /* Turn the route round and fill in the start and finish information */
 
- if(start_result!=finish_result)
-   {
-    start_result->next=finish_result;
-    finish_result->prev=start_result;
+/*++++++++++++++++++++++++++++++++++++++
+  Convert an arc in the contraction hierarchy into the super-segments that it represents.
 
-    while(start_result->prev && start_result->prev!=NO_RESULT)
-       start_result=start_result->prev;
+  int UnpackHierarchyArc Returns the number of super-segments.
+
+  Hierarchy *hierarchy The contraction hierarchy to use.
+
+  index_t lower The rank of the lower node of the arc.
+
+  index_t arc The arc to unpack.
+
+  int up Set to 1 to go up from the lower node or 0 to come down to it.
+
+  index_t *segments Returns the super-segments in route order.
+
+  score_t *scores Returns the score for each of the super-segments.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int UnpackHierarchyArc(Hierarchy *hierarchy,index_t lower,index_t arc,int up,index_t *segments,score_t *scores)
+{
+ index_t higher=hierarchy->arcs[arc];
+ index_t via;
+ int n;
+
+ if(up)
+   {
+    if(hierarchy->upvia[arc]==NO_NODE)
+      {
+       segments[0]=hierarchy->upseg[arc];
+       scores[0]=hierarchy->up[arc];
+       return(1);
+      }
 
-    FixForwardRoute(results,finish_result);
+    via=hierarchy->upvia[arc];
 
-    if(!start_result->prev && start_result->next)
-       start_result=start_result->next;
+    /* lower -> via -> higher */
 
-    while(finish_result->next && finish_result->next!=NO_RESULT)
-       finish_result=finish_result->next;
+    n =UnpackHierarchyArc(hierarchy,via,FindHierarchyArc(hierarchy,via,lower ),0,segments  ,scores  );
+    n+=UnpackHierarchyArc(hierarchy,via,FindHierarchyArc(hierarchy,via,higher),1,segments+n,scores+n);
    }
+ else
+   {
+    if(hierarchy->downvia[arc]==NO_NODE)
+      {
+       segments[0]=hierarchy->downseg[arc];
+       scores[0]=hierarchy->down[arc];
+       return(1);
+      }
 
- results->start_node=start_result->node;
- results->prev_segment=start_result->segment;
-
- results->finish_node=finish_result->node;
- results->last_segment=finish_result->segment;
-
-#if DEBUG
- printf("    -------- middle route (via super-nodes/segments) score=%.3f\n",total_score);
+    via=hierarchy->downvia[arc];
 
- print_debug_route(nodes,segments,results,NULL,4,+1);
-#endif
+    /* higher -> via -> lower */
 
-#if !DEBUG && !defined(LIBROUTINO)
- if(!option_quiet)
-    printf_last("Found Middle Route: Super-Nodes checked = %d",results->number);
-#endif
+    n =UnpackHierarchyArc(hierarchy,via,FindHierarchyArc(hierarchy,via,higher),0,segments  ,scores  );
+    n+=UnpackHierarchyArc(hierarchy,via,FindHierarchyArc(hierarchy,via,lower ),1,segments+n,scores+n);
+   }
 
- return(results);
+ return(n);
 }
 
 
@@ -1176,6 +2863,8 @@ static Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
   index_t FindSuperSegment Returns the index of the super-segment.
 
+  Context *context The routing context to use.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1191,7 +2880,7 @@ static Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relat
   index_t finish_segment The segment that the route ends with.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node,index_t finish_segment)
+static index_t FindSuperSegment(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node,index_t finish_segment)
 {
  Node *supernodep;
  Segment *supersegmentp;
@@ -1201,7 +2890,7 @@ static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relat
 #endif
 
  if(IsFakeSegment(finish_segment))
-    finish_segment=IndexRealSegment(finish_segment);
+    finish_segment=IndexRealSegment(&context->fakes,finish_segment);
 
  supernodep=LookupNode(nodes,finish_node,3); /* finish_node cannot be a fake node (must be a super-node) */
  supersegmentp=LookupSegment(segments,finish_segment,3); /* finish_segment cannot be a fake segment. */
@@ -1229,7 +2918,7 @@ static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
        start_node=OtherNode(supersegmentp,finish_node);
 
-       results=FindSuperRoute(nodes,segments,ways,relations,profile,start_node,finish_node);
+       results=FindSuperRoute(context,nodes,segments,ways,relations,profile,start_node,finish_node);
 
        if(!results)
           continue;
@@ -1238,7 +2927,7 @@ static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
        if(result && (distance_t)result->score==DISTANCE(supersegmentp->distance))
          {
-          FreeResultsList(results);
+          PutResultsList(&context->pool,results);
 
 #if DEBUG
           printf("      -- found super-segment = %"Pindex_t"\n",IndexSegment(segments,supersegmentp));
@@ -1248,7 +2937,7 @@ static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relat
          }
 
        if(results)
-          FreeResultsList(results);
+          PutResultsList(&context->pool,results);
       }
 
     supersegmentp=NextSegment(segments,supersegmentp,finish_node); /* finish_node cannot be a fake node (must be a super-node) */
@@ -1268,6 +2957,8 @@ static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
   Results *FindSuperRoute Returns a set of results.
 
+  Context *context The routing context to use.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1283,7 +2974,7 @@ static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relat
   index_t finish_node The finish node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t finish_node)
+static Results *FindSuperRoute(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t finish_node)
 {
  Results *results;
  Queue   *queue;
@@ -1295,8 +2986,8 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
 
  /* Create the list of results and insert the first node into the queue */
 
- results=NewResultsList(8);
- queue=NewQueueList(8);
+ results=GetResultsList(&context->pool,8);
+ queue=GetQueueList(&context->pool,8);
 
  result1=InsertResult(results,start_node,NO_SEGMENT);
 
@@ -1329,6 +3020,10 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
        if(!IsNormalSegment(segment2p))
           goto endloop;
 
+       /* must be a way that the profile can use (super-segments may be created for only this transport) */
+       if(LookupWayCost(profile,segment2p->way)->pref==0)
+          goto endloop;
+
        /* must obey one-way restrictions */
        if(IsOnewayTo(segment2p,node1))
          {
@@ -1386,7 +3081,7 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
       }
    }
 
- FreeQueueList(queue);
+ PutQueueList(&context->pool,queue);
 
 #if DEBUG
  Result *s=FirstResult(results);
@@ -1408,11 +3103,295 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Check whether a super-segment passes over a particular node. A higher level super-segment
+  is made from lower level ones so it can start along the same route as one of them.
+
+  int SuperSegmentPassesOver Returns 1 if the super-segment passes over the node.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type.
+
+  index_t start_node The node at the end of the super-segment to start from.
+
+  index_t superseg The super-segment to check.
+
+  index_t via_node The node to look for.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int SuperSegmentPassesOver(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile,index_t start_node,index_t superseg,index_t via_node)
+{
+ Segment *supersegmentp;
+ Way      superway;
+ Results *results;
+ Queue   *queue;
+ Result  *result1,*result2;
+ index_t  finish_node;
+ distance_t distance;
+ int      start_level,finish_level,pass_level;
+ int      found=0;
+
+ supersegmentp=LookupSegment(segments,superseg,3);
+
+ /* A normal segment does not pass over any nodes */
+ if(IsNormalSegment(supersegmentp))
+    return(0);
+
+ finish_node=OtherNode(supersegmentp,start_node);
+ distance=DISTANCE(supersegmentp->distance);
+
+ superway=*LookupWay(ways,supersegmentp->way,3);
+
+ /* A super-segment only passes over super-nodes that are a lower level than both ends */
+
+ start_level =SuperNodeLevel(LookupNode(nodes,start_node ,5));
+ finish_level=SuperNodeLevel(LookupNode(nodes,finish_node,5));
+
+ pass_level=start_level<finish_level?start_level:finish_level;
+
+ if(SuperNodeLevel(LookupNode(nodes,via_node,5))>=pass_level)
+    return(0);
+
+ /* Create the list of results and insert the first node into the queue */
+
+ results=GetResultsList(&context->pool,8);
+ queue=GetQueueList(&context->pool,8);
+
+ result1=InsertResult(results,start_node,NO_SEGMENT);
+
+ InsertInQueue(queue,result1,0);
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p;
+    Segment *segment2p;
+    index_t node1,seg1;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1p=LookupNode(nodes,node1,5); /* node1 cannot be a fake node */
+
+    /* Loop across all segments */
+
+    segment2p=FirstSegment(segments,node1p,4); /* node1 cannot be a fake node */
+
+    while(segment2p)
+      {
+       Node *node2p;
+       index_t node2,seg2;
+       score_t cumulative_score;
+
+       /* must be a normal segment */
+       if(!IsNormalSegment(segment2p))
+          goto endloop;
+
+       seg2=IndexSegment(segments,segment2p);
+
+       /* must not perform U-turn */
+       if(seg1==seg2)
+          goto endloop;
+
+       /* must be the same type of way as the super-segment (for this type of transport) */
+       if(WaysCompareTransports(LookupWay(ways,segment2p->way,3),&superway,profile->allow))
+          goto endloop;
+
+       /* must not be longer than the super-segment */
+       cumulative_score=result1->score+(score_t)DISTANCE(segment2p->distance);
+
+       if(cumulative_score>distance)
+          goto endloop;
+
+       node2=OtherNode(segment2p,node1);
+
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment combination */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       node2p=LookupNode(nodes,node2,6); /* node2 cannot be a fake node */
+
+       /* don't route beyond the end of the super-segment or a super-node of the same level */
+       if(node2!=finish_node && !(IsSuperNode(node2p) && SuperNodeLevel(node2p)>=pass_level))
+          InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       segment2p=NextSegment(segments,segment2p,node1);
+      }
+   }
+
+ PutQueueList(&context->pool,queue);
+
+ /* Check if the route that matches the super-segment goes via the node */
+
+ result1=FirstResult(results);
+
+ while(result1 && !found)
+   {
+    if(result1->node==finish_node && (distance_t)result1->score==distance)
+      {
+       result2=result1->prev;
+
+       while(result2 && !found)
+         {
+          if(result2->node==via_node)
+             found=1;
+
+          result2=result2->prev;
+         }
+      }
+
+    result1=NextResult(results,result1);
+   }
+
+ PutResultsList(&context->pool,results);
+
+ return(found);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a super-node at one end of the middle part of the route as a target for the landmark estimate.
+
+  Landmarks *landmarks The set of landmark distances to use.
+
+  index_t node The super-node.
+
+  score_t score The score between the super-node and the end of the route.
+
+  score_t factor The lowest possible score for each metre of distance.
+
+  int reverse Set to 1 for the reverse search (the super-node is at the start of the middle part).
+
+  score_t *targets The combined targets (two for each landmark) to be updated.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void AddLandmarkTarget(Landmarks *landmarks,index_t node,score_t score,score_t factor,int reverse,score_t *targets)
+{
+ index_t nlandmarks=landmarks->file.nlandmarks;
+ index_t index=LandmarksIndex(landmarks,node);
+ distance_t *from,*to;
+ index_t l;
+
+ /* An unknown super-node means that no estimate can be made */
+
+ if(index==NO_NODE)
+   {
+    for(l=0;l<2*nlandmarks;l++)
+       targets[l]=-INF_SCORE;
+
+    return;
+   }
+
+ if(reverse)
+   {
+    from=LandmarkDistancesTo(landmarks,index);
+    to  =LandmarkDistancesFrom(landmarks,index);
+   }
+ else
+   {
+    from=LandmarkDistancesFrom(landmarks,index);
+    to  =LandmarkDistancesTo(landmarks,index);
+   }
+
+ for(l=0;l<nlandmarks;l++)
+   {
+    /* The landmark must be able to reach the target for the first estimate */
+
+    if(from[l]!=NO_LANDMARK_DISTANCE && (score+factor*from[l])<targets[l])
+       targets[l]=score+factor*from[l];
+
+    /* The target must be able to reach the landmark for the second estimate */
+
+    if(to[l]==NO_LANDMARK_DISTANCE)
+       targets[nlandmarks+l]=-INF_SCORE;
+    else if((score-factor*to[l])<targets[nlandmarks+l])
+       targets[nlandmarks+l]=score-factor*to[l];
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the lowest possible score from a super-node to the nearest target using the landmarks.
+
+  score_t LandmarkPotential Returns the lowest possible score.
+
+  Landmarks *landmarks The set of landmark distances to use.
+
+  index_t node The super-node.
+
+  score_t factor The lowest possible score for each metre of distance.
+
+  int reverse Set to 1 for the reverse search (the targets are at the start of the middle part).
+
+  score_t *targets The combined targets (two for each landmark).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static score_t LandmarkPotential(Landmarks *landmarks,index_t node,score_t factor,int reverse,score_t *targets)
+{
+ index_t nlandmarks=landmarks->file.nlandmarks;
+ index_t index=LandmarksIndex(landmarks,node);
+ distance_t *from,*to;
+ score_t potential=0;
+ index_t l;
+
+ if(index==NO_NODE)
+    return(0);
+
+ if(reverse)
+   {
+    from=LandmarkDistancesTo(landmarks,index);
+    to  =LandmarkDistancesFrom(landmarks,index);
+   }
+ else
+   {
+    from=LandmarkDistancesFrom(landmarks,index);
+    to  =LandmarkDistancesTo(landmarks,index);
+   }
+
+ /* The triangle inequality gives two lower bounds for each landmark */
+
+ for(l=0;l<nlandmarks;l++)
+   {
+    if(from[l]!=NO_LANDMARK_DISTANCE && (targets[l]-factor*from[l])>potential)
+       potential=targets[l]-factor*from[l];
+
+    if(to[l]!=NO_LANDMARK_DISTANCE && targets[nlandmarks+l]!=-INF_SCORE && (targets[nlandmarks+l]+factor*to[l])>potential)
+       potential=targets[nlandmarks+l]+factor*to[l];
+   }
+
+ return(potential);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Find all routes from a specified node to any super-node.
 
   Results *FindStartRoutes Returns a set of results.
 
+  Context *context The routing context to use.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1430,7 +3409,7 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
   index_t finish_node The finish node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
+static Results *FindStartRoutes(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
 {
  Results *results;
  Queue   *queue,*superqueue;
@@ -1450,9 +3429,9 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
  /* Create the list of results and insert the first node into the queue */
 
- results=NewResultsList(8);
- queue=NewQueueList(8);
- superqueue=NewQueueList(8);
+ results=GetResultsList(&context->pool,8);
+ queue=GetQueueList(&context->pool,8);
+ superqueue=GetQueueList(&context->pool,8);
 
  start_result=InsertResult(results,start_node,prev_segment);
 
@@ -1485,7 +3464,7 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
     seg1=result1->segment;
 
     if(IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
+       seg1r=IndexRealSegment(&context->fakes,seg1);
     else
        seg1r=seg1;
 
@@ -1494,22 +3473,21 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
     /* lookup if a turn restriction applies */
     if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
-       turnrelation=FindFirstTurnRelation2(relations,node1,seg1r);
+       turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1r);
 
     /* Loop across all segments */
 
     if(IsFakeNode(node1))
-       segment2p=FirstFakeSegment(node1);
+       segment2p=FirstFakeSegment(&context->fakes,node1);
     else
        segment2p=FirstSegment(segments,node1p,1);
 
     while(segment2p)
       {
        Node *node2p=NULL;
-       Way *way2p;
+       WayCost *waycost2;
        index_t node2,seg2,seg2r;
        score_t segment_pref,segment_score,cumulative_score;
-       int i;
 
        node2=OtherNode(segment2p,node1); /* need this here because we use node2 at the end of the loop */
 
@@ -1517,22 +3495,16 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
        if(!IsNormalSegment(segment2p))
           goto endloop;
 
-       /* must obey one-way restrictions (unless profile allows) */
-       if(profile->oneway && IsOnewayTo(segment2p,node1))
-         {
-          if(profile->allow!=Transports_Bicycle)
-             goto endloop;
-
-          way2p=LookupWay(ways,segment2p->way,1);
+       waycost2=LookupWayCost(profile,segment2p->way);
 
-          if(!(way2p->type&Highway_CycleBothWays))
-             goto endloop;
-         }
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segment2p,node1) && !waycost2->bothways)
+          goto endloop;
 
        if(IsFakeNode(node1) || IsFakeNode(node2))
          {
-          seg2 =IndexFakeSegment(segment2p);
-          seg2r=IndexRealSegment(seg2);
+          seg2 =IndexFakeSegment(&context->fakes,segment2p);
+          seg2r=IndexRealSegment(&context->fakes,seg2);
          }
        else
          {
@@ -1548,45 +3520,16 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
          }
        else
           /* must not perform U-turn (unless profile allows) */
-          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2))))
+          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(&context->fakes,seg1,seg2))))
              goto endloop;
 
        /* must obey turn relations */
-       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2r,profile->allow))
-          goto endloop;
-
-       way2p=LookupWay(ways,segment2p->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(way2p->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(way2p->weight && way2p->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exists) */
-       if((way2p->height && way2p->height<profile->height) ||
-          (way2p->width  && way2p->width <profile->width ) ||
-          (way2p->length && way2p->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(way2p->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg1r,seg2r,profile->allow))
           goto endloop;
 
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(way2p->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
+       segment_pref=waycost2->pref;
 
-       /* profile preferences must allow this highway */
+       /* mode of transport, restrictions and preferences must allow this highway */
        if(segment_pref==0)
           goto endloop;
 
@@ -1598,10 +3541,10 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
           goto endloop;
 
        /* calculate the score for the segment and cumulative */
-       if(option_quickest==0)
+       if(context->quickest==0)
           segment_score=(score_t)DISTANCE(segment2p->distance)/segment_pref;
        else
-          segment_score=(score_t)Duration(segment2p,way2p,profile)/segment_pref;
+          segment_score=(score_t)WayCostDuration(DISTANCE(segment2p->distance),waycost2)/segment_pref;
 
        /* prefer not to follow two fake segments when one would do (special case) */
        if(IsFakeSegment(seg2))
@@ -1658,7 +3601,7 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
       endloop:
 
        if(IsFakeNode(node1))
-          segment2p=NextFakeSegment(segment2p,node1);
+          segment2p=NextFakeSegment(&context->fakes,segment2p,node1);
        else if(IsFakeNode(node2))
           segment2p=NULL; /* cannot call NextSegment() with a fake segment */
        else
@@ -1666,13 +3609,13 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
           segment2p=NextSegment(segments,segment2p,node1);
 
           if(!segment2p && IsFakeNode(finish_node))
-             segment2p=ExtraFakeSegment(node1,finish_node);
+             segment2p=ExtraFakeSegment(&context->fakes,node1,finish_node);
          }
       }
    }
 
- FreeQueueList(queue);
- FreeQueueList(superqueue);
+ PutQueueList(&context->pool,queue);
+ PutQueueList(&context->pool,superqueue);
 
  /* Check it worked */
 
@@ -1687,7 +3630,7 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
        printf_last("Found Start Route: Nodes checked = %d - Fail",results->number);
 #endif
 
-    FreeResultsList(results);
+    PutResultsList(&context->pool,results);
     return(NULL);
    }
 
@@ -1734,6 +3677,8 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
 
   Results *FindFinishRoutes Returns a set of results.
 
+  Context *context The routing context to use.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1747,7 +3692,7 @@ static Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relat
   index_t finish_node The finishing node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node)
+static Results *FindFinishRoutes(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node)
 {
  Results *results,*finish_results;
  Queue   *queue;
@@ -1765,10 +3710,10 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
 
  /* Create the results and insert the finish node into the queue */
 
- finish_results=NewResultsList(2);
+ finish_results=GetResultsList(&context->pool,2);
 
- results=NewResultsList(8);
- queue=NewQueueList(8);
+ results=GetResultsList(&context->pool,8);
+ queue=GetQueueList(&context->pool,8);
 
  finish_result=InsertResult(finish_results,finish_node,NO_SEGMENT);
 
@@ -1780,24 +3725,23 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
    {
     Node *node1p=NULL;
     Segment *segment1p,*segment2p;
-    Way *way1p;
+    WayCost *waycost1;
     index_t real_node1,node1,seg1,seg1r;
     index_t turnrelation=NO_RELATION;
     score_t segment1_pref,segment1_score=0;
-    int i;
 
     real_node1=result1->node;
     seg1=result1->segment;
 
     if(seg1!=NO_SEGMENT && IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
+       seg1r=IndexRealSegment(&context->fakes,seg1);
     else
        seg1r=seg1;
 
     if(seg1!=NO_SEGMENT)
       {
        if(IsFakeSegment(seg1))
-          segment1p=LookupFakeSegment(seg1);
+          segment1p=LookupFakeSegment(&context->fakes,seg1);
        else
           segment1p=LookupSegment(segments,seg1,1);
       }
@@ -1817,24 +3761,15 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
 
     if(seg1!=NO_SEGMENT)
       {
-       way1p=LookupWay(ways,segment1p->way,1);
+       waycost1=LookupWayCost(profile,segment1p->way);
 
-       segment1_pref=profile->highway[HIGHWAY(way1p->type)];
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(way1p->props & PROPERTIES(i))
-                segment1_pref*=profile->props_yes[i];
-             else
-                segment1_pref*=profile->props_no[i];
-            }
+       segment1_pref=waycost1->pref;
 
        /* calculate the score for the segment */
-       if(option_quickest==0)
+       if(context->quickest==0)
           segment1_score=(score_t)DISTANCE(segment1p->distance)/segment1_pref;
        else
-          segment1_score=(score_t)Duration(segment1p,way1p,profile)/segment1_pref;
+          segment1_score=(score_t)WayCostDuration(DISTANCE(segment1p->distance),waycost1)/segment1_pref;
 
        /* prefer not to follow two fake segments when one would do (special case) */
        if(IsFakeSegment(seg1))
@@ -1844,14 +3779,14 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
     /* Loop across all segments */
 
     if(IsFakeNode(node1))
-       segment2p=FirstFakeSegment(node1);
+       segment2p=FirstFakeSegment(&context->fakes,node1);
     else
        segment2p=FirstSegment(segments,node1p,1);
 
     while(segment2p)
       {
        Node *node2p=NULL;
-       Way *way2p;
+       WayCost *waycost2;
        index_t node2,seg2,seg2r;
        score_t segment_pref,cumulative_score;
 
@@ -1863,24 +3798,18 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
        if((!IsFakeNode(node1) && IsSuperNode(node1p)) && !IsSuperSegment(segment2p))
           goto endloop;
 
-       /* must obey one-way restrictions (unless profile allows) */
-       if(profile->oneway && IsOnewayFrom(segment2p,node1)) /* working backwards => disallow oneway *from* node1 */
-         {
-          if(profile->allow!=Transports_Bicycle)
-             goto endloop;
+       waycost2=LookupWayCost(profile,segment2p->way);
 
-          way2p=LookupWay(ways,segment2p->way,1);
-
-          if(!(way2p->type&Highway_CycleBothWays))
-             goto endloop;
-         }
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayFrom(segment2p,node1) && !waycost2->bothways) /* working backwards => disallow oneway *from* node1 */
+          goto endloop;
 
        node2=OtherNode(segment2p,node1);
 
        if(IsFakeNode(node1) || IsFakeNode(node2))
          {
-          seg2 =IndexFakeSegment(segment2p);
-          seg2r=IndexRealSegment(seg2);
+          seg2 =IndexFakeSegment(&context->fakes,segment2p);
+          seg2r=IndexRealSegment(&context->fakes,seg2);
          }
        else
          {
@@ -1895,59 +3824,37 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
             {
              if(IsFakeNode(node1) || !IsSuperNode(node1p))
                {
-                if(seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2)))
+                if(seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(&context->fakes,seg1,seg2)))
                    goto endloop;
                }
              else
                {
-                index_t superseg=FindSuperSegment(nodes,segments,ways,relations,profile,node1,seg1);
+                index_t superseg=FindSuperSegment(context,nodes,segments,ways,relations,profile,node1,seg1);
+                Segment *supersegmentp;
 
                 if(seg2==superseg)
                    goto endloop;
+
+                /* a higher level super-segment can start along the lower level one */
+                supersegmentp=LookupSegment(segments,superseg,2);
+
+                if(SuperSegmentPassesOver(context,nodes,segments,ways,profile,node1,seg2,OtherNode(supersegmentp,node1)))
+                   goto endloop;
                }
             }
 
           /* lookup if a turn restriction applies */
           if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
-             turnrelation=FindFirstTurnRelation2(relations,node1,seg2r);
+             turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg2r);
 
           /* must obey turn relations */
-          if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg2r,seg1r,profile->allow))
+          if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg2r,seg1r,profile->allow))
              goto endloop;
          }
 
-       way2p=LookupWay(ways,segment2p->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(way2p->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(way2p->weight && way2p->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exist) */
-       if((way2p->height && way2p->height<profile->height) ||
-          (way2p->width  && way2p->width <profile->width ) ||
-          (way2p->length && way2p->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(way2p->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(way2p->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
+       segment_pref=waycost2->pref;
 
-       /* profile preferences must allow this highway */
+       /* mode of transport, restrictions and preferences must allow this highway */
        if(segment_pref==0)
           goto endloop;
 
@@ -1985,15 +3892,15 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
       endloop:
 
        if(IsFakeNode(node1))
-          segment2p=NextFakeSegment(segment2p,node1);
+          segment2p=NextFakeSegment(&context->fakes,segment2p,node1);
        else
           segment2p=NextSegment(segments,segment2p,node1);
       }
    }
 
- FreeQueueList(queue);
+ PutQueueList(&context->pool,queue);
 
- FreeResultsList(finish_results);
+ PutResultsList(&context->pool,finish_results);
 
  /* Check it worked */
 
@@ -2008,7 +3915,7 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
     printf_last("Found Finish Route: Nodes checked = %d - Fail",results->number);
 #endif
 
-    FreeResultsList(results);
+    PutResultsList(&context->pool,results);
     return(NULL);
    }
 
@@ -2046,6 +3953,8 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
 
   Results *CombineRoutes Returns the results from joining the super-nodes.
 
+  Context *context The routing context to use.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -2063,7 +3972,7 @@ static Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Rela
   Results *end The set of results for the end of the route.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle,Results *end)
+static Results *CombineRoutes(Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle,Results *end)
 {
  Result *midres,*comres;
  Results *combined;
@@ -2077,7 +3986,9 @@ static Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relatio
     printf_first("Finding Combined Route: Nodes = 0");
 #endif
 
- combined=NewResultsList(10);
+ context->normal_checked=0;
+
+ combined=GetResultsList(&context->pool,10);
 
  /* Insert the start point */
 
@@ -2122,17 +4033,17 @@ static Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relatio
 
  while(midres->next && midres->next!=NO_RESULT)
    {
-    Results *results=FindNormalRoute(nodes,segments,ways,relations,profile,comres->node,comres->segment,midres->next->node);
+    Results *results=FindNormalRoute(context,nodes,segments,ways,relations,profile,comres->node,comres->segment,midres->next->node);
     Result *result;
 
     if(!results)
       {
 #if !DEBUG && !defined(LIBROUTINO)
        if(!option_quiet)
-          printf_last("Found Combined Route: Nodes = %d - Fail",combined->number);
+          printf_last("Found Combined Route: Nodes = %d, Nodes checked = %d - Fail",combined->number,context->normal_checked);
 #endif
 
-       FreeResultsList(combined);
+       PutResultsList(&context->pool,combined);
        return(NULL);
       }
 
@@ -2169,7 +4080,7 @@ static Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relatio
       }
     while(result);
 
-    FreeResultsList(results);
+    PutResultsList(&context->pool,results);
 
     midres=midres->next;
 
@@ -2215,13 +4126,449 @@ static Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relatio
 
 #if !DEBUG && !defined(LIBROUTINO)
  if(!option_quiet)
-    printf_last("Found Combined Route: Nodes = %d",combined->number);
+    printf_last("Found Combined Route: Nodes = %d, Nodes checked = %d",combined->number,context->normal_checked);
 #endif
 
  return(combined);
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Find the routes across the super-segments from the super-nodes near a start point to the
+  super-nodes near all of the finish points of a matrix (stopping when no route to any of the
+  finish points can be improved).
+
+  Results *FindMatrixForwardRoutes Returns a set of results.
+
+  Context *context The routing context to use.
+
+  Matrix *matrix The matrix containing the super-nodes near to the finish points.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *begin The initial portion of the route.
+
+  score_t *scores Returns the best score to each finish point.
+
+  Result **fwd_results Returns the last result of the best route to each finish point.
+
+  MatrixEntry **rev_entries Returns the super-node near each finish point that the best route uses.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *FindMatrixForwardRoutes(Context *context,Matrix *matrix,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                        Results *begin,score_t *scores,Result **fwd_results,MatrixEntry **rev_entries)
+{
+ Results *results;
+ Queue   *queue;
+ Result  *begin_result,*result1,*result2;
+ score_t max_score=INF_SCORE;
+ int     i;
+
+ /* Create the list of results and queue */
+
+ results=GetResultsList(&context->pool,20);
+ queue=GetQueueList(&context->pool,12);
+
+ /* Insert the finish points of the beginning part of the path into the results,
+    translating the segments into super-segments (the next pointer links them to
+    the beginning part of the path). */
+
+ begin_result=FirstResult(begin);
+
+ while((begin_result=NextResult(begin,begin_result)))
+   {
+    if(!IsFakeNode(begin_result->node) && IsSuperNode(LookupNode(nodes,begin_result->node,3)))
+      {
+       index_t superseg=FindSuperSegment(context,nodes,segments,ways,relations,profile,begin_result->node,begin_result->segment);
+
+       result1=FindResult(results,begin_result->node,superseg);
+
+       if(!result1) /* New end node/super-segment pair */
+         {
+          result1=InsertResult(results,begin_result->node,superseg);
+          result1->next=begin_result;
+          result1->score=begin_result->score;
+         }
+       else if(begin_result->score<result1->score) /* New end node/super-segment pair is better */
+         {
+          result1->next=begin_result;
+          result1->score=begin_result->score;
+         }
+       else
+          continue;
+
+       InsertInQueue(queue,result1,result1->score);
+
+       JoinMatrixEntries(matrix,result1,scores,fwd_results,rev_entries);
+      }
+   }
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p;
+    Segment *segment2p;
+    index_t node1,seg1;
+    index_t turnrelation=NO_RELATION;
+    index_t climbed_from=NO_NODE;
+
+    /* stop searching when no route to any finish point can be better than the current best score */
+    if(max_score==INF_SCORE)
+      {
+       for(i=0;i<matrix->nfinish;i++)
+          if(matrix->near[i] && scores[i]==INF_SCORE)
+             break;
+
+       if(i==matrix->nfinish)
+          for(max_score=0,i=0;i<matrix->nfinish;i++)
+             if(matrix->near[i] && scores[i]>max_score)
+                max_score=scores[i];
+      }
+
+    if(result1->score>=max_score)
+       break;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    /* mode of transport must be allowed through node1 (it can be reached if it is a finish point) */
+    if(!(node1p->allow&profile->allow))
+       continue;
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
+       turnrelation=FindFirstTurnRelation2(relations,&context->fakes,node1,seg1);
+
+    /* find whether node1 was reached by going up a level of super-node */
+    if(seg1!=NO_SEGMENT)
+      {
+       Segment *segment1p=LookupSegment(segments,seg1,2);
+       index_t node0=OtherNode(segment1p,node1);
+
+       if(SuperNodeLevel(LookupNode(nodes,node0,2))<SuperNodeLevel(node1p))
+          climbed_from=node0;
+      }
+
+    /* Loop across all segments */
+
+    segment2p=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    while(segment2p)
+      {
+       Node *node2p;
+       WayCost *waycost2;
+       index_t node2,seg2;
+       score_t segment_pref,segment_score,cumulative_score;
+
+       /* must be a super segment */
+       if(!IsSuperSegment(segment2p))
+          goto endloop;
+
+       waycost2=LookupWayCost(profile,segment2p->way);
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segment2p,node1) && !waycost2->bothways)
+          goto endloop;
+
+       seg2=IndexSegment(segments,segment2p); /* segment cannot be a fake segment (must be a super-segment) */
+
+       /* must not perform U-turn */
+       if(seg1==seg2) /* No fake segments, applies to all profiles */
+          goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,node1,seg1,seg2,profile->allow))
+          goto endloop;
+
+       segment_pref=waycost2->pref;
+
+       /* mode of transport, restrictions and preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       node2=OtherNode(segment2p,node1);
+
+       node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+       /* must not perform U-turn (a higher level super-segment can start along the lower level one just used) */
+       if(climbed_from!=NO_NODE && SuperSegmentPassesOver(context,nodes,segments,ways,profile,node1,seg2,climbed_from))
+          goto endloop;
+
+       /* must not perform U-turn (a lower level super-segment can start back along the higher level one just used,
+          there is no reverse search so the search can go down to a lower level of super-node) */
+       if(seg1!=NO_SEGMENT && SuperNodeLevel(node2p)<SuperNodeLevel(node1p) && SuperSegmentPassesOver(context,nodes,segments,ways,profile,node1,seg1,node2))
+          goto endloop;
+
+       /* calculate the score for the segment and cumulative */
+       if(context->quickest==0)
+          segment_score=(score_t)DISTANCE(segment2p->distance)/segment_pref;
+       else
+          segment_score=(score_t)WayCostDuration(DISTANCE(segment2p->distance),waycost2)/segment_pref;
+
+       cumulative_score=result1->score+segment_score;
+
+       /* score must be better than the current best score to every finish point */
+       if(cumulative_score>=max_score)
+          goto endloop;
+
+       /* find whether the node/segment combination already exists */
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment pair */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+         {
+          result2->prev=result1;
+          result2->next=NULL;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       InsertInQueue(queue,result2,result2->score);
+
+       if(JoinMatrixEntries(matrix,result2,scores,fwd_results,rev_entries) && max_score!=INF_SCORE)
+          for(max_score=0,i=0;i<matrix->nfinish;i++)
+             if(matrix->near[i] && scores[i]>max_score)
+                max_score=scores[i];
+
+      endloop:
+
+       segment2p=NextSegment(segments,segment2p,node1); /* node1 cannot be a fake node (must be a super-node) */
+      }
+   }
+
+ PutQueueList(&context->pool,queue);
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Join a result from the search forwards to the super-nodes near to the finish points of a matrix.
+
+  int JoinMatrixEntries Returns 1 if the best score to any of the finish points was improved.
+
+  Matrix *matrix The matrix containing the super-nodes near to the finish points.
+
+  Result *result The result from the search forwards.
+
+  score_t *scores The best score to each finish point (updated).
+
+  Result **fwd_results The last result of the best route to each finish point (updated).
+
+  MatrixEntry **rev_entries The super-node near each finish point that the best route uses (updated).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int JoinMatrixEntries(Matrix *matrix,Result *result,score_t *scores,Result **fwd_results,MatrixEntry **rev_entries)
+{
+ size_t start=0,end=matrix->nentries;
+ int improved=0;
+
+ /* Binary search for the first entry with the same node and segment */
+
+ while(start<end)
+   {
+    size_t mid=start+(end-start)/2;
+    MatrixEntry *entry=&matrix->entries[mid];
+
+    if(entry->node<result->node || (entry->node==result->node && entry->segment<result->segment))
+       start=mid+1;
+    else
+       end=mid;
+   }
+
+ for(;start<matrix->nentries;start++)
+   {
+    MatrixEntry *entry=&matrix->entries[start];
+
+    if(entry->node!=result->node || entry->segment!=result->segment)
+       break;
+
+    if((result->score+entry->score)<scores[entry->finish])
+      {
+       scores[entry->finish]=result->score+entry->score;
+       fwd_results[entry->finish]=result;
+       rev_entries[entry->finish]=entry;
+
+       improved=1;
+      }
+   }
+
+ return(improved);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Make a sorted list of the nodes that were reached in a search to or from a waypoint (two
+  waypoints that share one of these may have a route that does not follow any super-segments).
+
+  index_t *NearNodes Returns the sorted list of nodes.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Results *results The results of the search to or from the waypoint.
+
+  index_t waypoint_node The waypoint node.
+
+  int *number Returns the number of nodes in the list.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t *NearNodes(Nodes *nodes,Segments *segments,Results *results,index_t waypoint_node,int *number)
+{
+ index_t *near;
+ Result *result;
+ int i,n=0,nalloc;
+
+ nalloc=results->number+1;
+
+ near=(index_t*)malloc(nalloc*sizeof(index_t));
+
+ near[n++]=waypoint_node;
+
+ /* The neighbours of the waypoint are included because a search towards it cannot pass through
+    it (if it is a barrier) so it may not find the waypoint itself. */
+
+ if(!IsFakeNode(waypoint_node))
+   {
+    Segment *segmentp=FirstSegment(segments,LookupNode(nodes,waypoint_node,1),1);
+
+    while(segmentp)
+      {
+       if(IsNormalSegment(segmentp))
+         {
+          if(n==nalloc)
+             near=(index_t*)realloc(near,(nalloc+=8)*sizeof(index_t));
+
+          near[n++]=OtherNode(segmentp,waypoint_node);
+         }
+
+       segmentp=NextSegment(segments,segmentp,waypoint_node);
+      }
+   }
+
+ result=FirstResult(results);
+
+ while(result)
+   {
+    if(n==nalloc)
+       near=(index_t*)realloc(near,(nalloc+=8)*sizeof(index_t));
+
+    near[n++]=result->node;
+
+    result=NextResult(results,result);
+   }
+
+ qsort(near,n,sizeof(index_t),(int (*)(const void*,const void*))sort_by_index);
+
+ /* Remove the duplicates */
+
+ for(*number=0,i=0;i<n;i++)
+    if(*number==0 || near[i]!=near[*number-1])
+       near[(*number)++]=near[i];
+
+ return(near);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add the distance and duration of a segment to running totals.
+
+  Context *context The routing context to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t segment The segment (which may be a fake segment).
+
+  distance_t *distance The distance to add to.
+
+  duration_t *duration The duration to add to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void AddSegmentTotals(Context *context,Segments *segments,Ways *ways,Profile *profile,index_t segment,distance_t *distance,duration_t *duration)
+{
+ Segment *segmentp;
+ WayCost *waycost;
+
+ if(IsFakeSegment(segment))
+    segmentp=LookupFakeSegment(&context->fakes,segment);
+ else
+    segmentp=LookupSegment(segments,segment,1);
+
+ waycost=LookupWayCost(profile,segmentp->way);
+
+ *distance+=DISTANCE(segmentp->distance);
+ *duration+=WayCostDuration(DISTANCE(segmentp->distance),waycost);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the matrix entries into node, segment and then finish point order.
+
+  int sort_by_node_segment_finish Returns the comparison of the entries.
+
+  MatrixEntry *a The first entry.
+
+  MatrixEntry *b The second entry.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_node_segment_finish(MatrixEntry *a,MatrixEntry *b)
+{
+ if(a->node<b->node)
+    return(-1);
+ else if(a->node>b->node)
+    return(1);
+ else if(a->segment<b->segment)
+    return(-1);
+ else if(a->segment>b->segment)
+    return(1);
+ else
+    return(a->finish-b->finish);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the node indexes into ascending order.
+
+  int sort_by_index Returns the comparison of the indexes.
+
+  index_t *a The first index.
+
+  index_t *b The second index.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_index(index_t *a,index_t *b)
+{
+ if(*a<*b)
+    return(-1);
+ else if(*a>*b)
+    return(1);
+ else
+    return(0);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Fix the forward route (i.e. setup next pointers for forward path from prev nodes on reverse path).
 
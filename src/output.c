@@ -34,6 +34,7 @@
 #include "relations.h"
 
 #include "functions.h"
+#include "context.h"
 #include "fakes.h"
 #include "translations.h"
 #include "results.h"
@@ -50,16 +51,14 @@
 #define ROUTINO_POINT_IGNORE      -1      /*+ Ignore this point. +*/
 
 
-/* Global variables */
+/* Local functions */
 
-/*+ The option to calculate the quickest route insted of the shortest. +*/
-int option_quickest=0;
+static FILE *OpenOutputFile(Context *context,const char *name,const char *mode);
 
-/*+ The options to select the format of the file output. +*/
-int option_file_html=0,option_file_gpx_track=0,option_file_gpx_route=0,option_file_text=0,option_file_text_all=0,option_file_stdout=0;
+static score_t IsochroneSegmentScore(Context *context,Segments *segments,Ways *ways,Profile *profile,index_t segment);
 
-/*+ The options to select the format of the linked list output. +*/
-int option_list_html=0,option_list_html_all=0,option_list_text=0,option_list_text_all=0;
+static int sort_by_node_score(Result **a,Result **b);
+static int sort_by_score(Result **a,Result **b);
 
 
 /* Local variables */
@@ -88,6 +87,8 @@ static const char junction_other_way[Highway_Count][Highway_Count]=
 
   Routino_Output *PrintRoute Returns a linked list of data structures representing the route if required.
 
+  Context *context The routing context to use.
+
   Results **results The set of results to print (consecutive in array even if not consecutive waypoints).
 
   int nresults The number of results in the list.
@@ -105,12 +106,13 @@ static const char junction_other_way[Highway_Count][Highway_Count]=
   Translation *translation The set of translated strings.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Translation *translation)
+Routino_Output *PrintRoute(Context *context,Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Translation *translation)
 {
  FILE                          *htmlfile=NULL,*gpxtrackfile=NULL,*gpxroutefile=NULL,*textfile=NULL,*textallfile=NULL;
  Routino_Output *listhead=NULL,*htmllist=NULL,                                      *textlist=NULL,*textalllist=NULL,*htmlalllist=NULL;
 
  char *prev_bearing=NULL,*prev_wayname=NULL,*prev_waynameraw=NULL;
+ char *xmlbuffer=NULL;
  index_t prev_node=NO_NODE;
  distance_t cum_distance=0;
  duration_t cum_duration=0;
@@ -121,17 +123,17 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
 
  /* Open the files */
 
- if(option_file_stdout)
+ if(context->file_stdout)
    {
-    if(option_file_html)
+    if(context->file_html)
        htmlfile    =stdout;
-    if(option_file_gpx_track)
+    if(context->file_gpx_track)
        gpxtrackfile=stdout;
-    if(option_file_gpx_route)
+    if(context->file_gpx_route)
        gpxroutefile=stdout;
-    if(option_file_text)
+    if(context->file_text)
        textfile    =stdout;
-    if(option_file_text_all)
+    if(context->file_text_all)
        textallfile =stdout;
    }
  else
@@ -142,31 +144,31 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
     const char *open_mode="w";
 #endif
 
-    if(option_quickest==0)
+    if(context->quickest==0)
       {
        /* Print the result for the shortest route */
 
-       if(option_file_html)
-          htmlfile    =fopen("shortest.html",open_mode);
-       if(option_file_gpx_track)
-          gpxtrackfile=fopen("shortest-track.gpx",open_mode);
-       if(option_file_gpx_route)
-          gpxroutefile=fopen("shortest-route.gpx",open_mode);
-       if(option_file_text)
-          textfile    =fopen("shortest.txt",open_mode);
-       if(option_file_text_all)
-          textallfile =fopen("shortest-all.txt",open_mode);
+       if(context->file_html)
+          htmlfile    =OpenOutputFile(context,"shortest.html",open_mode);
+       if(context->file_gpx_track)
+          gpxtrackfile=OpenOutputFile(context,"shortest-track.gpx",open_mode);
+       if(context->file_gpx_route)
+          gpxroutefile=OpenOutputFile(context,"shortest-route.gpx",open_mode);
+       if(context->file_text)
+          textfile    =OpenOutputFile(context,"shortest.txt",open_mode);
+       if(context->file_text_all)
+          textallfile =OpenOutputFile(context,"shortest-all.txt",open_mode);
 
 #ifndef LIBROUTINO
-       if(option_file_html && !htmlfile)
+       if(context->file_html && !htmlfile)
           fprintf(stderr,"Warning: Cannot open file 'shortest.html' for writing [%s].\n",strerror(errno));
-       if(option_file_gpx_track && !gpxtrackfile)
+       if(context->file_gpx_track && !gpxtrackfile)
           fprintf(stderr,"Warning: Cannot open file 'shortest-track.gpx' for writing [%s].\n",strerror(errno));
-       if(option_file_gpx_route && !gpxroutefile)
+       if(context->file_gpx_route && !gpxroutefile)
           fprintf(stderr,"Warning: Cannot open file 'shortest-route.gpx' for writing [%s].\n",strerror(errno));
-       if(option_file_text && !textfile)
+       if(context->file_text && !textfile)
           fprintf(stderr,"Warning: Cannot open file 'shortest.txt' for writing [%s].\n",strerror(errno));
-       if(option_file_text_all && !textallfile)
+       if(context->file_text_all && !textallfile)
           fprintf(stderr,"Warning: Cannot open file 'shortest-all.txt' for writing [%s].\n",strerror(errno));
 #endif
       }
@@ -174,27 +176,27 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
       {
        /* Print the result for the quickest route */
 
-       if(option_file_html)
-          htmlfile    =fopen("quickest.html",open_mode);
-       if(option_file_gpx_track)
-          gpxtrackfile=fopen("quickest-track.gpx",open_mode);
-       if(option_file_gpx_route)
-          gpxroutefile=fopen("quickest-route.gpx",open_mode);
-       if(option_file_text)
-          textfile    =fopen("quickest.txt",open_mode);
-       if(option_file_text_all)
-          textallfile =fopen("quickest-all.txt",open_mode);
+       if(context->file_html)
+          htmlfile    =OpenOutputFile(context,"quickest.html",open_mode);
+       if(context->file_gpx_track)
+          gpxtrackfile=OpenOutputFile(context,"quickest-track.gpx",open_mode);
+       if(context->file_gpx_route)
+          gpxroutefile=OpenOutputFile(context,"quickest-route.gpx",open_mode);
+       if(context->file_text)
+          textfile    =OpenOutputFile(context,"quickest.txt",open_mode);
+       if(context->file_text_all)
+          textallfile =OpenOutputFile(context,"quickest-all.txt",open_mode);
 
 #ifndef LIBROUTINO
-       if(option_file_html && !htmlfile)
+       if(context->file_html && !htmlfile)
           fprintf(stderr,"Warning: Cannot open file 'quickest.html' for writing [%s].\n",strerror(errno));
-       if(option_file_gpx_track && !gpxtrackfile)
+       if(context->file_gpx_track && !gpxtrackfile)
           fprintf(stderr,"Warning: Cannot open file 'quickest-track.gpx' for writing [%s].\n",strerror(errno));
-       if(option_file_gpx_route && !gpxroutefile)
+       if(context->file_gpx_route && !gpxroutefile)
           fprintf(stderr,"Warning: Cannot open file 'quickest-route.gpx' for writing [%s].\n",strerror(errno));
-       if(option_file_text && !textfile)
+       if(context->file_text && !textfile)
           fprintf(stderr,"Warning: Cannot open file 'quickest.txt' for writing [%s].\n",strerror(errno));
-       if(option_file_text_all && !textallfile)
+       if(context->file_text_all && !textallfile)
           fprintf(stderr,"Warning: Cannot open file 'quickest-all.txt' for writing [%s].\n",strerror(errno));
 #endif
       }
@@ -214,7 +216,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
        fprintf(htmlfile,"<!-- %s : %s -->\n",translation->xml_copyright_license[0],translation->xml_copyright_license[1]);
     fprintf(htmlfile,"<head>\n");
     fprintf(htmlfile,"<title>");
-    fprintf(htmlfile,translation->html_title,option_quickest?translation->xml_route_quickest:translation->xml_route_shortest);
+    fprintf(htmlfile,translation->html_title,context->quickest?translation->xml_route_quickest:translation->xml_route_shortest);
     fprintf(htmlfile,"</title>\n");
     fprintf(htmlfile,"<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">\n");
     fprintf(htmlfile,"<style type=\"text/css\">\n");
@@ -239,7 +241,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
     fprintf(htmlfile,"</head>\n");
     fprintf(htmlfile,"<body>\n");
     fprintf(htmlfile,"<h1>");
-    fprintf(htmlfile,translation->html_title,option_quickest?translation->xml_route_quickest:translation->xml_route_shortest);
+    fprintf(htmlfile,translation->html_title,context->quickest?translation->xml_route_quickest:translation->xml_route_shortest);
     fprintf(htmlfile,"</h1>\n");
     fprintf(htmlfile,"<table>\n");
    }
@@ -264,10 +266,10 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
 
     fprintf(gpxtrackfile,"<trk>\n");
     fprintf(gpxtrackfile,"<name>");
-    fprintf(gpxtrackfile,translation->gpx_name,option_quickest?translation->xml_route_quickest:translation->xml_route_shortest);
+    fprintf(gpxtrackfile,translation->gpx_name,context->quickest?translation->xml_route_quickest:translation->xml_route_shortest);
     fprintf(gpxtrackfile,"</name>\n");
     fprintf(gpxtrackfile,"<desc>");
-    fprintf(gpxtrackfile,translation->gpx_desc,option_quickest?translation->xml_route_quickest:translation->xml_route_shortest);
+    fprintf(gpxtrackfile,translation->gpx_desc,context->quickest?translation->xml_route_quickest:translation->xml_route_shortest);
     fprintf(gpxtrackfile,"</desc>\n");
    }
 
@@ -291,10 +293,10 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
 
     fprintf(gpxroutefile,"<rte>\n");
     fprintf(gpxroutefile,"<name>");
-    fprintf(gpxroutefile,translation->gpx_name,option_quickest?translation->xml_route_quickest:translation->xml_route_shortest);
+    fprintf(gpxroutefile,translation->gpx_name,context->quickest?translation->xml_route_quickest:translation->xml_route_shortest);
     fprintf(gpxroutefile,"</name>\n");
     fprintf(gpxroutefile,"<desc>");
-    fprintf(gpxroutefile,translation->gpx_desc,option_quickest?translation->xml_route_quickest:translation->xml_route_shortest);
+    fprintf(gpxroutefile,translation->gpx_desc,context->quickest?translation->xml_route_quickest:translation->xml_route_shortest);
     fprintf(gpxroutefile,"</desc>\n");
    }
 
@@ -336,13 +338,13 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
 
  /* Create the head of the linked list */
 
- if(option_list_html)
+ if(context->list_html)
     listhead=htmllist=calloc(sizeof(Routino_Output),1);
- if(option_list_html_all)
+ if(context->list_html_all)
     listhead=htmlalllist=htmllist=calloc(sizeof(Routino_Output),1);
- if(option_list_text)
+ if(context->list_text)
     listhead=textlist=calloc(sizeof(Routino_Output),1);
- if(option_list_text_all)
+ if(context->list_text_all)
     listhead=textalllist=calloc(sizeof(Routino_Output),1);
 
  /* Loop through all the sections of the route and print them */
@@ -399,12 +401,12 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
        /* Calculate the information about this point */
 
        if(IsFakeNode(result->node))
-          GetFakeLatLong(result->node,&latitude,&longitude);
+          GetFakeLatLong(&context->fakes,result->node,&latitude,&longitude);
        else
          {
           resultnodep=LookupNode(nodes,result->node,6);
 
-          GetLatLong(nodes,result->node,resultnodep,&latitude,&longitude);
+          GetLatLong(nodes,result->node,&latitude,&longitude);
          }
 
        /* Calculate the next result */
@@ -428,8 +430,8 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
          {
           if(IsFakeSegment(result->segment))
             {
-             resultsegmentp=LookupFakeSegment(result->segment);
-             realsegment=IndexRealSegment(result->segment);
+             resultsegmentp=LookupFakeSegment(&context->fakes,result->segment);
+             realsegment=IndexRealSegment(&context->fakes,result->segment);
             }
           else
             {
@@ -456,8 +458,8 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
          {
           if(IsFakeSegment(next_result->segment))
             {
-             next_resultsegmentp=LookupFakeSegment(next_result->segment);
-             next_realsegment=IndexRealSegment(next_result->segment);
+             next_resultsegmentp=LookupFakeSegment(&context->fakes,next_result->segment);
+             next_realsegment=IndexRealSegment(&context->fakes,next_result->segment);
             }
           else
             {
@@ -486,7 +488,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
                 if(resultnodep)
                    segmentp=FirstSegment(segments,resultnodep,3);
                 else
-                   segmentp=FirstFakeSegment(result->node);
+                   segmentp=FirstFakeSegment(&context->fakes,result->node);
 
                 do
                   {
@@ -494,7 +496,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
                    index_t thissegment;
 
                    if(IsFakeNode(result->node))
-                      thissegment=IndexFakeSegment(segmentp);
+                      thissegment=IndexFakeSegment(&context->fakes,segmentp);
                    else
                       thissegment=IndexSegment(segments,segmentp);
 
@@ -531,7 +533,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
                    if(resultnodep)
                       segmentp=NextSegment(segments,segmentp,result->node);
                    else
-                      segmentp=NextFakeSegment(segmentp,result->node);
+                      segmentp=NextFakeSegment(&context->fakes,segmentp,result->node);
                   }
                 while(segmentp);
                }
@@ -585,9 +587,9 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
 
                 if(profile->turns && IsSuperNode(resultnodep) && IsTurnRestrictedNode(resultnodep))
                   {
-                   index_t turnrelation=FindFirstTurnRelation2(relations,result->node,realsegment);
+                   index_t turnrelation=FindFirstTurnRelation2(relations,&context->fakes,result->node,realsegment);
 
-                   if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,result->node,realsegment,seg,profile->allow))
+                   if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,&context->fakes,turnrelation,result->node,realsegment,seg,profile->allow))
                       cango=0;
                   }
 
@@ -626,7 +628,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
           if(!*waynameraw)
              waynameraw=translation->raw_highway[HIGHWAY(resultwayp->type)];
 
-          bearing_int=(int)BearingAngle(nodes,resultsegmentp,result->node);
+          bearing_int=(int)BearingAngle(nodes,&context->fakes,resultsegmentp,result->node);
 
           seg_speed=profile->speed[HIGHWAY(resultwayp->type)];
          }
@@ -638,27 +640,27 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
              if(DISTANCE(resultsegmentp->distance)==0 || DISTANCE(next_resultsegmentp->distance)==0)
                 turn_int=0;
              else
-                turn_int=(int)TurnAngle(nodes,resultsegmentp,next_resultsegmentp,result->node);
+                turn_int=(int)TurnAngle(nodes,&context->fakes,resultsegmentp,next_resultsegmentp,result->node);
 
              turn   =translation->xml_turn[((202+turn_int)/45)%8];
              turnraw=translation->notxml_turn[((202+turn_int)/45)%8];
             }
 
-          if(gpxroutefile || htmlfile || htmllist)
+          if(gpxroutefile || htmlfile || htmllist || textfile || textlist)
             {
              next_waynameraw=WayName(ways,next_resultwayp);
              if(!*next_waynameraw)
                 next_waynameraw=translation->raw_highway[HIGHWAY(next_resultwayp->type)];
 
-             next_wayname=ParseXML_Encode_Safe_XML(next_waynameraw);
+             next_wayname=ParseXML_Encode_Safe_XML_Buffer(next_waynameraw,&xmlbuffer);
             }
 
           if(htmlfile || htmllist || gpxroutefile || textfile || textlist)
             {
              if(!first && DISTANCE(next_resultsegmentp->distance)==0)
-                next_bearing_int=(int)BearingAngle(nodes,resultsegmentp,result->node);
+                next_bearing_int=(int)BearingAngle(nodes,&context->fakes,resultsegmentp,result->node);
              else
-                next_bearing_int=(int)BearingAngle(nodes,next_resultsegmentp,next_result->node);
+                next_bearing_int=(int)BearingAngle(nodes,&context->fakes,next_resultsegmentp,next_result->node);
 
              next_bearing   =translation->xml_heading[(4+(22+next_bearing_int)/45)%8];
              next_bearingraw=translation->notxml_heading[(4+(22+next_bearing_int)/45)%8];
@@ -1179,7 +1181,7 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
 
  /* Close the files */
 
- if(!option_file_stdout)
+ if(!context->file_stdout)
    {
     if(htmlfile)
        fclose(htmlfile);
@@ -1193,5 +1195,308 @@ Routino_Output *PrintRoute(Results **results,int nresults,Nodes *nodes,Segments
        fclose(textallfile);
    }
 
+ if(xmlbuffer)
+    free(xmlbuffer);
+
+ return(listhead);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print the nodes that can be reached from a node within a limited distance or duration.
+
+  Routino_Output *PrintIsochrone Returns a linked list of data structures representing the reachable nodes if required.
+
+  Context *context The routing context to use.
+
+  Results *results The set of results from the isochrone search.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Translation *translation The set of translated strings.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Routino_Output *PrintIsochrone(Context *context,Results *results,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile,Translation *translation)
+{
+ FILE *textfile=NULL;
+ Routino_Output *listhead=NULL,*list=NULL;
+ Result **reached,*result;
+ index_t i,j,nreached=0;
+
+ /* Open the file */
+
+ if(context->file_stdout)
+   {
+    if(context->file_text)
+       textfile=stdout;
+   }
+ else if(context->file_text)
+   {
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    const char *open_mode="wb";
+#else
+    const char *open_mode="w";
+#endif
+
+    if(context->quickest==0)
+      {
+       textfile=OpenOutputFile(context,"shortest-isochrone.txt",open_mode);
+
+#ifndef LIBROUTINO
+       if(!textfile)
+          fprintf(stderr,"Warning: Cannot open file 'shortest-isochrone.txt' for writing [%s].\n",strerror(errno));
+#endif
+      }
+    else
+      {
+       textfile=OpenOutputFile(context,"quickest-isochrone.txt",open_mode);
+
+#ifndef LIBROUTINO
+       if(!textfile)
+          fprintf(stderr,"Warning: Cannot open file 'quickest-isochrone.txt' for writing [%s].\n",strerror(errno));
+#endif
+      }
+   }
+
+ /* Keep the best result for each node and sort them by score */
+
+ reached=(Result**)malloc(results->number*sizeof(Result*));
+
+ result=FirstResult(results);
+
+ while(result)
+   {
+    reached[nreached++]=result;
+
+    result->sortby=-1; /* the queue is no longer used so store the other metric here */
+
+    result=NextResult(results,result);
+   }
+
+ qsort(reached,nreached,sizeof(Result*),(int (*)(const void*,const void*))sort_by_node_score);
+
+ for(i=0,j=0;i<nreached;i++)
+    if(i==0 || reached[i]->node!=reached[j-1]->node)
+       reached[j++]=reached[i];
+
+ nreached=j;
+
+ qsort(reached,nreached,sizeof(Result*),(int (*)(const void*,const void*))sort_by_score);
+
+ /* Print the head of the file */
+
+ if(textfile)
+   {
+    if(translation->raw_copyright_creator[0] && translation->raw_copyright_creator[1])
+       fprintf(textfile,"# %s : %s\n",translation->raw_copyright_creator[0],translation->raw_copyright_creator[1]);
+    if(translation->raw_copyright_source[0] && translation->raw_copyright_source[1])
+       fprintf(textfile,"# %s : %s\n",translation->raw_copyright_source[0],translation->raw_copyright_source[1]);
+    if(translation->raw_copyright_license[0] && translation->raw_copyright_license[1])
+       fprintf(textfile,"# %s : %s\n",translation->raw_copyright_license[0],translation->raw_copyright_license[1]);
+    if((translation->raw_copyright_creator[0] && translation->raw_copyright_creator[1]) ||
+       (translation->raw_copyright_source[0]  && translation->raw_copyright_source[1]) ||
+       (translation->raw_copyright_license[0] && translation->raw_copyright_license[1]))
+       fprintf(textfile,"#\n");
+
+    fprintf(textfile,"#Latitude\tLongitude\t    Node\tTotal\tTotal  \n");
+    fprintf(textfile,"#        \t         \t        \tDist \tDurat'n\n");
+                     /* "%10.6f\t%11.6f\t%8d%c\t%5.2f\t%5.1f\n" */
+   }
+
+ /* Loop through all of the reached nodes and print them */
+
+ for(i=0;i<nreached;i++)
+   {
+    Node *resultnodep=NULL;
+    double latitude,longitude;
+    distance_t distance;
+    duration_t duration;
+    score_t other,known=0;
+    Result *r;
+
+    result=reached[i];
+
+    /* Find the other metric (not used for the search) by following the route back to the start */
+
+    for(r=result,other=0;r && r->segment!=NO_SEGMENT && r->sortby<0;r=r->prev)
+       other+=IsochroneSegmentScore(context,segments,ways,profile,r->segment);
+
+    if(r && r->segment!=NO_SEGMENT)
+       known=r->sortby;
+
+    other+=known;
+
+    for(;result!=r;result=result->prev)
+      {
+       result->sortby=other;
+       other-=IsochroneSegmentScore(context,segments,ways,profile,result->segment);
+      }
+
+    result=reached[i];
+
+    if(context->quickest==0)
+      {
+       distance=(distance_t)result->score;
+       duration=(duration_t)(result->segment==NO_SEGMENT?0:result->sortby);
+      }
+    else
+      {
+       distance=(distance_t)(result->segment==NO_SEGMENT?0:result->sortby);
+       duration=(duration_t)result->score;
+      }
+
+    if(IsFakeNode(result->node))
+       GetFakeLatLong(&context->fakes,result->node,&latitude,&longitude);
+    else
+      {
+       resultnodep=LookupNode(nodes,result->node,6);
+
+       GetLatLong(nodes,result->node,&latitude,&longitude);
+      }
+
+    if(textfile)
+       fprintf(textfile,"%10.6f\t%11.6f\t%8d%c\t%5.2f\t%5.1f\n",
+                        radians_to_degrees(latitude),radians_to_degrees(longitude),
+                        IsFakeNode(result->node)?(NODE_FAKE-result->node):result->node,
+                        (resultnodep && IsSuperNode(resultnodep))?'*':' ',
+                        distance_to_km(distance),duration_to_minutes(duration));
+
+    if(context->list_html || context->list_html_all || context->list_text || context->list_text_all)
+      {
+       if(!listhead)
+          listhead=list=calloc(sizeof(Routino_Output),1);
+       else
+         {
+          list->next=calloc(sizeof(Routino_Output),1);
+          list=list->next;
+         }
+
+       list->lon=longitude;
+       list->lat=latitude;
+       list->dist=distance_to_km(distance);
+       list->time=duration_to_minutes(duration);
+       list->type=(result->node==results->start_node)?ROUTINO_POINT_WAYPOINT:ROUTINO_POINT_UNIMPORTANT;
+      }
+   }
+
+ free(reached);
+
+ /* Close the file */
+
+ if(!context->file_stdout && textfile)
+    fclose(textfile);
+
  return(listhead);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance or duration of a segment, whichever was not used by the isochrone search.
+
+  score_t IsochroneSegmentScore Returns the duration (shortest) or distance (quickest).
+
+  Context *context The routing context to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t segment The segment index (may be a fake segment).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static score_t IsochroneSegmentScore(Context *context,Segments *segments,Ways *ways,Profile *profile,index_t segment)
+{
+ Segment *segmentp;
+
+ if(IsFakeSegment(segment))
+    segmentp=LookupFakeSegment(&context->fakes,segment);
+ else
+    segmentp=LookupSegment(segments,segment,1);
+
+ if(context->quickest==0)
+    return((score_t)Duration(segmentp,LookupWay(ways,segmentp->way,1),profile));
+ else
+    return((score_t)DISTANCE(segmentp->distance));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Open one of the output files in the directory selected for the context.
+
+  FILE *OpenOutputFile Returns the opened file or NULL in case of error.
+
+  Context *context The routing context to use.
+
+  const char *name The name of the file.
+
+  const char *mode The mode to open the file with.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static FILE *OpenOutputFile(Context *context,const char *name,const char *mode)
+{
+ FILE *file;
+ char *filename;
+
+ if(!context->dirname)
+    return(fopen(name,mode));
+
+ filename=(char*)malloc(strlen(context->dirname)+1+strlen(name)+1);
+
+ sprintf(filename,"%s/%s",context->dirname,name);
+
+ file=fopen(filename,mode);
+
+ free(filename);
+
+ return(file);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the results by node and then by score.
+
+  int sort_by_node_score Returns the comparison of the node and score fields.
+
+  Result **a The first result.
+
+  Result **b The second result.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_node_score(Result **a,Result **b)
+{
+ if((*a)->node<(*b)->node)
+    return(-1);
+ else if((*a)->node>(*b)->node)
+    return(1);
+
+ return(sort_by_score(a,b));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the results by score.
+
+  int sort_by_score Returns the comparison of the score fields.
+
+  Result **a The first result.
+
+  Result **b The second result.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_score(Result **a,Result **b)
+{
+ if((*a)->score<(*b)->score)
+    return(-1);
+ else if((*a)->score>(*b)->score)
+    return(1);
+ else
+    return(0);
+}
@@ -36,6 +36,8 @@
 #include "waysx.h"
 #include "relationsx.h"
 #include "superx.h"
+#include "hierarchyx.h"
+#include "landmarksx.h"
 #include "prunex.h"
 
 #include "files.h"
@@ -71,16 +73,26 @@ static void print_usage(int detail,const char *argerr,const char *err);
 int main(int argc,char** argv)
 {
  NodesX     *OSMNodes;
- SegmentsX  *OSMSegments,*SuperSegments=NULL,*MergedSegments=NULL;
+ SegmentsX  *OSMSegments,*SuperSegments=NULL,*LevelSegments=NULL,*MergedSegments=NULL;
  WaysX      *OSMWays;
  RelationsX *OSMRelations;
+ ContainerFile container={0};
  int         iteration=0,quit=0;
  int         max_iterations=5;
- char       *dirname=NULL,*prefix=NULL,*tagging=NULL,*errorlog=NULL;
+ char       *dirname=NULL,*prefix=NULL,*superprefix=NULL,*tagging=NULL,*errorlog=NULL;
  int         option_parse_only=0,option_process_only=0;
  int         option_append=0,option_keep=0,option_changes=0;
  int         option_filenames=0;
  int         option_prune_isolated=500,option_prune_short=5,option_prune_straight=3;
+ int         option_super_levels=0;
+ int         option_hierarchy=0,option_landmarks=0;
+ index_t     option_hierarchy_degree=DEFAULT_HIERARCHY_DEGREE;
+ int         option_adjacency=0;
+ int         option_compress=0;
+ int         option_hilbert=0,option_container=0;
+ int         option_snap_index=0;
+ Transport   option_super_transport=Transport_None;
+ transports_t super_transports=Transports_ALL;
  int         arg;
 
  printf_program_start();
@@ -129,6 +141,34 @@ int main(int argc,char** argv)
        option_changes=1;
     else if(!strncmp(argv[arg],"--max-iterations=",17))
        max_iterations=atoi(&argv[arg][17]);
+    else if(!strcmp(argv[arg],"--super-levels"))
+       option_super_levels=1;
+    else if(!strcmp(argv[arg],"--hierarchy"))
+       option_hierarchy=1;
+    else if(!strncmp(argv[arg],"--hierarchy=",12))
+      {
+       option_hierarchy=1;
+       option_hierarchy_degree=atoi(&argv[arg][12]);
+      }
+    else if(!strncmp(argv[arg],"--landmarks=",12))
+       option_landmarks=atoi(&argv[arg][12]);
+    else if(!strcmp(argv[arg],"--adjacency"))
+       option_adjacency=1;
+    else if(!strcmp(argv[arg],"--compress"))
+       option_compress=1;
+    else if(!strcmp(argv[arg],"--hilbert"))
+       option_hilbert=1;
+    else if(!strcmp(argv[arg],"--snap-index"))
+       option_snap_index=1;
+    else if(!strcmp(argv[arg],"--container"))
+       option_container=1;
+    else if(!strncmp(argv[arg],"--super-transport=",18))
+      {
+       option_super_transport=TransportType(&argv[arg][18]);
+
+       if(option_super_transport==Transport_None)
+          print_usage(0,argv[arg],NULL);
+      }
     else if(!strncmp(argv[arg],"--prune",7))
       {
        if(!strcmp(&argv[arg][7],"-none"))
@@ -175,6 +215,22 @@ int main(int argc,char** argv)
  else
     option_filesort_ramsize*=1024*1024;
 
+ if(option_super_transport!=Transport_None)
+   {
+    if(option_container)
+       print_usage(0,NULL,"Cannot use '--super-transport' and '--container' at the same time.");
+
+    /* The files for a specialised super-graph are named after the transport type */
+
+    superprefix=(char*)malloc((prefix?strlen(prefix)+1:0)+strlen(TransportName(option_super_transport))+1);
+
+    sprintf(superprefix,"%s%s%s",prefix?prefix:"",prefix?"-":"",TransportName(option_super_transport));
+
+    super_transports=TRANSPORTS(option_super_transport);
+   }
+ else
+    superprefix=prefix;
+
 #if defined(USE_PTHREADS) && USE_PTHREADS
  if(option_filesort_threads<1 || option_filesort_threads>32)
     print_usage(0,NULL,"Sorting threads '--sort-threads=...' must be small positive integer.");
@@ -383,7 +439,7 @@ if(!option_process_only)
 
  /* Sort the nodes and segments geographically */
 
- SortNodeListGeographically(OSMNodes);
+ SortNodeListGeographically(OSMNodes,option_hilbert);
 
  SortSegmentListGeographically(OSMSegments,OSMNodes);
 
@@ -464,11 +520,11 @@ if(!option_process_only)
       {
        /* Select the super-nodes */
 
-       ChooseSuperNodes(OSMNodes,OSMSegments,OSMWays);
+       ChooseSuperNodes(OSMNodes,OSMSegments,OSMWays,super_transports,option_super_levels);
 
        /* Select the super-segments */
 
-       SuperSegments=CreateSuperSegments(OSMNodes,OSMSegments,OSMWays);
+       SuperSegments=CreateSuperSegments(OSMNodes,OSMSegments,OSMWays,super_transports);
 
        nsuper=OSMSegments->number;
       }
@@ -482,22 +538,36 @@ if(!option_process_only)
 
        /* Select the super-nodes */
 
-       ChooseSuperNodes(OSMNodes,SuperSegments,OSMWays);
+       ChooseSuperNodes(OSMNodes,SuperSegments,OSMWays,super_transports,option_super_levels);
 
        /* Select the super-segments */
 
-       SuperSegments2=CreateSuperSegments(OSMNodes,SuperSegments,OSMWays);
+       SuperSegments2=CreateSuperSegments(OSMNodes,SuperSegments,OSMWays,super_transports);
 
        nsuper=SuperSegments->number;
 
-       FreeSegmentList(SuperSegments);
+       /* Keep the super-segments from the lower levels */
+
+       if(!option_super_levels)
+          FreeSegmentList(SuperSegments);
+       else if(!LevelSegments)
+          LevelSegments=SuperSegments;
+       else
+         {
+          SegmentsX *LevelSegments2=MergeSuperSegmentLevels(LevelSegments,SuperSegments,OSMWays,super_transports);
+
+          FreeSegmentList(LevelSegments);
+          FreeSegmentList(SuperSegments);
+
+          LevelSegments=LevelSegments2;
+         }
 
        SuperSegments=SuperSegments2;
       }
 
     /* Sort the super-segments and remove duplicates */
 
-    DeduplicateSuperSegments(SuperSegments,OSMWays);
+    DeduplicateSuperSegments(SuperSegments,OSMWays,super_transports);
 
     /* Check for end condition */
 
@@ -516,6 +586,18 @@ if(!option_process_only)
  printf("\nCombine Segments and Super-Segments\n===================================\n\n");
  fflush(stdout);
 
+ /* Merge the super-segments from all levels */
+
+ if(LevelSegments)
+   {
+    SegmentsX *LevelSegments2=MergeSuperSegmentLevels(LevelSegments,SuperSegments,OSMWays,super_transports);
+
+    FreeSegmentList(LevelSegments);
+    FreeSegmentList(SuperSegments);
+
+    SuperSegments=LevelSegments2;
+   }
+
  /* Merge the super-segments */
 
  MergedSegments=MergeSuperSegments(OSMSegments,SuperSegments);
@@ -533,7 +615,7 @@ if(!option_process_only)
 
  /* Sort the nodes and segments geographically */
 
- SortNodeListGeographically(OSMNodes);
+ SortNodeListGeographically(OSMNodes,option_hilbert);
 
  SortSegmentListGeographically(OSMSegments,OSMNodes);
 
@@ -541,6 +623,11 @@ if(!option_process_only)
 
  IndexSegments(OSMSegments,OSMNodes,OSMWays);
 
+ /* Index the segments by node for the adjacency array */
+
+ if(option_adjacency)
+    IndexSegmentEdges(OSMSegments,OSMNodes);
+
  /* Sort the turn relations geographically */
 
  SortTurnRelationListGeographically(OSMRelations,OSMNodes,OSMSegments,1);
@@ -550,21 +637,47 @@ if(!option_process_only)
  printf("\nWrite Out Database Files\n========================\n\n");
  fflush(stdout);
 
+ /* Calculate the checksum that links the nodes file to the ways file */
+
+ ChecksumWayList(OSMWays);
+
  /* Write out the nodes */
 
- SaveNodeList(OSMNodes,FileName(dirname,prefix,"nodes.mem"),OSMSegments);
+ SaveNodeList(OSMNodes,FileName(dirname,superprefix,"nodes.mem"),OSMSegments,OSMWays,option_snap_index,option_compress);
 
  /* Write out the segments */
 
- SaveSegmentList(OSMSegments,FileName(dirname,prefix,"segments.mem"));
+ SaveSegmentList(OSMSegments,FileName(dirname,superprefix,"segments.mem"),option_compress);
 
- /* Write out the ways */
+ /* Write out the ways (a specialised super-graph shares them with the general purpose database) */
 
- SaveWayList(OSMWays,FileName(dirname,prefix,"ways.mem"));
+ if(option_super_transport==Transport_None)
+    SaveWayList(OSMWays,FileName(dirname,prefix,"ways.mem"));
 
  /* Write out the relations */
 
- SaveRelationList(OSMRelations,FileName(dirname,prefix,"relations.mem"));
+ SaveRelationList(OSMRelations,FileName(dirname,superprefix,"relations.mem"));
+
+ /* Write out the contraction hierarchy */
+
+ if(option_hierarchy)
+    SaveHierarchy(OSMNodes,OSMSegments,option_hierarchy_degree,FileName(dirname,superprefix,"hierarchy.mem"));
+
+ /* Write out the landmark distances */
+
+ if(option_landmarks>0)
+    SaveLandmarks(OSMNodes,OSMSegments,option_landmarks,FileName(dirname,superprefix,"landmarks.mem"));
+
+ /* Store the statistics for the database container */
+
+ container.nodes        =OSMNodes->number;
+ container.segments     =OSMSegments->number;
+ container.ways         =OSMWays->number;
+ container.turnrelations=OSMRelations->trnumber;
+
+ container.options=(option_compress?CONTAINER_OPTION_COMPRESS:0)|(option_adjacency?CONTAINER_OPTION_ADJACENCY:0)|
+                   (option_hilbert?CONTAINER_OPTION_HILBERT:0)|(option_snap_index?CONTAINER_OPTION_SNAP:0)|
+                   (option_hierarchy?CONTAINER_OPTION_HIERARCHY:0)|(option_landmarks>0?CONTAINER_OPTION_LANDMARKS:0);
 
  /* Free the memory (delete the temporary files) */
 
@@ -595,6 +708,39 @@ if(!option_process_only)
       }
    }
 
+ /* Combine the database files into a single container file */
+
+ if(option_container)
+   {
+    const char *names[CONTAINER_SECTIONS+1];
+    int n=0;
+
+    names[n++]="nodes.mem";
+    names[n++]="segments.mem";
+    names[n++]="ways.mem";
+    names[n++]="relations.mem";
+
+    if(option_hierarchy)
+       names[n++]="hierarchy.mem";
+
+    if(option_landmarks>0)
+       names[n++]="landmarks.mem";
+
+    if(errorlog && option_keep)
+       names[n++]="errorlogs.mem";
+
+    names[n]=NULL;
+
+    printf("\nWrite Database Container\n========================\n\n");
+    fflush(stdout);
+
+    printf_first("Writing Database Container: Sections=%d",n);
+
+    WriteContainer(dirname,prefix,&container,names);
+
+    printf_last("Wrote Database Container: Sections=%d",n);
+   }
+
  /* Free the memory (delete the temporary files) */
 
  FreeNodeList(OSMNodes,0);
@@ -646,7 +792,11 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "                      [--errorlog[=<name>]]\n"
             "                      [--parse-only | --process-only]\n"
             "                      [--append] [--keep] [--changes]\n"
-            "                      [--max-iterations=<number>]\n"
+            "                      [--max-iterations=<number>] [--super-levels]\n"
+            "                      [--hierarchy[=<number>]] [--landmarks=<number>]\n"
+            "                      [--adjacency] [--compress]\n"
+            "                      [--hilbert] [--snap-index] [--container]\n"
+            "                      [--super-transport=<transport>]\n"
             "                      [--prune-none]\n"
             "                      [--prune-isolated=<len>]\n"
             "                      [--prune-short=<len>]\n"
@@ -718,6 +868,33 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "\n"
             "--max-iterations=<number> The number of iterations for finding super-nodes\n"
             "                          (defaults to 5).\n"
+            "--super-levels            Keep the super-nodes from every iteration as levels\n"
+            "                          that routing climbs (faster but not always optimal).\n"
+            "--hierarchy[=<number>]    Create a contraction hierarchy of the super-nodes\n"
+            "                          for faster routing (stored in 'hierarchy.mem'),\n"
+            "                          contracting nodes with up to this many neighbours\n"
+            "                          (defaults to 32).\n"
+            "--landmarks=<number>      Choose this many landmarks and store the distances\n"
+            "                          to and from the super-nodes (in 'landmarks.mem').\n"
+            "--adjacency               Store a copy of the segments for each node together\n"
+            "                          for faster routing (in 'segments.mem').\n"
+            "--compress                Store the nodes and segments in small compressed\n"
+            "                          blocks (in 'nodes.mem' and 'segments.mem').\n"
+            "--hilbert                 Sort the nodes and segments along a Hilbert curve\n"
+            "                          so that nearby data is stored close together.\n"
+            "--snap-index              Store the segments for each node with their position\n"
+            "                          and transport types for finding the closest segment\n"
+            "                          to a waypoint faster (in 'nodes.mem').\n"
+            "--container               Combine the database files into a single file\n"
+            "                          (called 'database.mem').\n"
+            "--super-transport=<transport>\n"
+            "                          Choose the super-nodes and super-segments for only\n"
+            "                          one type of transport and store them in separate\n"
+            "                          files (e.g. 'bicycle-nodes.mem') that the router\n"
+            "                          uses with the existing 'ways.mem' for this transport.\n");
+
+ if(detail==1)
+    fprintf(stderr,
             "\n"
             "--prune-none              Disable the prune options below, they are re-enabled\n"
             "                          by adding them to the command line after this option.\n"
@@ -777,6 +777,9 @@ void FreeXMLProfiles(void)
     if(loaded_profiles[i]->name)
        free(loaded_profiles[i]->name);
 
+    if(loaded_profiles[i]->waycosts)
+       free(loaded_profiles[i]->waycosts);
+
     free(loaded_profiles[i]);
    }
 
@@ -795,6 +798,8 @@ void FreeXMLProfiles(void)
   Profile *profile The profile to be updated.
 
   Ways *ways The set of ways to use.
+
+  The table of way costs is stored in the profile so it is only valid for the same set of ways.
   ++++++++++++++++++++++++++++++++++++++*/
 
 int UpdateProfile(Profile *profile,Ways *ways)
@@ -876,6 +881,18 @@ int UpdateProfile(Profile *profile,Ways *ways)
           profile->max_pref*=profile->props_no[i];
       }
 
+ /* Calculate the cost of travel along each way */
+
+ if(profile->nwaycosts!=ways->file.number)
+   {
+    profile->waycosts=(WayCost*)realloc(profile->waycosts,(ways->file.number?ways->file.number:1)*sizeof(WayCost));
+    profile->nwaycosts=ways->file.number;
+   }
+
+ CalculateWayCosts(ways,profile,profile->waycosts);
+
+ profile->waychecksum=ways->file.checksum;
+
  return(0);
 }
 
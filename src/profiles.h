@@ -28,6 +28,16 @@
 
 /* Data structures */
 
+/*+ A data structure to hold the cost of travel along one way for a profile. +*/
+typedef struct _WayCost
+{
+ score_t      pref;                      /*+ The combined highway and property preference (or zero if the way is not allowed). +*/
+ speed_t      speed;                     /*+ The lower of the way and profile speeds (or zero if neither is set). +*/
+ uint8_t      bothways;                  /*+ Set if the one-way restrictions do not apply to the profile on this way. +*/
+}
+ WayCost;
+
+
 /*+ A data structure to hold a transport type profile. +*/
 typedef struct _Profile
 {
@@ -61,6 +71,10 @@ typedef struct _Profile
 
  score_t      max_pref;                  /*+ The maximum preference for any highway type. +*/
  speed_t      max_speed;                 /*+ The maximum speed for any highway type. +*/
+
+ uint32_t     waychecksum;               /*+ The checksum of the ways that the table of way costs was calculated for. +*/
+ index_t      nwaycosts;                 /*+ The number of ways in the table of way costs. +*/
+ WayCost     *waycosts;                  /*+ The cost of travel along each way of the database (indexed by way). +*/
 }
  Profile;
 
@@ -86,4 +100,13 @@ void PrintProfilesJSON(void);
 void PrintProfilesPerl(void);
 
 
+/* Macros and inline functions */
+
+/*+ Return a WayCost* pointer given a profile and a way index. +*/
+#define LookupWayCost(xxx,yyy)     (&(xxx)->waycosts[yyy])
+
+/*+ Return the duration of travel along a distance given a WayCost* pointer (the same as the Duration() function). +*/
+#define WayCostDuration(xxx,yyy)   ((yyy)->speed?distance_speed_to_duration(xxx,(yyy)->speed):hours_to_duration(10))
+
+
 #endif /* PROFILES_H */
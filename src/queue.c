@@ -27,41 +27,116 @@
 #include "logging.h"
 
 
+/* Constants */
+
+/*+ The number of buckets in a radix heap (one for each bit of the sort key plus one). +*/
+#define RADIX_BUCKETS 33
+
+
+/* Local data types */
+
+/*+ An entry in a 4-ary heap, the sort key is stored with the result to avoid following the pointer. +*/
+typedef struct _QuadEntry
+{
+ score_t  sortby;               /*+ The sort key of the result. +*/
+ Result  *result;               /*+ The result. +*/
+}
+ QuadEntry;
+
+/*+ A bucket of results in a radix heap. +*/
+typedef struct _RadixBucket
+{
+ uint32_t nallocated;           /*+ The number of entries allocated. +*/
+ uint32_t noccupied;            /*+ The number of entries occupied. +*/
+
+ Result **results;              /*+ The unsorted results in the bucket. +*/
+}
+ RadixBucket;
+
+
 /*+ A queue of results. +*/
 struct _Queue
 {
+ QueueType type;                /*+ The type of queue. +*/
+
  uint32_t nincrement;           /*+ The amount to increment the queue when full. +*/
  uint32_t nallocated;           /*+ The number of entries allocated. +*/
  uint32_t noccupied;            /*+ The number of entries occupied. +*/
+ uint32_t npeak;                /*+ The largest number of entries occupied since the queue was reset. +*/
+
+ Result **results;              /*+ The queue of pointers to results (binary heap). +*/
+
+ QuadEntry *entries;            /*+ The queue of sort keys and pointers to results (4-ary heap). +*/
+
+ uint32_t nbelow;               /*+ The number of results with a sort key less than 'last' (radix heap). +*/
+ uint32_t last;                 /*+ The sort key of the most recently removed result (radix heap). +*/
 
- Result **results;              /*+ The queue of pointers to results. +*/
+ RadixBucket buckets[RADIX_BUCKETS]; /*+ The buckets of results grouped by the highest bit that differs from 'last' (radix heap). +*/
 };
 
 
+/* Global variables */
+
+#ifndef LIBROUTINO
+
+/*+ The file to write a trace of the queue operations into (for benchmarking the queue types). +*/
+FILE *option_queue_trace=NULL;
+
+#endif
+
+
+/* Local functions */
+
+static void binary_insert(Queue *queue,Result *result,score_t score);
+static Result *binary_pop(Queue *queue);
+
+static void quad_insert(Queue *queue,Result *result,score_t score);
+static Result *quad_pop(Queue *queue);
+
+static void radix_insert(Queue *queue,Result *result,score_t score);
+static Result *radix_pop(Queue *queue);
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Allocate a new queue.
 
   Queue *NewQueueList Returns the queue.
 
+  QueueType type The type of queue to allocate.
+
   uint8_t log2bins The base 2 logarithm of the initial number of bins in the queue.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Queue *NewQueueList(uint8_t log2bins)
+Queue *NewQueueList(QueueType type,uint8_t log2bins)
 {
  Queue *queue;
 
- queue=(Queue*)malloc(sizeof(Queue));
+ queue=(Queue*)calloc(1,sizeof(Queue));
+
+ queue->type=type;
 
  queue->nincrement=1<<log2bins;
 
  queue->nallocated=queue->nincrement;
  queue->noccupied=0;
+ queue->npeak=0;
+
+ if(queue->type==Queue_Binary)
+   {
+    queue->results=(Result**)malloc(queue->nallocated*sizeof(Result*));
 
- queue->results=(Result**)malloc(queue->nallocated*sizeof(Result*));
+#ifndef LIBROUTINO
+    log_malloc(queue->results,queue->nallocated*sizeof(Result*));
+#endif
+   }
+ else if(queue->type==Queue_Quad)
+   {
+    queue->entries=(QuadEntry*)malloc(queue->nallocated*sizeof(QuadEntry));
 
 #ifndef LIBROUTINO
- log_malloc(queue->results,queue->nallocated*sizeof(Result*));
+    log_malloc(queue->entries,queue->nallocated*sizeof(QuadEntry));
 #endif
+   }
 
  return(queue);
 }
@@ -75,7 +150,24 @@ Queue *NewQueueList(uint8_t log2bins)
 
 void ResetQueueList(Queue *queue)
 {
+#ifndef LIBROUTINO
+ if(option_queue_trace)
+    fprintf(option_queue_trace,"R %p\n",(void*)queue);
+#endif
+
+ if(queue->type==Queue_Radix)
+   {
+    int i;
+
+    for(i=0;i<RADIX_BUCKETS;i++)
+       queue->buckets[i].noccupied=0;
+
+    queue->nbelow=0;
+    queue->last=0;
+   }
+
  queue->noccupied=0;
+ queue->npeak=0;
 }
 
 
@@ -87,18 +179,214 @@ void ResetQueueList(Queue *queue)
 
 void FreeQueueList(Queue *queue)
 {
+ int i;
+
 #ifndef LIBROUTINO
- log_free(queue->results);
+ if(option_queue_trace)
+    fprintf(option_queue_trace,"F %p\n",(void*)queue);
 #endif
 
- free(queue->results);
+ if(queue->results)
+   {
+#ifndef LIBROUTINO
+    log_free(queue->results);
+#endif
+
+    free(queue->results);
+   }
+
+ if(queue->entries)
+   {
+#ifndef LIBROUTINO
+    log_free(queue->entries);
+#endif
+
+    free(queue->entries);
+   }
+
+ for(i=0;i<RADIX_BUCKETS;i++)
+    if(queue->buckets[i].results)
+      {
+#ifndef LIBROUTINO
+       log_free(queue->buckets[i].results);
+#endif
+
+       free(queue->buckets[i].results);
+      }
 
  free(queue);
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Insert a new item into the queue in the right place.
+  Insert a new item into the queue in the right place or move an item that is
+  already in the queue if the score has changed.
+
+  Queue *queue The queue to insert the result into.
+
+  Result *result The result to insert into the queue.
+
+  score_t score The score to use for sorting the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void InsertInQueue(Queue *queue,Result *result,score_t score)
+{
+#ifndef LIBROUTINO
+ if(option_queue_trace)
+    fprintf(option_queue_trace,"I %p %p %.9g\n",(void*)queue,(void*)result,score);
+#endif
+
+ if(queue->type==Queue_Binary)
+    binary_insert(queue,result,score);
+ else if(queue->type==Queue_Quad)
+    quad_insert(queue,result,score);
+ else
+    radix_insert(queue,result,score);
+
+ if(queue->noccupied>queue->npeak)
+    queue->npeak=queue->noccupied;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Pop the item with the lowest score from the front of the queue.
+
+  Result *PopFromQueue Returns the top item (or NULL if the queue is empty).
+
+  Queue *queue The queue to remove the result from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Result *PopFromQueue(Queue *queue)
+{
+ Result *result;
+
+ if(queue->noccupied==0)
+    result=NULL;
+ else if(queue->type==Queue_Binary)
+    result=binary_pop(queue);
+ else if(queue->type==Queue_Quad)
+    result=quad_pop(queue);
+ else
+    result=radix_pop(queue);
+
+#ifndef LIBROUTINO
+ if(option_queue_trace)
+   {
+    if(result)
+       fprintf(option_queue_trace,"P %p %.9g\n",(void*)queue,result->sortby);
+    else
+       fprintf(option_queue_trace,"P %p -\n",(void*)queue);
+   }
+#endif
+
+ return(result);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the type of queue from its name.
+
+  QueueType QueueTypeByName Returns the type of queue or -1 if the name is not recognised.
+
+  const char *name The name of the queue type.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+QueueType QueueTypeByName(const char *name)
+{
+ if(!strcmp(name,"binary"))
+    return(Queue_Binary);
+ if(!strcmp(name,"quad"))
+    return(Queue_Quad);
+ if(!strcmp(name,"radix"))
+    return(Queue_Radix);
+
+ return((QueueType)-1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the name of a type of queue.
+
+  const char *QueueTypeName Returns the name of the queue type.
+
+  QueueType type The type of queue.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+const char *QueueTypeName(QueueType type)
+{
+ switch(type)
+   {
+   case Queue_Binary:
+    return("binary");
+   case Queue_Quad:
+    return("quad");
+   case Queue_Radix:
+    return("radix");
+   }
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get an empty queue, re-using one from the pool if there is one.
+
+  Queue *GetQueueList Returns the queue.
+
+  ResultsPool *pool The pool of queues to use.
+
+  uint8_t log2bins The base 2 logarithm of the initial number of bins if a new queue is allocated.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Queue *GetQueueList(ResultsPool *pool,uint8_t log2bins)
+{
+ while(pool->nqueues>0)
+   {
+    Queue *queue=pool->queues[--pool->nqueues];
+
+    if(queue->type==pool->queue_type)
+      {
+       pool->reused_queues++;
+
+       return(queue);
+      }
+
+    FreeQueueList(queue);
+   }
+
+ pool->new_queues++;
+
+ return(NewQueueList(pool->queue_type,log2bins));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Return a queue to the pool so that it can be re-used (or free it if the pool is full).
+
+  ResultsPool *pool The pool of queues to use.
+
+  Queue *queue The queue that is no longer needed.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void PutQueueList(ResultsPool *pool,Queue *queue)
+{
+ if(queue->npeak>pool->peak_queue)
+    pool->peak_queue=queue->npeak;
+
+ if(pool->nqueues==RESULTS_POOL_SIZE)
+   {
+    FreeQueueList(queue);
+    return;
+   }
+
+ ResetQueueList(queue);
+
+ pool->queues[pool->nqueues++]=queue;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert a new item into a binary heap queue in the right place.
 
   The data is stored in a "Binary Heap" http://en.wikipedia.org/wiki/Binary_heap
   and this operation is adding an item to the heap.
@@ -110,7 +398,7 @@ void FreeQueueList(Queue *queue)
   score_t score The score to use for sorting the node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void InsertInQueue(Queue *queue,Result *result,score_t score)
+static void binary_insert(Queue *queue,Result *result,score_t score)
 {
  uint32_t index;
 
@@ -162,24 +450,21 @@ void InsertInQueue(Queue *queue,Result *result,score_t score)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Pop an item from the front of the queue.
+  Pop an item from the front of a binary heap queue.
 
   The data is stored in a "Binary Heap" http://en.wikipedia.org/wiki/Binary_heap
   and this operation is deleting the root item from the heap.
 
-  Result *PopFromQueue Returns the top item.
+  Result *binary_pop Returns the top item.
 
   Queue *queue The queue to remove the result from.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Result *PopFromQueue(Queue *queue)
+static Result *binary_pop(Queue *queue)
 {
  uint32_t index;
  Result *retval;
 
- if(queue->noccupied==0)
-    return(NULL);
-
  retval=queue->results[1];
  retval->queued=NOT_QUEUED;
 
@@ -236,3 +521,376 @@ Result *PopFromQueue(Queue *queue)
 
  return(retval);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert a new item into a 4-ary heap queue in the right place.
+
+  The data is stored in a "d-ary Heap" https://en.wikipedia.org/wiki/D-ary_heap with
+  four children per node which is shallower than a binary heap and the children of
+  each node are adjacent in memory.  The heap is stored from index 1 so that the
+  children of index i are 4*i-2 to 4*i+1 and the parent of index i is (i+2)/4.
+
+  Queue *queue The queue to insert the result into.
+
+  Result *result The result to insert into the queue.
+
+  score_t score The score to use for sorting the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void quad_insert(Queue *queue,Result *result,score_t score)
+{
+ uint32_t index;
+
+ if(result->queued==NOT_QUEUED)
+   {
+    queue->noccupied++;
+    index=queue->noccupied;
+
+    if(queue->noccupied==queue->nallocated)
+      {
+       queue->nallocated=2*queue->nallocated;
+       queue->entries=(QuadEntry*)realloc((void*)queue->entries,queue->nallocated*sizeof(QuadEntry));
+
+#ifndef LIBROUTINO
+       log_malloc(queue->entries,queue->nallocated*sizeof(QuadEntry));
+#endif
+      }
+   }
+ else
+    index=result->queued;
+
+ result->sortby=score;
+
+ /* Move the parents down until the place for the new value is found */
+
+ while(index>1)
+   {
+    uint32_t parent=(index+2)/4;
+
+    if(score>=queue->entries[parent].sortby)
+       break;
+
+    queue->entries[index]=queue->entries[parent];
+    queue->entries[index].result->queued=index;
+
+    index=parent;
+   }
+
+ queue->entries[index].sortby=score;
+ queue->entries[index].result=result;
+
+ result->queued=index;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Pop an item from the front of a 4-ary heap queue.
+
+  Result *quad_pop Returns the top item.
+
+  Queue *queue The queue to remove the result from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Result *quad_pop(Queue *queue)
+{
+ QuadEntry last;
+ uint32_t index;
+ Result *retval;
+
+ retval=queue->entries[1].result;
+ retval->queued=NOT_QUEUED;
+
+ last=queue->entries[queue->noccupied];
+
+ queue->noccupied--;
+
+ if(queue->noccupied==0)
+    return(retval);
+
+ /* Move the smallest child up until the place for the last value is found */
+
+ index=1;
+
+ while(1)
+   {
+    uint32_t child=4*index-2,newindex,i,end;
+
+    if(child>queue->noccupied)
+       break;
+
+    end=child+3;
+
+    if(end>queue->noccupied)
+       end=queue->noccupied;
+
+    newindex=child;
+
+    for(i=child+1;i<=end;i++)
+       if(queue->entries[i].sortby<queue->entries[newindex].sortby)
+          newindex=i;
+
+    if(last.sortby<=queue->entries[newindex].sortby)
+       break;
+
+    queue->entries[index]=queue->entries[newindex];
+    queue->entries[index].result->queued=index;
+
+    index=newindex;
+   }
+
+ queue->entries[index]=last;
+ queue->entries[index].result->queued=index;
+
+ return(retval);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Convert a score into an integer sort key for a radix heap (scores are never negative
+  and the bit patterns of non-negative floating point numbers sort in the same order).
+
+  uint32_t radix_key Returns the sort key.
+
+  score_t score The score to convert.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline uint32_t radix_key(score_t score)
+{
+ uint32_t key;
+
+ if(score<=0)
+    return(0);
+
+ memcpy(&key,&score,sizeof(key));
+
+ return(key);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the radix heap bucket for a sort key (the highest bit that differs from the last key removed).
+
+  int radix_bucket Returns the bucket number.
+
+  Queue *queue The queue containing the buckets.
+
+  uint32_t key The sort key.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline int radix_bucket(Queue *queue,uint32_t key)
+{
+ uint32_t diff;
+
+ if(key<=queue->last)
+    return(0);
+
+ diff=key^queue->last;
+
+#ifdef __GNUC__
+
+ return(32-__builtin_clz(diff));
+
+#else
+
+ {
+  int bucket=0;
+
+  while(diff)
+    {
+     diff>>=1;
+     bucket++;
+    }
+
+  return(bucket);
+ }
+
+#endif
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a result to a radix heap bucket.
+
+  Queue *queue The queue containing the buckets.
+
+  int bucket The bucket number.
+
+  Result *result The result to add.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline void radix_add(Queue *queue,int bucket,Result *result)
+{
+ RadixBucket *b=&queue->buckets[bucket];
+
+ if(b->noccupied==b->nallocated)
+   {
+#ifndef LIBROUTINO
+    if(b->results)
+       log_free(b->results);
+#endif
+
+    b->nallocated=b->nallocated?2*b->nallocated:queue->nincrement;
+    b->results=(Result**)realloc((void*)b->results,b->nallocated*sizeof(Result*));
+
+#ifndef LIBROUTINO
+    log_malloc(b->results,b->nallocated*sizeof(Result*));
+#endif
+   }
+
+ b->results[b->noccupied++]=result;
+
+ result->queued=b->noccupied;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove a result from a radix heap bucket.
+
+  Queue *queue The queue containing the buckets.
+
+  int bucket The bucket number.
+
+  Result *result The result to remove.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline void radix_remove(Queue *queue,int bucket,Result *result)
+{
+ RadixBucket *b=&queue->buckets[bucket];
+ uint32_t index=result->queued-1;
+
+ b->noccupied--;
+
+ if(index!=b->noccupied)
+   {
+    b->results[index]=b->results[b->noccupied];
+    b->results[index]->queued=index+1;
+   }
+
+ result->queued=NOT_QUEUED;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert a new item into a radix heap queue.
+
+  The data is stored in a "Radix Heap" https://en.wikipedia.org/wiki/Radix_heap where
+  each result is kept in an unsorted bucket chosen by the highest bit of its sort key
+  that differs from the sort key of the last result removed.  Results with a sort key
+  lower than the last one removed (which cannot happen with Dijkstra's algorithm but
+  is allowed here) are kept in the first bucket and searched for when removing.
+
+  Queue *queue The queue to insert the result into.
+
+  Result *result The result to insert into the queue.
+
+  score_t score The score to use for sorting the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void radix_insert(Queue *queue,Result *result,score_t score)
+{
+ uint32_t key;
+
+ if(result->queued!=NOT_QUEUED)
+   {
+    key=radix_key(result->sortby);
+
+    if(key<queue->last)
+       queue->nbelow--;
+
+    radix_remove(queue,radix_bucket(queue,key),result);
+
+    queue->noccupied--;
+   }
+
+ key=radix_key(score);
+
+ if(queue->noccupied==0)
+    queue->last=key;
+ else if(key<queue->last)
+    queue->nbelow++;
+
+ result->sortby=score;
+
+ radix_add(queue,radix_bucket(queue,key),result);
+
+ queue->noccupied++;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Pop an item from the front of a radix heap queue.
+
+  Result *radix_pop Returns the top item.
+
+  Queue *queue The queue to remove the result from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Result *radix_pop(Queue *queue)
+{
+ RadixBucket *b=&queue->buckets[0];
+ Result *retval;
+
+ /* Refill the first bucket from the first non-empty bucket */
+
+ if(b->noccupied==0)
+   {
+    RadixBucket *from;
+    uint32_t i,min;
+    int bucket=1;
+
+    while(queue->buckets[bucket].noccupied==0)
+       bucket++;
+
+    from=&queue->buckets[bucket];
+
+    min=radix_key(from->results[0]->sortby);
+
+    for(i=1;i<from->noccupied;i++)
+      {
+       uint32_t key=radix_key(from->results[i]->sortby);
+
+       if(key<min)
+          min=key;
+      }
+
+    queue->last=min;
+
+    for(i=0;i<from->noccupied;i++)
+       radix_add(queue,radix_bucket(queue,radix_key(from->results[i]->sortby)),from->results[i]);
+
+    from->noccupied=0;
+   }
+
+ /* Remove a result from the first bucket */
+
+ if(queue->nbelow)
+   {
+    uint32_t i,index=0;
+    uint32_t min=radix_key(b->results[0]->sortby);
+
+    for(i=1;i<b->noccupied;i++)
+      {
+       uint32_t key=radix_key(b->results[i]->sortby);
+
+       if(key<min)
+         {
+          min=key;
+          index=i;
+         }
+      }
+
+    retval=b->results[index];
+
+    if(min<queue->last)
+       queue->nbelow--;
+   }
+ else
+    retval=b->results[b->noccupied-1];
+
+ radix_remove(queue,0,retval);
+
+ queue->noccupied--;
+
+ return(retval);
+}
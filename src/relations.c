@@ -35,17 +35,26 @@
   Relations *LoadRelationList Returns the relation list.
 
   const char *filename The name of the file to load.
+
+  int mapoptions The options for loading the file into memory (MAP_OPTION_* values ORed together).
+
+  size_t cachesize The amount of memory to use for all of the caches of the database in slim mode (or 0 for the default sizes).
   ++++++++++++++++++++++++++++++++++++++*/
 
-Relations *LoadRelationList(const char *filename)
+Relations *LoadRelationList(const char *filename,int mapoptions,size_t cachesize)
 {
  Relations *relations;
 
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,RELATIONS_MAGIC))
+    return(NULL);
+
  relations=(Relations*)malloc(sizeof(Relations));
 
 #if !SLIM
 
- relations->data=MapFile(filename);
+ relations->data=MapFileWithOptions(filename,mapoptions);
 
  /* Copy the RelationsFile header structure from the loaded data */
 
@@ -55,9 +64,11 @@ Relations *LoadRelationList(const char *filename)
 
  relations->turnrelations=(TurnRelation*)(relations->data+sizeof(RelationsFile));
 
+ relations->trindex=(TurnRelationIndex*)(relations->data+sizeof(RelationsFile)+relations->file.trnumber*sizeof(TurnRelation));
+
 #else
 
- relations->fd=SlimMapFile(filename);
+ relations->fd=SlimMapFileWithOptions(filename,mapoptions);
 
  /* Copy the RelationsFile header structure from the loaded data */
 
@@ -65,9 +76,25 @@ Relations *LoadRelationList(const char *filename)
 
  relations->troffset=sizeof(RelationsFile);
 
- relations->cache=NewTurnRelationCache();
+ /* Copy the hash table of turn relations since it is searched for every turn restricted node */
+
+ if(relations->file.trindexbins)
+   {
+    size_t sizetrindex=relations->file.trindexbins*sizeof(TurnRelationIndex);
+
+    relations->trindex=(TurnRelationIndex*)malloc(sizetrindex);
 #ifndef LIBROUTINO
- log_malloc(relations->cache,sizeof(*relations->cache));
+    log_malloc(relations->trindex,sizetrindex);
+#endif
+
+    SlimFetch(relations->fd,relations->trindex,sizetrindex,relations->troffset+(offset_t)relations->file.trnumber*sizeof(TurnRelation));
+   }
+ else
+    relations->trindex=NULL;
+
+ relations->cache=NewTurnRelationCache(CacheShare(cachesize,10),option_cache_block);
+#ifndef LIBROUTINO
+ log_malloc(relations->cache,relations->cache->stats.size);
 #endif
 
 #endif
@@ -105,6 +132,14 @@ void DestroyRelationList(Relations *relations)
 
  relations->fd=SlimUnmapFile(relations->fd);
 
+ if(relations->trindex)
+   {
+#ifndef LIBROUTINO
+    log_free(relations->trindex);
+#endif
+    free(relations->trindex);
+   }
+
 #ifndef LIBROUTINO
  log_free(relations->cache);
 #endif
@@ -236,88 +271,40 @@ index_t FindNextTurnRelation1(Relations *relations,index_t current)
 
   Relations *relations The set of relations to use.
 
+  Fakes *fakes The set of fake segments that may be used for the 'from' and 'to' segments.
+
   index_t via The node that the route is going via.
 
   index_t from The segment that the route is coming from.
   ++++++++++++++++++++++++++++++++++++++*/
 
-index_t FindFirstTurnRelation2(Relations *relations,index_t via,index_t from)
+index_t FindFirstTurnRelation2(Relations *relations,Fakes *fakes,index_t via,index_t from)
 {
- TurnRelation *relation;
- index_t start=0;
- index_t end=relations->file.trnumber-1;
- index_t mid;
- index_t match=NO_RELATION;
-
- if(IsFakeSegment(from))
-    from=IndexRealSegment(from);
-
- /* Binary search - search key first match is required.
-  *
-  *  # <- start  |  Check mid and move start or end if it doesn't match
-  *  #           |
-  *  #           |  Since an exact match is wanted we can set end=mid-1
-  *  # <- mid    |  or start=mid+1 because we know that mid doesn't match.
-  *  #           |
-  *  #           |  Eventually either end=start or end=start+1 and one of
-  *  # <- end    |  start or end matches (but may not be the first).
-  */
+ uint32_t bin;
 
- do
-   {
-    mid=(start+end)/2;              /* Choose mid point */
-
-    relation=LookupTurnRelation(relations,mid,1);
+ if(relations->file.trindexbins==0)
+    return(NO_RELATION);
 
-    if(relation->via<via)           /* Mid point is too low for 'via' */
-       start=mid+1;
-    else if(relation->via>via)      /* Mid point is too high for 'via' */
-       end=mid?(mid-1):mid;
-    else                            /* Mid point is correct for 'via' */
-      {
-       if(relation->from<from)      /* Mid point is too low for 'from' */
-          start=mid+1;
-       else if(relation->from>from) /* Mid point is too high for 'from' */
-          end=mid?(mid-1):mid;
-       else                         /* Mid point is correct for 'from' */
-         {
-          match=mid;
-          break;
-         }
-      }
-   }
- while((end-start)>1);
+ if(IsFakeSegment(from))
+    from=IndexRealSegment(fakes,from);
 
- if(match==NO_RELATION)             /* Check if start matches */
-   {
-    relation=LookupTurnRelation(relations,start,1);
+ /* Hash table lookup - the hash table was created by planetsplitter with "Linear Probing"
+    https://en.wikipedia.org/wiki/Linear_probing and is never more than half full. */
 
-    if(relation->via==via && relation->from==from)
-       match=start;
-   }
+ bin=HASH_TURN_RELATION(via,from)&(relations->file.trindexbins-1);
 
- if(match==NO_RELATION)             /* Check if end matches */
+ while(1)
    {
-    relation=LookupTurnRelation(relations,end,1);
+    TurnRelationIndex *entry=&relations->trindex[bin];
 
-    if(relation->via==via && relation->from==from)
-       match=end;
-   }
-
- if(match==NO_RELATION)
-    return(match);
+    if(entry->via==NO_NODE)
+       return(NO_RELATION);
 
- while(match>0)                     /* Search backwards for the first match */
-   {
-    relation=LookupTurnRelation(relations,match-1,1);
+    if(entry->via==via && entry->from==from)
+       return(entry->first);
 
-    if(relation->via==via && relation->from==from)
-       match--;
-    else
-       break;
+    bin=(bin+1)&(relations->file.trindexbins-1);
    }
-
- return(match);
 }
 
 
@@ -362,6 +349,8 @@ index_t FindNextTurnRelation2(Relations *relations,index_t current)
 
   Relations *relations The set of relations to use.
 
+  Fakes *fakes The set of fake segments that may be used for the 'from' and 'to' segments.
+
   index_t index The index of the first turn relation containing 'via' and 'from'.
 
   index_t via The via node.
@@ -373,13 +362,13 @@ index_t FindNextTurnRelation2(Relations *relations,index_t current)
   transports_t transport The type of transport that is being routed.
   ++++++++++++++++++++++++++++++++++++++*/
 
-int IsTurnAllowed(Relations *relations,index_t index,index_t via,index_t from,index_t to,transports_t transport)
+int IsTurnAllowed(Relations *relations,Fakes *fakes,index_t index,index_t via,index_t from,index_t to,transports_t transport)
 {
  if(IsFakeSegment(from))
-    from=IndexRealSegment(from);
+    from=IndexRealSegment(fakes,from);
 
  if(IsFakeSegment(to))
-    to=IndexRealSegment(to);
+    to=IndexRealSegment(fakes,to);
 
  while(index<relations->file.trnumber)
    {
@@ -33,6 +33,12 @@
 #include "profiles.h"
 
 
+/* Constants */
+
+/*+ The hash function for the index of turn relations by via node and from segment. +*/
+#define HASH_TURN_RELATION(via,from) ((uint32_t)((via)*2654435761U)^(uint32_t)(from))
+
+
 /* Data structures */
 
 
@@ -47,10 +53,26 @@ struct _TurnRelation
 };
 
 
+/*+ A structure containing an entry in the hash table of turn relations indexed by via node and from segment. +*/
+typedef struct _TurnRelationIndex
+{
+ index_t      via;              /*+ The node that the path goes via (or NO_NODE for an empty entry). +*/
+ index_t      from;             /*+ The segment that the path comes from. +*/
+
+ index_t      first;            /*+ The first turn relation with this via node and from segment. +*/
+}
+ TurnRelationIndex;
+
+
 /*+ A structure containing the header from the file. +*/
 typedef struct _RelationsFile
 {
+ uint32_t      magic;           /*+ The magic number that identifies the type of file. +*/
+ uint32_t      version;         /*+ The version of the file format. +*/
+
  index_t       trnumber;        /*+ The number of turn relations in total. +*/
+
+ index_t       trindexbins;     /*+ The number of entries in the hash table of turn relations (a power of 2). +*/
 }
  RelationsFile;
 
@@ -66,12 +88,16 @@ struct _Relations
 
  TurnRelation *turnrelations;   /*+ An array of nodes. +*/
 
+ TurnRelationIndex *trindex;    /*+ The hash table of turn relations. +*/
+
 #else
 
  int           fd;              /*+ The file descriptor for the file. +*/
 
  offset_t      troffset;        /*+ The offset of the turn relations in the file. +*/
 
+ TurnRelationIndex *trindex;    /*+ An allocated array with a copy of the hash table of turn relations. +*/
+
  TurnRelation  cached[2];       /*+ Two cached relations read from the file in slim mode. +*/
 
  TurnRelationCache *cache;      /*+ A RAM cache of turn relations read from the file. +*/
@@ -85,17 +111,17 @@ struct _Relations
 
 /* Functions in relations.c */
 
-Relations *LoadRelationList(const char *filename);
+Relations *LoadRelationList(const char *filename,int mapoptions,size_t cachesize);
 
 void DestroyRelationList(Relations *relations);
 
 index_t FindFirstTurnRelation1(Relations *relations,index_t via);
 index_t FindNextTurnRelation1(Relations *relations,index_t current);
 
-index_t FindFirstTurnRelation2(Relations *relations,index_t via,index_t from);
+index_t FindFirstTurnRelation2(Relations *relations,Fakes *fakes,index_t via,index_t from);
 index_t FindNextTurnRelation2(Relations *relations,index_t current);
 
-int IsTurnAllowed(Relations *relations,index_t index,index_t via,index_t from,index_t to,transports_t transport);
+int IsTurnAllowed(Relations *relations,Fakes *fakes,index_t index,index_t via,index_t from,index_t to,transports_t transport);
 
 
 /* Macros and inline functions */
@@ -114,6 +140,7 @@ static inline TurnRelation *LookupTurnRelation(Relations *relations,index_t inde
 CACHE_NEWCACHE_PROTO(TurnRelation)
 CACHE_DELETECACHE_PROTO(TurnRelation)
 CACHE_FETCHCACHE_PROTO(TurnRelation)
+CACHE_CHOOSEVICTIM_PROTO(TurnRelation)
 CACHE_INVALIDATECACHE_PROTO(TurnRelation)
 
 /* Data type */
@@ -125,6 +152,7 @@ CACHE_STRUCTURE(TurnRelation)
 CACHE_NEWCACHE(TurnRelation)
 CACHE_DELETECACHE(TurnRelation)
 CACHE_FETCHCACHE(TurnRelation)
+CACHE_CHOOSEVICTIM(TurnRelation)
 CACHE_INVALIDATECACHE(TurnRelation)
 
 
@@ -1405,14 +1405,39 @@ static int sort_by_via(TurnRelX *a,TurnRelX *b)
 
 void SaveRelationList(RelationsX* relationsx,const char *filename)
 {
- index_t i;
+ index_t i,prevvia=NO_NODE,prevfrom=NO_SEGMENT;
+ uint32_t nbins=0;
  int fd;
  RelationsFile relationsfile={0};
+ TurnRelationIndex *trindex=NULL;
 
  /* Print the start message */
 
  printf_first("Writing Relations: Turn Relations=0");
 
+ /* Allocate the memory for the hash table (never more than half full) */
+
+ if(relationsx->trnumber>0)
+   {
+    nbins=1;
+
+    while(nbins<2*relationsx->trnumber)
+       nbins<<=1;
+
+    trindex=(TurnRelationIndex*)malloc(nbins*sizeof(TurnRelationIndex));
+
+    logassert(trindex,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+    log_malloc(trindex,nbins*sizeof(TurnRelationIndex));
+
+    for(i=0;i<nbins;i++)
+      {
+       trindex[i].via=NO_NODE;
+       trindex[i].from=NO_SEGMENT;
+       trindex[i].first=NO_RELATION;
+      }
+   }
+
  /* Re-open the file read-only */
 
  relationsx->trfd=ReOpenFileBuffered(relationsx->trfilename_tmp);
@@ -1437,13 +1462,39 @@ void SaveRelationList(RelationsX* relationsx,const char *filename)
 
     WriteFileBuffered(fd,&relation,sizeof(TurnRelation));
 
+    /* Add the first relation for each via node and from segment to the hash table (they are sorted) */
+
+    if(i==0 || relation.via!=prevvia || relation.from!=prevfrom)
+      {
+       uint32_t bin=HASH_TURN_RELATION(relation.via,relation.from)&(nbins-1);
+
+       while(trindex[bin].via!=NO_NODE)
+          bin=(bin+1)&(nbins-1);
+
+       trindex[bin].via=relation.via;
+       trindex[bin].from=relation.from;
+       trindex[bin].first=i;
+
+       prevvia=relation.via;
+       prevfrom=relation.from;
+      }
+
     if(!((i+1)%1000))
        printf_middle("Writing Relations: Turn Relations=%"Pindex_t,i+1);
    }
 
+ /* Write out the hash table */
+
+ if(trindex)
+    WriteFileBuffered(fd,trindex,nbins*sizeof(TurnRelationIndex));
+
  /* Write out the header structure */
 
+ relationsfile.magic=RELATIONS_MAGIC;
+ relationsfile.version=DATABASE_VERSION;
+
  relationsfile.trnumber=relationsx->trnumber;
+ relationsfile.trindexbins=nbins;
 
  SeekFileBuffered(fd,0);
  WriteFileBuffered(fd,&relationsfile,sizeof(RelationsFile));
@@ -1454,6 +1505,13 @@ void SaveRelationList(RelationsX* relationsx,const char *filename)
 
  relationsx->trfd=CloseFileBuffered(relationsx->trfd);
 
+ if(trindex)
+   {
+    log_free(trindex);
+
+    free(trindex);
+   }
+
  /* Print the final message */
 
  printf_last("Wrote Relations: Turn Relations=%"Pindex_t,relationsx->trnumber);
@@ -30,6 +30,20 @@
 
 #define HASH_NODE_SEGMENT(node,segment) ((node)^(segment<<4))
 
+/*+ The packed hash table key for a node and segment. +*/
+#define PACK_NODE_SEGMENT(node,segment) (((uint64_t)(node)<<32)|(uint64_t)(segment))
+
+/*+ The hash table key for an empty bin (the node of a result is never NO_NODE). +*/
+#define NO_KEY PACK_NODE_SEGMENT(NO_NODE,NO_SEGMENT)
+
+/*+ Select the result with a particular index from the data array. +*/
+#define RESULT_FROM_INDEX(results,n) (&(results)->data[(n)>>(results)->log2data2][(n)&((results)->ndata2-1)])
+
+
+/* Local functions */
+
+static void allocate_bins(Results *results);
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Allocate a new results list.
@@ -50,15 +64,13 @@ Results *NewResultsList(uint8_t log2bins)
 
  results->number=0;
 
- results->point=(Result**)calloc(results->nbins,sizeof(Result*));
-
-#ifndef LIBROUTINO
- log_malloc(results->point,results->nbins*sizeof(Result*));
-#endif
+ allocate_bins(results);
 
  results->ndata1=0;
  results->nallocdata1=0;
- results->ndata2=results->nbins>>2;
+ results->lastdata1=0;
+ results->log2data2=log2bins-2;
+ results->ndata2=1<<results->log2data2;
 
  results->data=NULL;
 
@@ -76,26 +88,47 @@ Results *NewResultsList(uint8_t log2bins)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Allocate a new results list.
+  Reset a results list so that it can be re-used (keeping the allocated memory).
 
   Results *results The results list to be reset.
   ++++++++++++++++++++++++++++++++++++++*/
 
 void ResetResultsList(Results *results)
 {
- uint32_t i;
+ if(results->number<(results->nbins>>3))
+   {
+    uint32_t n;
+
+    /* Empty only the occupied bins by removing the results in the reverse order to insertion;
+       the probe sequence for each result only passes over bins that were occupied by results
+       inserted before it (this is also true after the hash table has been enlarged). */
+
+    for(n=results->number;n>0;n--)
+      {
+       Result *result=RESULT_FROM_INDEX(results,n-1);
+       uint64_t key=PACK_NODE_SEGMENT(result->node,result->segment);
+       uint32_t bin=HASH_NODE_SEGMENT(result->node,result->segment)&results->mask;
+
+       while(results->keys[bin]!=key)
+          bin=(bin+1)&results->mask;
+
+       results->keys[bin]=NO_KEY;
+      }
+   }
+ else
+    memset(results->keys,0xff,results->nbins*sizeof(uint64_t));
 
  results->number=0;
  results->ndata1=0;
 
- for(i=0;i<results->nbins;i++)
-    results->point[i]=NULL;
-
  results->start_node=NO_NODE;
  results->prev_segment=NO_SEGMENT;
 
  results->finish_node=NO_NODE;
  results->last_segment=NO_SEGMENT;
+
+ results->start_waypoint=NO_WAYPOINT;
+ results->finish_waypoint=NO_WAYPOINT;
 }
 
 
@@ -120,14 +153,36 @@ void FreeResultsList(Results *results)
  free(results->data);
 
 #ifndef LIBROUTINO
- log_free(results->point);
+ log_free(results->keys);
+ log_free(results->index);
 #endif
- free(results->point);
+ free(results->keys);
+ free(results->index);
 
  free(results);
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Allocate the (empty) hash table for a results list.
+
+  Results *results The results list whose hash table is to be allocated.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void allocate_bins(Results *results)
+{
+ results->keys=(uint64_t*)malloc(results->nbins*sizeof(uint64_t));
+ results->index=(uint32_t*)malloc(results->nbins*sizeof(uint32_t));
+
+#ifndef LIBROUTINO
+ log_malloc(results->keys,results->nbins*sizeof(uint64_t));
+ log_malloc(results->index,results->nbins*sizeof(uint32_t));
+#endif
+
+ memset(results->keys,0xff,results->nbins*sizeof(uint64_t));
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Insert a single entry into the hashed list.
 
@@ -136,28 +191,22 @@ void FreeResultsList(Results *results)
 
   Results *results The results structure to insert into.
 
-  Result *result The result to insert.
+  uint32_t n The index of the result in the data array.
 
   index_t node The node that is to be inserted into the results.
 
   index_t segment The segment that is to be inserted into the results.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static inline void insert_result(Results *results,Result *result,index_t node,index_t segment)
+static inline void insert_result(Results *results,uint32_t n,index_t node,index_t segment)
 {
  uint32_t bin=HASH_NODE_SEGMENT(node,segment)&results->mask;
 
- while(1)
-   {
-    Result *r=results->point[bin];
+ while(results->keys[bin]!=NO_KEY)
+    bin=(bin+1)&results->mask;
 
-    if(!r)
-       break;
-
-    bin=(bin+1)%results->nbins;
-   }
-
- results->point[bin]=result;
+ results->keys[bin]=PACK_NODE_SEGMENT(node,segment);
+ results->index[bin]=n;
 }
 
 
@@ -184,28 +233,23 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
     uint32_t n;
 
 #ifndef LIBROUTINO
-    log_free(results->point);
+    log_free(results->keys);
+    log_free(results->index);
 #endif
 
-    free(results->point);
+    free(results->keys);
+    free(results->index);
 
     results->nbins<<=1;
     results->mask=results->nbins-1;
 
-    results->point=(Result**)calloc(results->nbins,sizeof(Result*));
-
-#ifndef LIBROUTINO
-    log_malloc(results->point,results->nbins*sizeof(Result*));
-#endif
+    allocate_bins(results);
 
     for(n=0;n<results->number;n++)
       {
-       uint32_t i=n/results->ndata2;
-       uint32_t j=n%results->ndata2;
-
-       result=&results->data[i][j];
+       result=RESULT_FROM_INDEX(results,n);
 
-       insert_result(results,result,result->node,result->segment);
+       insert_result(results,n,result->node,result->segment);
       }
    }
 
@@ -228,9 +272,9 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
 
  /* Insert the new entry */
 
- result=&results->data[results->ndata1-1][results->number%results->ndata2];
+ result=RESULT_FROM_INDEX(results,results->number);
 
- insert_result(results,result,node,segment);
+ insert_result(results,results->number,node,segment);
 
  results->number++;
 
@@ -239,14 +283,14 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
  result->node=node;
  result->segment=segment;
 
- result->prev=NULL;
- result->next=NULL;
-
  result->score=0;
  result->sortby=0;
 
  result->queued=NOT_QUEUED;
 
+ result->prev=NULL;
+ result->next=NULL;
+
  return(result);
 }
 
@@ -255,7 +299,8 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
   Find a result; search by node and segment.
 
   The data is stored in a hash table with "Linear Probing" https://en.wikipedia.org/wiki/Linear_probing
-  for handling collisions and this operation is finding an item in the hash table.
+  for handling collisions and this operation is finding an item in the hash table.  The keys are
+  stored in the hash table so only the result that matches is accessed.
 
   Result *FindResult Returns the result that has been found.
 
@@ -268,19 +313,20 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
 
 Result *FindResult(Results *results,index_t node,index_t segment)
 {
+ uint64_t key=PACK_NODE_SEGMENT(node,segment);
  uint32_t bin=HASH_NODE_SEGMENT(node,segment)&results->mask;
 
  while(1)
    {
-    Result *r=results->point[bin];
+    uint64_t k=results->keys[bin];
 
-    if(!r)
-       break;
+    if(k==key)
+       return(RESULT_FROM_INDEX(results,results->index[bin]));
 
-    if(r->segment==segment && r->node==node)
-       return(r);
+    if(k==NO_KEY)
+       break;
 
-    bin=(bin+1)%results->nbins;
+    bin=(bin+1)&results->mask;
    }
 
  return(NULL);
@@ -290,13 +336,16 @@ Result *FindResult(Results *results,index_t node,index_t segment)
 /*++++++++++++++++++++++++++++++++++++++
   Find the first result from a set of results.
 
-  Result *FirstResult Returns the first result.
+  Result *FirstResult Returns the first result (or NULL if there are none).
 
   Results *results The set of results.
   ++++++++++++++++++++++++++++++++++++++*/
 
 Result *FirstResult(Results *results)
 {
+ if(results->number==0)
+    return(NULL);
+
  return(&results->data[0][0]);
 }
 
@@ -313,17 +362,22 @@ Result *FirstResult(Results *results)
 
 Result *NextResult(Results *results,Result *result)
 {
- uint32_t i;
+ uint32_t i=results->lastdata1;
  size_t j=0;
 
- for(i=0;i<results->ndata1;i++)
-    if(result>=results->data[i])
-      {
-       j=result-results->data[i];
+ /* Check the array that contained the last result first then search all of them */
 
-       if(j<results->ndata2)
-          break;
-      }
+ if(i<results->ndata1 && result>=results->data[i] && (size_t)(result-results->data[i])<results->ndata2)
+    j=result-results->data[i];
+ else
+    for(i=0;i<results->ndata1;i++)
+       if(result>=results->data[i])
+         {
+          j=result-results->data[i];
+
+          if(j<results->ndata2)
+             break;
+         }
 
  if(++j>=results->ndata2)
    {i++;j=0;}
@@ -331,5 +385,76 @@ Result *NextResult(Results *results,Result *result)
  if((i*results->ndata2+j)>=results->number)
     return(NULL);
 
+ results->lastdata1=i;
+
  return(&results->data[i][j]);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get an empty results list, re-using one from the pool if there is one.
+
+  Results *GetResultsList Returns the results list.
+
+  ResultsPool *pool The pool of results lists to use.
+
+  uint8_t log2bins The base 2 logarithm of the initial number of bins if a new results list is allocated.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Results *GetResultsList(ResultsPool *pool,uint8_t log2bins)
+{
+ if(pool->nresults>0)
+   {
+    pool->reused_results++;
+
+    return(pool->results[--pool->nresults]);
+   }
+
+ pool->new_results++;
+
+ return(NewResultsList(log2bins));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Return a results list to the pool so that it can be re-used (or free it if the pool is full).
+
+  ResultsPool *pool The pool of results lists to use.
+
+  Results *results The results list that is no longer needed.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void PutResultsList(ResultsPool *pool,Results *results)
+{
+ if(results->number>pool->peak_results)
+    pool->peak_results=results->number;
+
+ if(results->nbins>pool->peak_bins)
+    pool->peak_bins=results->nbins;
+
+ if(pool->nresults==RESULTS_POOL_SIZE)
+   {
+    FreeResultsList(results);
+    return;
+   }
+
+ ResetResultsList(results);
+
+ pool->results[pool->nresults++]=results;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Free all of the results lists and queues in a pool.
+
+  ResultsPool *pool The pool to be emptied.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void FreeResultsPool(ResultsPool *pool)
+{
+ while(pool->nresults>0)
+    FreeResultsList(pool->results[--pool->nresults]);
+
+ while(pool->nqueues>0)
+    FreeQueueList(pool->queues[--pool->nqueues]);
+}
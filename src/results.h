@@ -23,6 +23,7 @@
 #ifndef RESULTS_H
 #define RESULTS_H    /*+ To stop multiple inclusions. +*/
 
+#include <stdio.h>
 #include <stdint.h>
 
 #include "types.h"
@@ -36,24 +37,44 @@
 /*+ A result is not currently queued. +*/
 #define NOT_QUEUED ((uint32_t)0)
 
+/*+ The maximum number of results lists and queues that are kept in a pool for re-use. +*/
+#define RESULTS_POOL_SIZE 8
+
+/*+ The type of queue to use unless another is selected at run time. +*/
+#ifndef QUEUE_TYPE_DEFAULT
+#define QUEUE_TYPE_DEFAULT Queue_Binary
+#endif
+
+
+/* Enumerated types */
+
+/*+ The types of priority queue that can be used for routing. +*/
+typedef enum _QueueType
+ {
+  Queue_Binary = 0,             /*+ A binary heap of pointers to the results. +*/
+  Queue_Quad   = 1,             /*+ A 4-ary heap storing the sort keys with the pointers. +*/
+  Queue_Radix  = 2              /*+ A radix heap (fastest when the sort keys removed from the queue increase). +*/
+ }
+ QueueType;
+
 
 /* Data structures */
 
 typedef struct _Result Result;
 
-/*+ The result for a node. +*/
+/*+ The result for a node (the fields used while searching are kept together before the path pointers). +*/
 struct _Result
 {
  index_t   node;                /*+ The node for which this result applies. +*/
  index_t   segment;             /*+ The segmemt used to get to the node for which this result applies. +*/
 
- Result   *prev;                /*+ The previous result following the best path to get to this node via the segment. +*/
- Result   *next;                /*+ The next result following the best path from this node that was reached via the segment. +*/
-
  score_t   score;               /*+ The best actual weighted distance or duration score from the start to the node. +*/
  score_t   sortby;              /*+ The best possible weighted distance or duration score from the start to the finish. +*/
 
  uint32_t  queued;              /*+ The position of this result in the queue. +*/
+
+ Result   *prev;                /*+ The previous result following the best path to get to this node via the segment. +*/
+ Result   *next;                /*+ The next result following the best path from this node that was reached via the segment. +*/
 };
 
 /*+ A list of results. +*/
@@ -64,13 +85,19 @@ typedef struct _Results
 
  uint32_t  number;              /*+ The total number of occupied results. +*/
 
- Result  **point;               /*+ An array of nbins pointers to results in the data array. +*/
+ uint64_t *keys;                /*+ An array of nbins packed node and segment keys (so that probing
+                                    the hash table does not need to look at the results). +*/
+ uint32_t *index;               /*+ An array of nbins indexes of the results in the data array. +*/
 
  uint32_t  ndata1;              /*+ The size of the first dimension of the 'data' array. +*/
  uint32_t  ndata2;              /*+ The size of the second dimension of the 'data' array. +*/
+ uint8_t   log2data2;           /*+ The base 2 logarithm of the size of the second dimension of the 'data' array. +*/
 
  uint32_t  nallocdata1;         /*+ The amount of allocated space in the first dimension of the 'data' array. +*/
 
+ uint32_t  lastdata1;           /*+ The first dimension index of the result returned by the last call to
+                                    NextResult() (checked first since results are normally iterated in order). +*/
+
  Result  **data;                /*+ An array of arrays containing the actual results, the first
                                     dimension is reallocated but the second dimension is not.
                                     Most importantly pointers into the real data don't change
@@ -93,6 +120,29 @@ typedef struct _Results
 typedef struct _Queue Queue;
 
 
+/*+ A pool of results lists and queues that are kept (with their allocated memory) for re-use. +*/
+typedef struct _ResultsPool
+{
+ int       nresults;            /*+ The number of results lists in the pool. +*/
+ Results  *results[RESULTS_POOL_SIZE]; /*+ The results lists that can be re-used. +*/
+
+ QueueType queue_type;          /*+ The type of queue to allocate. +*/
+
+ int       nqueues;             /*+ The number of queues in the pool. +*/
+ Queue    *queues[RESULTS_POOL_SIZE]; /*+ The queues that can be re-used. +*/
+
+ uint32_t  new_results;         /*+ The number of results lists that have been allocated. +*/
+ uint32_t  reused_results;      /*+ The number of results lists that have been re-used from the pool. +*/
+ uint32_t  new_queues;          /*+ The number of queues that have been allocated. +*/
+ uint32_t  reused_queues;       /*+ The number of queues that have been re-used from the pool. +*/
+
+ uint32_t  peak_results;        /*+ The largest number of results in any results list returned to the pool. +*/
+ uint32_t  peak_bins;           /*+ The largest number of hash table bins in any results list returned to the pool. +*/
+ uint32_t  peak_queue;          /*+ The largest number of results in any queue returned to the pool. +*/
+}
+ ResultsPool;
+
+
 /* Results functions in results.c */
 
 Results *NewResultsList(uint8_t log2bins);
@@ -106,15 +156,35 @@ Result *FindResult(Results *results,index_t node,index_t segment);
 Result *FirstResult(Results *results);
 Result *NextResult(Results *results,Result *result);
 
+Results *GetResultsList(ResultsPool *pool,uint8_t log2bins);
+void PutResultsList(ResultsPool *pool,Results *results);
+
+void FreeResultsPool(ResultsPool *pool);
+
 
 /* Queue functions in queue.c */
 
-Queue *NewQueueList(uint8_t log2bins);
+Queue *NewQueueList(QueueType type,uint8_t log2bins);
 void ResetQueueList(Queue *queue);
 void FreeQueueList(Queue *queue);
 
+Queue *GetQueueList(ResultsPool *pool,uint8_t log2bins);
+void PutQueueList(ResultsPool *pool,Queue *queue);
+
 void InsertInQueue(Queue *queue,Result *result,score_t score);
 Result *PopFromQueue(Queue *queue);
 
+QueueType QueueTypeByName(const char *name);
+const char *QueueTypeName(QueueType type);
+
+
+/* Variables in queue.c */
+
+#ifndef LIBROUTINO
+
+extern FILE *option_queue_trace;
+
+#endif
+
 
 #endif /* RESULTS_H */
@@ -64,7 +64,8 @@ int main(int argc,char** argv)
  char                *profiles=NULL,*profilename="motorcar";
  char                *translations=NULL,*language="en";
  int                  reverse=0,loop=0;
- int                  quickest=0;
+ int                  quickest=0,bidirectional=0;
+ double               isochrone=0;
  int                  html=0,gpx_track=0,gpx_route=0,text=0,text_all=0,none=0,use_stdout=0;
  int                  list_html=0,list_html_all=0,list_text=0,list_text_all=0;
  int                  arg;
@@ -144,6 +145,15 @@ int main(int argc,char** argv)
        quickest=0;
     else if(!strcmp(argv[arg],"--quickest"))
        quickest=1;
+    else if(!strcmp(argv[arg],"--bidirectional"))
+       bidirectional=1;
+    else if(!strncmp(argv[arg],"--isochrone=",12))
+      {
+       isochrone=atof(&argv[arg][12]);
+
+       if(isochrone<=0)
+          print_usage(0,argv[arg],NULL);
+      }
     else if(!strncmp(argv[arg],"--lon",5) && isdigit(argv[arg][5]))
       {
        int point;
@@ -333,7 +343,15 @@ int main(int argc,char** argv)
     else if(point_used[waypoint]==3)
        nwaypoints++;
 
- if(first_waypoint>=last_waypoint)
+ if(isochrone>0)
+   {
+    if(first_waypoint!=last_waypoint)
+      {
+       fprintf(stderr,"Error: Exactly one waypoint must be specified with '--isochrone'.\n");
+       exit(EXIT_FAILURE);
+      }
+   }
+ else if(first_waypoint>=last_waypoint)
    {
     fprintf(stderr,"Error: At least two waypoints must be specified.\n");
     exit(EXIT_FAILURE);
@@ -345,6 +363,15 @@ int main(int argc,char** argv)
 
  database=Routino_LoadDatabase(dirname,prefix);
 
+ if(!database)
+   {
+    if(Routino_errno==ROUTINO_ERROR_DATABASE_VERSION)
+       fprintf(stderr,"Error: The database was created by a different version of planetsplitter; regenerate the database.\n");
+    else
+       fprintf(stderr,"Error: Cannot load the database (%d).\n",Routino_errno);
+    exit(EXIT_FAILURE);
+   }
+
  /* Check the profile is valid for use with this database */
 
  if(Routino_ValidateProfile(database,profile)!=ROUTINO_ERROR_NONE)
@@ -382,6 +409,9 @@ int main(int argc,char** argv)
  else
     routing_options|=ROUTINO_ROUTE_SHORTEST;
 
+ if(bidirectional)
+    routing_options|=ROUTINO_ROUTE_BIDIRECTIONAL;
+
  if(html     ) routing_options|=ROUTINO_ROUTE_FILE_HTML;
  if(gpx_track) routing_options|=ROUTINO_ROUTE_FILE_GPX_TRACK;
  if(gpx_route) routing_options|=ROUTINO_ROUTE_FILE_GPX_ROUTE;
@@ -396,7 +426,15 @@ int main(int argc,char** argv)
  if(reverse) routing_options|=ROUTINO_ROUTE_REVERSE;
  if(loop)    routing_options|=ROUTINO_ROUTE_LOOP;
 
- route=Routino_CalculateRoute(database,profile,translation,waypoints,nwaypoints,routing_options,NULL);
+ if(isochrone>0)
+   {
+    routing_options&=ROUTINO_ROUTE_QUICKEST|ROUTINO_ROUTE_FILE_TEXT|ROUTINO_ROUTE_FILE_STDOUT|
+                     ROUTINO_ROUTE_LIST_HTML|ROUTINO_ROUTE_LIST_HTML_ALL|ROUTINO_ROUTE_LIST_TEXT|ROUTINO_ROUTE_LIST_TEXT_ALL;
+
+    route=Routino_CalculateIsochrone(database,profile,translation,waypoints[0],isochrone,routing_options,NULL);
+   }
+ else
+    route=Routino_CalculateRoute(database,profile,translation,waypoints,nwaypoints,routing_options,NULL);
 
  if(Routino_errno>=ROUTINO_ERROR_NO_ROUTE_1)
    {
@@ -431,6 +469,12 @@ int main(int argc,char** argv)
 
        printf("Point type: %d\n",list->type);
 
+       if(isochrone>0)
+         {
+          list=list->next;
+          continue;
+         }
+
        if((list_html || list_html_all || list_text) && !first && !last)
           printf("Turn: %d degrees\n",list->turn);
 
@@ -531,7 +575,8 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "              [--list-html | --list-html-all |\n"
             "               --list-text | --list-text-all]\n"
             "              [--profile=<name>]\n"
-            "              [--shortest | --quickest]\n"
+            "              [--shortest | --quickest] [--bidirectional]\n"
+            "              [--isochrone=<limit>]\n"
             "              --lon1=<longitude> --lat1=<latitude>\n"
             "              --lon2=<longitude> --lon2=<latitude>\n"
             "              [ ... --lon99=<longitude> --lon99=<latitude>]\n"
@@ -586,6 +631,10 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "\n"
             "--shortest              Find the shortest route between the waypoints.\n"
             "--quickest              Find the quickest route between the waypoints.\n"
+            "--bidirectional         Search from both ends of the route at the same time.\n"
+            "--isochrone=<limit>     Find all points that can be reached from a single\n"
+            "                        waypoint within the limit (km for '--shortest' or\n"
+            "                        minutes for '--quickest') instead of a route.\n"
             "\n"
             "--lon<n>=<longitude>    Specify the longitude of the n'th waypoint.\n"
             "--lat<n>=<latitude>     Specify the latitude of the n'th waypoint.\n"
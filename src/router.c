@@ -32,11 +32,15 @@
 #include "segments.h"
 #include "ways.h"
 #include "relations.h"
+#include "hierarchy.h"
+#include "landmarks.h"
 
 #include "files.h"
 #include "logging.h"
 #include "functions.h"
+#include "context.h"
 #include "fakes.h"
+#include "matcher.h"
 #include "translations.h"
 #include "profiles.h"
 
@@ -44,6 +48,9 @@
 /*+ The maximum distance from the specified point to search for a node or segment (in km). +*/
 #define MAXSEARCH  1
 
+/*+ The maximum number of options on one line of a batch file. +*/
+#define MAXBATCHOPTIONS  (2*NWAYPOINTS+8)
+
 
 /* Global variables */
 
@@ -51,15 +58,38 @@
 int option_quiet=0;
 
 /*+ The option to calculate the quickest route insted of the shortest. +*/
-extern int option_quickest;
+int option_quickest=0;
+
+/*+ The option to search for normal routes in both directions at once. +*/
+int option_bidirectional=0;
 
 /*+ The options to select the format of the file output. +*/
-extern int option_file_html,option_file_gpx_track,option_file_gpx_route,option_file_text,option_file_text_all,option_file_stdout;
+int option_file_html=0,option_file_gpx_track=0,option_file_gpx_route=0,option_file_text=0,option_file_text_all=0,option_file_stdout=0;
 int option_file_none=0;
 
+/*+ The options for the caches of each database in slim mode (in files.c). +*/
+extern size_t option_cache_block;
+extern int    option_cache_readahead;
+
 
 /* Local functions */
 
+static int RouteBatch(FILE *file,Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,
+                      Profile *profile,int exactnodes,int reverse,int loop,double heading,int geometry);
+static const char *route_batch_line(char **options,int noptions,Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,
+                                    Profile *profile,int exactnodes,int reverse,int loop,double heading,int geometry,const char *id);
+static char *read_batch_line(FILE *file,char **buffer,size_t *length);
+
+static int MatchFile(FILE *file,Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,
+                     Profile *profile,double accuracy,int geometry);
+static void matched_lat_long(Nodes *nodes,MatchedPoint *matched,double *lat,double *lon);
+
+static void print_pool_statistics(FILE *file,ResultsPool *pool);
+#if SLIM
+static void print_cache_statistics(FILE *file,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations);
+static void print_one_cache_statistics(FILE *file,const char *name,CacheStatistics *stats);
+#endif
+
 static void print_usage(int detail,const char *argerr,const char *err);
 
 
@@ -73,22 +103,32 @@ int main(int argc,char** argv)
  Segments    *OSMSegments;
  Ways        *OSMWays;
  Relations   *OSMRelations;
+ Hierarchy   *OSMHierarchy=NULL;
+ Landmarks   *OSMLandmarks=NULL;
+ Context     *context;
  Results     *results[NWAYPOINTS+1]={NULL};
  int          point_used[NWAYPOINTS+1]={0};
  double       point_lon[NWAYPOINTS+1],point_lat[NWAYPOINTS+1];
  index_t      point_node[NWAYPOINTS+1]={NO_NODE};
- double       heading=-999;
+ double       heading=-999,isochrone=0;
  int          help_profile=0,help_profile_xml=0,help_profile_json=0,help_profile_pl=0;
- char        *dirname=NULL,*prefix=NULL;
+ char        *dirname=NULL,*prefix=NULL,*superprefix=NULL;
  char        *profiles=NULL,*profilename=NULL;
  char        *translations=NULL,*language=NULL;
- int          exactnodes=0,reverse=0,loop=0;
+ char        *batch=NULL,*match=NULL,*queuetrace=NULL;
+ double       accuracy=10;
+ int          match_geometry=0;
+ QueueType    queuetype=QUEUE_TYPE_DEFAULT;
+ size_t       cachesize=0;
+ int          mapoptions=0;
+ int          exactnodes=0,reverse=0,loop=0,hierarchy=0,landmarks=0,geometry=0;
  Transport    transport=Transport_None;
  Profile     *profile=NULL;
  Translation *translation=NULL;
  index_t      start_node,finish_node=NO_NODE;
  index_t      join_segment=NO_SEGMENT;
  int          arg,nresults=0;
+ int          container;
  waypoint_t   start_waypoint,finish_waypoint=NO_WAYPOINT;
  waypoint_t   first_waypoint=NWAYPOINTS,last_waypoint=1,waypoint;
  int          inc_dec_waypoint=1;
@@ -126,6 +166,43 @@ int main(int argc,char** argv)
        translations=&argv[arg][15];
     else if(!strcmp(argv[arg],"--exact-nodes-only"))
        exactnodes=1;
+    else if(!strncmp(argv[arg],"--batch=",8))
+      { batch=&argv[arg][8]; option_quiet=1; }
+    else if(!strcmp(argv[arg],"--batch-geometry"))
+       geometry=1;
+    else if(!strncmp(argv[arg],"--match=",8))
+      { match=&argv[arg][8]; option_quiet=1; }
+    else if(!strncmp(argv[arg],"--match-accuracy=",17))
+      {
+       accuracy=atof(&argv[arg][17]);
+
+       if(accuracy<=0)
+          print_usage(0,argv[arg],NULL);
+      }
+    else if(!strcmp(argv[arg],"--match-geometry"))
+       match_geometry=1;
+    else if(!strncmp(argv[arg],"--queue=",8))
+      {
+       queuetype=QueueTypeByName(&argv[arg][8]);
+
+       if(queuetype==(QueueType)-1)
+          print_usage(0,argv[arg],NULL);
+      }
+    else if(!strncmp(argv[arg],"--queue-trace=",14))
+       queuetrace=&argv[arg][14];
+    else if(!strncmp(argv[arg],"--cache-size=",13))
+       cachesize=(size_t)atoi(&argv[arg][13])*1024*1024;
+    else if(!strncmp(argv[arg],"--cache-block=",14))
+       option_cache_block=(size_t)atoi(&argv[arg][14])*1024;
+    else if(!strcmp(argv[arg],"--cache-readahead"))
+       option_cache_readahead=1;
+    else if(!strncmp(argv[arg],"--mmap=",7))
+      {
+       mapoptions=MapOptionsByName(&argv[arg][7]);
+
+       if(mapoptions<0)
+          print_usage(0,argv[arg],NULL);
+      }
     else if(!strncmp(argv[arg],"--reverse",9))
       {
        if(argv[arg][9]=='=')
@@ -170,6 +247,19 @@ int main(int argc,char** argv)
        option_quickest=0;
     else if(!strcmp(argv[arg],"--quickest"))
        option_quickest=1;
+    else if(!strcmp(argv[arg],"--bidirectional"))
+       option_bidirectional=1;
+    else if(!strcmp(argv[arg],"--hierarchy"))
+       hierarchy=1;
+    else if(!strcmp(argv[arg],"--landmarks"))
+       landmarks=1;
+    else if(!strncmp(argv[arg],"--isochrone=",12))
+      {
+       isochrone=atof(&argv[arg][12]);
+
+       if(isochrone<=0)
+          print_usage(0,argv[arg],NULL);
+      }
     else if(!strncmp(argv[arg],"--lon",5) && isdigit(argv[arg][5]))
       {
        int point;
@@ -244,6 +334,43 @@ int main(int argc,char** argv)
     exit(EXIT_FAILURE);
    }
 
+ if(batch)
+   {
+    if(isochrone>0)
+       print_usage(0,NULL,"The '--isochrone' option cannot be used with '--batch'.");
+
+    if(option_file_stdout)
+       print_usage(0,NULL,"The '--output-stdout' option cannot be used with '--batch'.");
+
+    if(first_waypoint<=last_waypoint)
+       print_usage(0,NULL,"Waypoints cannot be specified on the command line with '--batch'.");
+
+    option_file_none=1;
+    option_file_html=option_file_gpx_track=option_file_gpx_route=option_file_text=option_file_text_all=0;
+   }
+ else if(geometry)
+    print_usage(0,NULL,"The '--batch-geometry' option requires '--batch'.");
+
+ if(match)
+   {
+    if(batch)
+       print_usage(0,NULL,"The '--batch' option cannot be used with '--match'.");
+
+    if(isochrone>0)
+       print_usage(0,NULL,"The '--isochrone' option cannot be used with '--match'.");
+
+    if(option_file_stdout)
+       print_usage(0,NULL,"The '--output-stdout' option cannot be used with '--match'.");
+
+    if(first_waypoint<=last_waypoint)
+       print_usage(0,NULL,"Waypoints cannot be specified on the command line with '--match'.");
+
+    option_file_none=1;
+    option_file_html=option_file_gpx_track=option_file_gpx_route=option_file_text=option_file_text_all=0;
+   }
+ else if(match_geometry)
+    print_usage(0,NULL,"The '--match-geometry' option requires '--match'.");
+
  if(option_file_html==0 && option_file_gpx_track==0 && option_file_gpx_route==0 && option_file_text==0 && option_file_text_all==0 && option_file_none==0)
     option_file_html=option_file_gpx_track=option_file_gpx_route=option_file_text=option_file_text_all=1;
 
@@ -493,7 +620,15 @@ int main(int argc,char** argv)
     if(point_used[waypoint]==1 || point_used[waypoint]==2)
        print_usage(0,NULL,"All waypoints must have latitude and longitude.");
 
- if(first_waypoint>=last_waypoint)
+ if(isochrone>0)
+   {
+    if(first_waypoint!=last_waypoint)
+       print_usage(0,NULL,"Exactly one waypoint must be specified with '--isochrone'.");
+
+    if(loop)
+       print_usage(0,NULL,"The '--loop' option cannot be used with '--isochrone'.");
+   }
+ else if(!batch && !match && first_waypoint>=last_waypoint)
     print_usage(0,NULL,"At least two waypoints must be specified.");
 
  /* Load in the data - Note: No error checking because Load*List() will call exit() in case of an error. */
@@ -501,16 +636,49 @@ int main(int argc,char** argv)
  if(!option_quiet)
     printf_first("Loading Files:");
 
- OSMNodes=LoadNodeList(FileName(dirname,prefix,"nodes.mem"));
+ container=OpenContainer(dirname,prefix);
+
+ /* Use the super-graph specialised for the transport type if planetsplitter created one */
+
+ superprefix=(char*)malloc((prefix?strlen(prefix)+1:0)+strlen(TransportName(profile->transport))+1);
+
+ sprintf(superprefix,"%s%s%s",prefix?prefix:"",prefix?"-":"",TransportName(profile->transport));
+
+ if(!ExistsFile(FileName(dirname,superprefix,"nodes.mem")))
+   {
+    free(superprefix);
+    superprefix=NULL;
+   }
+
+ OSMNodes=LoadNodeList(FileName(dirname,superprefix?superprefix:prefix,"nodes.mem"),mapoptions,cachesize);
+
+ OSMSegments=LoadSegmentList(FileName(dirname,superprefix?superprefix:prefix,"segments.mem"),mapoptions,cachesize);
 
- OSMSegments=LoadSegmentList(FileName(dirname,prefix,"segments.mem"));
+ OSMWays=LoadWayList(FileName(dirname,prefix,"ways.mem"),mapoptions,cachesize);
 
- OSMWays=LoadWayList(FileName(dirname,prefix,"ways.mem"));
+ OSMRelations=LoadRelationList(FileName(dirname,superprefix?superprefix:prefix,"relations.mem"),mapoptions,cachesize);
 
- OSMRelations=LoadRelationList(FileName(dirname,prefix,"relations.mem"));
+ if(hierarchy)
+    OSMHierarchy=LoadHierarchy(FileName(dirname,superprefix?superprefix:prefix,"hierarchy.mem"),mapoptions);
+
+ if(landmarks)
+    OSMLandmarks=LoadLandmarks(FileName(dirname,superprefix?superprefix:prefix,"landmarks.mem"),mapoptions);
+
+ if(container>=0)
+    CloseContainer(container);
 
  if(!option_quiet)
-    printf_last("Loaded Files: nodes, segments, ways & relations");
+    printf_last("Loaded Files: nodes, segments, ways & relations%s%s%s%s",hierarchy?" & hierarchy":"",landmarks?" & landmarks":"",
+                superprefix?" for ":"",superprefix?TransportName(profile->transport):"");
+
+ /* Check the nodes (which may be specialised for the transport type) were created with the same ways */
+
+ if(OSMNodes->file.waychecksum!=OSMWays->file.checksum)
+   {
+    fprintf(stderr,"Error: The nodes file%s%s was not created with the same ways as the ways file; regenerate the database with planetsplitter.\n",
+                   superprefix?" for ":"",superprefix?TransportName(profile->transport):"");
+    exit(EXIT_FAILURE);
+   }
 
  /* Check the profile is valid for use with this database */
 
@@ -520,6 +688,95 @@ int main(int argc,char** argv)
     exit(EXIT_FAILURE);
    }
 
+ /* Open the file for the trace of the queue operations */
+
+ if(queuetrace)
+   {
+    option_queue_trace=fopen(queuetrace,"w");
+
+    if(!option_queue_trace)
+      {
+       fprintf(stderr,"Error: Cannot open file '%s' for writing the queue trace.\n",queuetrace);
+       exit(EXIT_FAILURE);
+      }
+   }
+
+ /* Create the routing context */
+
+ context=NewContext(OSMHierarchy);
+
+ context->quickest=option_quickest;
+ context->bidirectional=option_bidirectional;
+
+ context->pool.queue_type=queuetype;
+
+ context->file_html=option_file_html;
+ context->file_gpx_track=option_file_gpx_track;
+ context->file_gpx_route=option_file_gpx_route;
+ context->file_text=option_file_text;
+ context->file_text_all=option_file_text_all;
+ context->file_stdout=option_file_stdout;
+
+ /* Calculate the routes from the batch file or match the trace file (there are no waypoints to find below) */
+
+ if(batch || match)
+   {
+    const char *filename=batch?batch:match;
+    FILE *file;
+    int failed;
+
+    if(!strcmp(filename,"-"))
+       file=stdin;
+    else
+       file=fopen(filename,"r");
+
+    if(!file)
+      {
+       fprintf(stderr,"Error: Cannot open %s file '%s' for reading.\n",batch?"batch":"trace",filename);
+       exit(EXIT_FAILURE);
+      }
+
+    if(batch)
+       failed=RouteBatch(file,context,OSMNodes,OSMSegments,OSMWays,OSMRelations,OSMLandmarks,profile,exactnodes,reverse,loop,heading,geometry);
+    else
+       failed=!MatchFile(file,context,OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,accuracy,match_geometry);
+
+    if(file!=stdin)
+       fclose(file);
+
+    if(option_queue_trace)
+       fclose(option_queue_trace);
+
+    if(option_logmemory)
+      {
+       print_pool_statistics(stderr,&context->pool);
+#if SLIM
+       print_cache_statistics(stderr,OSMNodes,OSMSegments,OSMWays,OSMRelations);
+#endif
+      }
+
+#ifdef DEBUG_MEMORY_LEAK
+
+    FreeContext(context);
+
+    DestroyNodeList(OSMNodes);
+    DestroySegmentList(OSMSegments);
+    DestroyWayList(OSMWays);
+    DestroyRelationList(OSMRelations);
+
+    if(OSMHierarchy)
+       DestroyHierarchy(OSMHierarchy);
+
+    if(OSMLandmarks)
+       DestroyLandmarks(OSMLandmarks);
+
+    FreeXMLProfiles();
+
+#endif
+
+    exit(failed?EXIT_FAILURE:EXIT_SUCCESS);
+   }
+
  /* Find all waypoints */
 
  for(waypoint=first_waypoint;waypoint<=last_waypoint;waypoint++)
@@ -546,7 +803,7 @@ int main(int argc,char** argv)
        segment=FindClosestSegment(OSMNodes,OSMSegments,OSMWays,point_lat[waypoint],point_lon[waypoint],distmax,profile,&distmin,&node1,&node2,&dist1,&dist2);
 
        if(segment!=NO_SEGMENT)
-          node=CreateFakes(OSMNodes,OSMSegments,waypoint,LookupSegment(OSMSegments,segment,1),node1,node2,dist1,dist2);
+          node=CreateFakes(&context->fakes,OSMNodes,OSMSegments,waypoint,LookupSegment(OSMSegments,segment,1),node1,node2,dist1,dist2);
       }
 
     if(!option_quiet)
@@ -563,9 +820,9 @@ int main(int argc,char** argv)
        double lat,lon;
 
        if(IsFakeNode(node))
-          GetFakeLatLong(node,&lat,&lon);
+          GetFakeLatLong(&context->fakes,node,&lat,&lon);
        else
-          GetLatLong(OSMNodes,node,NULL,&lat,&lon);
+          GetLatLong(OSMNodes,node,&lat,&lon);
 
        if(IsFakeNode(node))
           printf("Waypoint %d is segment %"Pindex_t" (node %"Pindex_t" -> %"Pindex_t"): %3.6f %4.6f = %2.3f km\n",waypoint,segment,node1,node2,
@@ -578,6 +835,25 @@ int main(int argc,char** argv)
     point_node[waypoint]=node;
    }
 
+ /* Find the nodes that can be reached from the waypoint (there are no routes to calculate below) */
+
+ if(isochrone>0)
+   {
+    score_t limit;
+
+    if(option_quickest==0)
+       limit=(score_t)km_to_distance(isochrone);
+    else
+       limit=(score_t)minutes_to_duration(isochrone);
+
+    if(!option_quiet)
+       printf("Finding isochrone from waypoint %d\n",first_waypoint);
+
+    results[nresults]=CalculateIsochrone(context,OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,point_node[first_waypoint],limit);
+
+    nresults++;
+   }
+
  /* Check for reverse direction */
 
  if(reverse)
@@ -615,14 +891,14 @@ int main(int argc,char** argv)
        continue;
 
     if(heading!=-999 && join_segment==NO_SEGMENT)
-       join_segment=FindClosestSegmentHeading(OSMNodes,OSMSegments,OSMWays,start_node,heading,profile);
+       join_segment=FindClosestSegmentHeading(OSMNodes,OSMSegments,OSMWays,&context->fakes,start_node,heading,profile);
 
     /* Calculate the route */
 
     if(!option_quiet)
        printf("Routing from waypoint %d to waypoint %d\n",start_waypoint,finish_waypoint);
 
-    results[nresults]=CalculateRoute(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
+    results[nresults]=CalculateRoute(context,OSMNodes,OSMSegments,OSMWays,OSMRelations,OSMLandmarks,profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
 
     if(!results[nresults])
        exit(EXIT_FAILURE);
@@ -645,7 +921,7 @@ int main(int argc,char** argv)
     if(!option_quiet)
        printf("Routing from waypoint %d to waypoint %d\n",start_waypoint,finish_waypoint);
 
-    results[nresults]=CalculateRoute(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
+    results[nresults]=CalculateRoute(context,OSMNodes,OSMSegments,OSMWays,OSMRelations,OSMLandmarks,profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
 
     if(!results[nresults])
        exit(EXIT_FAILURE);
@@ -656,6 +932,15 @@ int main(int argc,char** argv)
  if(!option_quiet)
    {
     printf("Routed OK\n");
+
+    if(option_logmemory)
+      {
+       print_pool_statistics(stdout,&context->pool);
+#if SLIM
+       print_cache_statistics(stdout,OSMNodes,OSMSegments,OSMWays,OSMRelations);
+#endif
+      }
+
     fflush(stdout);
    }
 
@@ -665,11 +950,19 @@ int main(int argc,char** argv)
     printf_first("Generating Result Outputs");
 
  if(!option_file_none)
-    PrintRoute(results,nresults,OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,translation);
+   {
+    if(isochrone>0)
+       PrintIsochrone(context,results[0],OSMNodes,OSMSegments,OSMWays,profile,translation);
+    else
+       PrintRoute(context,results,nresults,OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,translation);
+   }
 
  if(!option_quiet)
     printf_last("Generated Result Outputs");
 
+ if(option_queue_trace)
+    fclose(option_queue_trace);
+
  /* Destroy the remaining results lists and data structures */
 
 #ifdef DEBUG_MEMORY_LEAK
@@ -677,11 +970,19 @@ int main(int argc,char** argv)
  for(waypoint=0;waypoint<nresults;waypoint++)
     FreeResultsList(results[waypoint]);
 
+ FreeContext(context);
+
  DestroyNodeList(OSMNodes);
  DestroySegmentList(OSMSegments);
  DestroyWayList(OSMWays);
  DestroyRelationList(OSMRelations);
 
+ if(OSMHierarchy)
+    DestroyHierarchy(OSMHierarchy);
+
+ if(OSMLandmarks)
+    DestroyLandmarks(OSMLandmarks);
+
  FreeXMLProfiles();
 
  FreeXMLTranslations();
@@ -695,6 +996,699 @@ int main(int argc,char** argv)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the routes for all of the queries in a batch file and write one record for each to stdout.
+
+  int RouteBatch Returns the number of queries that failed.
+
+  FILE *file The file to read the queries from (one per line).
+
+  Context *context The routing context to use (re-used for each query).
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Landmarks *landmarks The set of landmarks to use (or NULL).
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int exactnodes Set to true to only route between nodes.
+
+  int reverse The default for the '--reverse' option in each query.
+
+  int loop The default for the '--loop' option in each query.
+
+  double heading The default for the '--heading' option in each query (or -999 for none).
+
+  int geometry Set to true to include the route points in each record.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int RouteBatch(FILE *file,Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,
+                      Profile *profile,int exactnodes,int reverse,int loop,double heading,int geometry)
+{
+ char *buffer=NULL,*line;
+ size_t length=0;
+ int lineno=0,failed=0;
+ int quickest=context->quickest;
+
+ while((line=read_batch_line(file,&buffer,&length)))
+   {
+    char *options[MAXBATCHOPTIONS];
+    int noptions=0,option;
+    char idstring[16],*id=idstring;
+    const char *error=NULL;
+
+    lineno++;
+
+    /* Split the line into options */
+
+    while(*line)
+      {
+       while(isspace(*line))
+          line++;
+
+       if(!*line || (noptions==0 && *line=='#'))
+          break;
+
+       if(noptions==MAXBATCHOPTIONS)
+         {
+          error="Too many options.";
+          break;
+         }
+
+       options[noptions++]=line;
+
+       while(*line && !isspace(*line))
+          line++;
+
+       if(*line)
+          *line++=0;
+      }
+
+    if(noptions==0 && !error)
+       continue;
+
+    /* Find the query identifier (the line number if not specified) */
+
+    sprintf(idstring,"%d",lineno);
+
+    for(option=0;option<noptions;option++)
+       if(!strncmp(options[option],"--id=",5))
+          id=&options[option][5];
+
+    /* Calculate the route */
+
+    context->quickest=quickest;
+
+    if(!error)
+       error=route_batch_line(options,noptions,context,nodes,segments,ways,relations,landmarks,profile,exactnodes,reverse,loop,heading,geometry,id);
+
+    if(error)
+      {
+       printf("%s\tERROR\t%s\n",id,error);
+       failed++;
+      }
+
+    fflush(stdout);
+   }
+
+ if(buffer)
+    free(buffer);
+
+ return(failed);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the route for a single query from a batch file and print the record if successful.
+
+  const char *route_batch_line Returns an error message or NULL if the route was calculated.
+
+  char **options The options that make up the query.
+
+  int noptions The number of options in the query.
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Landmarks *landmarks The set of landmarks to use (or NULL).
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int exactnodes Set to true to only route between nodes.
+
+  int reverse The default for the '--reverse' option.
+
+  int loop The default for the '--loop' option.
+
+  double heading The default for the '--heading' option (or -999 for none).
+
+  int geometry Set to true to include the route points in the record.
+
+  const char *id The identifier for the query.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static const char *route_batch_line(char **options,int noptions,Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Landmarks *landmarks,
+                                    Profile *profile,int exactnodes,int reverse,int loop,double heading,int geometry,const char *id)
+{
+ Results     *results[NWAYPOINTS+1]={NULL};
+ int          point_used[NWAYPOINTS+1]={0};
+ double       point_lon[NWAYPOINTS+1],point_lat[NWAYPOINTS+1];
+ index_t      point_node[NWAYPOINTS+1]={NO_NODE};
+ index_t      start_node,finish_node=NO_NODE;
+ index_t      join_segment=NO_SEGMENT;
+ waypoint_t   start_waypoint,finish_waypoint=NO_WAYPOINT;
+ waypoint_t   first_waypoint=NWAYPOINTS,last_waypoint=1,waypoint;
+ int          inc_dec_waypoint=1;
+ int          option,nresults=0,npoints=0,i;
+ distance_t   distance=0;
+ duration_t   duration=0;
+ const char  *error=NULL;
+
+ /* Parse the options */
+
+ for(option=0;option<noptions;option++)
+   {
+    char *opt=options[option];
+
+    if(!strncmp(opt,"--id=",5))
+       ;
+    else if(!strcmp(opt,"--shortest"))
+       context->quickest=0;
+    else if(!strcmp(opt,"--quickest"))
+       context->quickest=1;
+    else if(!strncmp(opt,"--reverse",9) && (opt[9]==0 || opt[9]=='='))
+       reverse=opt[9]?atoi(&opt[10]):1;
+    else if(!strncmp(opt,"--loop",6) && (opt[6]==0 || opt[6]=='='))
+       loop=opt[6]?atoi(&opt[7]):1;
+    else if(!strncmp(opt,"--heading=",10))
+      {
+       double h=atof(&opt[10]);
+
+       if(h<-360 || h>360)
+          return("Invalid heading.");
+
+       heading=h;
+
+       if(heading<0) heading+=360;
+      }
+    else if((!strncmp(opt,"--lon",5) || !strncmp(opt,"--lat",5)) && isdigit(opt[5]))
+      {
+       int point,islat=(opt[3]=='a');
+       char *p=&opt[6];
+
+       while(isdigit(*p)) p++;
+       if(*p++!='=')
+          return("Invalid waypoint option.");
+
+       point=atoi(&opt[5]);
+       if(point>NWAYPOINTS || point_used[point]&(islat?2:1))
+          return("Invalid waypoint option.");
+
+       if(islat)
+          point_lat[point]=degrees_to_radians(atof(p));
+       else
+          point_lon[point]=degrees_to_radians(atof(p));
+
+       point_used[point]+=islat?2:1;
+
+       if(point<first_waypoint)
+          first_waypoint=point;
+       if(point>last_waypoint)
+          last_waypoint=point;
+      }
+    else
+       return("Unrecognised option.");
+   }
+
+ /* Check the waypoints are valid */
+
+ for(waypoint=1;waypoint<=NWAYPOINTS;waypoint++)
+    if(point_used[waypoint]==1 || point_used[waypoint]==2)
+       return("All waypoints must have latitude and longitude.");
+
+ if(first_waypoint>=last_waypoint)
+    return("At least two waypoints must be specified.");
+
+ /* Find all waypoints (discarding the fake nodes from the previous query) */
+
+ DeleteFakeNodes(&context->fakes);
+
+ for(waypoint=first_waypoint;waypoint<=last_waypoint;waypoint++)
+   {
+    distance_t distmax=km_to_distance(MAXSEARCH);
+    distance_t distmin;
+    index_t node=NO_NODE;
+
+    if(point_used[waypoint]!=3)
+       continue;
+
+    if(exactnodes)
+       node=FindClosestNode(nodes,segments,ways,point_lat[waypoint],point_lon[waypoint],distmax,profile,&distmin);
+    else
+      {
+       distance_t dist1,dist2;
+       index_t segment,node1,node2;
+
+       segment=FindClosestSegment(nodes,segments,ways,point_lat[waypoint],point_lon[waypoint],distmax,profile,&distmin,&node1,&node2,&dist1,&dist2);
+
+       if(segment!=NO_SEGMENT)
+          node=CreateFakes(&context->fakes,nodes,segments,waypoint,LookupSegment(segments,segment,1),node1,node2,dist1,dist2);
+      }
+
+    if(node==NO_NODE)
+       return("Cannot find node close to specified point.");
+
+    point_node[waypoint]=node;
+   }
+
+ /* Check for reverse direction */
+
+ if(reverse)
+   {
+    waypoint_t temp;
+
+    temp=first_waypoint;
+    first_waypoint=last_waypoint;
+    last_waypoint=temp;
+
+    inc_dec_waypoint=-1;
+   }
+
+ /* Loop through all pairs of waypoints */
+
+ if(loop && reverse)
+   {
+    finish_node=point_node[last_waypoint];
+
+    finish_waypoint=last_waypoint;
+   }
+
+ for(waypoint=first_waypoint;waypoint!=(last_waypoint+inc_dec_waypoint);waypoint+=inc_dec_waypoint)
+   {
+    if(point_used[waypoint]!=3)
+       continue;
+
+    start_node=finish_node;
+    finish_node=point_node[waypoint];
+
+    start_waypoint=finish_waypoint;
+    finish_waypoint=waypoint;
+
+    if(start_node==NO_NODE)
+       continue;
+
+    if(heading!=-999 && join_segment==NO_SEGMENT)
+       join_segment=FindClosestSegmentHeading(nodes,segments,ways,&context->fakes,start_node,heading,profile);
+
+    results[nresults]=CalculateRoute(context,nodes,segments,ways,relations,landmarks,profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
+
+    if(!results[nresults])
+      {
+       error="Cannot find route compatible with profile.";
+       goto free_results;
+      }
+
+    join_segment=results[nresults]->last_segment;
+
+    nresults++;
+   }
+
+ if(loop && !reverse)
+   {
+    start_node=finish_node;
+    finish_node=point_node[first_waypoint];
+
+    start_waypoint=finish_waypoint;
+    finish_waypoint=first_waypoint;
+
+    results[nresults]=CalculateRoute(context,nodes,segments,ways,relations,landmarks,profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
+
+    if(!results[nresults])
+      {
+       error="Cannot find route compatible with profile.";
+       goto free_results;
+      }
+
+    nresults++;
+   }
+
+ /* Print the record */
+
+ for(i=0;i<nresults;i++)
+   {
+    distance_t d;
+    duration_t t;
+
+    CalculateRouteTotals(context,results[i],segments,ways,profile,&d,&t);
+
+    distance+=d;
+    duration+=t;
+   }
+
+ printf("%s\tOK\t%.3f\t%.1f",id,distance_to_km(distance),duration_to_minutes(duration));
+
+ if(geometry)
+   {
+    printf("\tLINESTRING(");
+
+    for(i=0;i<nresults;i++)
+      {
+       Result *result=FindResult(results[i],results[i]->start_node,results[i]->prev_segment);
+
+       if(i>0)
+          result=result->next;
+
+       for(;result;result=result->next)
+         {
+          double lat,lon;
+
+          if(IsFakeNode(result->node))
+             GetFakeLatLong(&context->fakes,result->node,&lat,&lon);
+          else
+             GetLatLong(nodes,result->node,&lat,&lon);
+
+          printf("%s%.6f %.6f",npoints++?",":"",radians_to_degrees(lon),radians_to_degrees(lat));
+         }
+      }
+
+    printf(")");
+   }
+
+ printf("\n");
+
+ /* Free the results */
+
+ free_results:
+
+ for(i=0;i<nresults;i++)
+    PutResultsList(&context->pool,results[i]);
+
+ return(error);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Match all of the points of a GPS trace in a file to the highways and write one record for each to stdout.
+
+  int MatchFile Returns the number of points that were matched.
+
+  FILE *file The file to read the trace from (one longitude and latitude per line).
+
+  Context *context The routing context to use.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  double accuracy The accuracy of the points in the trace (in metres).
+
+  int geometry Set to true to include the route from the previous matched point in each record.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int MatchFile(FILE *file,Context *context,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,
+                     Profile *profile,double accuracy,int geometry)
+{
+ char *buffer=NULL,*line;
+ size_t length=0;
+ double *latitudes=NULL,*longitudes=NULL;
+ int *linenos=NULL;
+ int lineno=0,npoints=0,nallocated=0,nmatched=0,i,prev=-1;
+ MatchedPoint *matched;
+
+ /* Read in the trace */
+
+ while((line=read_batch_line(file,&buffer,&length)))
+   {
+    double lon,lat;
+    char *end;
+
+    lineno++;
+
+    while(isspace(*line))
+       line++;
+
+    if(!*line || *line=='#')
+       continue;
+
+    lon=strtod(line,&end);
+
+    line=end;
+    while(isspace(*line) || *line==',')
+       line++;
+
+    lat=strtod(line,&end);
+
+    if(end==line)
+      {
+       printf("%d\tERROR\tInvalid point.\n",lineno);
+       continue;
+      }
+
+    if(npoints==nallocated)
+      {
+       nallocated+=1024;
+
+       latitudes =(double*)realloc(latitudes ,nallocated*sizeof(double));
+       longitudes=(double*)realloc(longitudes,nallocated*sizeof(double));
+       linenos   =(int*)   realloc(linenos   ,nallocated*sizeof(int));
+      }
+
+    latitudes [npoints]=degrees_to_radians(lat);
+    longitudes[npoints]=degrees_to_radians(lon);
+    linenos   [npoints]=lineno;
+
+    npoints++;
+   }
+
+ if(buffer)
+    free(buffer);
+
+ if(npoints==0)
+    return(0);
+
+ /* Match the trace */
+
+ matched=(MatchedPoint*)malloc(npoints*sizeof(MatchedPoint));
+
+ nmatched=MatchTrace(context,nodes,segments,ways,relations,profile,npoints,latitudes,longitudes,(distance_t)km_to_distance(accuracy/1000),matched);
+
+ /* Print the records */
+
+ for(i=0;i<npoints;i++)
+   {
+    double lat,lon;
+
+    if(matched[i].segment==NO_SEGMENT)
+      {
+       printf("%d\tERROR\tCannot match point to highway compatible with profile.\n",linenos[i]);
+       continue;
+      }
+
+    matched_lat_long(nodes,&matched[i],&lat,&lon);
+
+    printf("%d\tOK\t%.6f %.6f\t%.1f",linenos[i],radians_to_degrees(lon),radians_to_degrees(lat),distance_to_km(matched[i].error)*1000);
+
+    if(matched[i].route==INF_DISTANCE)
+       printf("\t-");
+    else
+       printf("\t%.3f",distance_to_km(matched[i].route));
+
+    if(geometry)
+      {
+       if(matched[i].route==INF_DISTANCE || prev<0)
+          printf("\tLINESTRING EMPTY");
+       else
+         {
+          double plat,plon;
+          index_t *route;
+          int nnodes,j;
+
+          matched_lat_long(nodes,&matched[prev],&plat,&plon);
+
+          printf("\tLINESTRING(%.6f %.6f",radians_to_degrees(plon),radians_to_degrees(plat));
+
+          route=MatchedRoute(context,nodes,segments,ways,relations,profile,&matched[prev],&matched[i],&nnodes);
+
+          for(j=0;j<nnodes;j++)
+            {
+             double nlat,nlon;
+
+             GetLatLong(nodes,route[j],&nlat,&nlon);
+
+             printf(",%.6f %.6f",radians_to_degrees(nlon),radians_to_degrees(nlat));
+            }
+
+          if(route)
+             free(route);
+
+          printf(",%.6f %.6f)",radians_to_degrees(lon),radians_to_degrees(lat));
+         }
+      }
+
+    printf("\n");
+
+    prev=i;
+   }
+
+ fflush(stdout);
+
+ free(matched);
+
+ free(latitudes);
+ free(longitudes);
+ free(linenos);
+
+ return(nmatched);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the position of a matched point by interpolating along its segment.
+
+  Nodes *nodes The set of nodes to use.
+
+  MatchedPoint *matched The matched point.
+
+  double *lat Returns the latitude of the position.
+
+  double *lon Returns the longitude of the position.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void matched_lat_long(Nodes *nodes,MatchedPoint *matched,double *lat,double *lon)
+{
+ double lat1,lon1,lat2,lon2,frac=0;
+
+ GetLatLong(nodes,matched->node1,&lat1,&lon1);
+ GetLatLong(nodes,matched->node2,&lat2,&lon2);
+
+ if((matched->dist1+matched->dist2)>0)
+    frac=(double)matched->dist1/(double)(matched->dist1+matched->dist2);
+
+ *lat=lat1+frac*(lat2-lat1);
+ *lon=lon1+frac*(lon2-lon1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read a complete line from a batch file (of any length).
+
+  char *read_batch_line Returns the line without the trailing newline or NULL at the end of the file.
+
+  FILE *file The file to read from.
+
+  char **buffer A pointer to the buffer to use (reallocated as required).
+
+  size_t *length A pointer to the allocated length of the buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static char *read_batch_line(FILE *file,char **buffer,size_t *length)
+{
+ size_t used=0;
+
+ do
+   {
+    if((*length-used)<2)
+      {
+       *length+=256;
+       *buffer=(char*)realloc(*buffer,*length);
+      }
+
+    if(!fgets(*buffer+used,(int)(*length-used),file))
+       break;
+
+    used+=strlen(*buffer+used);
+   }
+ while(used==0 || (*buffer)[used-1]!='\n');
+
+ if(used==0)
+    return(NULL);
+
+ if((*buffer)[used-1]=='\n')
+    (*buffer)[--used]=0;
+
+ if(used>0 && (*buffer)[used-1]=='\r')
+    (*buffer)[--used]=0;
+
+ return(*buffer);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the statistics for the re-used results lists and queues.
+
+  FILE *file The file to print to.
+
+  ResultsPool *pool The pool of results lists and queues.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_pool_statistics(FILE *file,ResultsPool *pool)
+{
+ fprintf(file,"Results lists: %"PRIu32" allocated, %"PRIu32" re-used; peak %"PRIu32" results in %"PRIu32" bins.\n",
+         pool->new_results,pool->reused_results,pool->peak_results,pool->peak_bins);
+ fprintf(file,"Queues: %"PRIu32" allocated, %"PRIu32" re-used; peak %"PRIu32" queued results.\n",
+         pool->new_queues,pool->reused_queues,pool->peak_queue);
+}
+
+
+#if SLIM
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the statistics for the caches of the database files.
+
+  FILE *file The file to print to.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_cache_statistics(FILE *file,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations)
+{
+ print_one_cache_statistics(file,"Node positions",&nodes->poscache->stats);
+
+ if(nodes->cache)
+    print_one_cache_statistics(file,"Nodes",&nodes->cache->stats);
+ if(nodes->blockcache)
+    print_one_cache_statistics(file,"Node blocks",&nodes->blockcache->stats);
+
+ if(segments->cache)
+    print_one_cache_statistics(file,"Segments",&segments->cache->stats);
+ if(segments->blockcache)
+    print_one_cache_statistics(file,"Segment blocks",&segments->blockcache->stats);
+
+ if(segments->edgecache)
+    print_one_cache_statistics(file,"Edges",&segments->edgecache->stats);
+ if(segments->edgeblockcache)
+    print_one_cache_statistics(file,"Edge blocks",&segments->edgeblockcache->stats);
+
+ print_one_cache_statistics(file,"Ways",&ways->cache->stats);
+
+ print_one_cache_statistics(file,"Turn relations",&relations->cache->stats);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the statistics for a single cache.
+
+  FILE *file The file to print to.
+
+  const char *name The name of the cache.
+
+  CacheStatistics *stats The statistics of the cache.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_one_cache_statistics(FILE *file,const char *name,CacheStatistics *stats)
+{
+ fprintf(file,"%s cache: %"PRIu64" hits, %"PRIu64" misses, %"PRIu64" evictions; %zu kB.\n",
+         name,stats->hits,stats->misses,stats->evictions,stats->size/1024);
+}
+
+#endif /* SLIM */
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Print out the usage information.
 
@@ -731,11 +1725,20 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "              [--output-none] [--output-stdout]\n"
             "              [--profile=<name>]\n"
             "              [--transport=<transport>]\n"
-            "              [--shortest | --quickest]\n"
+            "              [--shortest | --quickest] [--bidirectional]\n"
+            "              [--hierarchy] [--landmarks]\n"
+            "              [--isochrone=<limit>]\n"
             "              --lon1=<longitude> --lat1=<latitude>\n"
             "              --lon2=<longitude> --lon2=<latitude>\n"
             "              [ ... --lon99=<longitude> --lon99=<latitude>]\n"
             "              [--reverse] [--loop]\n"
+            "              [--batch=<filename> [--batch-geometry]]\n"
+            "              [--match=<filename> [--match-accuracy=<metres>]\n"
+            "                                  [--match-geometry]]\n"
+            "              [--queue=(binary|quad|radix)] [--queue-trace=<filename>]\n"
+            "              [--cache-size=<megabytes>] [--cache-block=<kilobytes>]\n"
+            "              [--cache-readahead]\n"
+            "              [--mmap=<option>[,<option>...]]\n"
             "              [--highway-<highway>=<preference> ...]\n"
             "              [--speed-<highway>=<speed> ...]\n"
             "              [--property-<property>=<preference> ...]\n"
@@ -755,6 +1758,7 @@ static void print_usage(int detail,const char *argerr,const char *err)
    }
 
  if(detail==1)
+   {
     fprintf(stderr,
             "\n"
             "--version               Print the version of Routino.\n"
@@ -777,7 +1781,9 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "                         '" ROUTINO_DATADIR "').\n"
             "\n"
             "--exact-nodes-only      Only route between nodes (don't find closest segment).\n"
-            "\n"
+            "\n");
+
+    fprintf(stderr,
             "--quiet                 Don't print any screen output when running.\n"
             "--loggable              Print progress messages suitable for logging to file.\n"
             "--logtime               Print the elapsed time for each processing step.\n"
@@ -800,6 +1806,14 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "\n"
             "--shortest              Find the shortest route between the waypoints.\n"
             "--quickest              Find the quickest route between the waypoints.\n"
+            "--bidirectional         Search from both ends of the route at the same time.\n"
+            "--hierarchy             Use the contraction hierarchy created by planetsplitter\n"
+            "                        to find the route between the super-nodes.\n"
+            "--landmarks             Use the landmark distances created by planetsplitter\n"
+            "                        to guide the route between the super-nodes.\n"
+            "--isochrone=<limit>     Find all points that can be reached from a single\n"
+            "                        waypoint within the limit (km for '--shortest' or\n"
+            "                        minutes for '--quickest') instead of a route.\n"
             "\n"
             "--lon<n>=<longitude>    Specify the longitude of the n'th waypoint.\n"
             "--lat<n>=<latitude>     Specify the latitude of the n'th waypoint.\n"
@@ -808,6 +1822,36 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "--loop                  Find a route that returns to the first waypoint.\n"
             "\n"
             "--heading=<bearing>     Initial compass bearing at lowest numbered waypoint.\n"
+            "\n"
+            "--batch=<filename>      Read one route query per line from the file (or stdin\n"
+            "                        if '-') and write one result line for each to stdout\n"
+            "                        (implies '--quiet' and '--output-none').\n"
+            "--batch-geometry        Include the route points in each result line.\n"
+            "\n"
+            "--match=<filename>      Read a GPS trace with one longitude and latitude per\n"
+            "                        line from the file (or stdin if '-') and write the\n"
+            "                        matched position for each to stdout (implies\n"
+            "                        '--quiet' and '--output-none').\n"
+            "--match-accuracy=<m>    The accuracy of the trace points (default 10 metres).\n"
+            "--match-geometry        Include the route from the previous matched point in\n"
+            "                        each result line.\n"
+            "\n"
+            "--queue=<type>          Select the type of priority queue used for routing\n"
+            "                        (binary, quad or radix; defaults to %s).\n"
+            "--queue-trace=<fname>   Write all of the queue operations to a file (for\n"
+            "                        use with the queue-benchmark test program).\n"
+            "\n"
+            "--cache-size=<size>     The memory (in MB) for the caches of the database\n"
+            "                        files in slim mode (default is a fixed size).\n"
+            "--cache-block=<size>    The amount of data (in kB) read from file for each\n"
+            "                        slim mode cache miss (default 4, 0 for one item).\n"
+            "--cache-readahead       Ask the operating system to read ahead of each\n"
+            "                        block read for a slim mode cache miss.\n"
+            "--mmap=<options>        How to load the database files (a list of populate,\n"
+            "                        willneed, random, hugepage, copy or lock).\n",
+            QueueTypeName(QUEUE_TYPE_DEFAULT));
+
+    fprintf(stderr,
             "\n"
             "                                   Routing preference options\n"
             "--highway-<highway>=<preference>   * preference for highway type (%%).\n"
@@ -829,6 +1873,7 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "<property> can be selected from:\n"
             "%s",
             TransportList(),HighwayList(),PropertyList());
+   }
 
  exit(!detail);
 }
@@ -0,0 +1,1275 @@
+/***************************************
+ OSM routing server using libroutino library.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "version.h"
+
+#include "routino.h"
+
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*+ The maximum number of waypoints +*/
+#define NWAYPOINTS 99
+
+/*+ The default number of worker threads. +*/
+#define DEFAULT_THREADS 4
+
+/*+ The default number of seconds that a connection can be idle before it is closed. +*/
+#define DEFAULT_IDLE_TIMEOUT 10
+
+/*+ The number of requests or connections that can wait for each worker thread. +*/
+#define JOBS_PER_THREAD 16
+
+
+/* Local data types */
+
+/*+ A data type for holding the data for a worker. +*/
+typedef struct _Worker
+ {
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+  pthread_t         thread;     /*+ The thread identifier. +*/
+
+#endif
+
+  Routino_Database *database;   /*+ The database used by the worker (shared unless using the slim library). +*/
+
+  Routino_Context  *context;    /*+ The routing context used by the worker. +*/
+ }
+ Worker;
+
+/*+ A data type for holding a request or connection that is waiting for a worker. +*/
+typedef struct _Job
+ {
+  int               fd;         /*+ The file descriptor of a client connection (or -1). +*/
+
+  char             *request;    /*+ A request read from stdin (or NULL). +*/
+ }
+ Job;
+
+
+/* Local variables */
+
+/*+ The profiles that are not compatible with the database. +*/
+static Routino_Profile **invalid_profiles=NULL;
+
+/*+ The number of profiles that are not compatible with the database. +*/
+static int ninvalid_profiles=0;
+
+/*+ The directory that output files can be written into (or NULL if they cannot). +*/
+static char *output_dirname=NULL;
+
+/*+ The number of seconds that a connection can be idle before it is closed (or 0 for no limit). +*/
+static int idle_timeout=DEFAULT_IDLE_TIMEOUT;
+
+/*+ Set when the server has been asked to stop. +*/
+static volatile sig_atomic_t terminate=0;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*+ The jobs that are waiting for a worker (a circular buffer). +*/
+static Job *jobs=NULL;
+
+/*+ The size of the circular buffer of jobs. +*/
+static int njobs_alloc=0;
+
+/*+ The position of the first job and the number of jobs in the circular buffer. +*/
+static int job_first=0,njobs=0;
+
+static pthread_mutex_t jobs_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  jobs_cond   = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  space_cond  = PTHREAD_COND_INITIALIZER;
+
+static pthread_mutex_t output_mutex= PTHREAD_MUTEX_INITIALIZER;
+
+#endif
+
+
+/* Local functions */
+
+static void run_job(Worker *worker,Job job);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+static void add_job(Job job);
+static void *worker_thread(Worker *worker);
+#endif
+
+static void serve_connection(Worker *worker,int fd);
+static char *process_request(Worker *worker,char *request);
+static void print_list(FILE *out,Routino_Output *list,int list_html,int list_html_all,int list_text,int list_text_all,int isochrone);
+
+static void handle_signal(int signum);
+
+static char *FileName(const char *dirname,const char *prefix, const char *name);
+static int safe_output_dir(const char *dirname);
+static int load_options_by_name(const char *names);
+static void print_usage(int detail,const char *argerr,const char *err);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The main program for the routing server.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char** argv)
+{
+ Routino_Database    *database;
+ Worker              *workers;
+ char                *dirname=NULL,*prefix=NULL;
+ char                *profiles=NULL,*translations=NULL;
+ char                *socketname=NULL;
+ char               **list;
+ int                  nthreads=DEFAULT_THREADS,nworkers;
+ Routino_LoadOptions  loadoptions={0,NULL,0};
+ int                  listenfd=-1;
+ int                  arg,i;
+
+ /* Check the libroutino API version */
+
+ if(Routino_CheckAPIVersion()!=ROUTINO_ERROR_NONE)
+   {
+    fprintf(stderr,"Error: Executable version (%d) and library version (%d) do not match.\n",ROUTINO_API_VERSION,Routino_APIVersion);
+    exit(EXIT_FAILURE);
+   }
+
+ /* Parse the command line arguments */
+
+ for(arg=1;arg<argc;arg++)
+   {
+    if(!strcmp(argv[arg],"--version"))
+       print_usage(-1,NULL,NULL);
+    else if(!strcmp(argv[arg],"--help"))
+       print_usage(1,NULL,NULL);
+    else if(!strncmp(argv[arg],"--dir=",6))
+       dirname=&argv[arg][6];
+    else if(!strncmp(argv[arg],"--prefix=",9))
+       prefix=&argv[arg][9];
+    else if(!strncmp(argv[arg],"--profiles=",11))
+       profiles=&argv[arg][11];
+    else if(!strncmp(argv[arg],"--translations=",15))
+       translations=&argv[arg][15];
+    else if(!strncmp(argv[arg],"--socket=",9))
+       socketname=&argv[arg][9];
+    else if(!strncmp(argv[arg],"--output-dir=",13))
+       output_dirname=&argv[arg][13];
+    else if(!strncmp(argv[arg],"--mmap=",7))
+      {
+       loadoptions.options=load_options_by_name(&argv[arg][7]);
+
+       if(loadoptions.options<0)
+          print_usage(0,argv[arg],NULL);
+      }
+    else if(!strncmp(argv[arg],"--idle-timeout=",15))
+      {
+       idle_timeout=atoi(&argv[arg][15]);
+
+       if(idle_timeout<0)
+          print_usage(0,argv[arg],NULL);
+      }
+    else if(!strncmp(argv[arg],"--threads=",10))
+      {
+       nthreads=atoi(&argv[arg][10]);
+
+       if(nthreads<1)
+          print_usage(0,argv[arg],NULL);
+      }
+    else
+       print_usage(0,argv[arg],NULL);
+   }
+
+#if !defined(USE_PTHREADS) || !USE_PTHREADS
+
+ if(nthreads>1)
+    fprintf(stderr,"Warning: Compiled without threads so requests are processed one at a time.\n");
+
+ nthreads=1;
+
+#endif
+
+ /* Load in the profiles */
+
+ if(profiles)
+   {
+    if(access(profiles,F_OK))
+      {
+       fprintf(stderr,"Error: The '--profiles' option specifies a file '%s' that does not exist.\n",profiles);
+       exit(EXIT_FAILURE);
+      }
+   }
+ else
+   {
+    profiles=FileName(dirname,prefix,"profiles.xml");
+
+    if(access(profiles,F_OK))
+      {
+       char *defaultprofiles=FileName(ROUTINO_DATADIR,NULL,"profiles.xml");
+
+       if(access(defaultprofiles,F_OK))
+         {
+          fprintf(stderr,"Error: The '--profiles' option was not used and the files '%s' and '%s' do not exist.\n",profiles,defaultprofiles);
+          exit(EXIT_FAILURE);
+         }
+
+       free(profiles);
+       profiles=defaultprofiles;
+      }
+   }
+
+ if(Routino_ParseXMLProfiles(profiles))
+   {
+    fprintf(stderr,"Error: Cannot read the profiles in the file '%s'.\n",profiles);
+    exit(EXIT_FAILURE);
+   }
+
+ /* Load in the translations */
+
+ if(translations)
+   {
+    if(access(translations,F_OK))
+      {
+       fprintf(stderr,"Error: The '--translations' option specifies a file that does not exist.\n");
+       exit(EXIT_FAILURE);
+      }
+   }
+ else
+   {
+    translations=FileName(dirname,prefix,"translations.xml");
+
+    if(access(translations,F_OK))
+      {
+       char *defaulttranslations=FileName(ROUTINO_DATADIR,NULL,"translations.xml");
+
+       if(access(defaulttranslations,F_OK))
+         {
+          fprintf(stderr,"Error: The '--translations' option was not used and the files '%s' and '%s' do not exist.\n",translations,defaulttranslations);
+          exit(EXIT_FAILURE);
+         }
+
+       free(translations);
+       translations=defaulttranslations;
+      }
+   }
+
+ if(Routino_ParseXMLTranslations(translations))
+   {
+    fprintf(stderr,"Error: Cannot read the translations in the file '%s'.\n",translations);
+    exit(EXIT_FAILURE);
+   }
+
+ /* Load in the routing database */
+
+ database=Routino_LoadDatabaseWithOptions(dirname,prefix,&loadoptions);
+
+ if(!database)
+   {
+    if(Routino_errno==ROUTINO_ERROR_DATABASE_VERSION)
+       fprintf(stderr,"Error: The routing database was created by a different version of planetsplitter; regenerate the database.\n");
+    else
+       fprintf(stderr,"Error: Cannot load the routing database.\n");
+    exit(EXIT_FAILURE);
+   }
+
+ /* Check the profiles are valid for use with this database (once only since it modifies them) */
+
+ list=Routino_GetProfileNames();
+
+ for(i=0;list[i];i++)
+   {
+    Routino_Profile *profile=Routino_GetProfile(list[i]);
+
+    if(Routino_ValidateProfile(database,profile)!=ROUTINO_ERROR_NONE)
+      {
+       invalid_profiles=(Routino_Profile**)realloc(invalid_profiles,(ninvalid_profiles+1)*sizeof(Routino_Profile*));
+       invalid_profiles[ninvalid_profiles++]=profile;
+      }
+   }
+
+ /* Create the workers, each has its own context and with the slim library its own database */
+
+ nworkers=nthreads;
+
+ workers=(Worker*)calloc(nworkers,sizeof(Worker));
+
+ for(i=0;i<nworkers;i++)
+   {
+#if SLIM
+    if(i>0)
+       workers[i].database=Routino_LoadDatabaseWithOptions(dirname,prefix,&loadoptions);
+    else
+#endif
+       workers[i].database=database;
+
+    if(!workers[i].database)
+      {
+       fprintf(stderr,"Error: Cannot load the routing database.\n");
+       exit(EXIT_FAILURE);
+      }
+
+    workers[i].context=Routino_CreateContext(workers[i].database);
+   }
+
+ /* Stop cleanly on a signal and don't die if a client disconnects early */
+
+ if(socketname)
+   {
+    struct sigaction action;
+
+    action.sa_handler=handle_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags=0;
+
+    sigaction(SIGINT ,&action,NULL);
+    sigaction(SIGTERM,&action,NULL);
+
+    signal(SIGPIPE,SIG_IGN);
+   }
+
+ /* Open the socket */
+
+ if(socketname)
+   {
+    struct sockaddr_un address;
+
+    if(strlen(socketname)>=sizeof(address.sun_path))
+      {
+       fprintf(stderr,"Error: The socket name '%s' is too long.\n",socketname);
+       exit(EXIT_FAILURE);
+      }
+
+    memset(&address,0,sizeof(address));
+    address.sun_family=AF_UNIX;
+    strcpy(address.sun_path,socketname);
+
+    unlink(socketname);
+
+    listenfd=socket(AF_UNIX,SOCK_STREAM,0);
+
+    if(listenfd<0 || bind(listenfd,(struct sockaddr*)&address,sizeof(address)) || listen(listenfd,SOMAXCONN))
+      {
+       fprintf(stderr,"Error: Cannot listen on the socket '%s' [%s].\n",socketname,strerror(errno));
+       exit(EXIT_FAILURE);
+      }
+   }
+
+ /* Start the worker threads (with the signals blocked so that they interrupt accept() in this thread) */
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ njobs_alloc=JOBS_PER_THREAD*nworkers;
+ jobs=(Job*)malloc(njobs_alloc*sizeof(Job));
+
+ {
+  sigset_t signals,oldsignals;
+
+  sigemptyset(&signals);
+  sigaddset(&signals,SIGINT);
+  sigaddset(&signals,SIGTERM);
+
+  pthread_sigmask(SIG_BLOCK,&signals,&oldsignals);
+
+  for(i=0;i<nworkers;i++)
+     pthread_create(&workers[i].thread,NULL,(void* (*)(void*))worker_thread,&workers[i]);
+
+  pthread_sigmask(SIG_SETMASK,&oldsignals,NULL);
+ }
+
+#endif
+
+ /* Read the requests or accept the connections and pass them to the workers */
+
+ while(!terminate)
+   {
+    Job job;
+
+    job.fd=-1;
+    job.request=NULL;
+
+    if(socketname)
+      {
+       job.fd=accept(listenfd,NULL,NULL);
+
+       if(job.fd<0)
+         {
+          if(errno==EINTR || errno==ECONNABORTED)
+             continue;
+
+          fprintf(stderr,"Error: Cannot accept a connection on the socket '%s' [%s].\n",socketname,strerror(errno));
+          break;
+         }
+      }
+    else
+      {
+       size_t length=0;
+
+       if(getline(&job.request,&length,stdin)<0)
+         {
+          free(job.request);
+          break;
+         }
+      }
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    add_job(job);
+#else
+    run_job(&workers[0],job);
+#endif
+   }
+
+ /* Stop the worker threads (an empty job tells a worker to finish) */
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ for(i=0;i<nworkers;i++)
+   {
+    Job job;
+
+    job.fd=-1;
+    job.request=NULL;
+
+    add_job(job);
+   }
+
+ for(i=0;i<nworkers;i++)
+    pthread_join(workers[i].thread,NULL);
+
+ free(jobs);
+
+#endif
+
+ if(socketname)
+   {
+    close(listenfd);
+    unlink(socketname);
+   }
+
+ /* Tidy up and exit */
+
+ for(i=0;i<nworkers;i++)
+   {
+    Routino_DeleteContext(workers[i].context);
+
+    if(workers[i].database!=database)
+       Routino_UnloadDatabase(workers[i].database);
+   }
+
+ free(workers);
+
+ if(invalid_profiles)
+    free(invalid_profiles);
+
+ Routino_UnloadDatabase(database);
+
+ Routino_FreeXMLProfiles();
+
+ Routino_FreeXMLTranslations();
+
+ exit(EXIT_SUCCESS);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Process a client connection or a request read from stdin.
+
+  Worker *worker The worker to use.
+
+  Job job The job to process.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void run_job(Worker *worker,Job job)
+{
+ if(job.fd>=0)
+    serve_connection(worker,job.fd);
+ else if(job.request)
+   {
+    char *response=process_request(worker,job.request);
+
+    if(response)
+      {
+#if defined(USE_PTHREADS) && USE_PTHREADS
+       pthread_mutex_lock(&output_mutex);
+#endif
+
+       fputs(response,stdout);
+       fflush(stdout);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+       pthread_mutex_unlock(&output_mutex);
+#endif
+
+       free(response);
+      }
+
+    free(job.request);
+   }
+}
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a job to the list waiting for a worker (waits if the list is full).
+
+  Job job The job to add.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void add_job(Job job)
+{
+ pthread_mutex_lock(&jobs_mutex);
+
+ while(njobs==njobs_alloc)
+    pthread_cond_wait(&space_cond,&jobs_mutex);
+
+ jobs[(job_first+njobs)%njobs_alloc]=job;
+ njobs++;
+
+ pthread_cond_signal(&jobs_cond);
+
+ pthread_mutex_unlock(&jobs_mutex);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The worker thread, processes jobs until it is given an empty one.
+
+  void *worker_thread Returns NULL.
+
+  Worker *worker The data for this worker.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *worker_thread(Worker *worker)
+{
+ while(1)
+   {
+    Job job;
+
+    pthread_mutex_lock(&jobs_mutex);
+
+    while(njobs==0)
+       pthread_cond_wait(&jobs_cond,&jobs_mutex);
+
+    job=jobs[job_first];
+    job_first=(job_first+1)%njobs_alloc;
+    njobs--;
+
+    pthread_cond_signal(&space_cond);
+
+    pthread_mutex_unlock(&jobs_mutex);
+
+    if(job.fd<0 && !job.request)
+       break;
+
+    run_job(worker,job);
+   }
+
+ return(NULL);
+}
+
+#endif
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read requests from a client connection and reply to them until it is closed or is idle for too long.
+
+  Worker *worker The worker to use.
+
+  int fd The file descriptor of the connection.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void serve_connection(Worker *worker,int fd)
+{
+ FILE *in;
+ char *request=NULL;
+ size_t length=0;
+
+ /* Don't let an idle client keep the worker from other connections */
+
+ if(idle_timeout>0)
+   {
+    struct timeval timeout;
+
+    timeout.tv_sec=idle_timeout;
+    timeout.tv_usec=0;
+
+    setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+   }
+
+ in=fdopen(fd,"r");
+
+ if(!in)
+   {
+    close(fd);
+    return;
+   }
+
+ while(getline(&request,&length,in)>=0)
+   {
+    char *response=process_request(worker,request);
+
+    if(response)
+      {
+       size_t written=0,total=strlen(response);
+
+       while(written<total)
+         {
+          ssize_t n=write(fd,response+written,total-written);
+
+          if(n<0 && errno==EINTR)
+             continue;
+          if(n<=0)
+             break;
+
+          written+=n;
+         }
+
+       free(response);
+
+       if(written<total)
+          break;
+      }
+   }
+
+ free(request);
+
+ fclose(in);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Parse a request, calculate the route or isochrone and create the response.
+
+  char *process_request Returns the allocated response or NULL for an empty request.
+
+  Worker *worker The worker to use.
+
+  char *request The request (modified by this function).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static char *process_request(Worker *worker,char *request)
+{
+ Routino_Profile     *profile;
+ Routino_Translation *translation;
+ Routino_Waypoint    *waypoints[NWAYPOINTS+1];
+ Routino_Output      *route=NULL,*last;
+ int                  point_used[NWAYPOINTS+1]={0};
+ double               point_lon[NWAYPOINTS+1],point_lat[NWAYPOINTS+1];
+ char                *id=NULL,*profilename="motorcar",*language="en",*outputdir=NULL,*fulloutputdir=NULL;
+ char                *word,*saveptr=NULL,*argerr=NULL,*err=NULL;
+ int                  reverse=0,loop=0;
+ int                  quickest=0,bidirectional=0;
+ double               isochrone=0;
+ int                  html=0,gpx_track=0,gpx_route=0,text=0,text_all=0;
+ int                  list_html=0,list_html_all=0,list_text=0,list_text_all=0;
+ int                  first_waypoint=NWAYPOINTS,last_waypoint=1,waypoint,nwaypoints=0;
+ int                  routing_options,error,npoints=0,nwords=0,i;
+ char                *response=NULL;
+ size_t               size=0;
+ FILE                *out;
+
+ /* Parse the request */
+
+ for(word=strtok_r(request," \t\r\n",&saveptr);word;word=strtok_r(NULL," \t\r\n",&saveptr))
+   {
+    nwords++;
+
+    if(argerr)
+       ;
+    else if(!strncmp(word,"--id=",5))
+       id=&word[5];
+    else if(!strncmp(word,"--profile=",10))
+       profilename=&word[10];
+    else if(!strncmp(word,"--transport=",12))
+       profilename=&word[12];
+    else if(!strncmp(word,"--language=",11))
+       language=&word[11];
+    else if(!strncmp(word,"--output-dir=",13))
+       outputdir=&word[13];
+    else if(!strncmp(word,"--reverse",9))
+      {
+       if(word[9]=='=')
+          reverse=atoi(&word[10]);
+       else
+          reverse=1;
+      }
+    else if(!strncmp(word,"--loop",6))
+      {
+       if(word[6]=='=')
+          loop=atoi(&word[7]);
+       else
+          loop=1;
+      }
+    else if(!strcmp(word,"--output-html"))
+       html=1;
+    else if(!strcmp(word,"--output-gpx-track"))
+       gpx_track=1;
+    else if(!strcmp(word,"--output-gpx-route"))
+       gpx_route=1;
+    else if(!strcmp(word,"--output-text"))
+       text=1;
+    else if(!strcmp(word,"--output-text-all"))
+       text_all=1;
+    else if(!strcmp(word,"--list-html"))
+       list_html=1;
+    else if(!strcmp(word,"--list-html-all"))
+       list_html_all=1;
+    else if(!strcmp(word,"--list-text"))
+       list_text=1;
+    else if(!strcmp(word,"--list-text-all"))
+       list_text_all=1;
+    else if(!strcmp(word,"--shortest"))
+       quickest=0;
+    else if(!strcmp(word,"--quickest"))
+       quickest=1;
+    else if(!strcmp(word,"--bidirectional"))
+       bidirectional=1;
+    else if(!strncmp(word,"--isochrone=",12))
+      {
+       isochrone=atof(&word[12]);
+
+       if(isochrone<=0)
+          argerr=word;
+      }
+    else if((!strncmp(word,"--lon",5) || !strncmp(word,"--lat",5)) && isdigit(word[5]))
+      {
+       int point,bit=(word[4]=='n')?1:2;
+       char *p=&word[6];
+
+       while(isdigit(*p)) p++;
+
+       point=atoi(&word[5]);
+
+       if(*p++!='=' || point>NWAYPOINTS || point_used[point]&bit)
+          argerr=word;
+       else
+         {
+          if(bit==1)
+             point_lon[point]=atof(p);
+          else
+             point_lat[point]=atof(p);
+
+          point_used[point]+=bit;
+
+          if(point<first_waypoint)
+             first_waypoint=point;
+          if(point>last_waypoint)
+             last_waypoint=point;
+         }
+      }
+    else
+       argerr=word;
+   }
+
+ /* An empty request gets no response */
+
+ if(nwords==0)
+    return(NULL);
+
+ out=open_memstream(&response,&size);
+
+ /* Check the request */
+
+ if(argerr)
+   {
+    fprintf(out,"ERROR%s%s Unknown or invalid option '%s'.\n\n",id?" id=":"",id?id:"",argerr);
+    goto finished;
+   }
+
+ for(waypoint=first_waypoint;waypoint<=last_waypoint;waypoint++)
+    if(point_used[waypoint]==1 || point_used[waypoint]==2)
+       err="All waypoints must have latitude and longitude.";
+    else if(point_used[waypoint]==3)
+       nwaypoints++;
+
+ if(!err)
+   {
+    if(isochrone>0)
+      {
+       if(first_waypoint!=last_waypoint)
+          err="Exactly one waypoint must be specified with '--isochrone'.";
+      }
+    else if(first_waypoint>=last_waypoint)
+       err="At least two waypoints must be specified.";
+   }
+
+ if(!err && !outputdir && (html || gpx_track || gpx_route || text || text_all))
+    err="The output file options require the '--output-dir' option.";
+
+ if(!err && outputdir && !output_dirname)
+    err="The server was not started with the '--output-dir' option so it cannot write files.";
+
+ if(!err && outputdir && !safe_output_dir(outputdir))
+    err="The '--output-dir' option must be a relative directory name without any '..' in it.";
+
+ if(!err && outputdir)
+   {
+    fulloutputdir=FileName(output_dirname,NULL,outputdir);
+
+    if(access(fulloutputdir,W_OK))
+       err="The '--output-dir' option specifies a directory that cannot be written.";
+   }
+
+ if(err)
+   {
+    fprintf(out,"ERROR%s%s %s\n\n",id?" id=":"",id?id:"",err);
+    goto finished;
+   }
+
+ profile=Routino_GetProfile(profilename);
+
+ if(!profile)
+   {
+    fprintf(out,"ERROR%s%s Cannot find a profile called '%s'.\n\n",id?" id=":"",id?id:"",profilename);
+    goto finished;
+   }
+
+ for(i=0;i<ninvalid_profiles;i++)
+    if(invalid_profiles[i]==profile)
+      {
+       fprintf(out,"ERROR%s%s Profile '%s' is invalid or not compatible with database.\n\n",id?" id=":"",id?id:"",profilename);
+       goto finished;
+      }
+
+ translation=Routino_GetTranslation(language);
+
+ if(!translation)
+   {
+    fprintf(out,"ERROR%s%s Cannot find a translation called '%s'.\n\n",id?" id=":"",id?id:"",language);
+    goto finished;
+   }
+
+ /* Find the waypoints */
+
+ nwaypoints=0;
+
+ for(waypoint=first_waypoint;waypoint<=last_waypoint;waypoint++)
+   {
+    if(point_used[waypoint]!=3)
+       continue;
+
+    waypoints[nwaypoints]=Routino_FindWaypoint(worker->database,profile,point_lat[waypoint],point_lon[waypoint]);
+
+    if(!waypoints[nwaypoints])
+      {
+       fprintf(out,"ERROR%s%s Cannot find node close to specified point %d.\n\n",id?" id=":"",id?id:"",waypoint);
+       goto tidy_up;
+      }
+
+    nwaypoints++;
+   }
+
+ /* Create the route (a list is always created to get the totals) */
+
+ if(outputdir && !html && !gpx_track && !gpx_route && !text && !text_all)
+    html=gpx_track=gpx_route=text=text_all=1;
+
+ routing_options=0;
+
+ if(quickest)
+    routing_options|=ROUTINO_ROUTE_QUICKEST;
+ else
+    routing_options|=ROUTINO_ROUTE_SHORTEST;
+
+ if(bidirectional)
+    routing_options|=ROUTINO_ROUTE_BIDIRECTIONAL;
+
+ if(html     ) routing_options|=ROUTINO_ROUTE_FILE_HTML;
+ if(gpx_track) routing_options|=ROUTINO_ROUTE_FILE_GPX_TRACK;
+ if(gpx_route) routing_options|=ROUTINO_ROUTE_FILE_GPX_ROUTE;
+ if(text     ) routing_options|=ROUTINO_ROUTE_FILE_TEXT;
+ if(text_all ) routing_options|=ROUTINO_ROUTE_FILE_TEXT_ALL;
+
+ if(list_html)          routing_options|=ROUTINO_ROUTE_LIST_HTML;
+ else if(list_html_all) routing_options|=ROUTINO_ROUTE_LIST_HTML_ALL;
+ else if(list_text_all) routing_options|=ROUTINO_ROUTE_LIST_TEXT_ALL;
+ else                   routing_options|=ROUTINO_ROUTE_LIST_TEXT;
+
+ if(reverse) routing_options|=ROUTINO_ROUTE_REVERSE;
+ if(loop)    routing_options|=ROUTINO_ROUTE_LOOP;
+
+ Routino_SetOutputDirectory(worker->context,fulloutputdir);
+
+ if(isochrone>0)
+   {
+    routing_options&=ROUTINO_ROUTE_QUICKEST|ROUTINO_ROUTE_FILE_TEXT|
+                     ROUTINO_ROUTE_LIST_HTML|ROUTINO_ROUTE_LIST_HTML_ALL|ROUTINO_ROUTE_LIST_TEXT|ROUTINO_ROUTE_LIST_TEXT_ALL;
+
+    route=Routino_CalculateIsochroneInContext(worker->context,profile,translation,waypoints[0],isochrone,routing_options,NULL);
+   }
+ else
+    route=Routino_CalculateRouteInContext(worker->context,profile,translation,waypoints,nwaypoints,routing_options,NULL);
+
+ error=Routino_ContextErrno(worker->context);
+
+ if(error>=ROUTINO_ERROR_NO_ROUTE_1)
+   {
+    fprintf(out,"ERROR%s%s Cannot find a route between specified waypoints.\n\n",id?" id=":"",id?id:"");
+    goto tidy_up;
+   }
+ else if(error!=ROUTINO_ERROR_NONE)
+   {
+    fprintf(out,"ERROR%s%s Internal error (%d).\n\n",id?" id=":"",id?id:"",error);
+    goto tidy_up;
+   }
+
+ /* Print the response */
+
+ for(last=route;last && last->next;last=last->next)
+    npoints++;
+
+ if(isochrone>0)
+    fprintf(out,"OK%s%s points=%d\n",id?" id=":"",id?id:"",route?npoints+1:0);
+ else
+    fprintf(out,"OK%s%s distance=%.3f duration=%.1f\n",id?" id=":"",id?id:"",last?last->dist:0.0,last?last->time:0.0);
+
+ if(list_html || list_html_all || list_text || list_text_all)
+    print_list(out,route,list_html,list_html_all,list_text,list_text_all,isochrone>0);
+
+ fprintf(out,"\n");
+
+ /* Tidy up */
+
+ tidy_up:
+
+ if(route)
+    Routino_DeleteRoute(route);
+
+ while(nwaypoints>0)
+    free(waypoints[--nwaypoints]);
+
+ finished:
+
+ if(fulloutputdir)
+    free(fulloutputdir);
+
+ fclose(out);
+
+ return(response);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print the linked list output (in the same format as the router using the library).
+
+  FILE *out The file to print to.
+
+  Routino_Output *list The linked list output.
+
+  int list_html Set if the ROUTINO_ROUTE_LIST_HTML option was used.
+
+  int list_html_all Set if the ROUTINO_ROUTE_LIST_HTML_ALL option was used.
+
+  int list_text Set if the ROUTINO_ROUTE_LIST_TEXT option was used.
+
+  int list_text_all Set if the ROUTINO_ROUTE_LIST_TEXT_ALL option was used.
+
+  int isochrone Set if the list is the output of an isochrone.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_list(FILE *out,Routino_Output *list,int list_html,int list_html_all,int list_text,int list_text_all,int isochrone)
+{
+ int first=1,last;
+
+ while(list)
+   {
+    last=list->next?0:1;
+
+    fprintf(out,"----------------\n");
+    fprintf(out,"Lon,Lat: %.5f, %.5f\n",(180.0/M_PI)*list->lon,(180.0/M_PI)*list->lat);
+
+    fprintf(out,"Dist,Time: %.3f km, %.1f minutes\n",list->dist,list->time);
+
+    if(list_text_all && !first)
+       fprintf(out,"Speed: %.0f km/hr\n",list->speed);
+
+    fprintf(out,"Point type: %d\n",list->type);
+
+    if(isochrone)
+      {
+       list=list->next;
+       continue;
+      }
+
+    if((list_html || list_html_all || list_text) && !first && !last)
+       fprintf(out,"Turn: %d degrees\n",list->turn);
+
+    if(((list_html || list_html_all || list_text) && !last) || (list_text_all && !first))
+       fprintf(out,"Bearing: %d degrees\n",list->bearing);
+
+    if(((list_html || list_text) && !last) || (list_html_all && list->name) || (list_text_all && !first))
+       fprintf(out,"Name: %s\n",list->name?list->name:"");
+
+    if(list_html || (list_html_all && list->name))
+      {
+       fprintf(out,"Desc1: %s\n",list->desc1);
+       fprintf(out,"Desc2: %s\n",list->desc2);
+
+       if(!last)
+          fprintf(out,"Desc3: %s\n",list->desc3);
+      }
+
+    list=list->next;
+    first=0;
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Handle a signal that asks the server to stop.
+
+  int signum The signal number.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void handle_signal(int signum)
+{
+ terminate=1;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Return a filename composed of the dirname, prefix and name.
+
+  char *FileName Returns a pointer to memory allocated to the filename.
+
+  const char *dirname The directory name.
+
+  const char *prefix The file prefix.
+
+  const char *name The main part of the name.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static char *FileName(const char *dirname,const char *prefix, const char *name)
+{
+ char *filename=(char*)malloc((dirname?strlen(dirname):0)+1+(prefix?strlen(prefix):0)+1+strlen(name)+1);
+
+ sprintf(filename,"%s%s%s%s%s",dirname?dirname:"",dirname?"/":"",prefix?prefix:"",prefix?"-":"",name);
+
+ return(filename);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check that a directory name from a request stays inside the output directory.
+
+  int safe_output_dir Returns true if the name is relative and none of its parts is '..'.
+
+  const char *dirname The directory name to check.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int safe_output_dir(const char *dirname)
+{
+ const char *p=dirname;
+
+ if(*p=='/')
+    return(0);
+
+ while(*p)
+   {
+    size_t length=strcspn(p,"/");
+
+    if(length==2 && p[0]=='.' && p[1]=='.')
+       return(0);
+
+    p+=length;
+
+    while(*p=='/')
+       p++;
+   }
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Convert a comma separated list of names into a set of database loading options.
+
+  int load_options_by_name Returns the ROUTINO_LOAD_* values ORed together or -1 if a name is not recognised.
+
+  const char *names The list of names (populate, willneed, random, hugepage, copy or lock).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int load_options_by_name(const char *names)
+{
+ static const struct {const char *name; int option;} options[]={{"populate",ROUTINO_LOAD_POPULATE},
+                                                                {"willneed",ROUTINO_LOAD_WILLNEED},
+                                                                {"random"  ,ROUTINO_LOAD_RANDOM  },
+                                                                {"hugepage",ROUTINO_LOAD_HUGEPAGE},
+                                                                {"copy"    ,ROUTINO_LOAD_COPY    },
+                                                                {"lock"    ,ROUTINO_LOAD_LOCK    }};
+ int result=0;
+
+ while(*names)
+   {
+    size_t length=strcspn(names,",");
+    int i;
+
+    for(i=0;i<(int)(sizeof(options)/sizeof(options[0]));i++)
+       if(strlen(options[i].name)==length && !strncmp(names,options[i].name,length))
+          break;
+
+    if(i==(int)(sizeof(options)/sizeof(options[0])))
+       return(-1);
+
+    result|=options[i].option;
+
+    names+=length;
+
+    if(*names==',')
+       names++;
+   }
+
+ return(result);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the usage information.
+
+  int detail The level of detail to use: -1 = just version number, 0 = low detail, 1 = full details.
+
+  const char *argerr The argument that gave the error (if there is one).
+
+  const char *err Other error message (if there is one).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_usage(int detail,const char *argerr,const char *err)
+{
+ if(detail<0)
+   {
+    fprintf(stderr,
+            "Routino version " ROUTINO_VERSION " " ROUTINO_URL " "
+            "[Library version: %s, API version: %d]\n",
+            Routino_Version,Routino_APIVersion
+            );
+   }
+
+ if(detail>=0)
+   {
+    fprintf(stderr,
+            "Usage: routino-server [--version]\n"
+            "                      [--help ]\n"
+            "                      [--dir=<dirname>] [--prefix=<name>]\n"
+            "                      [--profiles=<filename>] [--translations=<filename>]\n"
+            "                      [--socket=<filename>]\n"
+            "                      [--output-dir=<dirname>]\n"
+            "                      [--threads=<number>] [--idle-timeout=<seconds>]\n"
+            "                      [--mmap=<option>[,<option>...]]\n");
+
+    if(argerr)
+       fprintf(stderr,
+               "\n"
+               "Error with command line parameter: %s\n",argerr);
+
+    if(err)
+       fprintf(stderr,
+               "\n"
+               "Error: %s\n",err);
+   }
+
+ if(detail==1)
+    fprintf(stderr,
+            "\n"
+            "--version               Print the version of Routino.\n"
+            "\n"
+            "--help                  Prints this information.\n"
+            "\n"
+            "--dir=<dirname>         The directory containing the routing database.\n"
+            "--prefix=<name>         The filename prefix for the routing database.\n"
+            "--profiles=<filename>   The name of the XML file containing the profiles\n"
+            "                        (defaults to 'profiles.xml' with '--dir' and\n"
+            "                         '--prefix' options or the file installed in\n"
+            "                         '" ROUTINO_DATADIR "').\n"
+            "--translations=<fname>  The name of the XML file containing the translations\n"
+            "                        (defaults to 'translations.xml' with '--dir' and\n"
+            "                         '--prefix' options or the file installed in\n"
+            "                         '" ROUTINO_DATADIR "').\n"
+            "\n"
+            "--socket=<filename>     Accept connections on this Unix domain socket\n"
+            "                        (defaults to reading requests from stdin).\n"
+            "--output-dir=<dirname>  The directory that requests can write files into\n"
+            "                        (defaults to no output files).\n"
+            "--threads=<number>      The number of requests to process at the same time\n"
+            "                        (defaults to %d).\n"
+            "--idle-timeout=<secs>   Close a connection that sends no request for this\n"
+            "                        long (defaults to %d, 0 for no limit).\n"
+            "--mmap=<options>        How to load the database files (a list of populate,\n"
+            "                        willneed, random, hugepage, copy or lock).\n"
+            "\n"
+            "Each request is one line containing these options:\n"
+            "\n"
+            "--id=<string>           An identifier to copy into the response.\n"
+            "--profile=<name>        Select the loaded profile with this name.\n"
+            "--transport=<transport> Select the profile named after the transport.\n"
+            "--language=<lang>       Use the translations for specified language.\n"
+            "\n"
+            "--output-dir=<dirname>  Write the output files into this directory (relative\n"
+            "                        to the server's '--output-dir' and without '..').\n"
+            "--output-html           Write an HTML description of the route.\n"
+            "--output-gpx-track      Write a GPX track file with all route points.\n"
+            "--output-gpx-route      Write a GPX route file with interesting junctions.\n"
+            "--output-text           Write a plain text file with interesting junctions.\n"
+            "--output-text-all       Write a plain text file with all route points.\n"
+            "                        (If no output option is given with '--output-dir'\n"
+            "                         then all are written.)\n"
+            "\n"
+            "--list-html             Reply with an HTML list of the route.\n"
+            "--list-html-all         Reply with an HTML list of the route with all points.\n"
+            "--list-text             Reply with a plain text list with interesting junctions.\n"
+            "--list-text-all         Reply with a plain text list with all route points.\n"
+            "\n"
+            "--shortest              Find the shortest route between the waypoints.\n"
+            "--quickest              Find the quickest route between the waypoints.\n"
+            "--bidirectional         Search from both ends of the route at the same time.\n"
+            "--isochrone=<limit>     Find all points that can be reached from a single\n"
+            "                        waypoint within the limit (km for '--shortest' or\n"
+            "                        minutes for '--quickest') instead of a route.\n"
+            "\n"
+            "--lon<n>=<longitude>    Specify the longitude of the n'th waypoint.\n"
+            "--lat<n>=<latitude>     Specify the latitude of the n'th waypoint.\n"
+            "\n"
+            "--reverse               Find a route between the waypoints in reverse order.\n"
+            "--loop                  Find a route that returns to the first waypoint.\n"
+            "\n"
+            "Each reply starts with a line 'OK' or 'ERROR' (followed by the identifier\n"
+            "and the distance and duration or an error message) and ends with an empty line.\n",
+            DEFAULT_THREADS,DEFAULT_IDLE_TIMEOUT);
+
+ exit(!detail);
+}
@@ -20,6 +20,7 @@
  ***************************************/
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "routino.h"
 
@@ -28,8 +29,12 @@
 #include "segments.h"
 #include "ways.h"
 #include "relations.h"
+#include "hierarchy.h"
+#include "landmarks.h"
 
+#include "context.h"
 #include "fakes.h"
+#include "matcher.h"
 #include "results.h"
 #include "functions.h"
 #include "profiles.h"
@@ -46,30 +51,20 @@ DLL_PUBLIC const int Routino_APIVersion=ROUTINO_API_VERSION;
 /*+ Contains the Routino version number. +*/
 DLL_PUBLIC const char *Routino_Version=ROUTINO_VERSION;
 
-/*+ Contains the error number of the most recent Routino function (one of the ROUTINO_ERROR_* values). +*/
-DLL_PUBLIC int Routino_errno=ROUTINO_ERROR_NONE;
-
-/*+ The function to be called to report on the routing progress. +*/
-Routino_ProgressFunc progress_func=NULL;
-
-/*+ The current state of the routing progress. +*/
-double progress_value=0;
-
-/*+ Set when the progress callback returns false in the routing function. +*/
-int progress_abort=0;
-
-/*+ The option to calculate the quickest route insted of the shortest. +*/
-extern int option_quickest;
-
-/*+ The options to select the format of the file output. +*/
-extern int option_file_html,option_file_gpx_track,option_file_gpx_route,option_file_text,option_file_text_all,option_file_stdout;
-
-/*+ The options to select the format of the linked list output. +*/
-extern int option_list_html,option_list_html_all,option_list_text,option_list_text_all;
-
 
 /* Static variables */
 
+/*+ Contains the error number of the most recent Routino function called by each thread (read using Routino_errno). +*/
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#if defined(_MSC_VER)
+static __declspec(thread) int routino_errno=ROUTINO_ERROR_NONE;
+#else
+static __thread int routino_errno=ROUTINO_ERROR_NONE;
+#endif
+#else
+static int routino_errno=ROUTINO_ERROR_NONE;
+#endif
+
 static distance_t distmax=km_to_distance(1);
 
 
@@ -81,6 +76,12 @@ struct _Routino_Database
  Segments   *segments;
  Ways       *ways;
  Relations  *relations;
+ Hierarchy  *hierarchy;
+ Landmarks  *landmarks;
+
+ Transport   transport;
+
+ Context    *context;
 };
 
 struct _Routino_Waypoint
@@ -111,7 +112,21 @@ DLL_PUBLIC int Routino_Check_API_Version(int caller_version)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Load a database of files for Routino to use for routing.
+  Get the location of the error number of the most recent Routino function called by this thread.
+
+  int *Routino_ErrnoLocation Returns a pointer to the error number.
+
+  This function should not be called directly, use Routino_errno which is a macro that calls it.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int *Routino_ErrnoLocation(void)
+{
+ return(&routino_errno);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load a database of files for Routino to use for routing (and the contraction hierarchy and landmarks if they exist).
 
   Routino_Database *Routino_LoadDatabase Returns a pointer to the database.
 
@@ -121,39 +136,144 @@ DLL_PUBLIC int Routino_Check_API_Version(int caller_version)
   ++++++++++++++++++++++++++++++++++++++*/
 
 DLL_PUBLIC Routino_Database *Routino_LoadDatabase(const char *dirname,const char *prefix)
+{
+ return(Routino_LoadDatabaseWithOptions(dirname,prefix,NULL));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load a database of files for Routino to use for routing selecting how the files are loaded into memory, the
+  super-graph specialised for one type of transport and the amount of memory for the file caches of the slim library.
+
+  Routino_Database *Routino_LoadDatabaseWithOptions Returns a pointer to the database.
+
+  const char *dirname The pathname of the directory containing the database files.
+
+  const char *prefix The prefix of the database files.
+
+  const Routino_LoadOptions *options The options for loading the database (or NULL for the defaults).
+
+  If there is no specialised super-graph for the transport type then the general purpose database is loaded and
+  can be used with any profile, otherwise only profiles for the same type of transport can be validated.  The
+  memory for the caches is shared between the nodes, segments, ways and turn relations in fixed proportions; the
+  normal library does not use file caches and ignores the size.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC Routino_Database *Routino_LoadDatabaseWithOptions(const char *dirname,const char *prefix,const Routino_LoadOptions *options)
 {
  char *nodes_filename;
  char *segments_filename;
  char *ways_filename;
  char *relations_filename;
+ char *hierarchy_filename;
+ char *landmarks_filename;
+ char *superprefix=NULL;
+ const char *transport=NULL;
+ int container,mapoptions=0;
+ size_t cachesize=0;
  Routino_Database *database=NULL;
 
- nodes_filename    =FileName(dirname,prefix,"nodes.mem");
- segments_filename =FileName(dirname,prefix,"segments.mem");
+ /* Select the options for loading the files */
+
+ if(options)
+   {
+    if(options->options&ROUTINO_LOAD_POPULATE) mapoptions|=MAP_OPTION_POPULATE;
+    if(options->options&ROUTINO_LOAD_WILLNEED) mapoptions|=MAP_OPTION_WILLNEED;
+    if(options->options&ROUTINO_LOAD_RANDOM)   mapoptions|=MAP_OPTION_RANDOM;
+    if(options->options&ROUTINO_LOAD_HUGEPAGE) mapoptions|=MAP_OPTION_HUGEPAGE;
+    if(options->options&ROUTINO_LOAD_COPY)     mapoptions|=MAP_OPTION_COPY;
+    if(options->options&ROUTINO_LOAD_LOCK)     mapoptions|=MAP_OPTION_LOCK;
+
+    transport=options->transport;
+
+    cachesize=(size_t)options->cachesize;
+   }
+
+ /* Use a single database container file if there is one */
+
+ container=OpenContainer(dirname,prefix);
+
+ if(container==-2)
+   {
+    Routino_errno=ROUTINO_ERROR_BAD_DATABASE_FILES;
+    return(NULL);
+   }
+
+ /* Use the super-graph specialised for the transport type if planetsplitter created one */
+
+ if(transport && TransportType(transport)!=Transport_None)
+   {
+    superprefix=(char*)malloc((prefix?strlen(prefix)+1:0)+strlen(transport)+1);
+
+    sprintf(superprefix,"%s%s%s",prefix?prefix:"",prefix?"-":"",transport);
+
+    nodes_filename=FileName(dirname,superprefix,"nodes.mem");
+
+    if(!ExistsFile(nodes_filename))
+      {
+       free(superprefix);
+       superprefix=NULL;
+      }
+
+    free(nodes_filename);
+   }
+
+ nodes_filename    =FileName(dirname,superprefix?superprefix:prefix,"nodes.mem");
+ segments_filename =FileName(dirname,superprefix?superprefix:prefix,"segments.mem");
  ways_filename     =FileName(dirname,prefix,"ways.mem");
- relations_filename=FileName(dirname,prefix,"relations.mem");
+ relations_filename=FileName(dirname,superprefix?superprefix:prefix,"relations.mem");
+ hierarchy_filename=FileName(dirname,superprefix?superprefix:prefix,"hierarchy.mem");
+ landmarks_filename=FileName(dirname,superprefix?superprefix:prefix,"landmarks.mem");
 
- if(!ExistsFile(nodes_filename) || !ExistsFile(nodes_filename) || !ExistsFile(nodes_filename) || !ExistsFile(nodes_filename))
+ if(!ExistsFile(nodes_filename) || !ExistsFile(segments_filename) || !ExistsFile(ways_filename) || !ExistsFile(relations_filename))
    {
     Routino_errno=ROUTINO_ERROR_NO_DATABASE_FILES;
     return(NULL);
    }
+ else if(CheckFileHeader(nodes_filename,NODES_MAGIC) || CheckFileHeader(segments_filename,SEGMENTS_MAGIC) ||
+         CheckFileHeader(ways_filename,WAYS_MAGIC) || CheckFileHeader(relations_filename,RELATIONS_MAGIC) ||
+         (ExistsFile(hierarchy_filename) && CheckFileHeader(hierarchy_filename,HIERARCHY_MAGIC)) ||
+         (ExistsFile(landmarks_filename) && CheckFileHeader(landmarks_filename,LANDMARKS_MAGIC)))
+   {
+    Routino_errno=ROUTINO_ERROR_DATABASE_VERSION;
+   }
  else
    {
     database=calloc(sizeof(Routino_Database),1);
 
-    database->nodes    =LoadNodeList    (nodes_filename);
-    database->segments =LoadSegmentList (segments_filename);
-    database->ways     =LoadWayList     (ways_filename);
-    database->relations=LoadRelationList(relations_filename);
+    database->nodes    =LoadNodeList    (nodes_filename    ,mapoptions,cachesize);
+    database->segments =LoadSegmentList (segments_filename ,mapoptions,cachesize);
+    database->ways     =LoadWayList     (ways_filename     ,mapoptions,cachesize);
+    database->relations=LoadRelationList(relations_filename,mapoptions,cachesize);
+
+    if(ExistsFile(hierarchy_filename))
+       database->hierarchy=LoadHierarchy(hierarchy_filename,mapoptions);
+
+    if(ExistsFile(landmarks_filename))
+       database->landmarks=LoadLandmarks(landmarks_filename,mapoptions);
+
+    database->transport=superprefix?TransportType(transport):Transport_None;
+
+    database->context=NewContext(database->hierarchy);
+
+    database->context->database=database;
    }
 
+ if(container>=0)
+    CloseContainer(container);
+
  free(nodes_filename);
  free(segments_filename);
  free(ways_filename);
  free(relations_filename);
+ free(hierarchy_filename);
+ free(landmarks_filename);
 
- if(!database->nodes || !database->segments || !database->ways || !database->relations)
+ if(superprefix)
+    free(superprefix);
+
+ if(database && (!database->nodes || !database->segments || !database->ways || !database->relations ||
+                 database->nodes->file.waychecksum!=database->ways->file.checksum))
    {
     Routino_UnloadDatabase(database);
     database=NULL;
@@ -187,6 +307,9 @@ DLL_PUBLIC void Routino_UnloadDatabase(Routino_Database *database)
     if(database->segments)  DestroySegmentList (database->segments);
     if(database->ways)      DestroyWayList     (database->ways);
     if(database->relations) DestroyRelationList(database->relations);
+    if(database->hierarchy) DestroyHierarchy   (database->hierarchy);
+    if(database->landmarks) DestroyLandmarks   (database->landmarks);
+    if(database->context)   FreeContext        (database->context);
 
     free(database);
 
@@ -195,6 +318,161 @@ DLL_PUBLIC void Routino_UnloadDatabase(Routino_Database *database)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Get the combined statistics of the file caches used by a database in the slim library (all zero for the normal library).
+
+  int Routino_GetCacheStatistics Returns ROUTINO_ERROR_NONE or an error code.
+
+  Routino_Database *database The loaded database to check.
+
+  Routino_CacheStatistics *statistics Returns the statistics.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_GetCacheStatistics(Routino_Database *database,Routino_CacheStatistics *statistics)
+{
+#if SLIM
+ CacheStatistics *stats[8];
+ int i,nstats=0;
+#endif
+
+ if(!database)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_DATABASE;
+    return(Routino_errno);
+   }
+
+ statistics->hits=statistics->misses=statistics->evictions=statistics->memory=0;
+
+#if SLIM
+
+ stats[nstats++]=&database->nodes->poscache->stats;
+ if(database->nodes->cache)              stats[nstats++]=&database->nodes->cache->stats;
+ if(database->nodes->blockcache)         stats[nstats++]=&database->nodes->blockcache->stats;
+ if(database->segments->cache)           stats[nstats++]=&database->segments->cache->stats;
+ if(database->segments->blockcache)      stats[nstats++]=&database->segments->blockcache->stats;
+ if(database->segments->edgecache)       stats[nstats++]=&database->segments->edgecache->stats;
+ if(database->segments->edgeblockcache)  stats[nstats++]=&database->segments->edgeblockcache->stats;
+ stats[nstats++]=&database->ways->cache->stats;
+ stats[nstats++]=&database->relations->cache->stats;
+
+ for(i=0;i<nstats;i++)
+   {
+    statistics->hits     +=(unsigned long)stats[i]->hits;
+    statistics->misses   +=(unsigned long)stats[i]->misses;
+    statistics->evictions+=(unsigned long)stats[i]->evictions;
+    statistics->memory   +=(unsigned long)stats[i]->size;
+   }
+
+#endif
+
+ Routino_errno=ROUTINO_ERROR_NONE;
+ return(Routino_errno);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create a routing context for a database so that routes can be calculated in
+  several threads at the same time (one context for each thread).
+
+  Routino_Context *Routino_CreateContext Returns a pointer to the context.
+
+  Routino_Database *database The loaded database to use.
+
+  Each context holds the fake nodes, options, progress state and customised
+  contraction hierarchy scores of one calculation.  The non-slim database is only
+  read while routing so one loaded database can be shared by all of the contexts,
+  the slim database has a file cache that is modified on every access so each
+  thread needs its own loaded database.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC Routino_Context *Routino_CreateContext(Routino_Database *database)
+{
+ Routino_Context *context;
+
+ if(!database)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_DATABASE;
+    return(NULL);
+   }
+
+ context=NewContext(database->hierarchy);
+
+ context->database=database;
+
+ Routino_errno=ROUTINO_ERROR_NONE;
+ return(context);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Delete a routing context that was created by a call to Routino_CreateContext().
+
+  Routino_Context *context The context to delete.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC void Routino_DeleteContext(Routino_Context *context)
+{
+ if(!context)
+    Routino_errno=ROUTINO_ERROR_NO_CONTEXT;
+ else
+   {
+    FreeContext(context);
+
+    Routino_errno=ROUTINO_ERROR_NONE;
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get the error number of the most recent function that used a routing context (the
+  same value as Routino_errno in the thread that called it but kept with the context).
+
+  int Routino_ContextErrno Returns one of the ROUTINO_ERROR_* values.
+
+  Routino_Context *context The context to check.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_ContextErrno(Routino_Context *context)
+{
+ if(!context)
+    return(ROUTINO_ERROR_NO_CONTEXT);
+
+ return(context->error);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Select the directory that the output files are written into by the calculations
+  that use a routing context (instead of the current directory).
+
+  int Routino_SetOutputDirectory Returns ROUTINO_ERROR_NONE or an error code.
+
+  Routino_Context *context The context to modify.
+
+  const char *dirname The name of the directory or NULL for the current directory.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_SetOutputDirectory(Routino_Context *context,const char *dirname)
+{
+ if(!context)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_CONTEXT;
+    return(Routino_errno);
+   }
+
+ if(context->dirname)
+    free(context->dirname);
+
+ if(dirname)
+    context->dirname=strdup(dirname);
+ else
+    context->dirname=NULL;
+
+ Routino_errno=context->error=ROUTINO_ERROR_NONE;
+ return(Routino_errno);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Parse a Routino XML file containing profiles, must be called before selecting a profile.
 
@@ -354,7 +632,7 @@ DLL_PUBLIC void Routino_FreeXMLTranslations(void)
 /*++++++++++++++++++++++++++++++++++++++
   Create a fully formed Routino Profile from a Routino User Profile.
 
-  Routino_Profile *Routino_CreateProfileFromUserProfile Returns an allocated Routino Profile.
+  Routino_Profile *Routino_CreateProfileFromUserProfile Returns an allocated Routino Profile (to be deleted with Routino_DeleteProfile()).
 
   Routino_UserProfile *profile The user specified profile to convert (not modified by this).
   ++++++++++++++++++++++++++++++++++++++*/
@@ -459,6 +737,26 @@ DLL_PUBLIC Routino_UserProfile *Routino_CreateUserProfileFromProfile(Routino_Pro
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Delete a Routino Profile that was created by Routino_CreateProfileFromUserProfile().
+
+  Routino_Profile *profile The Routino Profile to delete.
+
+  The table of way costs that is created by Routino_ValidateProfile() is freed as well as the profile.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC void Routino_DeleteProfile(Routino_Profile *profile)
+{
+ if(!profile)
+    return;
+
+ if(profile->waycosts)
+    free(profile->waycosts);
+
+ free(profile);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Validates that a selected routing profile is valid for use with the selected routing database.
 
@@ -467,13 +765,21 @@ DLL_PUBLIC Routino_UserProfile *Routino_CreateUserProfileFromProfile(Routino_Pro
   Routino_Database *database The Routino database to use.
 
   Routino_Profile *profile The Routino profile to validate.
+
+  The profile stores a table of way costs for the database so it can only be used with databases that have the same
+  ways as the one that it was most recently validated for and it must not be validated again while it is being used
+  in another thread.
   ++++++++++++++++++++++++++++++++++++++*/
 
 DLL_PUBLIC int Routino_ValidateProfile(Routino_Database *database,Routino_Profile *profile)
 {
  Routino_errno=ROUTINO_ERROR_NONE;
 
- if(UpdateProfile(profile,database->ways))
+ /* A super-graph specialised for one type of transport can only be used by that type of transport */
+
+ if(database->transport!=Transport_None && profile->transport!=database->transport)
+    Routino_errno=ROUTINO_ERROR_PROFILE_DATABASE_ERR;
+ else if(UpdateProfile(profile,database->ways))
     Routino_errno=ROUTINO_ERROR_PROFILE_DATABASE_ERR;
 
  return(Routino_errno);
@@ -511,7 +817,7 @@ DLL_PUBLIC Routino_Waypoint *Routino_FindWaypoint(Routino_Database *database,Rou
     return(NULL);
    }
 
- if(!profile->allow)
+ if(!profile->allow || profile->waychecksum!=database->ways->file.checksum)
    {
     Routino_errno=ROUTINO_ERROR_NOTVALID_PROFILE;
     return(NULL);
@@ -537,182 +843,335 @@ DLL_PUBLIC Routino_Waypoint *Routino_FindWaypoint(Routino_Database *database,Rou
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Calculate a route using a loaded database, chosen profile, chosen translation and set of waypoints.
-
-  Routino_Output *Routino_CalculateRoute Returns the head of a linked list of route data (if requested) or NULL.
+  Finds the nearest point in the database to each of a set of latitudes and longitudes. The points
+  that are close together share the search of the database so this is faster than calling
+  Routino_FindWaypoint() for each one and the results are the same.
 
-  Routino_Database *database The loaded database to use.
+  int Routino_FindWaypoints Returns the number of waypoints found or -1 in case of an error.
 
-  Routino_Profile *profile The chosen routing profile to use.
+  Routino_Database *database The Routino database to use.
 
-  Routino_Translation *translation The chosen translation information to use.
+  Routino_Profile *profile The Routino profile to use.
 
-  Routino_Waypoint **waypoints The set of waypoints.
+  const double *latitudes The latitudes in degrees of the points.
 
-  int nwaypoints The number of waypoints.
+  const double *longitudes The longitudes in degrees of the points.
 
-  int options The set of routing options (ROUTINO_ROUTE_*) ORed together.
+  int npoints The number of points.
 
-  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
+  Routino_Waypoint **waypoints Returns a pointer to a newly allocated Routino waypoint for each point or NULL if none could be found.
   ++++++++++++++++++++++++++++++++++++++*/
 
-DLL_PUBLIC Routino_Output *Routino_CalculateRoute(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
-                                                  Routino_Waypoint **waypoints,int nwaypoints,int options,Routino_ProgressFunc progress)
+DLL_PUBLIC int Routino_FindWaypoints(Routino_Database *database,Routino_Profile *profile,const double *latitudes,const double *longitudes,
+                                     int npoints,Routino_Waypoint **waypoints)
 {
- int first_waypoint,last_waypoint,this_waypoint,nwaypoints_routed,inc_dec_waypoint,start_waypoint,finish_waypoint=-1;
- index_t start_node,finish_node=NO_NODE;
- index_t join_segment=NO_SEGMENT;
- Results **results;
- Routino_Output *output=NULL;
-
- /* Check the input data */
+ double *lats,*lons;
+ index_t *segment,*node1,*node2;
+ distance_t *dist,*dist1,*dist2;
+ int i,nfound=0;
 
  if(!database)
    {
     Routino_errno=ROUTINO_ERROR_NO_DATABASE;
-    return(NULL);
+    return(-1);
    }
 
  if(!profile)
    {
     Routino_errno=ROUTINO_ERROR_NO_PROFILE;
-    return(NULL);
+    return(-1);
    }
 
- if(!profile->allow)
+ if(!profile->allow || profile->waychecksum!=database->ways->file.checksum)
    {
     Routino_errno=ROUTINO_ERROR_NOTVALID_PROFILE;
-    return(NULL);
+    return(-1);
    }
 
- if(!translation)
+ if(npoints<=0)
    {
-    Routino_errno=ROUTINO_ERROR_NO_TRANSLATION;
-    return(NULL);
+    Routino_errno=ROUTINO_ERROR_NONE;
+    return(0);
    }
 
- /* Extract the options */
-
- if(options&ROUTINO_ROUTE_QUICKEST) option_quickest=1; else option_quickest=0;
+ lats=(double*)malloc(npoints*sizeof(double));
+ lons=(double*)malloc(npoints*sizeof(double));
 
- if(options&ROUTINO_ROUTE_FILE_HTML)      option_file_html=1;      else option_file_html=0;
- if(options&ROUTINO_ROUTE_FILE_GPX_TRACK) option_file_gpx_track=1; else option_file_gpx_track=0;
- if(options&ROUTINO_ROUTE_FILE_GPX_ROUTE) option_file_gpx_route=1; else option_file_gpx_route=0;
- if(options&ROUTINO_ROUTE_FILE_TEXT)      option_file_text=1;      else option_file_text=0;
- if(options&ROUTINO_ROUTE_FILE_TEXT_ALL)  option_file_text_all=1;  else option_file_text_all=0;
+ segment=(index_t*)malloc(npoints*sizeof(index_t));
+ node1  =(index_t*)malloc(npoints*sizeof(index_t));
+ node2  =(index_t*)malloc(npoints*sizeof(index_t));
 
- if(options&ROUTINO_ROUTE_FILE_STDOUT)    option_file_stdout=1;    else option_file_stdout=0;
+ dist =(distance_t*)malloc(npoints*sizeof(distance_t));
+ dist1=(distance_t*)malloc(npoints*sizeof(distance_t));
+ dist2=(distance_t*)malloc(npoints*sizeof(distance_t));
 
- if(option_file_stdout && (option_file_html+option_file_gpx_track+option_file_gpx_route+option_file_text+option_file_text_all)!=1)
+ for(i=0;i<npoints;i++)
    {
-    Routino_errno=ROUTINO_ERROR_BAD_OPTIONS;
-    return(NULL);
+    lats[i]=degrees_to_radians(latitudes[i]);
+    lons[i]=degrees_to_radians(longitudes[i]);
    }
 
- if(options&ROUTINO_ROUTE_LIST_HTML)     option_list_html=1;      else option_list_html=0;
- if(options&ROUTINO_ROUTE_LIST_HTML_ALL) option_list_html_all=1;  else option_list_html_all=0;
- if(options&ROUTINO_ROUTE_LIST_TEXT)     option_list_text=1;      else option_list_text=0;
- if(options&ROUTINO_ROUTE_LIST_TEXT_ALL) option_list_text_all=1;  else option_list_text_all=0;
+ FindClosestSegments(database->nodes,database->segments,database->ways,npoints,lats,lons,distmax,profile,
+                     segment,dist,node1,node2,dist1,dist2);
 
- if((option_list_html+option_list_html_all+option_list_text+option_list_text_all)>1)
+ for(i=0;i<npoints;i++)
    {
-    Routino_errno=ROUTINO_ERROR_BAD_OPTIONS;
-    return(NULL);
-   }
+    if(segment[i]==NO_SEGMENT)
+       waypoints[i]=NULL;
+    else
+      {
+       waypoints[i]=calloc(sizeof(Routino_Waypoint),1);
 
- /* Set up the progress callback */
+       waypoints[i]->segment=segment[i];
+       waypoints[i]->node1  =node1[i];
+       waypoints[i]->node2  =node2[i];
+       waypoints[i]->dist1  =dist1[i];
+       waypoints[i]->dist2  =dist2[i];
 
- progress_func=progress;
- progress_value=0.0;
- progress_abort=0;
+       nfound++;
+      }
+   }
 
- /* Check for loop and reverse options */
+ free(lats);
+ free(lons);
 
- if(options&ROUTINO_ROUTE_LOOP)
-    nwaypoints_routed=nwaypoints+1;
- else
-    nwaypoints_routed=nwaypoints;
+ free(segment);
+ free(node1);
+ free(node2);
 
- if(options&ROUTINO_ROUTE_REVERSE)
-   {
-    first_waypoint=nwaypoints_routed-1;
-    last_waypoint=0;
+ free(dist);
+ free(dist1);
+ free(dist2);
 
-    inc_dec_waypoint=-1;
-   }
+ if(nfound<npoints)
+    Routino_errno=ROUTINO_ERROR_NO_NEARBY_HIGHWAY;
  else
-   {
-    first_waypoint=0;
-    last_waypoint=nwaypoints_routed-1;
+    Routino_errno=ROUTINO_ERROR_NONE;
 
-    inc_dec_waypoint=1;
-   }
+ return(nfound);
+}
 
- /* Loop through all pairs of waypoints */
 
- results=calloc(sizeof(Results*),nwaypoints);
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate a route using a loaded database, chosen profile, chosen translation and set of waypoints.
 
- for(this_waypoint=first_waypoint;this_waypoint!=(last_waypoint+inc_dec_waypoint);this_waypoint+=inc_dec_waypoint)
-   {
-    int waypoint=this_waypoint%nwaypoints;
-    int waypoint_count=(this_waypoint-first_waypoint)*inc_dec_waypoint;
+  Routino_Output *Routino_CalculateRoute Returns the head of a linked list of route data (if requested) or NULL.
 
-    if(progress_func)
-      {
-       progress_value=(double)waypoint_count/(double)(nwaypoints_routed+1);
+  Routino_Database *database The loaded database to use.
 
-       if(!progress_func(progress_value))
-         {
-          Routino_errno=ROUTINO_ERROR_PROGRESS_ABORTED;
-          goto tidy_and_exit;
-         }
-      }
+  Routino_Profile *profile The chosen routing profile to use.
 
-    start_waypoint=finish_waypoint;
-    start_node=finish_node;
+  Routino_Translation *translation The chosen translation information to use.
 
-    finish_waypoint=waypoint+1;
-    finish_node=CreateFakes(database->nodes,database->segments,finish_waypoint,
-                            LookupSegment(database->segments,waypoints[waypoint]->segment,1),
-                            waypoints[waypoint]->node1,waypoints[waypoint]->node2,waypoints[waypoint]->dist1,waypoints[waypoint]->dist2);
+  Routino_Waypoint **waypoints The set of waypoints.
 
-    if(waypoint_count==0)
-       continue;
+  int nwaypoints The number of waypoints.
 
-    results[waypoint_count-1]=CalculateRoute(database->nodes,database->segments,database->ways,database->relations,
-                                             profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
+  int options The set of routing options (ROUTINO_ROUTE_*) ORed together.
 
-    if(!results[waypoint_count-1])
-      {
-       if(progress_func && progress_abort)
-          Routino_errno=ROUTINO_ERROR_PROGRESS_ABORTED;
-       else
-          Routino_errno=ROUTINO_ERROR_NO_ROUTE_1-1+start_waypoint;
+  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
 
-       goto tidy_and_exit;
-      }
+  The default context of the database is used so only one calculation at a time is possible,
+  use Routino_CalculateRouteInContext() with a separate context for each thread instead.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC Routino_Output *Routino_CalculateRoute(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                                                  Routino_Waypoint **waypoints,int nwaypoints,int options,Routino_ProgressFunc progress)
+{
+ if(!database)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_DATABASE;
+    return(NULL);
+   }
+
+ return(Routino_CalculateRouteInContext(database->context,profile,translation,waypoints,nwaypoints,options,progress));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate a route using a routing context, chosen profile, chosen translation and set of waypoints.
+
+  Routino_Output *Routino_CalculateRouteInContext Returns the head of a linked list of route data (if requested) or NULL.
+
+  Routino_Context *context The routing context to use (which selects the database).
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  Routino_Translation *translation The chosen translation information to use.
+
+  Routino_Waypoint **waypoints The set of waypoints.
+
+  int nwaypoints The number of waypoints.
+
+  int options The set of routing options (ROUTINO_ROUTE_*) ORed together.
+
+  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC Routino_Output *Routino_CalculateRouteInContext(Routino_Context *context,Routino_Profile *profile,Routino_Translation *translation,
+                                                           Routino_Waypoint **waypoints,int nwaypoints,int options,Routino_ProgressFunc progress)
+{
+ Routino_Database *database;
+ int first_waypoint,last_waypoint,this_waypoint,nwaypoints_routed,inc_dec_waypoint,start_waypoint,finish_waypoint=-1;
+ index_t start_node,finish_node=NO_NODE;
+ index_t join_segment=NO_SEGMENT;
+ Results **results;
+ Routino_Output *output=NULL;
+
+ /* Check the input data */
+
+ if(!context)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_CONTEXT;
+    return(NULL);
+   }
+
+ database=context->database;
+
+ if(!profile)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NO_PROFILE;
+    return(NULL);
+   }
+
+ if(!profile->allow || profile->waychecksum!=database->ways->file.checksum)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NOTVALID_PROFILE;
+    return(NULL);
+   }
+
+ if(!translation)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NO_TRANSLATION;
+    return(NULL);
+   }
+
+ /* Extract the options */
+
+ if(options&ROUTINO_ROUTE_QUICKEST) context->quickest=1; else context->quickest=0;
+
+ if(options&ROUTINO_ROUTE_BIDIRECTIONAL) context->bidirectional=1; else context->bidirectional=0;
+
+ if(options&ROUTINO_ROUTE_FILE_HTML)      context->file_html=1;      else context->file_html=0;
+ if(options&ROUTINO_ROUTE_FILE_GPX_TRACK) context->file_gpx_track=1; else context->file_gpx_track=0;
+ if(options&ROUTINO_ROUTE_FILE_GPX_ROUTE) context->file_gpx_route=1; else context->file_gpx_route=0;
+ if(options&ROUTINO_ROUTE_FILE_TEXT)      context->file_text=1;      else context->file_text=0;
+ if(options&ROUTINO_ROUTE_FILE_TEXT_ALL)  context->file_text_all=1;  else context->file_text_all=0;
+
+ if(options&ROUTINO_ROUTE_FILE_STDOUT)    context->file_stdout=1;    else context->file_stdout=0;
+
+ if(context->file_stdout && (context->file_html+context->file_gpx_track+context->file_gpx_route+context->file_text+context->file_text_all)!=1)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS;
+    return(NULL);
+   }
+
+ if(options&ROUTINO_ROUTE_LIST_HTML)     context->list_html=1;      else context->list_html=0;
+ if(options&ROUTINO_ROUTE_LIST_HTML_ALL) context->list_html_all=1;  else context->list_html_all=0;
+ if(options&ROUTINO_ROUTE_LIST_TEXT)     context->list_text=1;      else context->list_text=0;
+ if(options&ROUTINO_ROUTE_LIST_TEXT_ALL) context->list_text_all=1;  else context->list_text_all=0;
+
+ if((context->list_html+context->list_html_all+context->list_text+context->list_text_all)>1)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS;
+    return(NULL);
+   }
+
+ /* Set up the progress callback */
+
+ context->progress_func=progress;
+ context->progress_value=0.0;
+ context->progress_abort=0;
+
+ context->error=ROUTINO_ERROR_NONE;
+
+ /* Check for loop and reverse options */
+
+ if(options&ROUTINO_ROUTE_LOOP)
+    nwaypoints_routed=nwaypoints+1;
+ else
+    nwaypoints_routed=nwaypoints;
+
+ if(options&ROUTINO_ROUTE_REVERSE)
+   {
+    first_waypoint=nwaypoints_routed-1;
+    last_waypoint=0;
+
+    inc_dec_waypoint=-1;
+   }
+ else
+   {
+    first_waypoint=0;
+    last_waypoint=nwaypoints_routed-1;
+
+    inc_dec_waypoint=1;
+   }
+
+ /* Loop through all pairs of waypoints */
+
+ results=calloc(sizeof(Results*),nwaypoints);
+
+ for(this_waypoint=first_waypoint;this_waypoint!=(last_waypoint+inc_dec_waypoint);this_waypoint+=inc_dec_waypoint)
+   {
+    int waypoint=this_waypoint%nwaypoints;
+    int waypoint_count=(this_waypoint-first_waypoint)*inc_dec_waypoint;
+
+    if(context->progress_func)
+      {
+       context->progress_value=(double)waypoint_count/(double)(nwaypoints_routed+1);
+
+       if(!context->progress_func(context->progress_value))
+         {
+          Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+          goto tidy_and_exit;
+         }
+      }
+
+    start_waypoint=finish_waypoint;
+    start_node=finish_node;
+
+    finish_waypoint=waypoint+1;
+    finish_node=CreateFakes(&context->fakes,database->nodes,database->segments,finish_waypoint,
+                            LookupSegment(database->segments,waypoints[waypoint]->segment,1),
+                            waypoints[waypoint]->node1,waypoints[waypoint]->node2,waypoints[waypoint]->dist1,waypoints[waypoint]->dist2);
+
+    if(waypoint_count==0)
+       continue;
+
+    results[waypoint_count-1]=CalculateRoute(context,database->nodes,database->segments,database->ways,database->relations,database->landmarks,
+                                             profile,start_node,join_segment,finish_node,start_waypoint,finish_waypoint);
+
+    if(!results[waypoint_count-1])
+      {
+       if(context->progress_func && context->progress_abort)
+          Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+       else
+          Routino_errno=context->error=ROUTINO_ERROR_NO_ROUTE_1-1+start_waypoint;
+
+       goto tidy_and_exit;
+      }
 
     join_segment=results[waypoint_count-1]->last_segment;
    }
 
- if(progress_func)
+ if(context->progress_func)
    {
-    progress_value=(double)this_waypoint/(double)(nwaypoints_routed+1);
+    context->progress_value=(double)this_waypoint/(double)(nwaypoints_routed+1);
 
-    if(!progress_func(progress_value))
+    if(!context->progress_func(context->progress_value))
       {
-       Routino_errno=ROUTINO_ERROR_PROGRESS_ABORTED;
+       Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
        goto tidy_and_exit;
       }
    }
 
  /* Print the route */
 
- output=PrintRoute(results,nwaypoints_routed-1,database->nodes,database->segments,database->ways,database->relations,profile,translation);
+ output=PrintRoute(context,results,nwaypoints_routed-1,database->nodes,database->segments,database->ways,database->relations,profile,translation);
 
- if(progress_func && !progress_func(1.0))
+ if(context->progress_func && !context->progress_func(1.0))
    {
-    Routino_errno=ROUTINO_ERROR_PROGRESS_ABORTED;
+    Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
     goto tidy_and_exit;
    }
 
@@ -720,11 +1179,11 @@ DLL_PUBLIC Routino_Output *Routino_CalculateRoute(Routino_Database *database,Rou
 
  tidy_and_exit:
 
- DeleteFakeNodes();
+ DeleteFakeNodes(&context->fakes);
 
  for(this_waypoint=0;this_waypoint<nwaypoints;this_waypoint++)
     if(results[this_waypoint])
-       FreeResultsList(results[this_waypoint]);
+       PutResultsList(&context->pool,results[this_waypoint]);
 
  free(results);
 
@@ -761,3 +1220,585 @@ DLL_PUBLIC void Routino_DeleteRoute(Routino_Output *output)
     output=next;
    }
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance and duration of the routes between every one of a set of source
+  waypoints and every one of a set of destination waypoints.
+
+  int Routino_CalculateMatrix Returns ROUTINO_ERROR_NONE or an error code.
+
+  Routino_Database *database The loaded database to use.
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  Routino_Waypoint **waypoints The set of waypoints, the source waypoints followed by the destination waypoints.
+
+  int nsources The number of source waypoints.
+
+  int ndestinations The number of destination waypoints.
+
+  int options The set of routing options (only ROUTINO_ROUTE_SHORTEST, ROUTINO_ROUTE_QUICKEST or ROUTINO_ROUTE_BIDIRECTIONAL).
+
+  float *distances Returns the distance (km) from each source to each destination (destinations vary fastest) or -1 if there is no route.
+
+  float *durations Returns the duration (minutes) from each source to each destination (destinations vary fastest) or -1 if there is no route.
+
+  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
+
+  The default context of the database is used so only one calculation at a time is possible,
+  use Routino_CalculateMatrixInContext() with a separate context for each thread instead.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_CalculateMatrix(Routino_Database *database,Routino_Profile *profile,
+                                       Routino_Waypoint **waypoints,int nsources,int ndestinations,int options,
+                                       float *distances,float *durations,Routino_ProgressFunc progress)
+{
+ if(!database)
+    return(Routino_errno=ROUTINO_ERROR_NO_DATABASE);
+
+ return(Routino_CalculateMatrixInContext(database->context,profile,waypoints,nsources,ndestinations,options,distances,durations,progress));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance and duration of the routes between every one of a set of source
+  waypoints and every one of a set of destination waypoints.
+
+  int Routino_CalculateMatrixInContext Returns ROUTINO_ERROR_NONE or an error code.
+
+  Routino_Context *context The routing context to use (which selects the database).
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  Routino_Waypoint **waypoints The set of waypoints, the source waypoints followed by the destination waypoints.
+
+  int nsources The number of source waypoints.
+
+  int ndestinations The number of destination waypoints.
+
+  int options The set of routing options (only ROUTINO_ROUTE_SHORTEST, ROUTINO_ROUTE_QUICKEST or ROUTINO_ROUTE_BIDIRECTIONAL).
+
+  float *distances Returns the distance (km) from each source to each destination (destinations vary fastest) or -1 if there is no route.
+
+  float *durations Returns the duration (minutes) from each source to each destination (destinations vary fastest) or -1 if there is no route.
+
+  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_CalculateMatrixInContext(Routino_Context *context,Routino_Profile *profile,
+                                                Routino_Waypoint **waypoints,int nsources,int ndestinations,int options,
+                                                float *distances,float *durations,Routino_ProgressFunc progress)
+{
+ Routino_Database *database;
+ Matrix *matrix;
+ int *status;
+ distance_t *row_distances;
+ duration_t *row_durations;
+ int source,destination;
+
+ /* Check the input data */
+
+ if(!context)
+    return(Routino_errno=ROUTINO_ERROR_NO_CONTEXT);
+
+ database=context->database;
+
+ if(!profile)
+    return(Routino_errno=context->error=ROUTINO_ERROR_NO_PROFILE);
+
+ if(!profile->allow || profile->waychecksum!=database->ways->file.checksum)
+    return(Routino_errno=context->error=ROUTINO_ERROR_NOTVALID_PROFILE);
+
+ /* Extract the options */
+
+ if(options&~(ROUTINO_ROUTE_QUICKEST|ROUTINO_ROUTE_BIDIRECTIONAL))
+    return(Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS);
+
+ if(options&ROUTINO_ROUTE_QUICKEST) context->quickest=1; else context->quickest=0;
+
+ if(options&ROUTINO_ROUTE_BIDIRECTIONAL) context->bidirectional=1; else context->bidirectional=0;
+
+ /* Set up the progress callback */
+
+ context->progress_func=progress;
+ context->progress_value=0.0;
+ context->progress_abort=0;
+
+ Routino_errno=context->error=ROUTINO_ERROR_NONE;
+
+ /* Search backwards from each of the destinations (the fake nodes and segments for the
+    destinations are always created with point number 2 and the sources with point number 1) */
+
+ matrix=NewMatrix(ndestinations);
+
+ status=(int*)malloc(ndestinations*sizeof(int));
+ row_distances=(distance_t*)malloc(ndestinations*sizeof(distance_t));
+ row_durations=(duration_t*)malloc(ndestinations*sizeof(duration_t));
+
+ for(destination=0;destination<ndestinations;destination++)
+   {
+    Routino_Waypoint *waypoint=waypoints[nsources+destination];
+    index_t finish_node;
+
+    if(context->progress_func)
+      {
+       context->progress_value=(double)destination/(double)(ndestinations+nsources);
+
+       if(!context->progress_func(context->progress_value))
+         {
+          Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+          goto tidy_and_exit;
+         }
+      }
+
+    DeleteFakeNodes(&context->fakes);
+
+    finish_node=CreateFakes(&context->fakes,database->nodes,database->segments,2,
+                            LookupSegment(database->segments,waypoint->segment,1),
+                            waypoint->node1,waypoint->node2,waypoint->dist1,waypoint->dist2);
+
+    AddMatrixFinish(context,matrix,database->nodes,database->segments,database->ways,database->relations,profile,
+                    destination,finish_node);
+   }
+
+ /* Search forwards from each of the sources and join to the destinations */
+
+ for(source=0;source<nsources;source++)
+   {
+    Routino_Waypoint *waypoint=waypoints[source];
+    index_t start_node;
+
+    if(context->progress_func)
+      {
+       context->progress_value=(double)(ndestinations+source)/(double)(ndestinations+nsources);
+
+       if(!context->progress_func(context->progress_value))
+         {
+          Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+          goto tidy_and_exit;
+         }
+      }
+
+    DeleteFakeNodes(&context->fakes);
+
+    start_node=CreateFakes(&context->fakes,database->nodes,database->segments,1,
+                           LookupSegment(database->segments,waypoint->segment,1),
+                           waypoint->node1,waypoint->node2,waypoint->dist1,waypoint->dist2);
+
+    CalculateMatrixRow(context,matrix,database->nodes,database->segments,database->ways,database->relations,profile,
+                       start_node,status,row_distances,row_durations);
+
+    for(destination=0;destination<ndestinations;destination++)
+      {
+       Routino_Waypoint *waypoint2=waypoints[nsources+destination];
+       float *distance=&distances[source*ndestinations+destination];
+       float *duration=&durations[source*ndestinations+destination];
+
+       /* Waypoints that are close together need the complete route calculating */
+
+       if(status[destination]==-1 || waypoint->segment==waypoint2->segment)
+         {
+          Results *results;
+          index_t finish_node;
+
+          DeleteFakeNodes(&context->fakes);
+
+          start_node=CreateFakes(&context->fakes,database->nodes,database->segments,1,
+                                 LookupSegment(database->segments,waypoint->segment,1),
+                                 waypoint->node1,waypoint->node2,waypoint->dist1,waypoint->dist2);
+
+          finish_node=CreateFakes(&context->fakes,database->nodes,database->segments,2,
+                                  LookupSegment(database->segments,waypoint2->segment,1),
+                                  waypoint2->node1,waypoint2->node2,waypoint2->dist1,waypoint2->dist2);
+
+          results=CalculateRoute(context,database->nodes,database->segments,database->ways,database->relations,database->landmarks,
+                                 profile,start_node,NO_SEGMENT,finish_node,1,2);
+
+          if(results)
+            {
+             CalculateRouteTotals(context,results,database->segments,database->ways,profile,&row_distances[destination],&row_durations[destination]);
+
+             PutResultsList(&context->pool,results);
+
+             status[destination]=1;
+            }
+          else if(context->progress_func && context->progress_abort)
+            {
+             Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+             goto tidy_and_exit;
+            }
+          else
+             status[destination]=0;
+         }
+
+       if(status[destination]==1)
+         {
+          *distance=distance_to_km(row_distances[destination]);
+          *duration=duration_to_minutes(row_durations[destination]);
+         }
+       else
+         {
+          *distance=-1;
+          *duration=-1;
+         }
+      }
+   }
+
+ if(context->progress_func && !context->progress_func(1.0))
+    Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+
+ /* Tidy up and exit */
+
+ tidy_and_exit:
+
+ DeleteFakeNodes(&context->fakes);
+
+ FreeMatrix(matrix);
+
+ free(status);
+ free(row_distances);
+ free(row_durations);
+
+ return(context->error);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find all of the points that can be reached from a waypoint within a limited distance or duration.
+
+  Routino_Output *Routino_CalculateIsochrone Returns a linked list of the reachable points (sorted
+                                             by increasing distance or duration) or NULL on error.
+
+  Routino_Database *database The loaded database to use.
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  Routino_Translation *translation The chosen translation information to use (only needed for ROUTINO_ROUTE_FILE_TEXT).
+
+  Routino_Waypoint *waypoint The waypoint to start from.
+
+  float limit The limit of the distance (km) for the shortest or duration (minutes) for the quickest.
+
+  int options The set of routing options (only ROUTINO_ROUTE_QUICKEST, ROUTINO_ROUTE_FILE_TEXT,
+              ROUTINO_ROUTE_FILE_STDOUT and any one of the ROUTINO_ROUTE_LIST_* options).
+
+  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
+
+  The default context of the database is used so only one calculation at a time is possible,
+  use Routino_CalculateIsochroneInContext() with a separate context for each thread instead.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC Routino_Output *Routino_CalculateIsochrone(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                                                      Routino_Waypoint *waypoint,float limit,int options,Routino_ProgressFunc progress)
+{
+ if(!database)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_DATABASE;
+    return(NULL);
+   }
+
+ return(Routino_CalculateIsochroneInContext(database->context,profile,translation,waypoint,limit,options,progress));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find all of the points that can be reached from a waypoint within a limited distance or duration.
+
+  Routino_Output *Routino_CalculateIsochroneInContext Returns a linked list of the reachable points (sorted
+                                             by increasing distance or duration) or NULL on error.
+
+  Routino_Context *context The routing context to use (which selects the database).
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  Routino_Translation *translation The chosen translation information to use (only needed for ROUTINO_ROUTE_FILE_TEXT).
+
+  Routino_Waypoint *waypoint The waypoint to start from.
+
+  float limit The limit of the distance (km) for the shortest or duration (minutes) for the quickest.
+
+  int options The set of routing options (only ROUTINO_ROUTE_QUICKEST, ROUTINO_ROUTE_FILE_TEXT,
+              ROUTINO_ROUTE_FILE_STDOUT and any one of the ROUTINO_ROUTE_LIST_* options).
+
+  Routino_ProgressFunc progress A function to be called occasionally to report progress or NULL.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC Routino_Output *Routino_CalculateIsochroneInContext(Routino_Context *context,Routino_Profile *profile,Routino_Translation *translation,
+                                                               Routino_Waypoint *waypoint,float limit,int options,Routino_ProgressFunc progress)
+{
+ Routino_Database *database;
+ Results *results;
+ Routino_Output *output=NULL;
+ index_t start_node;
+ score_t score_limit;
+
+ /* Check the input data */
+
+ if(!context)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_CONTEXT;
+    return(NULL);
+   }
+
+ database=context->database;
+
+ if(!profile)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NO_PROFILE;
+    return(NULL);
+   }
+
+ if(!profile->allow || profile->waychecksum!=database->ways->file.checksum)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NOTVALID_PROFILE;
+    return(NULL);
+   }
+
+ if(!translation && options&ROUTINO_ROUTE_FILE_TEXT)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NO_TRANSLATION;
+    return(NULL);
+   }
+
+ /* Extract the options */
+
+ if(options&~(ROUTINO_ROUTE_QUICKEST|ROUTINO_ROUTE_FILE_TEXT|ROUTINO_ROUTE_FILE_STDOUT|
+              ROUTINO_ROUTE_LIST_HTML|ROUTINO_ROUTE_LIST_HTML_ALL|ROUTINO_ROUTE_LIST_TEXT|ROUTINO_ROUTE_LIST_TEXT_ALL))
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS;
+    return(NULL);
+   }
+
+ if(options&ROUTINO_ROUTE_QUICKEST) context->quickest=1; else context->quickest=0;
+
+ context->file_html=context->file_gpx_track=context->file_gpx_route=context->file_text_all=0;
+
+ if(options&ROUTINO_ROUTE_FILE_TEXT)      context->file_text=1;      else context->file_text=0;
+
+ if(options&ROUTINO_ROUTE_FILE_STDOUT)    context->file_stdout=1;    else context->file_stdout=0;
+
+ if(context->file_stdout && !context->file_text)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS;
+    return(NULL);
+   }
+
+ if(options&ROUTINO_ROUTE_LIST_HTML)     context->list_html=1;      else context->list_html=0;
+ if(options&ROUTINO_ROUTE_LIST_HTML_ALL) context->list_html_all=1;  else context->list_html_all=0;
+ if(options&ROUTINO_ROUTE_LIST_TEXT)     context->list_text=1;      else context->list_text=0;
+ if(options&ROUTINO_ROUTE_LIST_TEXT_ALL) context->list_text_all=1;  else context->list_text_all=0;
+
+ if((context->list_html+context->list_html_all+context->list_text+context->list_text_all)>1)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS;
+    return(NULL);
+   }
+
+ if(context->quickest==0)
+    score_limit=(score_t)km_to_distance(limit);
+ else
+    score_limit=(score_t)minutes_to_duration(limit);
+
+ /* Set up the progress callback */
+
+ context->progress_func=progress;
+ context->progress_value=0.0;
+ context->progress_abort=0;
+
+ Routino_errno=context->error=ROUTINO_ERROR_NONE;
+
+ /* Search outwards from the waypoint */
+
+ start_node=CreateFakes(&context->fakes,database->nodes,database->segments,1,
+                        LookupSegment(database->segments,waypoint->segment,1),
+                        waypoint->node1,waypoint->node2,waypoint->dist1,waypoint->dist2);
+
+ results=CalculateIsochrone(context,database->nodes,database->segments,database->ways,database->relations,profile,start_node,score_limit);
+
+ if(context->progress_func && context->progress_abort)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+    goto tidy_and_exit;
+   }
+
+ /* Print the reachable points */
+
+ output=PrintIsochrone(context,results,database->nodes,database->segments,database->ways,profile,translation);
+
+ if(context->progress_func && !context->progress_func(1.0))
+   {
+    Routino_DeleteRoute(output);
+    output=NULL;
+
+    Routino_errno=context->error=ROUTINO_ERROR_PROGRESS_ABORTED;
+   }
+
+ /* Tidy up and exit */
+
+ tidy_and_exit:
+
+ DeleteFakeNodes(&context->fakes);
+
+ PutResultsList(&context->pool,results);
+
+ return(output);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Match the points of a GPS trace to the most likely positions on the highways that were travelled.
+
+  int Routino_MatchTrace Returns the number of points that were matched or -1 in case of an error.
+
+  Routino_Database *database The loaded database to use.
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  const double *latitudes The latitudes in degrees of the points of the trace (in order).
+
+  const double *longitudes The longitudes in degrees of the points of the trace (in order).
+
+  int npoints The number of points in the trace.
+
+  double accuracy The accuracy of the points of the trace (in metres).
+
+  Routino_Waypoint **waypoints Returns a pointer to a newly allocated Routino waypoint for each point or NULL if it could not be matched.
+
+  float *distances Returns the distance (km) along the highways from the previous matched point or -1 if the
+                   point starts a new section of the trace (or NULL if not required).
+
+  The default context of the database is used so only one calculation at a time is possible,
+  use Routino_MatchTraceInContext() with a separate context for each thread instead.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_MatchTrace(Routino_Database *database,Routino_Profile *profile,const double *latitudes,const double *longitudes,
+                                  int npoints,double accuracy,Routino_Waypoint **waypoints,float *distances)
+{
+ if(!database)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_DATABASE;
+    return(-1);
+   }
+
+ return(Routino_MatchTraceInContext(database->context,profile,latitudes,longitudes,npoints,accuracy,waypoints,distances));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Match the points of a GPS trace to the most likely positions on the highways that were travelled.
+
+  int Routino_MatchTraceInContext Returns the number of points that were matched or -1 in case of an error.
+
+  Routino_Context *context The routing context to use (which selects the database).
+
+  Routino_Profile *profile The chosen routing profile to use.
+
+  const double *latitudes The latitudes in degrees of the points of the trace (in order).
+
+  const double *longitudes The longitudes in degrees of the points of the trace (in order).
+
+  int npoints The number of points in the trace.
+
+  double accuracy The accuracy of the points of the trace (in metres).
+
+  Routino_Waypoint **waypoints Returns a pointer to a newly allocated Routino waypoint for each point or NULL if it could not be matched.
+
+  float *distances Returns the distance (km) along the highways from the previous matched point or -1 if the
+                   point starts a new section of the trace (or NULL if not required).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+DLL_PUBLIC int Routino_MatchTraceInContext(Routino_Context *context,Routino_Profile *profile,const double *latitudes,const double *longitudes,
+                                           int npoints,double accuracy,Routino_Waypoint **waypoints,float *distances)
+{
+ Routino_Database *database;
+ double *lats,*lons;
+ MatchedPoint *matched;
+ int i,nmatched;
+
+ /* Check the input data */
+
+ if(!context)
+   {
+    Routino_errno=ROUTINO_ERROR_NO_CONTEXT;
+    return(-1);
+   }
+
+ database=context->database;
+
+ if(!profile)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NO_PROFILE;
+    return(-1);
+   }
+
+ if(!profile->allow || profile->waychecksum!=database->ways->file.checksum)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NOTVALID_PROFILE;
+    return(-1);
+   }
+
+ if(accuracy<=0)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_BAD_OPTIONS;
+    return(-1);
+   }
+
+ if(npoints<=0)
+   {
+    Routino_errno=context->error=ROUTINO_ERROR_NONE;
+    return(0);
+   }
+
+ /* Match the trace */
+
+ lats=(double*)malloc(npoints*sizeof(double));
+ lons=(double*)malloc(npoints*sizeof(double));
+
+ matched=(MatchedPoint*)malloc(npoints*sizeof(MatchedPoint));
+
+ for(i=0;i<npoints;i++)
+   {
+    lats[i]=degrees_to_radians(latitudes[i]);
+    lons[i]=degrees_to_radians(longitudes[i]);
+   }
+
+ nmatched=MatchTrace(context,database->nodes,database->segments,database->ways,database->relations,profile,
+                     npoints,lats,lons,km_to_distance(accuracy/1000),matched);
+
+ for(i=0;i<npoints;i++)
+   {
+    if(matched[i].segment==NO_SEGMENT)
+       waypoints[i]=NULL;
+    else
+      {
+       waypoints[i]=calloc(sizeof(Routino_Waypoint),1);
+
+       waypoints[i]->segment=matched[i].segment;
+       waypoints[i]->node1  =matched[i].node1;
+       waypoints[i]->node2  =matched[i].node2;
+       waypoints[i]->dist1  =matched[i].dist1;
+       waypoints[i]->dist2  =matched[i].dist2;
+      }
+
+    if(distances)
+      {
+       if(matched[i].segment==NO_SEGMENT || matched[i].route==INF_DISTANCE)
+          distances[i]=-1;
+       else
+          distances[i]=distance_to_km(matched[i].route);
+      }
+   }
+
+ free(lats);
+ free(lons);
+
+ free(matched);
+
+ if(nmatched<npoints)
+    Routino_errno=context->error=ROUTINO_ERROR_NO_NEARBY_HIGHWAY;
+ else
+    Routino_errno=context->error=ROUTINO_ERROR_NONE;
+
+ return(nmatched);
+}
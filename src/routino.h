@@ -61,7 +61,7 @@ extern "C"
 
  /* Routino library API version */
 
-#define ROUTINO_API_VERSION                 8 /*+ A version number for the Routino API. +*/
+#define ROUTINO_API_VERSION                22 /*+ A version number for the Routino API. +*/
 
 
  /* Routino error constants */
@@ -71,6 +71,7 @@ extern "C"
 #define ROUTINO_ERROR_NO_DATABASE           1 /*+ A function was called without the database variable set. +*/
 #define ROUTINO_ERROR_NO_PROFILE            2 /*+ A function was called without the profile variable set. +*/
 #define ROUTINO_ERROR_NO_TRANSLATION        3 /*+ A function was called without the translation variable set. +*/
+#define ROUTINO_ERROR_NO_CONTEXT            4 /*+ A function was called without the context variable set. +*/
 
 #define ROUTINO_ERROR_NO_DATABASE_FILES    11 /*+ The specified database to load did not exist. +*/
 #define ROUTINO_ERROR_BAD_DATABASE_FILES   12 /*+ The specified database could not be loaded. +*/
@@ -78,6 +79,7 @@ extern "C"
 #define ROUTINO_ERROR_BAD_PROFILES_XML     14 /*+ The specified profiles XML file could not be loaded. +*/
 #define ROUTINO_ERROR_NO_TRANSLATIONS_XML  15 /*+ The specified translations XML file did not exist. +*/
 #define ROUTINO_ERROR_BAD_TRANSLATIONS_XML 16 /*+ The specified translations XML file could not be loaded. +*/
+#define ROUTINO_ERROR_DATABASE_VERSION     17 /*+ The specified database was created by a different version of planetsplitter. +*/
 
 #define ROUTINO_ERROR_NO_SUCH_PROFILE      21 /*+ The requested profile name does not exist in the loaded XML file. +*/
 #define ROUTINO_ERROR_NO_SUCH_TRANSLATION  22 /*+ The requested translation language does not exist in the loaded XML file. +*/
@@ -85,7 +87,7 @@ extern "C"
 #define ROUTINO_ERROR_NO_NEARBY_HIGHWAY    31 /*+ There is no highway near the coordinates to place a waypoint. +*/
 
 #define ROUTINO_ERROR_PROFILE_DATABASE_ERR 41 /*+ The profile and database do not work together. +*/
-#define ROUTINO_ERROR_NOTVALID_PROFILE     42 /*+ The profile being used has not been validated. +*/
+#define ROUTINO_ERROR_NOTVALID_PROFILE     42 /*+ The profile being used has not been validated (for this database). +*/
 #define ROUTINO_ERROR_BAD_USER_PROFILE     43 /*+ The user specified profile contained invalid data. +*/
 
 #define ROUTINO_ERROR_BAD_OPTIONS          51 /*+ The routing options specified are not consistent with each other. +*/
@@ -121,6 +123,18 @@ extern "C"
 #define ROUTINO_ROUTE_LOOP               2048 /*+ Route between the points in a loop returning to the first point. +*/
 #define ROUTINO_ROUTE_REVERSE            4096 /*+ Route between the points in reverse order. +*/
 
+#define ROUTINO_ROUTE_BIDIRECTIONAL      8192 /*+ Search from both ends of the route at the same time. +*/
+
+
+ /* Routino database loading option constants */
+
+#define ROUTINO_LOAD_POPULATE               1 /*+ Read all of the database files into memory when they are loaded. +*/
+#define ROUTINO_LOAD_WILLNEED               2 /*+ Advise the operating system that all of the files will be needed. +*/
+#define ROUTINO_LOAD_RANDOM                 4 /*+ Advise the operating system that the files will be accessed randomly. +*/
+#define ROUTINO_LOAD_HUGEPAGE               8 /*+ Advise the operating system to use huge pages for the files. +*/
+#define ROUTINO_LOAD_COPY                  16 /*+ Copy the files into anonymous memory instead of mapping them (non-slim library only). +*/
+#define ROUTINO_LOAD_LOCK                  32 /*+ Lock the contraction hierarchy and landmarks into memory. +*/
+
 
  /* Routino output point types */
 
@@ -165,6 +179,9 @@ extern "C"
  /*+ A data structure to hold a Routino database loaded from a file (the contents are private). +*/
  typedef struct _Routino_Database Routino_Database;
 
+ /*+ A data structure to hold the state of one routing calculation at a time for a database (the contents are private). +*/
+ typedef struct _Routino_Context Routino_Context;
+
  /*+ A data structure to hold a Routino waypoint found within the database (the contents are private). +*/
  typedef struct _Routino_Waypoint Routino_Waypoint;
 
@@ -205,6 +222,30 @@ extern "C"
   Routino_UserProfile;
 
 
+ /*+ A data structure to hold the options for loading a database with Routino_LoadDatabaseWithOptions(). +*/
+ typedef struct _Routino_LoadOptions
+ {
+  int            options;        /*+ The set of loading options (ROUTINO_LOAD_*) ORed together. +*/
+
+  const char    *transport;      /*+ The name of the type of transport whose specialised super-graph is loaded (or NULL for the general purpose one). +*/
+
+  unsigned long  cachesize;      /*+ The amount of memory for the file caches of the slim library (in bytes) or zero for the default sizes. +*/
+ }
+  Routino_LoadOptions;
+
+
+ /*+ A data structure to hold the statistics of the file caches used by a slim database. +*/
+ typedef struct _Routino_CacheStatistics
+ {
+  unsigned long hits;            /*+ The number of items found in the caches. +*/
+  unsigned long misses;          /*+ The number of items read from the files. +*/
+  unsigned long evictions;       /*+ The number of items removed from the caches to make space. +*/
+
+  unsigned long memory;          /*+ The amount of memory used by the caches (in bytes). +*/
+ }
+  Routino_CacheStatistics;
+
+
  /*+ Forward declaration of the Routino_Output data type. +*/
  typedef struct _Routino_Output Routino_Output;
 
@@ -246,8 +287,8 @@ extern "C"
  /*+ Contains the Routino version number. +*/
  DLL_PUBLIC extern const char *Routino_Version;
 
- /*+ Contains the error number of the most recent Routino function (one of the ROUTINO_ERROR_* values). +*/
- DLL_PUBLIC extern int Routino_errno;
+ /*+ Contains the error number of the most recent Routino function called by this thread (one of the ROUTINO_ERROR_* values). +*/
+#define Routino_errno (*Routino_ErrnoLocation())
 
 
  /* Routino library functions */
@@ -256,9 +297,14 @@ extern "C"
 
  DLL_PUBLIC int Routino_Check_API_Version(int caller_version);
 
+ DLL_PUBLIC int *Routino_ErrnoLocation(void);
+
  DLL_PUBLIC Routino_Database *Routino_LoadDatabase(const char *dirname,const char *prefix);
+ DLL_PUBLIC Routino_Database *Routino_LoadDatabaseWithOptions(const char *dirname,const char *prefix,const Routino_LoadOptions *options);
  DLL_PUBLIC void Routino_UnloadDatabase(Routino_Database *database);
 
+ DLL_PUBLIC int Routino_GetCacheStatistics(Routino_Database *database,Routino_CacheStatistics *statistics);
+
  DLL_PUBLIC int Routino_ParseXMLProfiles(const char *filename);
  DLL_PUBLIC char **Routino_GetProfileNames(void);
  DLL_PUBLIC Routino_Profile *Routino_GetProfile(const char *name);
@@ -272,16 +318,48 @@ extern "C"
 
  DLL_PUBLIC Routino_Profile *Routino_CreateProfileFromUserProfile(Routino_UserProfile *profile);
  DLL_PUBLIC Routino_UserProfile *Routino_CreateUserProfileFromProfile(Routino_Profile *profile);
+ DLL_PUBLIC void Routino_DeleteProfile(Routino_Profile *profile);
 
  DLL_PUBLIC int Routino_ValidateProfile(Routino_Database *database,Routino_Profile *profile);
 
  DLL_PUBLIC Routino_Waypoint *Routino_FindWaypoint(Routino_Database *database,Routino_Profile *profile,double latitude,double longitude);
+ DLL_PUBLIC int Routino_FindWaypoints(Routino_Database *database,Routino_Profile *profile,const double *latitudes,const double *longitudes,
+                                      int npoints,Routino_Waypoint **waypoints);
 
  DLL_PUBLIC Routino_Output *Routino_CalculateRoute(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
                                                    Routino_Waypoint **waypoints,int nwaypoints,int options,Routino_ProgressFunc progress);
 
  DLL_PUBLIC void Routino_DeleteRoute(Routino_Output *output);
 
+ DLL_PUBLIC int Routino_CalculateMatrix(Routino_Database *database,Routino_Profile *profile,
+                                        Routino_Waypoint **waypoints,int nsources,int ndestinations,int options,
+                                        float *distances,float *durations,Routino_ProgressFunc progress);
+
+ DLL_PUBLIC Routino_Output *Routino_CalculateIsochrone(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                                                       Routino_Waypoint *waypoint,float limit,int options,Routino_ProgressFunc progress);
+
+ DLL_PUBLIC int Routino_MatchTrace(Routino_Database *database,Routino_Profile *profile,const double *latitudes,const double *longitudes,
+                                   int npoints,double accuracy,Routino_Waypoint **waypoints,float *distances);
+
+ DLL_PUBLIC Routino_Context *Routino_CreateContext(Routino_Database *database);
+ DLL_PUBLIC void Routino_DeleteContext(Routino_Context *context);
+ DLL_PUBLIC int Routino_ContextErrno(Routino_Context *context);
+
+ DLL_PUBLIC int Routino_SetOutputDirectory(Routino_Context *context,const char *dirname);
+
+ DLL_PUBLIC Routino_Output *Routino_CalculateRouteInContext(Routino_Context *context,Routino_Profile *profile,Routino_Translation *translation,
+                                                            Routino_Waypoint **waypoints,int nwaypoints,int options,Routino_ProgressFunc progress);
+
+ DLL_PUBLIC int Routino_CalculateMatrixInContext(Routino_Context *context,Routino_Profile *profile,
+                                                 Routino_Waypoint **waypoints,int nsources,int ndestinations,int options,
+                                                 float *distances,float *durations,Routino_ProgressFunc progress);
+
+ DLL_PUBLIC Routino_Output *Routino_CalculateIsochroneInContext(Routino_Context *context,Routino_Profile *profile,Routino_Translation *translation,
+                                                                Routino_Waypoint *waypoint,float limit,int options,Routino_ProgressFunc progress);
+
+ DLL_PUBLIC int Routino_MatchTraceInContext(Routino_Context *context,Routino_Profile *profile,const double *latitudes,const double *longitudes,
+                                            int npoints,double accuracy,Routino_Waypoint **waypoints,float *distances);
+
 
 /* Handle compilation with a C++ compiler */
 
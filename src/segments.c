@@ -21,6 +21,7 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "types.h"
@@ -29,6 +30,7 @@
 #include "ways.h"
 
 #include "fakes.h"
+#include "blocks.h"
 #include "files.h"
 #include "profiles.h"
 
@@ -39,17 +41,29 @@
   Segments *LoadSegmentList Returns the segment list that has just been loaded.
 
   const char *filename The name of the file to load.
+
+  int mapoptions The options for loading the file into memory (MAP_OPTION_* values ORed together).
+
+  size_t cachesize The amount of memory to use for all of the caches of the database in slim mode (or 0 for the default sizes).
   ++++++++++++++++++++++++++++++++++++++*/
 
-Segments *LoadSegmentList(const char *filename)
+Segments *LoadSegmentList(const char *filename,int mapoptions,size_t cachesize)
 {
  Segments *segments;
+#if SLIM
+ int i;
+#endif
+
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,SEGMENTS_MAGIC))
+    return(NULL);
 
  segments=(Segments*)malloc(sizeof(Segments));
 
 #if !SLIM
 
- segments->data=MapFile(filename);
+ segments->data=MapFileWithOptions(filename,mapoptions);
 
  /* Copy the SegmentsFile structure from the loaded data */
 
@@ -57,21 +71,132 @@ Segments *LoadSegmentList(const char *filename)
 
  /* Set the pointers in the Segments structure. */
 
- segments->segments=(Segment*)(segments->data+sizeof(SegmentsFile));
+ if(segments->file.blocksize)
+   {
+    const char *data=segments->data+sizeof(SegmentsFile);
+    size_t size=(segments->file.number+segments->file.enumber)*sizeof(Segment);
+
+    if(segments->file.enumber)
+       size+=(segments->file.enodes+1)*sizeof(index_t);
+
+    /* Decompress the segments (and the adjacency array that follows them) into one block of memory. */
+
+    segments->segments=(Segment*)malloc(size);
+#ifndef LIBROUTINO
+    log_malloc(segments->segments,size);
+#endif
+
+    data=DecodeAllSegmentBlocks(data,segments->segments,segments->file.number);
+
+    if(segments->file.enumber)
+      {
+       segments->edges=segments->segments+segments->file.number;
+       segments->firstedge=(index_t*)(segments->edges+segments->file.enumber);
+
+       data=DecodeAllSegmentBlocks(data,segments->edges,segments->file.enumber);
+
+       memcpy(segments->firstedge,data,(segments->file.enodes+1)*sizeof(index_t));
+      }
+    else
+      {
+       segments->edges=NULL;
+       segments->firstedge=NULL;
+      }
+   }
+ else
+   {
+    segments->segments=(Segment*)(segments->data+sizeof(SegmentsFile));
+
+    /* The adjacency array (if there is one) follows the segments. */
+
+    if(segments->file.enumber)
+      {
+       segments->edges=segments->segments+segments->file.number;
+       segments->firstedge=(index_t*)(segments->edges+segments->file.enumber);
+      }
+    else
+      {
+       segments->edges=NULL;
+       segments->firstedge=NULL;
+      }
+   }
 
 #else
 
- segments->fd=SlimMapFile(filename);
+ segments->fd=SlimMapFileWithOptions(filename,mapoptions);
 
  /* Copy the SegmentsFile header structure from the loaded data */
 
  SlimFetch(segments->fd,&segments->file,sizeof(SegmentsFile),0);
 
- segments->cache=NewSegmentCache();
+ for(i=0;i<4;i++)
+   {
+    segments->inedge[i]=NO_SEGMENT;
+    segments->edgenode[i]=NO_NODE;
+   }
+
+ segments->cache=NULL;
+ segments->edgecache=NULL;
+
+ segments->blockcache=NULL;
+ segments->edgeblockcache=NULL;
+
+ if(segments->file.blocksize)
+   {
+    offset_t size;
+
+    /* Each block index is followed by the compressed data, the last index entry is the size of the data. */
+
+    segments->blockindexoffset=sizeof(SegmentsFile);
+    segments->segmentsoffset=segments->blockindexoffset+BlockIndexSize(segments->file.number);
+
+    SlimFetch(segments->fd,&size,sizeof(offset_t),segments->segmentsoffset-sizeof(offset_t));
+
+    segments->blockcache=NewSegmentBlockCache(segments->file.number,CacheShare(cachesize,25));
+#ifndef LIBROUTINO
+    log_malloc(segments->blockcache,segments->blockcache->stats.size);
+#endif
+
+    /* The adjacency array (if there is one) follows the segments. */
+
+    if(segments->file.enumber)
+      {
+       segments->edgeblockindexoffset=segments->segmentsoffset+size;
+       segments->edgesoffset=segments->edgeblockindexoffset+BlockIndexSize(segments->file.enumber);
+
+       SlimFetch(segments->fd,&size,sizeof(offset_t),segments->edgesoffset-sizeof(offset_t));
+
+       segments->firstedgeoffset=segments->edgesoffset+size;
+
+       segments->edgeblockcache=NewSegmentBlockCache(segments->file.enumber,CacheShare(cachesize,20));
+#ifndef LIBROUTINO
+       log_malloc(segments->edgeblockcache,segments->edgeblockcache->stats.size);
+#endif
+      }
+   }
+ else
+   {
+    segments->segmentsoffset=sizeof(SegmentsFile);
+
+    segments->cache=NewSegmentCache(CacheShare(cachesize,25),option_cache_block);
 #ifndef LIBROUTINO
- log_malloc(segments->cache,sizeof(*segments->cache));
+    log_malloc(segments->cache,segments->cache->stats.size);
 #endif
 
+    /* The adjacency array (if there is one) follows the segments. */
+
+    segments->edgesoffset=segments->segmentsoffset+(offset_t)segments->file.number*sizeof(Segment);
+    segments->firstedgeoffset=segments->edgesoffset+(offset_t)segments->file.enumber*sizeof(Segment);
+
+    if(segments->file.enumber)
+      {
+       segments->edgecache=NewSegmentCache(CacheShare(cachesize,20),option_cache_block);
+#ifndef LIBROUTINO
+       log_malloc(segments->edgecache,segments->edgecache->stats.size);
+#endif
+      }
+   }
+
 #endif
 
  return(segments);
@@ -88,16 +213,51 @@ void DestroySegmentList(Segments *segments)
 {
 #if !SLIM
 
+ if(segments->file.blocksize)
+   {
+#ifndef LIBROUTINO
+    log_free(segments->segments);
+#endif
+    free(segments->segments);
+   }
+
  segments->data=UnmapFile(segments->data);
 
 #else
 
  segments->fd=SlimUnmapFile(segments->fd);
 
+ if(segments->cache)
+   {
+#ifndef LIBROUTINO
+    log_free(segments->cache);
+#endif
+    DeleteSegmentCache(segments->cache);
+   }
+
+ if(segments->edgecache)
+   {
+#ifndef LIBROUTINO
+    log_free(segments->edgecache);
+#endif
+    DeleteSegmentCache(segments->edgecache);
+   }
+
+ if(segments->blockcache)
+   {
+#ifndef LIBROUTINO
+    log_free(segments->blockcache);
+#endif
+    DeleteSegmentBlockCache(segments->blockcache);
+   }
+
+ if(segments->edgeblockcache)
+   {
 #ifndef LIBROUTINO
- log_free(segments->cache);
+    log_free(segments->edgeblockcache);
 #endif
- DeleteSegmentCache(segments->cache);
+    DeleteSegmentBlockCache(segments->edgeblockcache);
+   }
 
 #endif
 
@@ -116,6 +276,8 @@ void DestroySegmentList(Segments *segments)
 
   Ways *ways The set of ways to use.
 
+  Fakes *fakes The set of fake nodes and segments to use.
+
   index_t node1 The node to start from.
 
   double heading The desired heading from the node.
@@ -123,14 +285,14 @@ void DestroySegmentList(Segments *segments)
   Profile *profile The profile of the mode of transport (or NULL).
   ++++++++++++++++++++++++++++++++++++++*/
 
-index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,index_t node1,double heading,Profile *profile)
+index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,Fakes *fakes,index_t node1,double heading,Profile *profile)
 {
  Segment *segmentp;
  index_t best_seg=NO_SEGMENT;
  double best_difference=360;
 
  if(IsFakeNode(node1))
-    segmentp=FirstFakeSegment(node1);
+    segmentp=FirstFakeSegment(fakes,node1);
  else
    {
     Node *nodep=LookupNode(nodes,node1,3);
@@ -150,7 +312,7 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
        goto endloop;
 
     if(IsFakeNode(node1) || IsFakeNode(node2))
-       seg2=IndexFakeSegment(segmentp);
+       seg2=IndexFakeSegment(fakes,segmentp);
     else
        seg2=IndexSegment(segments,segmentp);
 
@@ -168,7 +330,7 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
           goto endloop;
       }
 
-    bearing=BearingAngle(nodes,segmentp,node1);
+    bearing=BearingAngle(nodes,fakes,segmentp,node1);
 
     difference=(heading-bearing);
 
@@ -186,7 +348,7 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
    endloop:
 
     if(IsFakeNode(node1))
-       segmentp=NextFakeSegment(segmentp,node1);
+       segmentp=NextFakeSegment(fakes,segmentp,node1);
     else if(IsFakeNode(node2))
        segmentp=NULL; /* cannot call NextSegment() with a fake segment */
     else
@@ -212,6 +374,31 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
   ++++++++++++++++++++++++++++++++++++++*/
 
 distance_t Distance(double lat1,double lon1,double lat2,double lon2)
+{
+ return DistanceCos(lat1,lon1,cos(lat1),lat2,lon2,cos(lat2));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance between two locations using the cosines of their latitudes (so that they
+  only need calculating once when a location is used many times).
+
+  distance_t DistanceCos Returns the distance between the locations.
+
+  double lat1 The latitude of the first location.
+
+  double lon1 The longitude of the first location.
+
+  double coslat1 The cosine of the latitude of the first location.
+
+  double lat2 The latitude of the second location.
+
+  double lon2 The longitude of the second location.
+
+  double coslat2 The cosine of the latitude of the second location.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+distance_t DistanceCos(double lat1,double lon1,double coslat1,double lat2,double lon2,double coslat2)
 {
  double dlon = lon1 - lon2;
  double dlat = lat1 - lat2;
@@ -223,7 +410,7 @@ distance_t Distance(double lat1,double lon1,double lat2,double lon2)
 
  a1 = sin (dlat / 2);
  a2 = sin (dlon / 2);
- a = a1 * a1 + cos (lat1) * cos (lat2) * a2 * a2;
+ a = a1 * a1 + coslat1 * coslat2 * a2 * a2;
  sa = sqrt (a);
  if (sa <= 1.0)
    {c = 2 * asin (sa);}
@@ -235,6 +422,66 @@ distance_t Distance(double lat1,double lon1,double lat2,double lon2)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance from a point to a segment and the position of the closest point along the
+  segment from the distances between the point and the two nodes and the length of the segment.
+
+  double DistanceToSegment Returns the distance from the point to the closest point on the segment.
+
+  distance_t dist1 The distance from the point to the node at one end of the segment.
+
+  distance_t dist2 The distance from the point to the node at the other end of the segment.
+
+  distance_t dist3 The length of the segment.
+
+  double *dist3a Returns the distance along the segment from the node at one end to the closest point.
+
+  double *dist3b Returns the distance along the segment from the node at the other end to the closest point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+double DistanceToSegment(distance_t dist1,distance_t dist2,distance_t dist3,double *dist3a,double *dist3b)
+{
+ double distp;
+
+ /* Use law of cosines (assume flat Earth) */
+
+ if(dist3==0)
+   {
+    distp=dist1;   /* == dist2 */
+    *dist3a=dist1; /* == dist2 */
+    *dist3b=dist2; /* == dist1 */
+   }
+ else if((dist1+dist2)<dist3)
+   {
+    distp=0;
+    *dist3a=dist1;
+    *dist3b=dist2;
+   }
+ else
+   {
+    *dist3a=((double)dist1*(double)dist1-(double)dist2*(double)dist2+(double)dist3*(double)dist3)/(2.0*(double)dist3);
+    *dist3b=(double)dist3-*dist3a;
+
+    if(*dist3a>=0 && *dist3b>=0)
+       distp=sqrt((double)dist1*(double)dist1-*dist3a*(*dist3a));
+    else if(*dist3a>0)
+      {
+       distp=dist2;
+       *dist3a=dist3;
+       *dist3b=0;
+      }
+    else /* if(*dist3b>0) */
+      {
+       distp=dist1;
+       *dist3a=0;
+       *dist3b=dist3;
+      }
+   }
+
+ return(distp);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Calculate the change in latitude (same longitude) between two locations a known distance apart.
 
@@ -341,6 +588,8 @@ duration_t Duration(Segment *segmentp,Way *wayp,Profile *profile)
 
   Nodes *nodes The set of nodes to use.
 
+  Fakes *fakes The set of fake nodes and segments to use (or NULL if there are none).
+
   Segment *segment1p The current segment.
 
   Segment *segment2p The next segment.
@@ -351,7 +600,7 @@ duration_t Duration(Segment *segmentp,Way *wayp,Profile *profile)
   Angles are calculated using flat Cartesian lat/long grid approximation (after scaling longitude due to latitude).
   ++++++++++++++++++++++++++++++++++++++*/
 
-double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node)
+double TurnAngle(Nodes *nodes,Fakes *fakes,Segment *segment1p,Segment *segment2p,index_t node)
 {
  double lat1,latm,lat2;
  double lon1,lonm,lon2;
@@ -362,19 +611,19 @@ double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node
  node2=OtherNode(segment2p,node);
 
  if(IsFakeNode(node1))
-    GetFakeLatLong(node1,&lat1,&lon1);
+    GetFakeLatLong(fakes,node1,&lat1,&lon1);
  else
-    GetLatLong(nodes,node1,NULL,&lat1,&lon1);
+    GetLatLong(nodes,node1,&lat1,&lon1);
 
  if(IsFakeNode(node))
-    GetFakeLatLong(node,&latm,&lonm);
+    GetFakeLatLong(fakes,node,&latm,&lonm);
  else
-    GetLatLong(nodes,node,NULL,&latm,&lonm);
+    GetLatLong(nodes,node,&latm,&lonm);
 
  if(IsFakeNode(node2))
-    GetFakeLatLong(node2,&lat2,&lon2);
+    GetFakeLatLong(fakes,node2,&lat2,&lon2);
  else
-    GetLatLong(nodes,node2,NULL,&lat2,&lon2);
+    GetLatLong(nodes,node2,&lat2,&lon2);
 
  angle1=atan2((lonm-lon1)*cos(latm),(latm-lat1));
  angle2=atan2((lon2-lonm)*cos(latm),(lat2-latm));
@@ -397,6 +646,8 @@ double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node
 
   Nodes *nodes The set of nodes to use.
 
+  Fakes *fakes The set of fake nodes and segments to use (or NULL if there are none).
+
   Segment *segmentp The segment.
 
   index_t node The node to finish.
@@ -404,7 +655,7 @@ double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node
   Angles are calculated using flat Cartesian lat/long grid approximation (after scaling longitude due to latitude).
   ++++++++++++++++++++++++++++++++++++++*/
 
-double BearingAngle(Nodes *nodes,Segment *segmentp,index_t node)
+double BearingAngle(Nodes *nodes,Fakes *fakes,Segment *segmentp,index_t node)
 {
  double lat1,lat2;
  double lon1,lon2;
@@ -415,14 +666,14 @@ double BearingAngle(Nodes *nodes,Segment *segmentp,index_t node)
  node2=OtherNode(segmentp,node);
 
  if(IsFakeNode(node1))
-    GetFakeLatLong(node1,&lat1,&lon1);
+    GetFakeLatLong(fakes,node1,&lat1,&lon1);
  else
-    GetLatLong(nodes,node1,NULL,&lat1,&lon1);
+    GetLatLong(nodes,node1,&lat1,&lon1);
 
  if(IsFakeNode(node2))
-    GetFakeLatLong(node2,&lat2,&lon2);
+    GetFakeLatLong(fakes,node2,&lat2,&lon2);
  else
-    GetLatLong(nodes,node2,NULL,&lat2,&lon2);
+    GetLatLong(nodes,node2,&lat2,&lon2);
 
  angle=atan2((lat2-lat1),(lon2-lon1)*cos(lat1));
 
@@ -30,6 +30,7 @@
 #include "types.h"
 
 #include "cache.h"
+#include "blocks.h"
 #include "files.h"
 #include "profiles.h"
 
@@ -54,9 +55,17 @@ struct _Segment
 /*+ A structure containing the header from the file. +*/
 typedef struct _SegmentsFile
 {
+ uint32_t  magic;               /*+ The magic number that identifies the type of file. +*/
+ uint32_t  version;             /*+ The version of the file format. +*/
+
  index_t   number;              /*+ The number of segments in total. +*/
  index_t   snumber;             /*+ The number of super-segments. +*/
  index_t   nnumber;             /*+ The number of normal segments. +*/
+
+ index_t   enumber;             /*+ The number of edges in the adjacency array (or 0 if there is none). +*/
+ index_t   enodes;              /*+ The number of nodes indexed by the adjacency array. +*/
+
+ index_t   blocksize;           /*+ The number of segments in each compressed block (or 0 if not compressed). +*/
 }
  SegmentsFile;
 
@@ -72,6 +81,9 @@ struct _Segments
 
  Segment     *segments;         /*+ An array of segments. +*/
 
+ Segment     *edges;            /*+ An array of edges (copies of the segments grouped by node, 'next2' is the segment index). +*/
+ index_t     *firstedge;        /*+ An array of the index of the first edge for each node (and one more for the end). +*/
+
 #else
 
  int          fd;               /*+ The file descriptor for the file. +*/
@@ -81,27 +93,45 @@ struct _Segments
 
  SegmentCache *cache;           /*+ A RAM cache of segments read from the file. +*/
 
+ offset_t     segmentsoffset;   /*+ The offset of the segments (or the compressed data) in the file. +*/
+ offset_t     edgesoffset;      /*+ The offset of the edges (or the compressed data) in the file. +*/
+ offset_t     firstedgeoffset;  /*+ The offset of the first edge indexes in the file. +*/
+
+ index_t      inedge[4];        /*+ The edge indexes of the cached segments (or NO_SEGMENT if not an edge). +*/
+ index_t      edgenode[4];      /*+ The node whose edges are being read into each cached segment. +*/
+ index_t      edgeend[4];       /*+ The index after the last edge of the node whose edges are being read. +*/
+
+ SegmentCache *edgecache;       /*+ A RAM cache of edges read from the file. +*/
+
+ offset_t     blockindexoffset;     /*+ The offset of the compressed segment block index in the file. +*/
+ offset_t     edgeblockindexoffset; /*+ The offset of the compressed edge block index in the file. +*/
+
+ SegmentBlockCache *blockcache;     /*+ A RAM cache of decompressed blocks of segments (if the file is compressed). +*/
+ SegmentBlockCache *edgeblockcache; /*+ A RAM cache of decompressed blocks of edges (if the file is compressed). +*/
+
 #endif
 };
 
 
 /* Functions in segments.c */
 
-Segments *LoadSegmentList(const char *filename);
+Segments *LoadSegmentList(const char *filename,int mapoptions,size_t cachesize);
 
 void DestroySegmentList(Segments *segments);
 
-index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,index_t node1,double heading,Profile *profile);
+index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,Fakes *fakes,index_t node1,double heading,Profile *profile);
 
 distance_t Distance(double lat1,double lon1,double lat2,double lon2);
+distance_t DistanceCos(double lat1,double lon1,double coslat1,double lat2,double lon2,double coslat2);
+double DistanceToSegment(distance_t dist1,distance_t dist2,distance_t dist3,double *dist3a,double *dist3b);
 
 double DeltaLat(double lon,distance_t distance);
 double DeltaLon(double lat,distance_t distance);
 
 duration_t Duration(Segment *segmentp,Way *wayp,Profile *profile);
 
-double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node);
-double BearingAngle(Nodes *nodes,Segment *segmentp,index_t node);
+double TurnAngle(Nodes *nodes,Fakes *fakes,Segment *segment1p,Segment *segment2p,index_t node);
+double BearingAngle(Nodes *nodes,Fakes *fakes,Segment *segmentp,index_t node);
 
 
 static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t node);
@@ -133,8 +163,11 @@ static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t
 /*+ Return a segment pointer given a set of segments and an index. +*/
 #define LookupSegment(xxx,yyy,ppp) (&(xxx)->segments[yyy])
 
-/*+ Return a segment index given a set of segments and a pointer. +*/
-#define IndexSegment(xxx,yyy)      (index_t)((yyy)-&(xxx)->segments[0])
+/*+ Return an edge (a segment pointer) given a set of segments and an edge index. +*/
+#define LookupEdge(xxx,yyy,ppp)    (&(xxx)->edges[yyy])
+
+/*+ Return a segment index given a set of segments and a pointer (to a segment or to an edge). +*/
+#define IndexSegment(xxx,yyy)      ((xxx)->file.enumber && (yyy)>=(xxx)->edges?(yyy)->next2:(index_t)((yyy)-&(xxx)->segments[0]))
 
 
 /*++++++++++++++++++++++++++++++++++++++
@@ -151,7 +184,16 @@ static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t
 
 static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t node)
 {
- if(segmentp->node1==node)
+ if(segments->file.enumber && segmentp>=segments->edges)
+   {
+    segmentp++;
+
+    if(segmentp>=&segments->edges[segments->firstedge[node+1]])
+       return(NULL);
+    else
+       return(segmentp);
+   }
+ else if(segmentp->node1==node)
    {
     segmentp++;
 
@@ -175,24 +217,38 @@ static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t
 
 static inline Segment *LookupSegment(Segments *segments,index_t index,int position);
 
+static inline Segment *LookupEdge(Segments *segments,index_t index,int position);
+
 static inline index_t IndexSegment(Segments *segments,Segment *segmentp);
 
 CACHE_NEWCACHE_PROTO(Segment)
 CACHE_DELETECACHE_PROTO(Segment)
 CACHE_FETCHCACHE_PROTO(Segment)
+CACHE_CHOOSEVICTIM_PROTO(Segment)
 CACHE_INVALIDATECACHE_PROTO(Segment)
 
+BLOCKCACHE_NEWCACHE_PROTO(Segment)
+BLOCKCACHE_DELETECACHE_PROTO(Segment)
+BLOCKCACHE_FETCHCACHE_PROTO(Segment)
+
 /* Data type */
 
 CACHE_STRUCTURE(Segment)
 
+BLOCKCACHE_STRUCTURE(Segment)
+
 /* Inline functions */
 
 CACHE_NEWCACHE(Segment)
 CACHE_DELETECACHE(Segment)
 CACHE_FETCHCACHE(Segment)
+CACHE_CHOOSEVICTIM(Segment)
 CACHE_INVALIDATECACHE(Segment)
 
+BLOCKCACHE_NEWCACHE(Segment)
+BLOCKCACHE_DELETECACHE(Segment)
+BLOCKCACHE_FETCHCACHE(Segment)
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Find the Segment information for a particular segment.
@@ -208,9 +264,39 @@ CACHE_INVALIDATECACHE(Segment)
 
 static inline Segment *LookupSegment(Segments *segments,index_t index,int position)
 {
- segments->cached[position-1]=*FetchCachedSegment(segments->cache,index,segments->fd,sizeof(SegmentsFile));
+ if(segments->blockcache)
+    segments->cached[position-1]=*FetchBlockCachedSegment(segments->blockcache,index,segments->fd,segments->blockindexoffset,segments->segmentsoffset);
+ else
+    segments->cached[position-1]=*FetchCachedSegment(segments->cache,index,segments->fd,segments->segmentsoffset);
 
  segments->incache[position-1]=index;
+ segments->inedge[position-1]=NO_SEGMENT;
+
+ return(&segments->cached[position-1]);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the Segment information for a particular edge.
+
+  Segment *LookupEdge Returns a pointer to the cached segment information.
+
+  Segments *segments The set of segments to use.
+
+  index_t index The index of the edge.
+
+  int position The position in the cache to store the value.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline Segment *LookupEdge(Segments *segments,index_t index,int position)
+{
+ if(segments->edgeblockcache)
+    segments->cached[position-1]=*FetchBlockCachedSegment(segments->edgeblockcache,index,segments->fd,segments->edgeblockindexoffset,segments->edgesoffset);
+ else
+    segments->cached[position-1]=*FetchCachedSegment(segments->edgecache,index,segments->fd,segments->edgesoffset);
+
+ segments->incache[position-1]=segments->cached[position-1].next2;
+ segments->inedge[position-1]=index;
 
  return(&segments->cached[position-1]);
 }
@@ -250,7 +336,25 @@ static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t
 {
  int position=(int)(segmentp-segments->cached)+1;
 
- if(segmentp->node1==node)
+ if(segments->inedge[position-1]!=NO_SEGMENT)
+   {
+    index_t index=segments->inedge[position-1];
+
+    if(segments->edgenode[position-1]!=node)
+      {
+       SlimFetch(segments->fd,&segments->edgeend[position-1],sizeof(index_t),segments->firstedgeoffset+(offset_t)(node+1)*sizeof(index_t));
+
+       segments->edgenode[position-1]=node;
+      }
+
+    index++;
+
+    if(index>=segments->edgeend[position-1])
+       return(NULL);
+
+    return(LookupEdge(segments,index,position));
+   }
+ else if(segmentp->node1==node)
    {
     index_t index=IndexSegment(segments,segmentp);
 
@@ -43,12 +43,25 @@
 /*+ The command line '--tmpdir' option or its default value. +*/
 extern char *option_tmpdirname;
 
+/* Local data types */
+
+/*+ An edge in the adjacency array with the node that it belongs to (used for sorting). +*/
+typedef struct _EdgeX
+{
+ index_t node;                  /*+ The node whose adjacency array contains the edge. +*/
+
+ Segment segment;               /*+ The segment ('next2' contains the segment index). +*/
+}
+ EdgeX;
+
+
 /* Local variables */
 
 /*+ Temporary file-local variables for use by the sort functions (re-initialised for each sort). +*/
 static NodesX *sortnodesx;
 static SegmentsX *sortsegmentsx;
 static WaysX *sortwaysx;
+static transports_t sorttransports;
 
 /* Local functions */
 
@@ -60,6 +73,10 @@ static int deduplicate_super(SegmentX *segmentx,index_t index);
 
 static int geographically_index(SegmentX *segmentx,index_t index);
 
+static int sort_edges(EdgeX *a,EdgeX *b);
+
+static void write_segment_block(int fd,const Segment *block,index_t i,offset_t *blockindex);
+
 static distance_t DistanceX(NodeX *nodex1,NodeX *nodex2);
 
 
@@ -84,8 +101,8 @@ SegmentsX *NewSegmentList(void)
  segmentsx->fd=OpenFileBufferedNew(segmentsx->filename_tmp);
 
 #if SLIM
- segmentsx->cache=NewSegmentXCache();
- log_malloc(segmentsx->cache,sizeof(*segmentsx->cache));
+ segmentsx->cache=NewSegmentXCache(0,0);
+ log_malloc(segmentsx->cache,segmentsx->cache->stats.size);
 #endif
 
  return(segmentsx);
@@ -116,6 +133,12 @@ void FreeSegmentList(SegmentsX *segmentsx)
     free(segmentsx->firstnode);
    }
 
+ if(segmentsx->firstedge)
+   {
+    log_free(segmentsx->firstedge);
+    free(segmentsx->firstedge);
+   }
+
  if(segmentsx->next1)
    {
     log_free(segmentsx->next1);
@@ -617,6 +640,70 @@ void IndexSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Index the segments by node so that an adjacency array can be written with the database where
+  all of the segments for each node are stored together (a compressed sparse row format).
+
+  SegmentsX *segmentsx The set of segments to use.
+
+  NodesX *nodesx The set of nodes to use.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void IndexSegmentEdges(SegmentsX *segmentsx,NodesX *nodesx)
+{
+ index_t i,total=0;
+
+ /* Print the start message */
+
+ printf_first("Indexing Segment Edges: Segments=0");
+
+ /* Allocate the array of indexes */
+
+ segmentsx->nedgenodes=nodesx->number;
+
+ segmentsx->firstedge=(index_t*)calloc(nodesx->number+1,sizeof(index_t));
+ log_malloc(segmentsx->firstedge,(nodesx->number+1)*sizeof(index_t));
+
+ logassert(segmentsx->firstedge,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ /* Count the segments for each node */
+
+ segmentsx->fd=ReOpenFileBuffered(segmentsx->filename_tmp);
+
+ for(i=0;i<segmentsx->number;i++)
+   {
+    SegmentX segmentx;
+
+    ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX));
+
+    segmentsx->firstedge[segmentx.node1]++;
+
+    if(segmentx.node2!=segmentx.node1)
+       segmentsx->firstedge[segmentx.node2]++;
+
+    if(!((i+1)%10000))
+       printf_middle("Indexing Segment Edges: Segments=%"Pindex_t,i+1);
+   }
+
+ segmentsx->fd=CloseFileBuffered(segmentsx->fd);
+
+ /* Convert the counts into the index of the first edge */
+
+ for(i=0;i<=nodesx->number;i++)
+   {
+    index_t count=segmentsx->firstedge[i];
+
+    segmentsx->firstedge[i]=total;
+
+    total+=count;
+   }
+
+ /* Print the final message */
+
+ printf_last("Indexed Segment Edges: Segments=%"Pindex_t" Edges=%"Pindex_t,segmentsx->number,total);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Prune the deleted segments while resorting the list.
 
@@ -696,9 +783,11 @@ static int delete_pruned(SegmentX *segmentx,index_t index)
   SegmentsX *segmentsx The set of super-segments to modify.
 
   WaysX *waysx The set of ways to use.
+
+  transports_t transports The types of transport that the super-segments were created for.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void DeduplicateSuperSegments(SegmentsX *segmentsx,WaysX *waysx)
+void DeduplicateSuperSegments(SegmentsX *segmentsx,WaysX *waysx,transports_t transports)
 {
  int fd;
  index_t xnumber;
@@ -730,6 +819,7 @@ void DeduplicateSuperSegments(SegmentsX *segmentsx,WaysX *waysx)
 
  sortsegmentsx=segmentsx;
  sortwaysx=waysx;
+ sorttransports=transports;
 
  segmentsx->number=filesort_fixed(segmentsx->fd,fd,sizeof(SegmentX),NULL,
                                                                     (int (*)(const void*,const void*))sort_by_id,
@@ -789,7 +879,7 @@ static int deduplicate_super(SegmentX *segmentx,index_t index)
     for(offset=0;offset<nprev;offset++)
       {
        if(DISTFLAG(segmentx->distance)==DISTFLAG(prevsegx[offset].distance))
-          if(!WaysCompare(&prevway[offset],&wayx->way))
+          if(!WaysCompareTransports(&prevway[offset],&wayx->way,sorttransports))
             {
              isduplicate=1;
              break;
@@ -899,14 +989,20 @@ static int geographically_index(SegmentX *segmentx,index_t index)
   SegmentsX *segmentsx The set of segments to save.
 
   const char *filename The name of the file to save.
+
+  int compress Set to true if the segments are to be written in compressed blocks.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void SaveSegmentList(SegmentsX *segmentsx,const char *filename)
+void SaveSegmentList(SegmentsX *segmentsx,const char *filename,int compress)
 {
  index_t i;
- int fd;
+ int fd,edgefd=-1;
  SegmentsFile segmentsfile={0};
- index_t super_number=0,normal_number=0;
+ index_t super_number=0,normal_number=0,edge_number=0;
+ char *edgefilename=NULL;
+ offset_t *blockindex=NULL,*edgeblockindex=NULL;
+ offset_t edgeindexpos=0;
+ Segment block[BLOCK_SIZE];
 
  /* Print the start message */
 
@@ -916,11 +1012,36 @@ void SaveSegmentList(SegmentsX *segmentsx,const char *filename)
 
  segmentsx->fd=ReOpenFileBuffered(segmentsx->filename_tmp);
 
+ /* Open the temporary file for the edges */
+
+ if(segmentsx->firstedge)
+   {
+    edgefilename=(char*)malloc(strlen(option_tmpdirname)+48); /* allow %p to be up to 20 bytes */
+
+    sprintf(edgefilename,"%s/segmentsx.%p.edges.tmp",option_tmpdirname,(void*)segmentsx);
+
+    edgefd=OpenFileBufferedNew(edgefilename);
+   }
+
+ /* Allocate the memory for the index of the compressed blocks */
+
+ if(compress)
+   {
+    blockindex=(offset_t*)malloc(BlockIndexSize(segmentsx->number));
+
+    logassert(blockindex,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+    blockindex[0]=0;
+   }
+
  /* Write out the segments data */
 
  fd=OpenFileBufferedNew(filename);
 
- SeekFileBuffered(fd,sizeof(SegmentsFile));
+ if(compress)
+    SeekFileBuffered(fd,sizeof(SegmentsFile)+BlockIndexSize(segmentsx->number));
+ else
+    SeekFileBuffered(fd,sizeof(SegmentsFile));
 
  for(i=0;i<segmentsx->number;i++)
    {
@@ -940,18 +1061,134 @@ void SaveSegmentList(SegmentsX *segmentsx,const char *filename)
     if(IsNormalSegment(&segment))
        normal_number++;
 
-    WriteFileBuffered(fd,&segment,sizeof(Segment));
+    if(compress)
+      {
+       block[i%BLOCK_SIZE]=segment;
+
+       if((i+1)%BLOCK_SIZE==0 || (i+1)==segmentsx->number)
+          write_segment_block(fd,block,i,blockindex);
+      }
+    else
+       WriteFileBuffered(fd,&segment,sizeof(Segment));
+
+    /* Write out an edge for each node of the segment */
+
+    if(segmentsx->firstedge)
+      {
+       EdgeX edgex;
+
+       edgex.segment=segment;
+       edgex.segment.next2=i;
+
+       edgex.node=segment.node1;
+       WriteFileBuffered(edgefd,&edgex,sizeof(EdgeX));
+
+       if(segment.node2!=segment.node1)
+         {
+          edgex.node=segment.node2;
+          WriteFileBuffered(edgefd,&edgex,sizeof(EdgeX));
+         }
+      }
 
     if(!((i+1)%10000))
        printf_middle("Writing Segments: Segments=%"Pindex_t,i+1);
    }
 
+ /* Sort the edges by node and write them out followed by the index of the first edge for each node */
+
+ if(segmentsx->firstedge)
+   {
+    int sortedfd;
+
+    CloseFileBuffered(edgefd);
+
+    sortedfd=ReplaceFileBuffered(edgefilename,&edgefd);
+
+    edge_number=filesort_fixed(edgefd,sortedfd,sizeof(EdgeX),NULL,
+                                                              (int (*)(const void*,const void*))sort_edges,
+                                                              NULL);
+
+    edgefd=CloseFileBuffered(edgefd);
+    CloseFileBuffered(sortedfd);
+
+    logassert(edge_number==segmentsx->firstedge[segmentsx->nedgenodes],"Number of edges is not the same as the number indexed"); /* Check edges are consistent */
+
+    edgefd=ReOpenFileBuffered(edgefilename);
+
+    if(compress)
+      {
+       edgeblockindex=(offset_t*)malloc(BlockIndexSize(edge_number));
+
+       logassert(edgeblockindex,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+       edgeblockindex[0]=0;
+
+       edgeindexpos=sizeof(SegmentsFile)+BlockIndexSize(segmentsx->number)+blockindex[(segmentsx->number+BLOCK_SIZE-1)/BLOCK_SIZE];
+
+       SeekFileBuffered(fd,edgeindexpos+BlockIndexSize(edge_number));
+      }
+
+    for(i=0;i<edge_number;i++)
+      {
+       EdgeX edgex;
+
+       ReadFileBuffered(edgefd,&edgex,sizeof(EdgeX));
+
+       if(compress)
+         {
+          block[i%BLOCK_SIZE]=edgex.segment;
+
+          if((i+1)%BLOCK_SIZE==0 || (i+1)==edge_number)
+             write_segment_block(fd,block,i,edgeblockindex);
+         }
+       else
+          WriteFileBuffered(fd,&edgex.segment,sizeof(Segment));
+
+       if(!((i+1)%10000))
+          printf_middle("Writing Segments: Segments=%"Pindex_t" Edges=%"Pindex_t,segmentsx->number,i+1);
+      }
+
+    edgefd=CloseFileBuffered(edgefd);
+
+    DeleteFile(edgefilename);
+
+    free(edgefilename);
+
+    WriteFileBuffered(fd,segmentsx->firstedge,(segmentsx->nedgenodes+1)*sizeof(index_t));
+
+    if(compress)
+      {
+       SeekFileBuffered(fd,edgeindexpos);
+       WriteFileBuffered(fd,edgeblockindex,BlockIndexSize(edge_number));
+
+       free(edgeblockindex);
+      }
+   }
+
+ /* Write out the index of the compressed blocks */
+
+ if(compress)
+   {
+    SeekFileBuffered(fd,sizeof(SegmentsFile));
+    WriteFileBuffered(fd,blockindex,BlockIndexSize(segmentsx->number));
+
+    free(blockindex);
+   }
+
  /* Write out the header structure */
 
+ segmentsfile.magic=SEGMENTS_MAGIC;
+ segmentsfile.version=DATABASE_VERSION;
+
  segmentsfile.number=segmentsx->number;
  segmentsfile.snumber=super_number;
  segmentsfile.nnumber=normal_number;
 
+ segmentsfile.enumber=edge_number;
+ segmentsfile.enodes=edge_number?segmentsx->nedgenodes:0;
+
+ segmentsfile.blocksize=compress?BLOCK_SIZE:0;
+
  SeekFileBuffered(fd,0);
  WriteFileBuffered(fd,&segmentsfile,sizeof(SegmentsFile));
 
@@ -963,7 +1200,70 @@ void SaveSegmentList(SegmentsX *segmentsx,const char *filename)
 
  /* Print the final message */
 
- printf_last("Wrote Segments: Segments=%"Pindex_t,segmentsx->number);
+ if(edge_number)
+    printf_last("Wrote Segments: Segments=%"Pindex_t" Edges=%"Pindex_t,segmentsx->number,edge_number);
+ else
+    printf_last("Wrote Segments: Segments=%"Pindex_t,segmentsx->number);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the edges into node order and then into segment index order for each node (the
+  same order that the segments are visited by following the 'next2' index).
+
+  int sort_edges Returns the comparison of the node and segment index fields.
+
+  EdgeX *a The first edge.
+
+  EdgeX *b The second edge.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_edges(EdgeX *a,EdgeX *b)
+{
+ index_t a_id=a->node;
+ index_t b_id=b->node;
+
+ if(a_id<b_id)
+    return(-1);
+ else if(a_id>b_id)
+    return(1);
+ else
+   {
+    index_t a_id=a->segment.next2;
+    index_t b_id=b->segment.next2;
+
+    if(a_id<b_id)
+       return(-1);
+    else if(a_id>b_id)
+       return(1);
+    else
+       return(FILESORT_PRESERVE_ORDER(a,b));
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compress a block of segments (or edges) and write it to the file.
+
+  int fd The file to write to.
+
+  const Segment *block The segments in the block.
+
+  index_t i The index of the last segment in the block.
+
+  offset_t *blockindex The index of compressed blocks to update.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void write_segment_block(int fd,const Segment *block,index_t i,offset_t *blockindex)
+{
+ unsigned char buffer[BLOCK_MAX_BYTES];
+ int bytes;
+
+ bytes=EncodeSegmentBlock(buffer,block,(int)(i%BLOCK_SIZE)+1);
+
+ WriteFileBuffered(fd,buffer,bytes);
+
+ blockindex[i/BLOCK_SIZE+1]=blockindex[i/BLOCK_SIZE]+bytes;
 }
 
 
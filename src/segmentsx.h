@@ -74,6 +74,9 @@ struct _SegmentsX
 
  index_t   *firstnode;          /*+ The first segment index for each node. +*/
 
+ index_t   *firstedge;          /*+ The first edge index for each node in the adjacency array (if one is being written). +*/
+ index_t    nedgenodes;         /*+ The number of nodes in the firstedge array (it has one more entry). +*/
+
  index_t   *next1;              /*+ The index of the next segment with the same node1 (used while pruning). +*/
 
  BitMask   *usedway;            /*+ A flag to indicate if a way is used (used for removing pruned ways). +*/
@@ -95,15 +98,17 @@ void SortSegmentList(SegmentsX *segmentsx);
 
 void IndexSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx);
 
+void IndexSegmentEdges(SegmentsX *segmentsx,NodesX *nodesx);
+
 void ProcessSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx);
 
 void RemovePrunedSegments(SegmentsX *segmentsx,WaysX *waysx);
 
-void DeduplicateSuperSegments(SegmentsX *segmentsx,WaysX *waysx);
+void DeduplicateSuperSegments(SegmentsX *segmentsx,WaysX *waysx,transports_t transports);
 
 void SortSegmentListGeographically(SegmentsX *segmentsx,NodesX *nodesx);
 
-void SaveSegmentList(SegmentsX *segmentsx,const char *filename);
+void SaveSegmentList(SegmentsX *segmentsx,const char *filename,int compress);
 
 
 /* Macros / inline functions */
@@ -137,6 +142,7 @@ static inline void ReLookupSegmentX(SegmentsX *segmentsx,SegmentX *segmentx);
 CACHE_NEWCACHE_PROTO(SegmentX)
 CACHE_DELETECACHE_PROTO(SegmentX)
 CACHE_FETCHCACHE_PROTO(SegmentX)
+CACHE_CHOOSEVICTIM_PROTO(SegmentX)
 CACHE_REPLACECACHE_PROTO(SegmentX)
 CACHE_INVALIDATECACHE_PROTO(SegmentX)
 
@@ -149,6 +155,7 @@ CACHE_STRUCTURE(SegmentX)
 CACHE_NEWCACHE(SegmentX)
 CACHE_DELETECACHE(SegmentX)
 CACHE_FETCHCACHE(SegmentX)
+CACHE_CHOOSEVICTIM(SegmentX)
 CACHE_REPLACECACHE(SegmentX)
 CACHE_INVALIDATECACHE(SegmentX)
 
@@ -39,21 +39,26 @@
 
 /* Local functions */
 
-static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,node_t start,Way *match);
+static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,node_t start,Way *match,transports_t transports);
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Select the super-nodes from the list of nodes.
+  Select the super-nodes from the list of nodes (and optionally record the level of each one).
 
-  NodesX *nodesx The set of nodes to use.
+  NodesX *nodesx The set of nodes to modify.
 
   SegmentsX *segmentsx The set of segments to use.
 
   WaysX *waysx The set of ways to use.
+
+  transports_t transports The types of transport that the super-nodes are chosen for (Transports_ALL for a general purpose database).
+
+  int levels If true then the level of each super-node is increased, otherwise only the latest super-nodes have level 1.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
+void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,transports_t transports,int levels)
 {
+ int fd;
  index_t i;
  index_t nnodes=0;
 
@@ -76,9 +81,11 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
     SetAllBits(nodesx->super,nodesx->number);
    }
 
- /* Map into memory / open the files */
+ /* Re-open the file read-only and a new file writeable */
+
+ fd=ReplaceFileBuffered(nodesx->filename_tmp,&nodesx->fd);
 
- nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
+ /* Map into memory / open the files */
 
 #if !SLIM
  segmentsx->data=MapFile(segmentsx->filename_tmp);
@@ -117,6 +124,14 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
              WayX *wayx=LookupWayX(waysx,segmentx->way,1);
              int nsegments;
 
+             /* Segments that cannot be used by any of the types of transport are ignored */
+
+             if(!(wayx->way.allow&transports))
+               {
+                segmentx=NextSegmentX(segmentsx,segmentx,i);
+                continue;
+               }
+
              /* Segments that are loops count twice */
 
              logassert(count<MAX_SEG_PER_NODE,"Too many segments for one node (increase MAX_SEG_PER_NODE?)"); /* Only a limited amount of information stored. */
@@ -130,7 +145,7 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
 
              /* If the node allows less traffic types than any connecting way then it is super if it allows anything */
 
-             if((wayx->way.allow&nodex.allow)!=wayx->way.allow && nodex.allow!=Transports_None)
+             if((wayx->way.allow&nodex.allow&transports)!=(wayx->way.allow&transports) && (nodex.allow&transports)!=Transports_None)
                {
                 issuper=1;
                 break;
@@ -139,11 +154,11 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
              nsegments=segmentweight[count];
 
              for(j=0;j<count;j++)
-                if(wayx->way.allow & segmentway[j].allow)
+                if(wayx->way.allow & segmentway[j].allow & transports)
                   {
                    /* If two ways are different in any attribute and there is a type of traffic that can use both then it is super */
 
-                   if(WaysCompare(&segmentway[j],&wayx->way))
+                   if(WaysCompareTransports(&segmentway[j],&wayx->way,transports))
                      {
                       issuper=1;
                       break;
@@ -168,14 +183,28 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
             }
          }
 
-       /* Mark the node as super if it is. */
+       /* Mark the node as super if it is and increase its level (or clear it). */
 
        if(issuper)
+         {
           nnodes++;
+
+          if(!levels)
+             nodex.flags|=1;
+          else if((nodex.flags&NODE_LEVEL)!=NODE_LEVEL)
+             nodex.flags++;
+         }
        else
+         {
           ClearBit(nodesx->super,i);
+
+          if(!levels)
+             nodex.flags&=~NODE_LEVEL;
+         }
       }
 
+    WriteFileBuffered(fd,&nodex,sizeof(NodeX));
+
     if(!((i+1)%10000))
        printf_middle("Finding Super-Nodes: Nodes=%"Pindex_t" Super-Nodes=%"Pindex_t,i+1,nnodes);
    }
@@ -191,6 +220,7 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
 #endif
 
  nodesx->fd=CloseFileBuffered(nodesx->fd);
+ CloseFileBuffered(fd);
 
  /* Print the final message */
 
@@ -208,9 +238,11 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
   SegmentsX *segmentsx The set of segments to use.
 
   WaysX *waysx The set of ways to use.
+
+  transports_t transports The types of transport that the super-segments are created for (Transports_ALL for a general purpose database).
   ++++++++++++++++++++++++++++++++++++++*/
 
-SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
+SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,transports_t transports)
 {
  index_t i;
  SegmentsX *supersegmentsx;
@@ -261,16 +293,16 @@ SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
          {
           WayX *wayx=LookupWayX(waysx,segmentx->way,1);
 
-          /* Check that this type of way hasn't already been routed */
+          /* Check that this type of way can be used and hasn't already been routed */
 
-          match=0;
+          match=!(wayx->way.allow&transports);
 
-          if(count>0)
+          if(!match && count>0)
             {
              int j;
 
              for(j=0;j<count;j++)
-                if(!WaysCompare(&prevway[j],&wayx->way))
+                if(!WaysCompareTransports(&prevway[j],&wayx->way,transports))
                   {
                    match=1;
                    break;
@@ -285,7 +317,7 @@ SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
 
           if(!match)
             {
-             Results *results=FindSuperRoutes(nodesx,segmentsx,waysx,i,&wayx->way);
+             Results *results=FindSuperRoutes(nodesx,segmentsx,waysx,i,&wayx->way,transports);
              Result *result=FirstResult(results);
 
              while(result)
@@ -345,6 +377,128 @@ SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Merge the super-segments from one level with the super-segments from the levels below it (both sorted).
+
+  SegmentsX *MergeSuperSegmentLevels Returns a new sorted set of super-segments without those already in the lower levels.
+
+  SegmentsX *segmentsx The set of super-segments from the lower levels.
+
+  SegmentsX *supersegmentsx The set of super-segments from the new level.
+
+  WaysX *waysx The set of ways to use.
+
+  transports_t transports The types of transport that the super-segments were created for.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+SegmentsX *MergeSuperSegmentLevels(SegmentsX *segmentsx,SegmentsX *supersegmentsx,WaysX *waysx,transports_t transports)
+{
+ index_t i=0,j=0,duplicate=0;
+ SegmentsX *levelsegmentsx;
+ SegmentX segmentx,supersegmentx;
+
+ levelsegmentsx=NewSegmentList();
+
+ /* Print the start message */
+
+ printf_first("Merging Super-Segment Levels: Lower=0 Upper=0 Duplicate=0");
+
+ /* Map into memory / open the files */
+
+#if !SLIM
+ waysx->data=MapFile(waysx->filename_tmp);
+#else
+ waysx->fd=SlimMapFile(waysx->filename_tmp);
+
+ InvalidateWayXCache(waysx->cache);
+#endif
+
+ segmentsx->fd=ReOpenFileBuffered(segmentsx->filename_tmp);
+ supersegmentsx->fd=ReOpenFileBuffered(supersegmentsx->filename_tmp);
+
+ if(segmentsx->number>0)
+    ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX));
+ if(supersegmentsx->number>0)
+    ReadFileBuffered(supersegmentsx->fd,&supersegmentx,sizeof(SegmentX));
+
+ /* Loop through and create a new list keeping the sort order */
+
+ while(i<segmentsx->number || j<supersegmentsx->number)
+   {
+    int lower;
+
+    if(j==supersegmentsx->number)
+       lower=1;
+    else if(i==segmentsx->number)
+       lower=0;
+    else if(segmentx.node1!=supersegmentx.node1)
+       lower=(segmentx.node1<supersegmentx.node1);
+    else if(segmentx.node2!=supersegmentx.node2)
+       lower=(segmentx.node2<supersegmentx.node2);
+    else if(DISTANCE(segmentx.distance)!=DISTANCE(supersegmentx.distance))
+       lower=(DISTANCE(segmentx.distance)<DISTANCE(supersegmentx.distance));
+    else if(DISTFLAG(segmentx.distance)!=DISTFLAG(supersegmentx.distance))
+       lower=(DISTFLAG(segmentx.distance)<DISTFLAG(supersegmentx.distance));
+    else
+      {
+       WayX *wayx1=LookupWayX(waysx,segmentx.way,1);
+       WayX *wayx2=LookupWayX(waysx,supersegmentx.way,2);
+
+       lower=1;
+
+       /* the same super-segment (same ends, distance, direction and type of way) is only kept once */
+
+       if(!WaysCompareTransports(&wayx1->way,&wayx2->way,transports))
+         {
+          duplicate++;
+
+          if(++j<supersegmentsx->number)
+             ReadFileBuffered(supersegmentsx->fd,&supersegmentx,sizeof(SegmentX));
+         }
+      }
+
+    if(lower)
+      {
+       AppendSegmentList(levelsegmentsx,segmentx.way,segmentx.node1,segmentx.node2,segmentx.distance);
+
+       if(++i<segmentsx->number)
+          ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX));
+      }
+    else
+      {
+       AppendSegmentList(levelsegmentsx,supersegmentx.way,supersegmentx.node1,supersegmentx.node2,supersegmentx.distance);
+
+       if(++j<supersegmentsx->number)
+          ReadFileBuffered(supersegmentsx->fd,&supersegmentx,sizeof(SegmentX));
+      }
+
+    if(!((i+j)%10000))
+       printf_middle("Merging Super-Segment Levels: Lower=%"Pindex_t" Upper=%"Pindex_t" Duplicate=%"Pindex_t,i,j,duplicate);
+   }
+
+ FinishSegmentList(levelsegmentsx);
+
+ /* Close the files */
+
+ segmentsx->fd=CloseFileBuffered(segmentsx->fd);
+ supersegmentsx->fd=CloseFileBuffered(supersegmentsx->fd);
+
+ /* Unmap from memory / close the files */
+
+#if !SLIM
+ waysx->data=UnmapFile(waysx->data);
+#else
+ waysx->fd=SlimUnmapFile(waysx->fd);
+#endif
+
+ /* Print the final message */
+
+ printf_last("Merged Super-Segment Levels: Lower=%"Pindex_t" Upper=%"Pindex_t" Duplicate=%"Pindex_t" Total=%"Pindex_t,segmentsx->number,supersegmentsx->number,duplicate,levelsegmentsx->number);
+
+ return(levelsegmentsx);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Merge the segments and super-segments into a new segment list.
 
@@ -488,9 +642,11 @@ SegmentsX *MergeSuperSegments(SegmentsX *segmentsx,SegmentsX *supersegmentsx)
   node_t start The start node.
 
   Way *match A template for the type of way that the route must follow.
+
+  transports_t transports The types of transport that the way must match for.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,node_t start,Way *match)
+static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,node_t start,Way *match,transports_t transports)
 {
  static Results *results=NULL; /* static allocation of return value (reset each call) */
  static Queue *queue=NULL;     /* static allocation of internal value (reset each call) */
@@ -505,7 +661,7 @@ static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx
     ResetResultsList(results);
 
  if(!queue)
-    queue=NewQueueList(8);
+    queue=NewQueueList(QUEUE_TYPE_DEFAULT,8);
  else
     ResetQueueList(queue);
 
@@ -543,7 +699,7 @@ static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx
        wayx=LookupWayX(waysx,segmentx->way,2); /* position 1 is already used */
 
        /* must be the right type of way */
-       if(WaysCompare(&wayx->way,match))
+       if(WaysCompareTransports(&wayx->way,match,transports))
           goto endloop;
 
        node2=OtherNode(segmentx,node1);
@@ -551,7 +707,7 @@ static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx
        node2x=LookupNodeX(nodesx,node2,2); /* position 1 is already used */
 
        /* Don't route beyond a node with no access */
-       if(node2x->allow==Transports_None)
+       if(!(node2x->allow&transports))
           goto endloop;
 
        cumulative_distance=(distance_t)result1->score+DISTANCE(segmentx->distance);
@@ -586,3 +742,4 @@ static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx
 
  return(results);
 }
+
@@ -28,9 +28,11 @@
 
 /* Functions in superx.c */
 
-void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx);
+void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,transports_t transports,int levels);
 
-SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx);
+SegmentsX *CreateSuperSegments(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,transports_t transports);
+
+SegmentsX *MergeSuperSegmentLevels(SegmentsX *segmentsx,SegmentsX *supersegmentsx,WaysX *waysx,transports_t transports);
 
 SegmentsX *MergeSuperSegments(SegmentsX *segmentsx,SegmentsX *supersegmentsx);
 
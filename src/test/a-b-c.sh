@@ -39,9 +39,20 @@ else
     pruned=""
 fi
 
+# Alternative options or not alternative options
+
+case "$2" in
+    ""|lib|prune)
+        variation=""
+        ;;
+    *)
+        variation="-$2"
+        ;;
+esac
+
 # Create the output directory
 
-dir="$dir$lib$pruned"
+dir="$dir$lib$pruned$variation"
 
 [ -d $dir ] || mkdir $dir
 
@@ -52,29 +63,49 @@ debugger=${TEST_DEBUGGER:-}
 # Name related options
 
 osm=$name.osm
-log=$name$lib$slim$pruned.log
+log=$name$lib$slim$pruned$variation.log
 
 option_prefix="--prefix=$name"
 option_dir="--dir=$dir"
 
 # Generic program options
 
-option_planetsplitter="--loggable --tagging=../../xml/routino-tagging.xml --errorlog $prune"
+option_planetsplitter="--loggable --tagging=../../xml/routino-tagging.xml --errorlog $prune ${TEST_PLANETSPLITTER_OPTIONS:-}"
+
+if [ -n "${TEST_PLANETSPLITTER_TRANSPORT:-}" ]; then
+    option_planetsplitter_keep="--keep"
+    option_planetsplitter_transport="--process-only --super-transport=$TEST_PLANETSPLITTER_TRANSPORT"
+else
+    option_planetsplitter_keep=""
+fi
 
 option_filedumper="--dump-osm"
 
-option_router="--profile=motorcar --profiles=../../xml/routino-profiles.xml --translations=copyright.xml"
+option_router="--profile=motorcar --profiles=../../xml/routino-profiles.xml --translations=copyright.xml ${TEST_ROUTER_OPTIONS:-}"
 
 if [ ! "$2" = "lib" ]; then
     option_router="$option_router --loggable"
 fi
 
+option_server="--profiles=../../xml/routino-profiles.xml --translations=copyright.xml --output-dir=$dir"
+
+option_request="--output-html --output-gpx-track --output-gpx-route --output-text --output-text-all"
+
 # Run planetsplitter
 
 echo "Running planetsplitter"
 
-echo ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $osm > $log
-$debugger ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $osm >> $log
+echo ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $option_planetsplitter_keep $osm > $log
+$debugger ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $option_planetsplitter_keep $osm >> $log
+
+# Run planetsplitter again for the transport specific super-graph
+
+if [ -n "${TEST_PLANETSPLITTER_TRANSPORT:-}" ]; then
+
+    echo ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $option_planetsplitter_transport >> $log
+    $debugger ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $option_planetsplitter_transport >> $log
+
+fi
 
 # Run filedumper
 
@@ -87,6 +118,11 @@ $debugger ../filedumper$slim $option_dir $option_prefix $option_filedumper > $di
 
 waypoints=`perl waypoints.pl $osm list`
 
+# The same routes are requested from the server when testing the library
+# or calculated by the router in batch mode otherwise
+
+rm -f $dir/$name-requests.txt $dir/$name-batch.txt
+
 # Run the router for each waypoint
 
 for waypoint in $waypoints; do
@@ -109,6 +145,14 @@ for waypoint in $waypoints; do
 
     mv shortest* $dir/$name-$waypoint
 
+    if [ "$2" = "lib" ]; then
+        [ -d $dir/$name-$waypoint-server ] || mkdir $dir/$name-$waypoint-server
+
+        echo --id=$waypoint --output-dir=$name-$waypoint-server $option_request $waypoint_a $waypoint_b $waypoint_c >> $dir/$name-requests.txt
+    else
+        echo --id=$waypoint $waypoint_a $waypoint_b $waypoint_c >> $dir/$name-batch.txt
+    fi
+
     echo diff -u expected/$name-$waypoint.txt $dir/$name-$waypoint/shortest-all.txt >> $log
 
     if ./is-fast-math; then
@@ -118,3 +162,50 @@ for waypoint in $waypoints; do
     fi
 
 done
+
+# Run the server with the same routes and compare the files
+
+if [ "$2" = "lib" ]; then
+
+    echo "Running routino-server"
+
+    echo ../routino-server$slim $option_dir $option_prefix $option_server \< $dir/$name-requests.txt >> $log
+    $debugger ../routino-server$slim $option_dir $option_prefix $option_server < $dir/$name-requests.txt >> $log
+
+    if grep -q '^ERROR' $log; then
+        exit 1
+    fi
+
+    for waypoint in `sed -e 's%^--id=\([^ ]*\) .*%\1%' $dir/$name-requests.txt`; do
+
+        echo diff -r $dir/$name-$waypoint $dir/$name-$waypoint-server >> $log
+        diff -r $dir/$name-$waypoint $dir/$name-$waypoint-server >> $log
+
+    done
+
+fi
+
+# Run the router in batch mode with the same routes and compare the results
+
+if [ ! "$2" = "lib" ]; then
+
+    echo "Running router : batch"
+
+    echo ../router$slim $option_dir $option_prefix $option_router --batch=$dir/$name-batch.txt >> $log
+    $debugger ../router$slim $option_dir $option_prefix $option_router --batch=$dir/$name-batch.txt > $dir/$name-batch-results.txt
+
+    for waypoint in `sed -e 's%^--id=\([^ ]*\) .*%\1%' $dir/$name-batch.txt`; do
+
+        route=`tail -1 $dir/$name-$waypoint/shortest-all.txt | awk -F'\t' '{print $7, $8}'`
+        batch=`awk -F'\t' -v id=$waypoint '$1==id && $2=="OK" {print $3, $4}' $dir/$name-batch-results.txt`
+
+        echo "$waypoint route: $route batch: $batch" >> $log
+
+        if ! echo $route $batch | awk '{exit !($3!="" && $1-$3<0.0051 && $3-$1<0.0051 && $2==$4)}'; then
+            echo "Batch result for $waypoint is different from the route"
+            exit 1
+        fi
+
+    done
+
+fi
@@ -0,0 +1,663 @@
+/***************************************
+ Library test program - checks the results of the libroutino functions that
+ do not have an equivalent in the router program against the routes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "routino.h"
+
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*+ The maximum number of waypoints +*/
+#define NWAYPOINTS 99
+
+
+/* Local functions */
+
+static int check_waypoints(Routino_Database *database,Routino_Profile *profile,
+                           const double *latitudes,const double *longitudes,int npoints,Routino_Waypoint **found);
+
+static int check_matrix(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                        Routino_Waypoint **waypoints,int nwaypoints,int options);
+
+static int check_isochrone(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                           Routino_Waypoint **waypoints,int nwaypoints,int options,float limit);
+
+static int check_match(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                       Routino_Waypoint **waypoints,int nwaypoints,double accuracy);
+
+static int same_value(float value1,float value2,float tolerance);
+
+static void print_usage(const char *argerr);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The main program for the library test.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char** argv)
+{
+ Routino_Database    *database;
+ Routino_Profile     *profile;
+ Routino_Translation *translation;
+ Routino_Waypoint    *waypoints[NWAYPOINTS+1],*found[NWAYPOINTS+1];
+ double               point_lon[NWAYPOINTS+1],point_lat[NWAYPOINTS+1];
+ double               latitudes[NWAYPOINTS+1],longitudes[NWAYPOINTS+1];
+ int                  point_used[NWAYPOINTS+1]={0};
+ char                *dirname=NULL,*prefix=NULL;
+ char                *profiles=NULL,*profilename="motorcar",*translations=NULL;
+ int                  arg,point,npoints=0,nwaypoints=0;
+ int                  failed=0;
+
+ /* Parse the command line arguments */
+
+ for(arg=1;arg<argc;arg++)
+   {
+    if(!strncmp(argv[arg],"--dir=",6))
+       dirname=&argv[arg][6];
+    else if(!strncmp(argv[arg],"--prefix=",9))
+       prefix=&argv[arg][9];
+    else if(!strncmp(argv[arg],"--profiles=",11))
+       profiles=&argv[arg][11];
+    else if(!strncmp(argv[arg],"--profile=",10))
+       profilename=&argv[arg][10];
+    else if(!strncmp(argv[arg],"--translations=",15))
+       translations=&argv[arg][15];
+    else if((!strncmp(argv[arg],"--lon",5) || !strncmp(argv[arg],"--lat",5)) && isdigit(argv[arg][5]))
+      {
+       char *p=&argv[arg][5];
+
+       while(isdigit(*p)) p++;
+       if(*p++!='=')
+          print_usage(argv[arg]);
+
+       point=atoi(&argv[arg][5]);
+       if(point<1 || point>NWAYPOINTS)
+          print_usage(argv[arg]);
+
+       if(argv[arg][4]=='n')
+          point_lon[point]=atof(p);
+       else
+          point_lat[point]=atof(p);
+
+       point_used[point]|=(argv[arg][4]=='n')?1:2;
+      }
+    else
+       print_usage(argv[arg]);
+   }
+
+ if(!profiles || !translations)
+    print_usage(NULL);
+
+ if(Routino_CheckAPIVersion()!=ROUTINO_ERROR_NONE)
+   {
+    fprintf(stderr,"Error: Executable version (%d) and library version (%d) do not match.\n",ROUTINO_API_VERSION,Routino_APIVersion);
+    exit(EXIT_FAILURE);
+   }
+
+ /* Load the database, profile and translation */
+
+ if(!(database=Routino_LoadDatabase(dirname,prefix)))
+   {
+    fprintf(stderr,"Error: Could not load Routino database (error %d).\n",Routino_errno);
+    exit(EXIT_FAILURE);
+   }
+
+ if(Routino_ParseXMLProfiles(profiles) || !(profile=Routino_GetProfile(profilename)))
+   {
+    fprintf(stderr,"Error: Cannot find a profile called '%s' in '%s'.\n",profilename,profiles);
+    exit(EXIT_FAILURE);
+   }
+
+ if(Routino_ValidateProfile(database,profile)!=ROUTINO_ERROR_NONE)
+   {
+    fprintf(stderr,"Error: Profile is invalid or not compatible with database (error %d).\n",Routino_errno);
+    exit(EXIT_FAILURE);
+   }
+
+ if(Routino_ParseXMLTranslations(translations) || !(translation=Routino_GetTranslation("")))
+   {
+    fprintf(stderr,"Error: Cannot read the translations in the file '%s'.\n",translations);
+    exit(EXIT_FAILURE);
+   }
+
+ /* Find the waypoints (only the ones that are near a highway are used) */
+
+ for(point=1;point<=NWAYPOINTS;point++)
+   {
+    Routino_Waypoint *waypoint;
+
+    if(point_used[point]!=3)
+       continue;
+
+    waypoint=Routino_FindWaypoint(database,profile,point_lat[point],point_lon[point]);
+
+    latitudes[npoints]=point_lat[point];
+    longitudes[npoints]=point_lon[point];
+    found[npoints++]=waypoint;
+
+    if(waypoint)
+       waypoints[nwaypoints++]=waypoint;
+
+    printf("Waypoint %d: %s\n",point,waypoint?"found":"not found");
+   }
+
+ /* Run the checks */
+
+ failed+=check_waypoints(database,profile,latitudes,longitudes,npoints,found);
+
+ failed+=check_matrix(database,profile,translation,waypoints,nwaypoints,ROUTINO_ROUTE_SHORTEST);
+ failed+=check_matrix(database,profile,translation,waypoints,nwaypoints,ROUTINO_ROUTE_QUICKEST);
+
+ failed+=check_isochrone(database,profile,translation,waypoints,nwaypoints,ROUTINO_ROUTE_SHORTEST,0.5);
+ failed+=check_isochrone(database,profile,translation,waypoints,nwaypoints,ROUTINO_ROUTE_QUICKEST,0.5);
+
+ failed+=check_match(database,profile,translation,waypoints,nwaypoints,5.0);
+
+ /* Tidy up and exit */
+
+ for(point=0;point<nwaypoints;point++)
+    free(waypoints[point]);
+
+ Routino_FreeXMLTranslations();
+ Routino_FreeXMLProfiles();
+ Routino_UnloadDatabase(database);
+
+ if(failed)
+    fprintf(stderr,"Error: %d library checks failed.\n",failed);
+
+ return(failed?EXIT_FAILURE:EXIT_SUCCESS);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find all of the waypoints together and check that they are the same as the ones that were found
+  one at a time (the matrices of distances and durations between them must be identical).
+
+  int check_waypoints Returns the number of checks that failed.
+
+  Routino_Database *database The Routino database to use.
+
+  Routino_Profile *profile The Routino profile to use.
+
+  const double *latitudes The latitudes of the points.
+
+  const double *longitudes The longitudes of the points.
+
+  int npoints The number of points.
+
+  Routino_Waypoint **found The waypoints found one at a time for each point (or NULL if not found).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int check_waypoints(Routino_Database *database,Routino_Profile *profile,
+                           const double *latitudes,const double *longitudes,int npoints,Routino_Waypoint **found)
+{
+ Routino_Waypoint **waypoints,**single,**multiple;
+ float *distances1,*durations1,*distances2,*durations2;
+ int i,nwaypoints=0,failed=0;
+
+ if(npoints==0)
+    return(0);
+
+ waypoints=(Routino_Waypoint**)malloc(npoints*sizeof(Routino_Waypoint*));
+
+ if(Routino_FindWaypoints(database,profile,latitudes,longitudes,npoints,waypoints)<0)
+   {
+    fprintf(stderr,"Error: Cannot find the waypoints together (error %d).\n",Routino_errno);
+    free(waypoints);
+    return(1);
+   }
+
+ /* The same points must have been found */
+
+ single=(Routino_Waypoint**)malloc(2*npoints*sizeof(Routino_Waypoint*));
+ multiple=(Routino_Waypoint**)malloc(2*npoints*sizeof(Routino_Waypoint*));
+
+ for(i=0;i<npoints;i++)
+   {
+    if(!found[i]!=!waypoints[i])
+      {
+       fprintf(stderr,"Error: The waypoint for point %d was %s one at a time but %s together.\n",i+1,
+                      found[i]?"found":"not found",waypoints[i]?"found":"not found");
+       failed++;
+      }
+    else if(found[i])
+      {
+       single[nwaypoints]=found[i];
+       multiple[nwaypoints++]=waypoints[i];
+      }
+   }
+
+ printf("Waypoints: %d found together\n",nwaypoints);
+
+ /* The routes between them must be the same */
+
+ if(!failed && nwaypoints>0)
+   {
+    memcpy(single+nwaypoints,single,nwaypoints*sizeof(Routino_Waypoint*));
+    memcpy(multiple+nwaypoints,multiple,nwaypoints*sizeof(Routino_Waypoint*));
+
+    distances1=(float*)malloc(nwaypoints*nwaypoints*sizeof(float));
+    durations1=(float*)malloc(nwaypoints*nwaypoints*sizeof(float));
+    distances2=(float*)malloc(nwaypoints*nwaypoints*sizeof(float));
+    durations2=(float*)malloc(nwaypoints*nwaypoints*sizeof(float));
+
+    if(Routino_CalculateMatrix(database,profile,single,nwaypoints,nwaypoints,ROUTINO_ROUTE_SHORTEST,distances1,durations1,NULL)!=ROUTINO_ERROR_NONE ||
+       Routino_CalculateMatrix(database,profile,multiple,nwaypoints,nwaypoints,ROUTINO_ROUTE_SHORTEST,distances2,durations2,NULL)!=ROUTINO_ERROR_NONE)
+      {
+       fprintf(stderr,"Error: Cannot calculate the matrix (error %d).\n",Routino_errno);
+       failed++;
+      }
+    else if(memcmp(distances1,distances2,nwaypoints*nwaypoints*sizeof(float)) ||
+            memcmp(durations1,durations2,nwaypoints*nwaypoints*sizeof(float)))
+      {
+       fprintf(stderr,"Error: The routes between the waypoints found together are different.\n");
+       failed++;
+      }
+
+    free(distances1);
+    free(durations1);
+    free(distances2);
+    free(durations2);
+   }
+
+ for(i=0;i<npoints;i++)
+    if(waypoints[i])
+       free(waypoints[i]);
+
+ free(waypoints);
+ free(single);
+ free(multiple);
+
+ return(failed);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the matrix of distances and durations between all of the waypoints and check each
+  one against a route calculated between the same pair of waypoints.
+
+  int check_matrix Returns the number of checks that failed.
+
+  Routino_Database *database The Routino database to use.
+
+  Routino_Profile *profile The Routino profile to use.
+
+  Routino_Translation *translation The Routino translation to use.
+
+  Routino_Waypoint **waypoints The waypoints.
+
+  int nwaypoints The number of waypoints.
+
+  int options The routing options (ROUTINO_ROUTE_SHORTEST or ROUTINO_ROUTE_QUICKEST).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int check_matrix(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                        Routino_Waypoint **waypoints,int nwaypoints,int options)
+{
+ Routino_Waypoint **both;
+ float *distances,*durations;
+ int i,j,failed=0;
+
+ if(nwaypoints==0)
+    return(0);
+
+ distances=(float*)malloc(nwaypoints*nwaypoints*sizeof(float));
+ durations=(float*)malloc(nwaypoints*nwaypoints*sizeof(float));
+
+ /* The waypoints are used as both the sources and the destinations */
+
+ both=(Routino_Waypoint**)malloc(2*nwaypoints*sizeof(Routino_Waypoint*));
+
+ memcpy(both,waypoints,nwaypoints*sizeof(Routino_Waypoint*));
+ memcpy(both+nwaypoints,waypoints,nwaypoints*sizeof(Routino_Waypoint*));
+
+ if(Routino_CalculateMatrix(database,profile,both,nwaypoints,nwaypoints,options,distances,durations,NULL)!=ROUTINO_ERROR_NONE)
+   {
+    fprintf(stderr,"Error: Cannot calculate the matrix (error %d).\n",Routino_errno);
+    failed++;
+   }
+
+ free(both);
+
+ if(failed)
+   {
+    free(distances);
+    free(durations);
+    return(failed);
+   }
+
+ printf("Matrix (%s):\n",options==ROUTINO_ROUTE_QUICKEST?"quickest":"shortest");
+
+ for(i=0;i<nwaypoints;i++)
+    for(j=0;j<nwaypoints;j++)
+      {
+       Routino_Waypoint *pair[2];
+       Routino_Output *route,*last;
+       float distance=-1,duration=-1;
+       int nsegments=0;
+
+       printf("%3d %3d : %8.3f km %8.3f min\n",i+1,j+1,distances[i*nwaypoints+j],durations[i*nwaypoints+j]);
+
+       if(i==j)
+          continue;
+
+       pair[0]=waypoints[i];
+       pair[1]=waypoints[j];
+
+       route=Routino_CalculateRoute(database,profile,translation,pair,2,options|ROUTINO_ROUTE_LIST_TEXT_ALL,NULL);
+
+       if(route)
+         {
+          for(last=route;last->next;last=last->next)
+             nsegments++;
+
+          distance=last->dist;
+          duration=last->time;
+
+          Routino_DeleteRoute(route);
+         }
+       else if(Routino_errno<ROUTINO_ERROR_NO_ROUTE_1)
+         {
+          fprintf(stderr,"Error: Cannot calculate the route from %d to %d (error %d).\n",i+1,j+1,Routino_errno);
+          failed++;
+          continue;
+         }
+
+       /* The duration of each segment is rounded down to 0.1 seconds but the matrix adds up the super-segments */
+
+       if(!same_value(distance,distances[i*nwaypoints+j],0.001f) ||
+          !same_value(duration,durations[i*nwaypoints+j],0.001f+nsegments/600.0f))
+         {
+          fprintf(stderr,"Error: The matrix from %d to %d (%.3f km, %.3f min) is not the route (%.3f km, %.3f min).\n",i+1,j+1,
+                         distances[i*nwaypoints+j],durations[i*nwaypoints+j],distance,duration);
+          failed++;
+         }
+      }
+
+ free(distances);
+ free(durations);
+
+ return(failed);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the isochrone from each of the waypoints and check that no route from the waypoint
+  to a point in it is shorter (or quicker) than the isochrone says.
+
+  int check_isochrone Returns the number of checks that failed.
+
+  Routino_Database *database The Routino database to use.
+
+  Routino_Profile *profile The Routino profile to use.
+
+  Routino_Translation *translation The Routino translation to use.
+
+  Routino_Waypoint **waypoints The waypoints.
+
+  int nwaypoints The number of waypoints.
+
+  int options The routing options (ROUTINO_ROUTE_SHORTEST or ROUTINO_ROUTE_QUICKEST).
+
+  float limit The limit of the distance (km) or duration (minutes).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int check_isochrone(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                           Routino_Waypoint **waypoints,int nwaypoints,int options,float limit)
+{
+ int i,failed=0;
+
+ for(i=0;i<nwaypoints;i++)
+   {
+    Routino_Output *isochrone,*point;
+    float previous=0;
+
+    isochrone=Routino_CalculateIsochrone(database,profile,translation,waypoints[i],limit,options|ROUTINO_ROUTE_LIST_TEXT,NULL);
+
+    if(!isochrone)
+      {
+       fprintf(stderr,"Error: Cannot calculate the isochrone from %d (error %d).\n",i+1,Routino_errno);
+       failed++;
+       continue;
+      }
+
+    printf("Isochrone from %d (%s):\n",i+1,options==ROUTINO_ROUTE_QUICKEST?"quickest":"shortest");
+
+    for(point=isochrone;point;point=point->next)
+      {
+       Routino_Waypoint *pair[2];
+       Routino_Output *route,*last;
+       float value,distance,duration;
+       int nsegments=0;
+
+       printf("%10.6f %11.6f : %8.3f km %8.3f min\n",(180.0/M_PI)*point->lat,(180.0/M_PI)*point->lon,point->dist,point->time);
+
+       value=(options==ROUTINO_ROUTE_QUICKEST)?point->time:point->dist;
+
+       if(value>limit || value<previous)
+         {
+          fprintf(stderr,"Error: The isochrone from %d is not sorted or is outside the limit (%.3f).\n",i+1,value);
+          failed++;
+         }
+
+       previous=value;
+
+       /* The route to a waypoint placed on the node */
+
+       pair[0]=waypoints[i];
+       pair[1]=Routino_FindWaypoint(database,profile,(180.0/M_PI)*point->lat,(180.0/M_PI)*point->lon);
+
+       if(!pair[1])
+         {
+          fprintf(stderr,"Error: Cannot find a waypoint at a point of the isochrone from %d.\n",i+1);
+          failed++;
+          continue;
+         }
+
+       route=Routino_CalculateRoute(database,profile,translation,pair,2,options|ROUTINO_ROUTE_LIST_TEXT_ALL,NULL);
+
+       free(pair[1]);
+
+       if(!route)
+         {
+          fprintf(stderr,"Error: Cannot calculate the route to a point of the isochrone from %d (error %d).\n",i+1,Routino_errno);
+          failed++;
+          continue;
+         }
+
+       for(last=route;last->next;last=last->next)
+          nsegments++;
+
+       distance=last->dist;
+       duration=last->time;
+
+       Routino_DeleteRoute(route);
+
+       /* The isochrone is the minimum distance or duration but the route can be longer because
+          it must reach the waypoint along one particular segment and it prefers some highways;
+          the waypoint is within a metre of the node and each segment is rounded. */
+
+       if(options==ROUTINO_ROUTE_QUICKEST ? (duration<point->time-0.005f-nsegments/600.0f) : (distance<point->dist-0.005f))
+         {
+          fprintf(stderr,"Error: The isochrone from %d (%.3f km, %.3f min) is longer than the route (%.3f km, %.3f min).\n",i+1,
+                         point->dist,point->time,distance,duration);
+          failed++;
+         }
+      }
+
+    Routino_DeleteRoute(isochrone);
+   }
+
+ return(failed);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Use the points of the route between each pair of adjacent waypoints as a GPS trace and check
+  that all of them are matched and that the distance along the highways is the route distance.
+
+  int check_match Returns the number of checks that failed.
+
+  Routino_Database *database The Routino database to use.
+
+  Routino_Profile *profile The Routino profile to use.
+
+  Routino_Translation *translation The Routino translation to use.
+
+  Routino_Waypoint **waypoints The waypoints.
+
+  int nwaypoints The number of waypoints.
+
+  double accuracy The accuracy of the points of the trace (in metres).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int check_match(Routino_Database *database,Routino_Profile *profile,Routino_Translation *translation,
+                       Routino_Waypoint **waypoints,int nwaypoints,double accuracy)
+{
+ int i,failed=0;
+
+ for(i=1;i<nwaypoints;i++)
+   {
+    Routino_Output *route,*point;
+    Routino_Waypoint **matched;
+    double *latitudes,*longitudes;
+    float *distances,distance=0;
+    int j,npoints=0,nmatched;
+
+    route=Routino_CalculateRoute(database,profile,translation,&waypoints[i-1],2,ROUTINO_ROUTE_SHORTEST|ROUTINO_ROUTE_LIST_TEXT_ALL,NULL);
+
+    if(!route)
+       continue;
+
+    for(point=route;point;point=point->next)
+       npoints++;
+
+    latitudes=(double*)malloc(npoints*sizeof(double));
+    longitudes=(double*)malloc(npoints*sizeof(double));
+    matched=(Routino_Waypoint**)malloc(npoints*sizeof(Routino_Waypoint*));
+    distances=(float*)malloc(npoints*sizeof(float));
+
+    for(j=0,point=route;point;point=point->next,j++)
+      {
+       latitudes[j]=(180.0/M_PI)*point->lat;
+       longitudes[j]=(180.0/M_PI)*point->lon;
+      }
+
+    nmatched=Routino_MatchTrace(database,profile,latitudes,longitudes,npoints,accuracy,matched,distances);
+
+    printf("Match from %d to %d: %d of %d points\n",i,i+1,nmatched,npoints);
+
+    if(nmatched!=npoints)
+      {
+       fprintf(stderr,"Error: Only %d of the %d points of the route from %d to %d were matched (error %d).\n",nmatched,npoints,i,i+1,Routino_errno);
+       failed++;
+      }
+    else
+      {
+       for(j=1;j<npoints;j++)
+          if(distances[j]<0)
+             break;
+          else
+             distance+=distances[j];
+
+       for(point=route;point->next;point=point->next)
+          ;
+
+       /* The distance between each pair of matched points is rounded to a metre */
+
+       if(j<npoints || !same_value(distance,point->dist,0.001f*npoints))
+         {
+          fprintf(stderr,"Error: The matched trace from %d to %d (%.3f km) is not the route (%.3f km).\n",i,i+1,
+                         j<npoints?-1.0f:distance,point->dist);
+          failed++;
+         }
+      }
+
+    for(j=0;j<npoints;j++)
+       if(nmatched>0 && matched[j])
+          free(matched[j]);
+
+    free(latitudes);
+    free(longitudes);
+    free(matched);
+    free(distances);
+
+    Routino_DeleteRoute(route);
+   }
+
+ return(failed);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compare two distances or durations allowing for rounding.
+
+  int same_value Returns true if the values are the same (or both are negative for no route).
+
+  float value1 The first value.
+
+  float value2 The second value.
+
+  float tolerance The largest difference allowed.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int same_value(float value1,float value2,float tolerance)
+{
+ if(value1<0 || value2<0)
+    return(value1<0 && value2<0);
+
+ return(fabsf(value1-value2)<=tolerance);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the usage information.
+
+  const char *argerr The argument that gave the error (if there is one).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_usage(const char *argerr)
+{
+ fprintf(stderr,
+         "Usage: library-calls [--dir=<dirname>] [--prefix=<name>]\n"
+         "                     --profiles=<filename> [--profile=<name>]\n"
+         "                     --translations=<filename>\n"
+         "                     --lon1=<longitude> --lat1=<latitude>\n"
+         "                     --lon2=<longitude> --lat2=<latitude>\n"
+         "                     ... --lon99=<longitude> --lat99=<latitude>\n");
+
+ if(argerr)
+    fprintf(stderr,
+            "\n"
+            "Error with command line parameter: %s\n",argerr);
+
+ exit(EXIT_FAILURE);
+}
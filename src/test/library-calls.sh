@@ -0,0 +1,61 @@
+#!/bin/sh
+
+# Exit on error
+
+set -e
+
+# Slim or non-slim
+
+if [ "$1" = "slim" ]; then
+    slim="-slim"
+    dir="slim+lib"
+else
+    slim=""
+    dir="fat+lib"
+fi
+
+# Libroutino
+
+LD_LIBRARY_PATH=$PWD/..:$LD_LIBRARY_PATH
+export LD_LIBRARY_PATH
+
+# Run the programs under a run-time debugger
+
+debugger=${TEST_DEBUGGER:-}
+
+# Generic program options
+
+option_library="--profile=motorcar --profiles=../../xml/routino-profiles.xml --translations=copyright.xml"
+
+# Run the library checks for each database created by the libroutino tests
+
+for script in $@; do
+
+    name=`basename $script .sh`
+    osm=$name.osm
+
+    [ -f $dir/$name-nodes.mem ] || continue
+
+    echo "Running library-calls : $name"
+
+    log=$name-library-calls$slim.log
+
+    option_prefix="--prefix=$name"
+    option_dir="--dir=$dir"
+
+    # All of the waypoints
+
+    option_waypoints=""
+    number=0
+
+    for waypoint in `perl waypoints.pl $osm list`; do
+        number=`expr $number + 1`
+        option_waypoints="$option_waypoints `perl waypoints.pl $osm $waypoint $number`"
+    done
+
+    [ $number -gt 0 ] || continue
+
+    echo ./library-calls$slim $option_dir $option_prefix $option_library $option_waypoints > $log
+    $debugger ./library-calls$slim $option_dir $option_prefix $option_library $option_waypoints > $dir/$name-library-calls.txt 2>> $log
+
+done
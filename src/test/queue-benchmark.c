@@ -0,0 +1,374 @@
+/***************************************
+ Queue benchmark program - replays a trace of queue operations from the router
+ ('--queue-trace' option) with each type of queue and reports the time taken.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2026 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "results.h"
+
+
+/* Local data types */
+
+/*+ A single operation from the trace. +*/
+typedef struct _Operation
+{
+ char     op;                   /*+ The operation ('I'nsert, 'P'op, 'R'eset or 'F'ree). +*/
+ char     empty;                /*+ Set if the pop operation found an empty queue. +*/
+ uint32_t queue;                /*+ The number of the queue. +*/
+ uint32_t result;               /*+ The number of the result (insert only). +*/
+ score_t  score;                /*+ The score inserted or popped. +*/
+}
+ Operation;
+
+/*+ A hash table converting the pointers in the trace into consecutive numbers. +*/
+typedef struct _PointerMap
+{
+ uint32_t  nbins;               /*+ The number of bins in the hash table. +*/
+ uint32_t  number;              /*+ The number of occupied bins. +*/
+
+ uint64_t *pointers;            /*+ The pointers. +*/
+ uint32_t *numbers;             /*+ The numbers allocated to the pointers. +*/
+
+ uint32_t  next;                /*+ The next number to allocate. +*/
+}
+ PointerMap;
+
+
+/* Local functions */
+
+static uint32_t *lookup_pointer(PointerMap *map,uint64_t pointer);
+static uint32_t pointer_number(PointerMap *map,const char *string,int renumber);
+
+static int replay(QueueType type,Operation *ops,size_t nops,uint32_t nqueues,uint32_t nresults,double *elapsed);
+
+static void print_usage(const char *argerr);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The main program for the queue benchmark.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char** argv)
+{
+ char *filename=NULL;
+ int arg,repeat=3;
+ FILE *file;
+ char line[256];
+ PointerMap queues={0},results={0};
+ Operation *ops=NULL;
+ size_t nops=0,nallocops=0;
+ QueueType type;
+
+ /* Parse the command line arguments */
+
+ for(arg=1;arg<argc;arg++)
+   {
+    if(!strcmp(argv[arg],"--help"))
+       print_usage(NULL);
+    else if(!strncmp(argv[arg],"--repeat=",9))
+      {
+       repeat=atoi(&argv[arg][9]);
+
+       if(repeat<1)
+          print_usage(argv[arg]);
+      }
+    else if(argv[arg][0]=='-' && argv[arg][1]=='-')
+       print_usage(argv[arg]);
+    else if(filename)
+       print_usage(argv[arg]);
+    else
+       filename=argv[arg];
+   }
+
+ if(!filename)
+    print_usage(NULL);
+
+ /* Read in the trace */
+
+ file=fopen(filename,"r");
+
+ if(!file)
+   {
+    fprintf(stderr,"Error: Cannot open file '%s' for reading.\n",filename);
+    exit(EXIT_FAILURE);
+   }
+
+ while(fgets(line,sizeof(line),file))
+   {
+    char q[32],r[32],s[32];
+    Operation *op;
+
+    if(nops==nallocops)
+      {
+       nallocops+=nallocops+1024;
+       ops=(Operation*)realloc(ops,nallocops*sizeof(Operation));
+      }
+
+    op=&ops[nops];
+
+    op->op=line[0];
+    op->empty=0;
+    op->result=0;
+    op->score=0;
+
+    if(line[0]=='I' && sscanf(line+1,"%31s %31s %31s",q,r,s)==3)
+      {
+       op->queue=pointer_number(&queues,q,0);
+       op->result=pointer_number(&results,r,0);
+       op->score=(score_t)atof(s);
+      }
+    else if(line[0]=='P' && sscanf(line+1,"%31s %31s",q,s)==2)
+      {
+       op->queue=pointer_number(&queues,q,0);
+
+       if(s[0]=='-')
+          op->empty=1;
+       else
+          op->score=(score_t)atof(s);
+      }
+    else if(line[0]=='R' && sscanf(line+1,"%31s",q)==1)
+       op->queue=pointer_number(&queues,q,0);
+    else if(line[0]=='F' && sscanf(line+1,"%31s",q)==1)
+       op->queue=pointer_number(&queues,q,1);
+    else
+      {
+       fprintf(stderr,"Error: Cannot parse line %lu of the trace.\n",(unsigned long)nops+1);
+       exit(EXIT_FAILURE);
+      }
+
+    nops++;
+   }
+
+ fclose(file);
+
+ printf("Trace: %lu operations using %"PRIu32" queues and %"PRIu32" results.\n",(unsigned long)nops,queues.next,results.next);
+
+ /* Replay the trace with each queue type */
+
+ for(type=Queue_Binary;type<=Queue_Radix;type++)
+   {
+    double best=-1;
+    int mismatches=0,i;
+
+    for(i=0;i<repeat;i++)
+      {
+       double elapsed;
+
+       mismatches=replay(type,ops,nops,queues.next,results.next,&elapsed);
+
+       if(best<0 || elapsed<best)
+          best=elapsed;
+      }
+
+    printf("%-8s %9.3f ms %7.2f ns/operation (%d mismatched pops)\n",QueueTypeName(type),
+           1000*best,nops?1e9*best/nops:0.0,mismatches);
+   }
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Replay the trace with one type of queue.
+
+  int replay Returns the number of pops that removed a different score from the trace.
+
+  QueueType type The type of queue to use.
+
+  Operation *ops The operations to replay.
+
+  size_t nops The number of operations.
+
+  uint32_t nqueues The number of queues used in the trace.
+
+  uint32_t nresults The number of results used in the trace.
+
+  double *elapsed Returns the elapsed time in seconds.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int replay(QueueType type,Operation *ops,size_t nops,uint32_t nqueues,uint32_t nresults,double *elapsed)
+{
+ Queue **queues=(Queue**)calloc(nqueues,sizeof(Queue*));
+ Result *results=(Result*)calloc(nresults,sizeof(Result));
+ struct timeval start,finish;
+ int mismatches=0;
+ size_t i;
+
+ gettimeofday(&start,NULL);
+
+ for(i=0;i<nops;i++)
+   {
+    Operation *op=&ops[i];
+    Queue *queue=queues[op->queue];
+
+    switch(op->op)
+      {
+      case 'I':
+       if(!queue)
+          queue=queues[op->queue]=NewQueueList(type,8);
+
+       InsertInQueue(queue,&results[op->result],op->score);
+       break;
+
+      case 'P':
+       {
+        Result *result=queue?PopFromQueue(queue):NULL;
+
+        if(op->empty?(result!=NULL):(!result || result->sortby!=op->score))
+           mismatches++;
+       }
+       break;
+
+      case 'R':
+      case 'F':
+       if(queue)
+         {
+          /* Any results left in the queue would still be marked as queued */
+
+          while(PopFromQueue(queue))
+             ;
+
+          if(op->op=='F')
+            {
+             FreeQueueList(queue);
+             queues[op->queue]=NULL;
+            }
+          else
+             ResetQueueList(queue);
+         }
+       break;
+      }
+   }
+
+ gettimeofday(&finish,NULL);
+
+ *elapsed=(double)(finish.tv_sec-start.tv_sec)+(double)(finish.tv_usec-start.tv_usec)/1e6;
+
+ for(i=0;i<nqueues;i++)
+    if(queues[i])
+       FreeQueueList(queues[i]);
+
+ free(queues);
+ free(results);
+
+ return(mismatches);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the bin in the hash table for a pointer (adding it if it is not there).
+
+  uint32_t *lookup_pointer Returns a pointer to the number for the pointer.
+
+  PointerMap *map The hash table.
+
+  uint64_t pointer The pointer to find.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint32_t *lookup_pointer(PointerMap *map,uint64_t pointer)
+{
+ uint32_t bin;
+
+ if(map->number>=map->nbins/2)
+   {
+    PointerMap old=*map;
+
+    map->nbins=map->nbins?2*map->nbins:1024;
+    map->number=0;
+    map->pointers=(uint64_t*)calloc(map->nbins,sizeof(uint64_t));
+    map->numbers=(uint32_t*)calloc(map->nbins,sizeof(uint32_t));
+
+    for(bin=0;bin<old.nbins;bin++)
+       if(old.pointers[bin])
+          *lookup_pointer(map,old.pointers[bin])=old.numbers[bin];
+
+    if(old.nbins)
+      {
+       free(old.pointers);
+       free(old.numbers);
+      }
+   }
+
+ bin=(uint32_t)((pointer>>4)^(pointer>>20))&(map->nbins-1);
+
+ while(map->pointers[bin] && map->pointers[bin]!=pointer)
+    bin=(bin+1)&(map->nbins-1);
+
+ if(!map->pointers[bin])
+   {
+    map->pointers[bin]=pointer;
+    map->numbers[bin]=map->next++;
+    map->number++;
+   }
+
+ return(&map->numbers[bin]);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Convert a pointer from the trace into a number.
+
+  uint32_t pointer_number Returns the number.
+
+  PointerMap *map The hash table of pointers.
+
+  const char *string The pointer as a string.
+
+  int renumber Set to true if the pointer will get a new number the next time that it is used (after being freed).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint32_t pointer_number(PointerMap *map,const char *string,int renumber)
+{
+ uint32_t *number=lookup_pointer(map,(uint64_t)strtoull(string,NULL,16)+1);
+ uint32_t retval=*number;
+
+ if(renumber)
+    *number=map->next++;
+
+ return(retval);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the usage information.
+
+  const char *argerr The argument that gave the error (if there is one).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_usage(const char *argerr)
+{
+ fprintf(stderr,
+         "Usage: queue-benchmark [--help] [--repeat=<n>] <trace-file>\n"
+         "\n"
+         "Replays a trace of queue operations written by 'router --queue-trace=<trace-file>'\n"
+         "with each type of queue and prints the fastest time from <n> repeats (default 3).\n");
+
+ if(argerr)
+    fprintf(stderr,
+            "\n"
+            "Error with command line parameter: %s\n",argerr);
+
+ exit(!!argerr);
+}
@@ -34,6 +34,22 @@ compare_results ()
     fi
 }
 
+compare_routes ()
+{
+    exclude=""
+
+    for route in $3; do
+        exclude="$exclude -x $route"
+    done
+
+    if diff -q -r -x '*.mem' -x '*.osm' -x '*.log' -x '*-all.txt' -x '*-batch-results.txt' $exclude $1 $2; then
+        echo "... matched"
+    else
+        echo "... match FAILED"
+        status=false
+    fi
+}
+
 
 # Initial informational message
 
@@ -46,7 +62,12 @@ echo ""
 TEST_DEBUGGER=$debugger
 export TEST_DEBUGGER
 
-for type in 1 2 3; do
+for type in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15; do
+
+    options_planetsplitter=""
+    options_router=""
+    options_transport=""
+    different_routes=""
 
     case $type in
         1)
@@ -64,8 +85,91 @@ for type in 1 2 3; do
             arg="prune"
             description="pruned"
             ;;
+        4)
+            suffix="-bidirectional"
+            arg="bidirectional"
+            description="bidirectional"
+            options_router="--bidirectional"
+            ;;
+        5)
+            suffix="-hierarchy"
+            arg="hierarchy"
+            description="hierarchy"
+            options_planetsplitter="--hierarchy"
+            options_router="--hierarchy"
+            ;;
+        6)
+            suffix="-landmarks"
+            arg="landmarks"
+            description="landmarks"
+            options_planetsplitter="--landmarks=4"
+            options_router="--landmarks"
+            ;;
+        7)
+            suffix="-quad"
+            arg="quad"
+            description="4-ary heap queue"
+            options_router="--queue=quad"
+            ;;
+        8)
+            suffix="-radix"
+            arg="radix"
+            description="radix heap queue"
+            options_router="--queue=radix"
+            ;;
+        9)
+            suffix="-adjacency"
+            arg="adjacency"
+            description="adjacency arrays"
+            options_planetsplitter="--adjacency"
+            ;;
+        10)
+            suffix="-compressed"
+            arg="compressed"
+            description="compressed nodes and segments"
+            options_planetsplitter="--compress"
+            ;;
+        11)
+            suffix="-hilbert"
+            arg="hilbert"
+            description="Hilbert curve order"
+            options_planetsplitter="--hilbert"
+            # The zero length segment between coincident waypoints points
+            # towards node1 of the real segment so the direction that the
+            # next part of the route starts in depends on the node order.
+            different_routes="coincident-waypoint-WP03"
+            ;;
+        12)
+            suffix="-container"
+            arg="container"
+            description="single file container"
+            options_planetsplitter="--container"
+            ;;
+        13)
+            suffix="-snap-index"
+            arg="snap-index"
+            description="segment snapping index"
+            options_planetsplitter="--snap-index"
+            ;;
+        14)
+            suffix="-super-transport"
+            arg="super-transport"
+            description="motorcar super-graph"
+            options_transport="motorcar"
+            ;;
+        15)
+            suffix="-super-levels"
+            arg="super-levels"
+            description="levels of super-nodes"
+            options_planetsplitter="--super-levels"
+            ;;
     esac
 
+    TEST_PLANETSPLITTER_OPTIONS=$options_planetsplitter
+    TEST_ROUTER_OPTIONS=$options_router
+    TEST_PLANETSPLITTER_TRANSPORT=$options_transport
+    export TEST_PLANETSPLITTER_OPTIONS TEST_ROUTER_OPTIONS TEST_PLANETSPLITTER_TRANSPORT
+
     # Normal mode
 
     for script in $@; do
@@ -82,6 +186,18 @@ for type in 1 2 3; do
         run_a_test $script slim $arg
     done
 
+    # Library functions not used by the router
+
+    if [ "$arg" = "lib" ]; then
+        echo ""
+        echo "Testing: library-calls (non-slim, $description) ... "
+        run_a_test library-calls.sh fat $@
+
+        echo ""
+        echo "Testing: library-calls (slim, $description) ... "
+        run_a_test library-calls.sh slim $@
+    fi
+
     # Check results
 
     if $status; then
@@ -108,6 +224,25 @@ for type in 1 2 3; do
         exit 1
     fi
 
+    # Compare the routes with the ones without the extra options
+
+    [ -n "$options_planetsplitter$options_router$options_transport" ] || continue
+
+    echo ""
+
+    echo "Comparing: routes with and without the options ($description) ... "
+
+    compare_routes fat fat$suffix "$different_routes"
+
+    # Check comparison
+
+    if $status; then
+        echo "Success: routes with and without the options match"
+    else
+        echo "Warning: routes with and without the options are different"
+        exit 1
+    fi
+
 done
 
 exit 0
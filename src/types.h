@@ -39,6 +39,19 @@
 #define NWAYPOINTS 99
 
 
+/*+ The version of the database file formats (stored in each file header and checked when loading). +*/
+#define DATABASE_VERSION 1
+
+/*+ The magic numbers at the start of the header of each type of database file ("RT" and two letters). +*/
+#define NODES_MAGIC      0x52544E44
+#define SEGMENTS_MAGIC   0x52545347
+#define WAYS_MAGIC       0x52545759
+#define RELATIONS_MAGIC  0x5254524C
+#define HIERARCHY_MAGIC  0x52544852
+#define LANDMARKS_MAGIC  0x52544C4D
+#define ERRORLOGS_MAGIC  0x52544552
+
+
 /*+ An undefined waypoint index. +*/
 #define NO_WAYPOINT    ((waypoint_t)~0)
 
@@ -90,6 +103,9 @@
 /*+ A flag to mark a node as deleted. +*/
 #define NODE_DELETED     ((nodeflags_t)0x0400)
 
+/*+ The flag bits used to store the level of a super-node (1 for the lowest level, 0 if unknown). +*/
+#define NODE_LEVEL       ((nodeflags_t)0x0007)
+
 
 /*+ A flag to mark a segment as being part of an area (must be the highest valued flag). +*/
 #define SEGMENT_AREA   ((distance_t)0x80000000)
@@ -205,6 +221,9 @@ typedef float score_t;
 /*+ Conversion from duration_t to minutes. +*/
 #define duration_to_minutes(xx) ((double)(xx)/600.0)
 
+/*+ Conversion from minutes to duration_t. +*/
+#define minutes_to_duration(xx) ((duration_t)((double)(xx)*600.0))
+
 /*+ Conversion from duration_t to hours. +*/
 #define duration_to_hours(xx)   ((double)(xx)/36000.0)
 
@@ -437,6 +456,14 @@ typedef struct _TurnRelation TurnRelation;
 
 typedef struct _Relations Relations;
 
+typedef struct _Hierarchy Hierarchy;
+
+typedef struct _Landmarks Landmarks;
+
+typedef struct _Fakes Fakes;
+
+typedef struct _Routino_Context Context;
+
 
 /* Functions in types.c */
 
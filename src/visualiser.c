@@ -229,7 +229,7 @@ static void output_super(index_t node,double latitude,double longitude)
        index_t othernode=OtherNode(segmentp,node);
        double lat,lon;
 
-       GetLatLong(OSMNodes,othernode,NULL,&lat,&lon);
+       GetLatLong(OSMNodes,othernode,&lat,&lon);
 
        if(node>othernode || (lat<LatMin || lat>LatMax || lon<LonMin || lon>LonMax))
           printf("segment%"Pindex_t" %.6f %.6f\n",IndexSegment(OSMSegments,segmentp),radians_to_degrees(lat),radians_to_degrees(lon));
@@ -313,7 +313,7 @@ static void output_waytype(index_t node,double latitude,double longitude)
           index_t othernode=OtherNode(segmentp,node);
           double lat,lon;
 
-          GetLatLong(OSMNodes,othernode,NULL,&lat,&lon);
+          GetLatLong(OSMNodes,othernode,&lat,&lon);
 
           if(node>othernode || (lat<LatMin || lat>LatMax || lon<LonMin || lon>LonMax))
             {
@@ -403,7 +403,7 @@ static void output_highway(index_t node,double latitude,double longitude)
           index_t othernode=OtherNode(segmentp,node);
           double lat,lon;
 
-          GetLatLong(OSMNodes,othernode,NULL,&lat,&lon);
+          GetLatLong(OSMNodes,othernode,&lat,&lon);
 
           if(node>othernode || (lat<LatMin || lat>LatMax || lon<LonMin || lon>LonMax))
              printf("segment%"Pindex_t" %.6f %.6f %.6f %.6f\n",IndexSegment(OSMSegments,segmentp),radians_to_degrees(latitude),radians_to_degrees(longitude),radians_to_degrees(lat),radians_to_degrees(lon));
@@ -488,7 +488,7 @@ static void output_transport(index_t node,double latitude,double longitude)
           index_t othernode=OtherNode(segmentp,node);
           double lat,lon;
 
-          GetLatLong(OSMNodes,othernode,NULL,&lat,&lon);
+          GetLatLong(OSMNodes,othernode,&lat,&lon);
 
           if(node>othernode || (lat<LatMin || lat>LatMax || lon<LonMin || lon>LonMax))
              printf("segment%"Pindex_t" %.6f %.6f %.6f %.6f\n",IndexSegment(OSMSegments,segmentp),radians_to_degrees(latitude),radians_to_degrees(longitude),radians_to_degrees(lat),radians_to_degrees(lon));
@@ -639,8 +639,8 @@ static void output_turnrestriction(index_t node,double latitude,double longitude
     from_node=OtherNode(from_segmentp,node);
     to_node  =OtherNode(to_segmentp  ,node);
 
-    GetLatLong(OSMNodes,from_node,NULL,&from_lat,&from_lon);
-    GetLatLong(OSMNodes,to_node  ,NULL,&to_lat  ,&to_lon);
+    GetLatLong(OSMNodes,from_node,&from_lat,&from_lon);
+    GetLatLong(OSMNodes,to_node  ,&to_lat  ,&to_lon);
 
     printf("turn-relation%"Pindex_t" %.6f %.6f %.6f %.6f %.6f %.6f\n",
            turnrelation,
@@ -942,7 +942,7 @@ static void output_limits(index_t node,double latitude,double longitude)
       {
        double lat,lon;
 
-       GetLatLong(OSMNodes,OtherNode(&segmentps[i],node),NULL,&lat,&lon);
+       GetLatLong(OSMNodes,OtherNode(&segmentps[i],node),&lat,&lon);
 
        switch(limit_type)
          {
@@ -1039,7 +1039,7 @@ static void output_property(index_t node,double latitude,double longitude)
           index_t othernode=OtherNode(segmentp,node);
           double lat,lon;
 
-          GetLatLong(OSMNodes,othernode,NULL,&lat,&lon);
+          GetLatLong(OSMNodes,othernode,&lat,&lon);
 
           if(node>othernode || (lat<LatMin || lat>LatMax || lon<LonMin || lon>LonMax))
              printf("segment%"Pindex_t" %.6f %.6f %.6f %.6f\n",IndexSegment(OSMSegments,segmentp),radians_to_degrees(latitude),radians_to_degrees(longitude),radians_to_degrees(lat),radians_to_degrees(lon));
@@ -1082,18 +1082,18 @@ static void find_all_nodes(Nodes *nodes,callback_t callback)
       {
        ll_bin2_t llbin=lonb*nodes->file.latbins+latb;
 
-       if(llbin<0 || llbin>(nodes->file.latbins*nodes->file.lonbins))
+       if(llbin<0 || llbin>=(nodes->file.latbins*nodes->file.lonbins))
           continue;
 
        index1=LookupNodeOffset(nodes,llbin);
-       index2=LookupNodeOffset(nodes,llbin+1);
+       index2=LookupNodeOffsetEnd(nodes,llbin);
 
        for(i=index1;i<index2;i++)
          {
-          Node *nodep=LookupNode(nodes,i,1);
+          NodePosition *positionp=LookupNodePosition(nodes,i,2);
 
-          double lat=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(nodep->latoffset));
-          double lon=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(nodep->lonoffset));
+          double lat=latlong_to_radians(bin_to_latlong(nodes->file.latzero+latb)+off_to_latlong(positionp->latoffset));
+          double lon=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonb)+off_to_latlong(positionp->lonoffset));
 
           if(lat>LatMin && lat<LatMax && lon>LonMin && lon<LonMax)
              (*callback)(i,lat,lon);
@@ -33,17 +33,26 @@
   Ways *LoadWayList Returns the way list.
 
   const char *filename The name of the file to load.
+
+  int mapoptions The options for loading the file into memory (MAP_OPTION_* values ORed together).
+
+  size_t cachesize The amount of memory to use for all of the caches of the database in slim mode (or 0 for the default sizes).
   ++++++++++++++++++++++++++++++++++++++*/
 
-Ways *LoadWayList(const char *filename)
+Ways *LoadWayList(const char *filename,int mapoptions,size_t cachesize)
 {
  Ways *ways;
 
+ /* Check that the file was written by this version of planetsplitter */
+
+ if(CheckFileHeader(filename,WAYS_MAGIC))
+    return(NULL);
+
  ways=(Ways*)malloc(sizeof(Ways));
 
 #if !SLIM
 
- ways->data=MapFile(filename);
+ ways->data=MapFileWithOptions(filename,mapoptions);
 
  /* Copy the WaysFile structure from the loaded data */
 
@@ -56,7 +65,7 @@ Ways *LoadWayList(const char *filename)
 
 #else
 
- ways->fd=SlimMapFile(filename);
+ ways->fd=SlimMapFileWithOptions(filename,mapoptions);
 
  /* Copy the WaysFile header structure from the loaded data */
 
@@ -66,9 +75,9 @@ Ways *LoadWayList(const char *filename)
 
  memset(ways->ncached,0,sizeof(ways->ncached));
 
- ways->cache=NewWayCache();
+ ways->cache=NewWayCache(CacheShare(cachesize,20),option_cache_block);
 #ifndef LIBROUTINO
- log_malloc(ways->cache,sizeof(*ways->cache));
+ log_malloc(ways->cache,ways->cache->stats.size);
 #endif
 
 #endif
@@ -146,3 +155,94 @@ int WaysCompare(Way *way1p,Way *way2p)
 
  return(0);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compare two ways ignoring the types of transport that are not selected.
+
+  int WaysCompareTransports Returns 0 if the two ways are the same for the selected types of transport,
+                            otherwise positive or negative to allow sorting.
+
+  Way *way1p The first way.
+
+  Way *way2p The second way.
+
+  transports_t transports The types of transport to consider.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int WaysCompareTransports(Way *way1p,Way *way2p,transports_t transports)
+{
+ Way way1,way2;
+
+ if(transports==Transports_ALL)
+    return(WaysCompare(way1p,way2p));
+
+ way1=*way1p;
+ way2=*way2p;
+
+ way1.allow&=transports;
+ way2.allow&=transports;
+
+ return(WaysCompare(&way1,&way2));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the cost of travel along each of the ways for a profile so that the routing does
+  not need to look up the way and apply the profile to it for every segment.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  WayCost *waycosts Returns the cost of travel along each way (an array with one element per way).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CalculateWayCosts(Ways *ways,Profile *profile,WayCost *waycosts)
+{
+ index_t w;
+
+ for(w=0;w<ways->file.number;w++)
+   {
+    Way *wayp=LookupWay(ways,w,1);
+    WayCost *waycost=&waycosts[w];
+    speed_t speed=profile->speed[HIGHWAY(wayp->type)];
+    int i;
+
+    /* highway preferences */
+    waycost->pref=profile->highway[HIGHWAY(wayp->type)];
+
+    /* mode of transport must be allowed on the highway */
+    if(!(wayp->allow&profile->allow))
+       waycost->pref=0;
+
+    /* must obey weight restriction (if exists) */
+    if(wayp->weight && wayp->weight<profile->weight)
+       waycost->pref=0;
+
+    /* must obey height/width/length restriction (if exist) */
+    if((wayp->height && wayp->height<profile->height) ||
+       (wayp->width  && wayp->width <profile->width ) ||
+       (wayp->length && wayp->length<profile->length))
+       waycost->pref=0;
+
+    /* property preferences */
+    for(i=1;i<Property_Count;i++)
+       if(ways->file.props & PROPERTIES(i))
+         {
+          if(wayp->props & PROPERTIES(i))
+             waycost->pref*=profile->props_yes[i];
+          else
+             waycost->pref*=profile->props_no[i];
+         }
+
+    /* the lower of the two speeds that are set (see the Duration() function) */
+    if(wayp->speed && (speed==0 || wayp->speed<speed))
+       speed=wayp->speed;
+
+    waycost->speed=speed;
+
+    /* bicycles can go both ways on some one-way highways */
+    waycost->bothways=(profile->allow==Transports_Bicycle && (wayp->type&Highway_CycleBothWays));
+   }
+}
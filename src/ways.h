@@ -30,6 +30,7 @@
 
 #include "cache.h"
 #include "files.h"
+#include "profiles.h"
 
 
 /* Data structures */
@@ -58,11 +59,16 @@ struct _Way
 /*+ A structure containing the header from the file. +*/
 typedef struct _WaysFile
 {
+ uint32_t     magic;            /*+ The magic number that identifies the type of file. +*/
+ uint32_t     version;          /*+ The version of the file format. +*/
+
  index_t      number;           /*+ The number of ways. +*/
 
  highways_t   highways;         /*+ The types of highways that were seen when parsing. +*/
  transports_t allow;            /*+ The types of traffic that were seen when parsing. +*/
  properties_t props;            /*+ The properties that were seen when parsing. +*/
+
+ uint32_t     checksum;         /*+ The checksum of the ways and their names (must match the one in the nodes file). +*/
 }
  WaysFile;
 
@@ -96,12 +102,16 @@ struct _Ways
 
 /* Functions in ways.c */
 
-Ways *LoadWayList(const char *filename);
+Ways *LoadWayList(const char *filename,int mapoptions,size_t cachesize);
 
 void DestroyWayList(Ways *ways);
 
 int WaysCompare(Way *way1p,Way *way2p);
 
+int WaysCompareTransports(Way *way1p,Way *way2p,transports_t transports);
+
+void CalculateWayCosts(Ways *ways,Profile *profile,WayCost *waycosts);
+
 
 /* Macros and inline functions */
 
@@ -122,6 +132,7 @@ static inline char *WayName(Ways *ways,Way *wayp);
 CACHE_NEWCACHE_PROTO(Way)
 CACHE_DELETECACHE_PROTO(Way)
 CACHE_FETCHCACHE_PROTO(Way)
+CACHE_CHOOSEVICTIM_PROTO(Way)
 CACHE_INVALIDATECACHE_PROTO(Way)
 
 /* Data type */
@@ -133,6 +144,7 @@ CACHE_STRUCTURE(Way)
 CACHE_NEWCACHE(Way)
 CACHE_DELETECACHE(Way)
 CACHE_FETCHCACHE(Way)
+CACHE_CHOOSEVICTIM(Way)
 CACHE_INVALIDATECACHE(Way)
 
 
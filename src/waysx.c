@@ -111,8 +111,8 @@ WaysX *NewWayList(int append,int readonly)
     waysx->fd=-1;
 
 #if SLIM
- waysx->cache=NewWayXCache();
- log_malloc(waysx->cache,sizeof(*waysx->cache));
+ waysx->cache=NewWayXCache(0,0);
+ log_malloc(waysx->cache,waysx->cache->stats.size);
 #endif
 
 
@@ -807,6 +807,71 @@ static int deduplicate_and_index_by_compact_id(WayX *wayx,index_t index)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate a checksum of the ways and their names as they will be saved so that the nodes file can be matched to
+  the ways file (a specialised super-graph is saved without a ways file of its own).
+
+  WaysX *waysx The set of ways to check.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void ChecksumWayList(WaysX *waysx)
+{
+ index_t i;
+ index_t position=0;
+ WayX wayx;
+ uint32_t checksum=2166136261U;
+
+ /* Re-open the files */
+
+ waysx->fd=ReOpenFileBuffered(waysx->filename_tmp);
+ waysx->nfd=ReOpenFileBuffered(waysx->nfilename_tmp);
+
+ /* Add in the ways data (field by field to ignore any padding) */
+
+ checksum=(checksum^waysx->number)*16777619U;
+
+ for(i=0;i<waysx->number;i++)
+   {
+    ReadFileBuffered(waysx->fd,&wayx,sizeof(WayX));
+
+    checksum=(checksum^wayx.way.name  )*16777619U;
+    checksum=(checksum^wayx.way.allow )*16777619U;
+    checksum=(checksum^wayx.way.type  )*16777619U;
+    checksum=(checksum^wayx.way.props )*16777619U;
+    checksum=(checksum^wayx.way.speed )*16777619U;
+    checksum=(checksum^wayx.way.weight)*16777619U;
+    checksum=(checksum^wayx.way.height)*16777619U;
+    checksum=(checksum^wayx.way.width )*16777619U;
+    checksum=(checksum^wayx.way.length)*16777619U;
+   }
+
+ /* Add in the ways names */
+
+ while(position<waysx->nlength)
+   {
+    size_t j,len=1024;
+    unsigned char temp[1024];
+
+    if((waysx->nlength-position)<1024)
+       len=waysx->nlength-position;
+
+    ReadFileBuffered(waysx->nfd,temp,len);
+
+    for(j=0;j<len;j++)
+       checksum=(checksum^temp[j])*16777619U;
+
+    position+=len;
+   }
+
+ /* Close the files */
+
+ waysx->fd=CloseFileBuffered(waysx->fd);
+ waysx->nfd=CloseFileBuffered(waysx->nfd);
+
+ waysx->checksum=checksum;
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Save the way list to a file.
 
@@ -881,12 +946,17 @@ void SaveWayList(WaysX *waysx,const char *filename)
 
  /* Write out the header structure */
 
+ waysfile.magic=WAYS_MAGIC;
+ waysfile.version=DATABASE_VERSION;
+
  waysfile.number =waysx->number;
 
  waysfile.highways=highways;
  waysfile.allow   =allow;
  waysfile.props   =props;
 
+ waysfile.checksum=waysx->checksum;
+
  SeekFileBuffered(fd,0);
  WriteFileBuffered(fd,&waysfile,sizeof(WaysFile));
 
@@ -82,6 +82,8 @@ struct _WaysX
  int       nfd;                 /*+ The file descriptor of the temporary file (for the WaysX names). +*/
 
  uint32_t  nlength;             /*+ The length of the string of name entries. +*/
+
+ uint32_t  checksum;            /*+ The checksum of the ways and their names (calculated by ChecksumWayList()). +*/
 };
 
 
@@ -104,6 +106,8 @@ void SortWayNames(WaysX *waysx);
 
 void CompactWayList(WaysX *waysx,SegmentsX *segmentsx);
 
+void ChecksumWayList(WaysX *waysx);
+
 void SaveWayList(WaysX *waysx,const char *filename);
 
 
@@ -126,6 +130,7 @@ static inline void PutBackWayX(WaysX *waysx,WayX *wayx);
 CACHE_NEWCACHE_PROTO(WayX)
 CACHE_DELETECACHE_PROTO(WayX)
 CACHE_FETCHCACHE_PROTO(WayX)
+CACHE_CHOOSEVICTIM_PROTO(WayX)
 CACHE_REPLACECACHE_PROTO(WayX)
 CACHE_INVALIDATECACHE_PROTO(WayX)
 
@@ -138,6 +143,7 @@ CACHE_STRUCTURE(WayX)
 CACHE_NEWCACHE(WayX)
 CACHE_DELETECACHE(WayX)
 CACHE_FETCHCACHE(WayX)
+CACHE_CHOOSEVICTIM(WayX)
 CACHE_REPLACECACHE(WayX)
 CACHE_INVALIDATECACHE(WayX)
 
@@ -1366,9 +1366,27 @@ char *ParseXML_Decode_Char_Ref(const char *string)
   ++++++++++++++++++++++++++++++++++++++*/
 
 char *ParseXML_Encode_Safe_XML(const char *string)
+{
+ static char *result=NULL;      /* static allocation of return value */
+
+ return(ParseXML_Encode_Safe_XML_Buffer(string,&result));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Convert a string into something that is safe to output in an XML file.
+
+  char *ParseXML_Encode_Safe_XML_Buffer Returns a pointer to the replacement encoded string (or the original if no change needed).
+
+  const char *string The string to convert.
+
+  char **buffer A pointer to a buffer (allocated or NULL) that will be reallocated to hold the replacement string.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+char *ParseXML_Encode_Safe_XML_Buffer(const char *string,char **buffer)
 {
  static const char hexstring[17]="0123456789ABCDEF"; /* local lookup table */
- static char *result=NULL;                           /* static allocation of return value */
+ char *result=*buffer;
  int i=0,j=0,len;
 
  for(i=0;string[i];i++)
@@ -1381,6 +1399,7 @@ char *ParseXML_Encode_Safe_XML(const char *string)
  len=i+256-6;
 
  result=(char*)realloc((void*)result,len+7);
+ *buffer=result;
  strncpy(result,string,j=i);
 
  do
@@ -1489,6 +1508,7 @@ char *ParseXML_Encode_Safe_XML(const char *string)
       {
        len+=256;
        result=(char*)realloc((void*)result,len+7);
+       *buffer=result;
       }
    }
  while(string[i]);
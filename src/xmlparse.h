@@ -79,6 +79,7 @@ char *ParseXML_GetError(void);
 char *ParseXML_Decode_Entity_Ref(const char *string);
 char *ParseXML_Decode_Char_Ref(const char *string);
 char *ParseXML_Encode_Safe_XML(const char *string);
+char *ParseXML_Encode_Safe_XML_Buffer(const char *string,char **buffer);
 
 int ParseXML_IsInteger(const char *string);
 int ParseXML_IsFloating(const char *string);